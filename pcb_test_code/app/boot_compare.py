@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+"""Compare boot phase timestamps (max77654_boot.h) of two runs and check them against a budget.
+
+Takes the CSV of pmic_ctrl.py boot or the 'b' command of test_max77654 (boot,phase,arg,time_us)
+and uses the newest boot of each file unless --boot says otherwise. Prints every phase with its
+time since reset in both runs and the difference, and exits with 1 if the candidate reaches the
+--phase (rails up by default) later than --budget-us.
+
+    python3 pmic_ctrl.py /dev/ttyACM1 boot > after.csv
+    python3 boot_compare.py before.csv after.csv --budget-us 5000
+    python3 boot_compare.py after.csv --budget-us 150000 --phase usb_host
+"""
+import argparse
+import csv
+import sys
+
+PHASES = ["main", "stdio", "store", "i2c_init", "on_bus", "ercflag", "reg_write", "rails_up", "usb_init", "usb_host",
+          "done", "error"]
+PHASE_APP = 0x80
+ARG_PHASES = {"reg_write": "0x%02x", "error": "%d"}  # arg tells the marks apart
+
+
+def phase_name(phase, arg):
+    if phase >= PHASE_APP:
+        return "app%d" % (phase - PHASE_APP)
+    name = PHASES[phase] if phase < len(PHASES) else "phase%d" % phase
+    if name in ARG_PHASES:
+        name += " " + ARG_PHASES[name] % arg
+    return name
+
+
+def load(path, boot):
+    """[(name, time_us)] of one boot, a name seen twice gets #2, #3, ..."""
+    runs = {}
+    with open(path) as f:
+        for row in csv.DictReader(line for line in f if not line.startswith("#")):
+            runs.setdefault(int(row["boot"]), []).append((int(row["phase"]), int(row["arg"]), int(row["time_us"])))
+    if not runs:
+        sys.exit("%s: no boot records" % path)
+    marks = runs[boot if boot is not None else max(runs)]
+    seen, out = {}, []
+    for phase, arg, t in marks:
+        name = phase_name(phase, arg)
+        seen[name] = seen.get(name, 0) + 1
+        out.append((name if seen[name] == 1 else "%s #%d" % (name, seen[name]), t))
+    return out
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("runs", nargs="+", help="baseline.csv [candidate.csv], one file only checks the budget")
+    parser.add_argument("--boot", type=int, help="boot number to use instead of the newest one")
+    parser.add_argument("--budget-us", type=int, help="latest time since reset for --phase")
+    parser.add_argument("--phase", default="rails_up", help="phase the budget applies to")
+    a = parser.parse_args()
+
+    runs = [load(path, a.boot) for path in a.runs[:2]]
+    base = dict(runs[0])
+    cand = dict(runs[-1])
+    names = [n for n, _ in runs[-1]] + [n for n, _ in runs[0] if n not in cand]
+
+    if len(runs) == 1:
+        print("%-20s %10s %10s" % ("phase", "us", "step us"))
+        prev = 0
+        for name, t in runs[0]:
+            print("%-20s %10d %10d" % (name, t, t - prev))
+            prev = t
+    else:
+        print("%-20s %10s %10s %10s" % ("phase", "baseline", "candidate", "delta"))
+        for name in names:
+            b, c = base.get(name), cand.get(name)
+            delta = "%+10d" % (c - b) if b is not None and c is not None else "%10s" % "-"
+            print("%-20s %10s %10s %s" % (name, b if b is not None else "-", c if c is not None else "-", delta))
+
+    if a.budget_us is None:
+        return 0
+    t = cand.get(a.phase)
+    if t is None:
+        print("# %s not reached" % a.phase, file=sys.stderr)
+        return 1
+    ok = t <= a.budget_us
+    print("# %s at %d us, budget %d us: %s" % (a.phase, t, a.budget_us, "ok" if ok else "OVER"), file=sys.stderr)
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
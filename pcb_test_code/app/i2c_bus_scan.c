@@ -4,8 +4,11 @@
  * SPDX-License-Identifier: BSD-3-Clause
  */
 
-// Sweep through all 7-bit I2C addresses, to see if any slaves are present on
-// the I2C bus. Print out a table that looks like this:
+// Sweep through the 7-bit I2C addresses, to see if any slaves are present on
+// the I2C bus, see i2c_scan.h. Commands are lines on cdc0 (stdio):
+//
+//   t                                    print a table that looks like this:
+//   scan [hz=N] [timeout=US] [id] [reserved] [csv|bin]
 //
 // I2C Bus Scan
 //   0  1  2  3  4  5  6  7  8  9  A  B  C  D  E  F
@@ -17,6 +20,9 @@
 // 5
 // 6
 // 7
+//
+// scan prints CSV on cdc0 (default) or sends one binary record (I2C_SCAN_BIN_*) on cdc1,
+// e.g. "scan hz=1000000 id bin" for manufacturing test.
 
 // ================
 // Wiring, using I2C1
@@ -26,15 +32,93 @@
 // 27    ->  SCL
 // 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "pico/stdlib.h"
 #include "hardware/i2c.h"
+#include "usb_dual_cdc.h"
+#include "usb_stdio_cdc.h"
+#include "i2c_scan.h"
+
+#define CDC_BIN_ITF 1 // take 1 since 0 is used for stdio
+
+static i2c_scan_result_t result;
+
+static void print_table(void)
+{
+    printf("\nI2C Bus Scan\n");
+    printf("   0  1  2  3  4  5  6  7  8  9  A  B  C  D  E  F\n");
+
+    for (int addr = 0; addr < (1 << 7); ++addr) {
+        if (addr % 16 == 0) {
+            printf("%02x ", addr);
+        }
+
+        printf(i2c_scan_bit(result.found, addr) ? "@" : i2c_scan_bit(result.timed_out, addr) ? "?" : ".");
+        printf(addr % 16 == 15 ? "\n" : "  ");
+    }
+    printf("Done.\n");
+}
+
+static void run_command(char *line)
+{
+    i2c_scan_config_t cfg = { .baudrate = 400 * 1000 };
+    bool binary = false;
+    char *arg = strtok(line, " ");
+
+    if (arg == NULL)
+        return;
+
+    if (strcmp(arg, "t") == 0)
+    {
+        i2c_scan(i2c1, &cfg, &result);
+        print_table();
+        return;
+    }
+    if (strcmp(arg, "scan") != 0)
+    {
+        printf("unknown command '%s'\n", arg);
+        return;
+    }
+
+    while ((arg = strtok(NULL, " ")) != NULL)
+    {
+        if (strncmp(arg, "hz=", 3) == 0)
+            cfg.baudrate = strtoul(&arg[3], NULL, 0);
+        else if (strncmp(arg, "timeout=", 8) == 0)
+            cfg.timeout_us = strtoul(&arg[8], NULL, 0);
+        else if (strcmp(arg, "id") == 0)
+            cfg.identify = true;
+        else if (strcmp(arg, "reserved") == 0)
+            cfg.include_reserved = true;
+        else if (strcmp(arg, "bin") == 0)
+            binary = true;
+        else if (strcmp(arg, "csv") != 0)
+            printf("ignoring '%s'\n", arg);
+    }
+
+    i2c_scan(i2c1, &cfg, &result);
+    if (binary)
+    {
+        uint8_t record[I2C_SCAN_BIN_MAX];
+        cdc_write_buf(CDC_BIN_ITF, record, i2c_scan_format_binary(&result, record));
+    }
+    else
+    {
+        static char csv[128 * 20 + 80];
+        i2c_scan_format_csv(&result, csv, sizeof(csv));
+        fputs(csv, stdout);
+    }
+}
 
 int main() {
-    // Enable UART so we can print status output
-    stdio_init_all();
+    char line[80];
+    int len = 0;
+
+    cdc_init();
+    usb_stdio_cdc_init();
+    cdc_set_overflow_policy(CDC_BIN_ITF, CDC_OVERFLOW_BLOCK, 100000);
 
-    // This example will use I2C0 on the default SDA and SCL pins (0, 1 on a Pico)
-    i2c_init(i2c1, 1 * 100);
     gpio_set_function(26, GPIO_FUNC_I2C);
     gpio_set_function(27, GPIO_FUNC_I2C);
     gpio_pull_up(26);
@@ -42,30 +126,21 @@ int main() {
 
     while (1)
     {
-        char c = getchar_timeout_us(10000);
-        if (c == 't')
+        cdc_task();
+
+        int c = getchar_timeout_us(0);
+        if (c == PICO_ERROR_TIMEOUT)
+            continue;
+
+        if (c == '\r' || c == '\n')
+        {
+            line[len] = '\0';
+            run_command(line);
+            len = 0;
+        }
+        else if (len < (int)sizeof(line) - 1)
         {
-            printf("\nI2C Bus Scan\n");
-            printf("   0  1  2  3  4  5  6  7  8  9  A  B  C  D  E  F\n");
-
-            for (int addr = 0; addr < (1 << 7); ++addr) {
-                if (addr % 16 == 0) {
-                    printf("%02x ", addr);
-                }
-
-                // Perform a 1-byte dummy read from the probe address. If a slave
-                // acknowledges this address, the function returns the number of bytes
-                // transferred. If the address byte is ignored, the function returns
-                // -1.
-
-                int ret;
-                uint8_t rxdata;
-                ret = i2c_read_blocking(i2c1, addr, &rxdata, 1, false);
-
-                printf(ret < 0 ? "." : "@");
-                printf(addr % 16 == 15 ? "\n" : "  ");
-            }
-            printf("Done.\n");
+            line[len++] = c;
         }
     }
-}
\ No newline at end of file
+}
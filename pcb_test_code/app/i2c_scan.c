@@ -0,0 +1,124 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "i2c_scan.h"
+
+#define DEFAULT_BAUDRATE (100 * 1000)
+
+static void set_bit(uint8_t *map, uint8_t addr)
+{
+    map[addr >> 3] |= 1u << (addr & 7);
+}
+
+// the I2C specification keeps 0000xxx and 1111xxx for special purposes
+static bool reserved_addr(uint8_t addr)
+{
+    return (addr & 0x78) == 0 || (addr & 0x78) == 0x78;
+}
+
+int i2c_scan(i2c_inst_t *i2c, const i2c_scan_config_t *cfg, i2c_scan_result_t *res)
+{
+    uint32_t baudrate = cfg->baudrate ? MIN(cfg->baudrate, I2C_SCAN_MAX_BAUDRATE) : DEFAULT_BAUDRATE;
+    uint32_t timeout_us = cfg->timeout_us ? cfg->timeout_us : I2C_SCAN_DEFAULT_TIMEOUT_US(baudrate);
+    int timeouts_in_row = 0;
+
+    memset(res, 0, sizeof(*res));
+    res->baudrate = i2c_init(i2c, baudrate);
+
+    uint64_t start = time_us_64();
+    for (uint8_t addr = 0; addr < 128; addr++)
+    {
+        if (reserved_addr(addr) && !cfg->include_reserved)
+            continue;
+
+        uint8_t data;
+        int ret = i2c_read_timeout_us(i2c, addr, &data, 1, false, timeout_us);
+        res->probes++;
+
+        if (ret == PICO_ERROR_TIMEOUT)
+        {
+            set_bit(res->timed_out, addr);
+            if (++timeouts_in_row >= I2C_SCAN_MAX_TIMEOUTS)
+            {
+                res->bus_stuck = true;
+                break;
+            }
+            continue;
+        }
+        timeouts_in_row = 0;
+        if (ret < 0)
+            continue;
+
+        set_bit(res->found, addr);
+        res->count++;
+
+        // register address, repeated start, one byte
+        uint8_t reg = 0;
+        if (cfg->identify
+            && i2c_write_timeout_us(i2c, addr, &reg, 1, true, timeout_us) == 1
+            && i2c_read_timeout_us(i2c, addr, &res->id[addr], 1, false, timeout_us) == 1)
+            set_bit(res->id_valid, addr);
+    }
+    res->elapsed_us = (uint32_t)(time_us_64() - start);
+
+    return res->count;
+}
+
+// snprintf that keeps appending at *len and stops at the end of buf
+static void append(char *buf, size_t size, size_t *len, const char *fmt, ...)
+{
+    va_list args;
+
+    va_start(args, fmt);
+    int n = vsnprintf(&buf[*len], size - *len, fmt, args);
+    va_end(args);
+    if (n > 0)
+        *len = MIN(*len + n, size - 1);
+}
+
+size_t i2c_scan_format_csv(const i2c_scan_result_t *res, char *buf, size_t size)
+{
+    size_t len = 0;
+
+    append(buf, size, &len, "addr,status,reg0\n");
+    for (int addr = 0; addr < 128; addr++)
+    {
+        if (i2c_scan_bit(res->id_valid, addr))
+            append(buf, size, &len, "0x%02x,ack,0x%02x\n", addr, res->id[addr]);
+        else if (i2c_scan_bit(res->found, addr))
+            append(buf, size, &len, "0x%02x,ack,\n", addr);
+        else if (i2c_scan_bit(res->timed_out, addr))
+            append(buf, size, &len, "0x%02x,timeout,\n", addr);
+    }
+    append(buf, size, &len, "# %u devices, %u probes in %u us at %u Hz%s\n", res->count, res->probes,
+           (unsigned)res->elapsed_us, (unsigned)res->baudrate, res->bus_stuck ? ", bus stuck" : "");
+
+    return len;
+}
+
+size_t i2c_scan_format_binary(const i2c_scan_result_t *res, uint8_t *buf)
+{
+    uint32_t khz = res->baudrate / 1000;
+    bool identified = false;
+    size_t len = I2C_SCAN_BIN_HEADER;
+
+    for (int addr = 0; addr < 128; addr++)
+    {
+        if (!i2c_scan_bit(res->found, addr))
+            continue;
+        bool id = i2c_scan_bit(res->id_valid, addr);
+        identified |= id;
+        buf[len++] = addr | (id ? 0x80 : 0);
+        buf[len++] = id ? res->id[addr] : 0;
+    }
+
+    buf[0] = I2C_SCAN_BIN_MAGIC;
+    buf[1] = (identified ? 0x01 : 0) | (res->bus_stuck ? 0x02 : 0);
+    buf[2] = res->count;
+    buf[3] = khz;
+    buf[4] = khz >> 8;
+    for (int i = 0; i < 4; i++)
+        buf[5 + i] = res->elapsed_us >> (8 * i);
+
+    return len;
+}
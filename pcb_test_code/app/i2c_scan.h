@@ -0,0 +1,54 @@
+#ifndef __I2C__SCAN__H__
+
+#define __I2C__SCAN__H__
+
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+
+// I2C bus scanner for manufacturing test. Every address gets one 1-byte read with its own timeout,
+// the reserved ranges 0x00..0x07 and 0x78..0x7F are skipped unless asked for, and devices that ACK
+// can be identified by reading their register 0. A bus that times out several probes in a row
+// (SDA or SCL held low) ends the scan early instead of spending the timeout on every address.
+
+#define I2C_SCAN_MAX_BAUDRATE (1000 * 1000) // Fast-mode Plus
+#define I2C_SCAN_MAX_TIMEOUTS 3 // consecutive timed out probes before the bus counts as stuck
+
+// probe timeout when none is given: three times the bus time of address + data byte, plus 100us of clock stretching
+#define I2C_SCAN_DEFAULT_TIMEOUT_US(baudrate) (3 * 2 * 9 * 1000000u / (baudrate) + 100)
+
+typedef struct {
+    uint32_t baudrate;     // Hz, 0 = 100kHz, at most I2C_SCAN_MAX_BAUDRATE
+    uint32_t timeout_us;   // per probe, 0 = I2C_SCAN_DEFAULT_TIMEOUT_US
+    bool include_reserved; // also probe 0x00..0x07 and 0x78..0x7F
+    bool identify;         // read register 0 of every device that ACKs, mind clear-on-read registers (MAX77654 INT_GLBL0)
+} i2c_scan_config_t;
+
+typedef struct {
+    uint8_t found[16];     // one bit per address, ACKed
+    uint8_t timed_out[16]; // one bit per address, the probe did not finish
+    uint8_t id_valid[16];  // one bit per address, id[] holds its register 0
+    uint8_t id[128];
+    uint32_t baudrate;     // actually set, the controller rounds
+    uint32_t elapsed_us;
+    uint8_t probes;
+    uint8_t count;         // addresses that ACKed
+    bool bus_stuck;        // ended after I2C_SCAN_MAX_TIMEOUTS timeouts in a row
+} i2c_scan_result_t;
+
+// Binary result: 'I', flags, count, baudrate / 1000 (u16), elapsed_us (u32), then addr, reg0 per device.
+// flags: bit 0 register 0 was read, bit 1 bus stuck. addr has bit 7 set when its reg0 is valid.
+#define I2C_SCAN_BIN_MAGIC 'I'
+#define I2C_SCAN_BIN_HEADER 9
+#define I2C_SCAN_BIN_MAX (I2C_SCAN_BIN_HEADER + 2 * 128)
+
+// initialises the bus at cfg->baudrate (pins are up to the caller) and probes it, returns the number of devices
+int i2c_scan(i2c_inst_t *i2c, const i2c_scan_config_t *cfg, i2c_scan_result_t *res);
+
+static inline bool i2c_scan_bit(const uint8_t *map, uint8_t addr) { return map[addr >> 3] & (1u << (addr & 7)); }
+
+// "addr,status,reg0" rows for every device and timed out address, then a '#' summary line. Returns the length.
+size_t i2c_scan_format_csv(const i2c_scan_result_t *res, char *buf, size_t size);
+// see above, buf needs I2C_SCAN_BIN_MAX bytes at most. Returns the length.
+size_t i2c_scan_format_binary(const i2c_scan_result_t *res, uint8_t *buf);
+
+#endif
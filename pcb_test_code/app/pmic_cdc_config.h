@@ -0,0 +1,12 @@
+#ifndef __PMIC_CDC_CONFIG_H__
+
+#define __PMIC_CDC_CONFIG_H__
+
+// CDC interfaces of pmic_cdc_ctrl, see usb_cdc_config.h.
+// cdc0 is stdio: log lines out, next to nothing comes in.
+// cdc1 carries pmic_protocol: requests are short, telemetry streams need room to ride out a busy host.
+#define USB_CDC_INTERFACES(X) \
+    X(0, "PMIC log", 64, 1024) \
+    X(1, "PMIC control", 512, 4096)
+
+#endif
@@ -0,0 +1,67 @@
+// ================
+// Wiring, using I2C1
+// ================
+// PICO     PMIC
+// 26    ->  SDA 
+// 27    ->  SCL
+// 
+// Controls the MAX77654 through the binary protocol of pmic_protocol.h on cdc1,
+// cdc0 carries stdio for logging. See app/pmic_ctrl.py for the host side.
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "usb_dual_cdc.h"
+#include "usb_stdio_cdc.h"
+#include "max77654.h"
+#include "max77654_async.h"
+#include "max77654_boot.h"
+#include "max77654_store.h"
+#include "pmic_protocol.h"
+
+#define CDC_APP_ITF 1 // take 1 since 0 is used for stdio
+
+static uint32_t write_frame(const uint8_t *data, uint32_t len)
+{
+    return cdc_write_buf(CDC_APP_ITF, (uint8_t *)data, len);
+}
+
+int main() {
+    max77654_boot_begin(); // boot phase timestamps, read back with PMIC_CMD_BOOT_REPORT
+
+    // rails before USB, with the profile saved over PMIC_CMD_PROFILE_SAVE if there is one
+    int boot = max77654_store_boot(i2c1);
+
+    cdc_init();
+    usb_stdio_cdc_init();
+    max77654_boot_mark(MAX77654_BOOT_USB_INIT, 0);
+
+    if (boot < 0)
+        printf("MAX77654 is not on the bus\n");
+    i2c_set_baudrate(i2c1, 1000 * 1000); // Fast-mode Plus, kHz telemetry rates need the bus time
+
+    max77654_async_init(i2c1); // telemetry samples through the async queue
+    pmic_proto_init(write_frame);
+
+    while (1)
+    {
+        cdc_wait(100);
+
+        // parse the received frames in place
+        uint8_t *data;
+        uint32_t len;
+        cdc_peek(CDC_APP_ITF, &data, &len);
+        if (len)
+        {
+            if (max77654_boot_recording())
+            {
+                max77654_boot_mark(MAX77654_BOOT_USB_HOST, 0);
+                max77654_boot_done();
+            }
+            pmic_proto_feed(data, len);
+            cdc_consume(CDC_APP_ITF, len);
+        }
+
+        // stream the telemetry records sampled meanwhile
+        pmic_proto_poll();
+    }
+}
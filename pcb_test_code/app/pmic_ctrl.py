@@ -0,0 +1,274 @@
+#!/usr/bin/env python3
+"""Host side of the pmic_protocol.h binary protocol (pmic_cdc_ctrl firmware, cdc1).
+
+    python3 pmic_ctrl.py /dev/ttyACM1 set 0 1800      # SSB0 to 1.8 V
+    python3 pmic_ctrl.py /dev/ttyACM1 enable 3 1      # LDO0 on
+    python3 pmic_ctrl.py /dev/ttyACM1 read 0x29 6
+    python3 pmic_ctrl.py /dev/ttyACM1 bench 1000      # batched reconfigurations per second
+    python3 pmic_ctrl.py /dev/ttyACM1 telem 0x00 7 1000 5   # INT_GLBL0..STAT_GLBL at 1 kHz for 5 s, CSV
+    python3 pmic_ctrl.py /dev/ttyACM1 log 10 --table build/pmic_cdc_ctrl.logfmt  # driver log for 10 s
+    python3 pmic_ctrl.py /dev/ttyACM1 trace 0x29 0x2B   # I2C latency per operation and for the given registers
+    python3 pmic_ctrl.py /dev/ttyACM1 profile-save 1800 3300 0 1200 900   # rails at every boot, 0 = off
+    python3 pmic_ctrl.py /dev/ttyACM1 profile          # the profile stored in flash
+    python3 pmic_ctrl.py /dev/ttyACM1 boot > run.csv   # boot phase timestamps, see boot_compare.py
+
+Rails: 0..2 = SSB0..SSB2, 3..4 = LDO0..LDO1.
+"""
+import argparse
+import re
+import struct
+import sys
+import time
+
+import serial  # pyserial
+
+(CMD_PING, CMD_SET_VOLTAGE, CMD_ENABLE, CMD_LDO_MODE, CMD_READ_REGS, CMD_WRITE_REGS, CMD_BATCH,
+ CMD_TELEM_ADD, CMD_TELEM_REMOVE, CMD_TELEM_COUNTERS, CMD_TRACE, CMD_TRACE_RESET,
+ CMD_PROFILE_GET, CMD_PROFILE_SAVE, CMD_PROFILE_CLEAR, CMD_BOOT_REPORT) = range(16)
+BOOT_RUNS = 4  # MAX77654_BOOT_RUNS
+TRACE_OPS = ["write", "read", "async write", "async read", "probe"]
+STATUS = {0: "ok", 1: "unknown command", 2: "bad arguments", 3: "bus error", 4: "flash error"}
+STATUS_TELEMETRY = 0x80
+STATUS_LOG = 0x81
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) & 0xFFFF if crc & 0x8000 else (crc << 1) & 0xFFFF
+    return crc
+
+
+def cobs_encode(data):
+    out, block = bytearray(), bytearray()
+    for b in data:
+        if b == 0:
+            out += bytes([len(block) + 1]) + block
+            block = bytearray()
+        else:
+            block.append(b)
+            if len(block) == 254:
+                out += b"\xff" + block
+                block = bytearray()
+    out += bytes([len(block) + 1]) + block
+    return bytes(out) + b"\x00"
+
+
+def cobs_decode(data):
+    out, i = bytearray(), 0
+    while i < len(data):
+        code = data[i]
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+class Pmic:
+    def __init__(self, port):
+        self.port = serial.Serial(port, timeout=1)
+        self.next_id = 0
+
+    def frame(self, cmd, args=b""):
+        self.next_id = self.next_id % 255 + 1  # id 0 is telemetry
+        payload = bytes([self.next_id, cmd]) + bytes(args)
+        return self.next_id, cobs_encode(payload + struct.pack("<H", crc16(payload)))
+
+    def send(self, frames):
+        """Write all frames in one go (pipelined), then collect one response per frame."""
+        self.port.write(b"".join(f for _, f in frames))
+        results = []
+        for req_id, _ in frames:
+            while True:
+                resp = self.receive()
+                if resp is None:
+                    raise TimeoutError("no response to request %d" % req_id)
+                if resp[0] != 0:  # skip telemetry records
+                    break
+            if resp[0] != req_id:
+                raise IOError("bad response to request %d" % req_id)
+            results.append((resp[1], resp[2:]))
+        return results
+
+    def receive(self):
+        """Next frame with a good CRC, CRC stripped, None on timeout."""
+        while True:
+            raw = self.port.read_until(b"\x00")
+            if not raw.endswith(b"\x00"):
+                return None
+            resp = cobs_decode(raw[:-1])
+            if len(resp) >= 4 and crc16(resp[:-2]) == struct.unpack("<H", resp[-2:])[0]:
+                return resp[:-2]
+
+    def call(self, cmd, args=b""):
+        status, data = self.send([self.frame(cmd, args)])[0]
+        if status:
+            raise IOError(STATUS.get(status, status))
+        return data
+
+
+class LogDecoder:
+    """Rebuilds MAX77654_LOG() lines from the record batches and the format table dumped at build time."""
+    CONVERSION = re.compile(r"%[-+ #0]*\d*(?:\.\d+)?[hlzjt]*([diouxXc%])")
+
+    def __init__(self, table_path):
+        with open(table_path, "rb") as f:
+            self.table = f.read()
+        self.next_seq = None
+        self.dropped = 0
+
+    def format(self, fmt_id, args):
+        end = self.table.find(b"\x00", fmt_id)
+        if fmt_id >= len(self.table) or end < 0:
+            return "<unknown format %d> %s" % (fmt_id, " ".join("0x%x" % a for a in args))
+        fmt = self.table[fmt_id:end].decode(errors="replace")
+        fmt = re.sub(r"^\[[^\]]*/", "[", fmt)  # file name without the build directory
+        values = []
+        for m in self.CONVERSION.finditer(fmt):
+            if m.group(1) == "%" or not args:
+                continue
+            a = args.pop(0)
+            values.append(a - (1 << 32) if m.group(1) in "di" and a & 0x80000000 else a)
+        fmt = self.CONVERSION.sub(lambda m: m.group(0) if m.group(1) in "%c" else re.sub(r"[hlzjt]", "", m.group(0)), fmt)
+        return fmt % tuple(values)
+
+    def batch(self, data):
+        """Yields (timestamp_us, text) for every record of a PMIC_STATUS_LOG frame."""
+        pos = 0
+        while pos + 8 <= len(data):
+            header, ts = struct.unpack_from("<II", data, pos)
+            nargs, seq = (header >> 16) & 0xFF, header >> 24
+            args = list(struct.unpack_from("<%dI" % nargs, data, pos + 8))
+            pos += 8 + 4 * nargs
+            if self.next_seq is not None and seq != self.next_seq:
+                self.dropped += (seq - self.next_seq) & 0xFF
+            self.next_seq = (seq + 1) & 0xFF
+            yield ts, self.format(header & 0xFFFF, args)
+
+
+def percentile(hist, fraction):
+    """Upper bound in us of the log2 bucket holding the given fraction of the samples."""
+    total, seen = sum(hist), 0
+    for b, n in enumerate(hist):
+        seen += n
+        if total and seen >= total * fraction:
+            return 0 if b == 0 else ">%d" % (1 << (b - 1)) if b == len(hist) - 1 else (1 << b) - 1
+    return "-"
+
+
+def sub(cmd, args):
+    return bytes([cmd, len(args)]) + bytes(args)
+
+
+def profile_image(mvs):
+    """Register image of max77654_profile_t, rails on at mV (0 = off), SSBs buck-boost at 330 mA."""
+    sbb, ldo = b"", b""
+    for mv in mvs[:3]:
+        sbb += bytes([(max(mv, 800) - 800) // 50, (0x07 if mv else 0x04) | (0x03 << 4)])
+    for mv in mvs[3:5]:
+        ldo += bytes([(max(mv, 800) - 800) // 25, 0x07 if mv else 0x04])
+    return sbb + ldo
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("port")
+    parser.add_argument("command", choices=["ping", "set", "enable", "mode", "read", "write", "bench", "telem", "log", "trace",
+                                                "profile", "profile-save", "profile-clear", "boot"])
+    parser.add_argument("args", nargs="*", type=lambda x: int(x, 0))
+    parser.add_argument("--table", default="pmic_cdc_ctrl.logfmt", help="log format table of the firmware build")
+    a = parser.parse_args()
+    pmic = Pmic(a.port)
+
+    if a.command == "ping":
+        print(pmic.call(CMD_PING, b"\x00ping").hex())
+    elif a.command == "set":
+        pmic.call(CMD_SET_VOLTAGE, struct.pack("<BH", a.args[0], a.args[1]))
+    elif a.command == "enable":
+        pmic.call(CMD_ENABLE, bytes(a.args[:2]))
+    elif a.command == "mode":
+        pmic.call(CMD_LDO_MODE, bytes(a.args[:2]))
+    elif a.command == "read":
+        print(pmic.call(CMD_READ_REGS, bytes(a.args[:2])).hex(" "))
+    elif a.command == "write":
+        pmic.call(CMD_WRITE_REGS, bytes(a.args))
+    elif a.command == "bench":
+        count = a.args[0] if a.args else 1000
+        t0 = time.perf_counter()
+        for i in range(count):
+            mv = 1800 if i & 1 else 3300
+            batch = b"".join(sub(CMD_SET_VOLTAGE, struct.pack("<BH", rail, mv)) for rail in range(3))
+            pmic.call(CMD_BATCH, batch)
+        print("%.0f reconfigurations/s" % (count / (time.perf_counter() - t0)))
+    elif a.command == "telem":
+        reg, count, rate, seconds = a.args
+        stream = pmic.call(CMD_TELEM_ADD, struct.pack("<BBH", reg, count, rate))[0]
+        print("stream,seq,timestamp_us," + ",".join("0x%02x" % (reg + i) for i in range(count)))
+        end = time.perf_counter() + seconds
+        while time.perf_counter() < end:
+            frame = pmic.receive()
+            if frame and frame[0] == 0 and frame[1] == STATUS_TELEMETRY:
+                s, n, seq, ts = struct.unpack_from("<BBHI", frame, 2)
+                print("%d,%d,%d,%s" % (s, seq, ts, ",".join("%d" % b for b in frame[10:10 + n])))
+        pmic.call(CMD_TELEM_REMOVE, bytes([stream]))
+        counters = struct.unpack("<4I", pmic.call(CMD_TELEM_COUNTERS, bytes([stream])))
+        print("# samples %d, dropped busy %d, dropped full %d, bus errors %d" % counters, file=sys.stderr)
+    elif a.command == "log":
+        decoder = LogDecoder(a.table)
+        end = time.perf_counter() + (a.args[0] if a.args else 10)
+        while time.perf_counter() < end:
+            frame = pmic.receive()
+            if frame and frame[0] == 0 and frame[1] == STATUS_LOG:
+                for ts, text in decoder.batch(frame[2:]):
+                    print("%10d %s" % (ts, text))
+        print("# %d records dropped on the device" % decoder.dropped, file=sys.stderr)
+    elif a.command == "trace":
+        print("%-12s %8s %6s %8s %6s %6s %6s %6s %6s" % ("operation", "count", "nacks", "timeouts", "min", "mean", "p50", "p99", "max"))
+        for op, name in enumerate(TRACE_OPS):
+            v = struct.unpack("<23I", pmic.call(CMD_TRACE, bytes([0, op])))
+            count, nacks, timeouts, lo, hi, total, hist = v[0], v[1], v[2], v[3], v[4], v[5] | (v[6] << 32), v[7:]
+            print("%-12s %8d %6d %8d %6d %6d %6s %6s %6d" % (name, count, nacks, timeouts, lo if count else 0,
+                  total // count if count else 0, percentile(hist, 0.5), percentile(hist, 0.99), hi))
+        for reg in a.args:
+            v = struct.unpack("<19I", pmic.call(CMD_TRACE, bytes([1, reg])))
+            print("reg 0x%02x     %8d errors %d, p50 %s, p99 %s, max %d us" % (reg, v[0], v[1], percentile(v[3:], 0.5),
+                  percentile(v[3:], 0.99), v[2]))
+    elif a.command == "profile":
+        data = pmic.call(CMD_PROFILE_GET)
+        stored, seq, free = struct.unpack_from("<BIH", data)
+        if not stored:
+            print("no profile stored, the built-in one is used")
+        else:
+            image = data[7:]
+            sbb = ["SSB%d %4d mV %s" % (i, 800 + 50 * image[2 * i], "on" if image[2 * i + 1] & 0x07 != 0x04 else "off")
+                   for i in range(3)]
+            ldo = ["LDO%d %4d mV %s" % (i, 800 + 25 * image[6 + 2 * i], "on" if image[7 + 2 * i] & 0x07 != 0x04 else "off")
+                   for i in range(2)]
+            print("\n".join(sbb + ldo))
+            print("# save %d, %d free slots before the next erase" % (seq, free), file=sys.stderr)
+    elif a.command == "profile-save":
+        pmic.call(CMD_PROFILE_SAVE, bytes([1]) + profile_image(a.args[:5]))
+    elif a.command == "profile-clear":
+        pmic.call(CMD_PROFILE_CLEAR)
+    elif a.command == "boot":
+        # oldest boot first, the same CSV test_max77654 prints for 'b'
+        print("boot,phase,arg,time_us")
+        for age in reversed(range(BOOT_RUNS)):
+            try:
+                data = pmic.call(CMD_BOOT_REPORT, bytes([age]))
+            except IOError:
+                continue
+            boot, count, flags = struct.unpack_from("<IBB", data)
+            for i in range(count):
+                phase, arg, t = struct.unpack_from("<BBI", data, 6 + 6 * i)
+                print("%d,%d,%d,%d" % (boot, phase, arg, t))
+            if flags & 1:
+                print("# boot %d: marks dropped" % boot, file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -15,21 +15,40 @@
 #include "pico/stdlib.h"
 #include "hardware/i2c.h"
 #include "max77654.h"
+#include "max77654_log.h"
+#include "max77654_store.h"
+#include "max77654_boot.h"
 
 int main() {
+    max77654_boot_begin();
+
+    // rails first, the loads must not wait for USB enumeration; the profile saved in flash
+    // (app/pmic_ctrl.py profile-save through pmic_cdc_ctrl) or the built-in one
+    int boot = max77654_store_boot(i2c1);
+
     // Enable UART so we can print status output
     stdio_init_all();
+    max77654_boot_mark(MAX77654_BOOT_STDIO, 0);
 
-    // This example will use I2C0 on the default SDA and SCL pins (0, 1 on a Pico)
-    // max77654_init(i2c1);
-
+    bool reported = false;
     while (1)
     {
         char c = getchar_timeout_us(10000);
+        if (!reported && stdio_usb_connected())
+        {
+            printf(boot < 0 ? "MAX77654 is not on the bus\n"
+                            : boot ? "Rails up with the stored profile\n" : "Rails up with the built-in profile\n");
+            reported = true;
+            max77654_boot_mark(MAX77654_BOOT_USB_HOST, 0);
+            max77654_boot_done();
+        }
         if (c == 't')
         {
             printf("\nStart test the MAX77654\n");
-            int ret = max77654_init(i2c1);
+            // the same profile as at boot, without recording another boot step
+            max77654_profile_t profile;
+            bool stored = max77654_store_load(&profile) == 0;
+            int ret = max77654_init_with_profile(i2c1, stored ? &profile : NULL);
             if (ret < 0)
             {
                 printf("MAX77654 is not on the bus\n");
@@ -68,6 +87,22 @@ int main() {
             SSBx_set_voltage(0, 3300);
             SSBx_set_voltage(2, 3300);
         }
-        
+        else if (c == 'b')
+        {
+            // this boot and the ones before it since the last power cycle, as CSV
+            printf("boot,phase,arg,time_us\n");
+            for (int age = MAX77654_BOOT_RUNS - 1; age >= 0; age--)
+            {
+                const max77654_boot_run_t *run = max77654_boot_get_run(age);
+                if (!run)
+                    continue;
+                for (int i = 0; i < run->count; i++)
+                    printf("%lu,%u,%u,%lu\n", (unsigned long)run->boot, run->marks[i].phase, run->marks[i].arg,
+                           (unsigned long)run->marks[i].time_us);
+            }
+        }
+
+        // the driver only records its log lines, format them here
+        max77654_log_print();
     }
 }
\ No newline at end of file
@@ -0,0 +1,118 @@
+// Streams data through the old linear memmove buffer and the SPSC ring of usb_dual_cdc,
+// 64 byte USB packets in, consumer reads in chunks of different sizes, and prints
+// bytes/s and cycles (ns where no cycle counter is available) per consumer call as CSV
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "cdc_ring.h"
+
+#define BUFFER_SIZE 1024
+#define PACKET_SIZE 64
+#define STREAM_BYTES (64u * 1024 * 1024)
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CYCLES() __rdtsc()
+#define CYCLE_UNIT "cycles"
+#else
+#define CYCLES() now_ns()
+#define CYCLE_UNIT "ns"
+#endif
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+// ---- the buffer as it was before: flat, leftovers moved to the front on every read ----
+typedef struct {
+    uint8_t buffer[BUFFER_SIZE];
+    uint32_t pos;
+} linear_buf_t;
+
+static uint32_t linear_write(linear_buf_t *b, const uint8_t *data, uint32_t len)
+{
+    len = MIN(len, BUFFER_SIZE - b->pos);
+    memcpy(&b->buffer[b->pos], data, len);
+    b->pos += len;
+    return len;
+}
+
+static uint32_t linear_read(linear_buf_t *b, uint8_t *data, uint32_t len)
+{
+    if (b->pos < len)
+    {
+        len = b->pos;
+        memcpy(data, b->buffer, len);
+        b->pos = 0;
+    }
+    else
+    {
+        memcpy(data, b->buffer, len);
+        memmove(b->buffer, &b->buffer[len], b->pos - len);
+        b->pos -= len;
+    }
+    return len;
+}
+
+// ---- the ring ----
+static uint8_t ring_storage[BUFFER_SIZE];
+static cdc_ring_t ring;
+
+static uint32_t ring_write(void *ctx, const uint8_t *data, uint32_t len) { (void)ctx; return cdc_ring_write(&ring, data, len); }
+static uint32_t ring_read(void *ctx, uint8_t *data, uint32_t len) { (void)ctx; return cdc_ring_read(&ring, data, len); }
+static uint32_t lin_write(void *ctx, const uint8_t *data, uint32_t len) { return linear_write(ctx, data, len); }
+static uint32_t lin_read(void *ctx, uint8_t *data, uint32_t len) { return linear_read(ctx, data, len); }
+
+typedef uint32_t (*io_fn)(void *ctx, uint8_t *data, uint32_t len);
+typedef uint32_t (*wr_fn)(void *ctx, const uint8_t *data, uint32_t len);
+
+static uint32_t checksum;
+
+static void run(const char *name, wr_fn wr, io_fn rd, void *ctx, uint32_t chunk)
+{
+    uint8_t packet[PACKET_SIZE];
+    uint8_t out[BUFFER_SIZE];
+    uint64_t produced = 0, consumed = 0, calls = 0, cycles = 0;
+
+    for (int i = 0; i < PACKET_SIZE; i++)
+        packet[i] = i;
+
+    uint64_t t0 = now_ns();
+    while (consumed < STREAM_BYTES)
+    {
+        // the USB side keeps the buffer as full as it can
+        while (produced - consumed <= BUFFER_SIZE - PACKET_SIZE)
+            produced += wr(ctx, packet, PACKET_SIZE);
+
+        uint64_t c0 = CYCLES();
+        uint32_t n = rd(ctx, out, chunk);
+        cycles += CYCLES() - c0;
+
+        checksum += out[0];
+        consumed += n;
+        calls++;
+    }
+    double seconds = (now_ns() - t0) / 1e9;
+
+    printf("%s,%u,%.1f,%.1f\n", name, (unsigned)chunk, consumed / seconds / 1e6, (double)cycles / calls);
+}
+
+int main() {
+    static const uint32_t chunks[] = {1, 4, 16, 64, 256};
+    static linear_buf_t linear;
+
+    printf("buffer,chunk_bytes,MB_per_s,%s_per_read\n", CYCLE_UNIT);
+    for (unsigned int i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++)
+    {
+        memset(&linear, 0, sizeof(linear));
+        run("linear", lin_write, lin_read, &linear, chunks[i]);
+
+        cdc_ring_init(&ring, ring_storage, BUFFER_SIZE);
+        run("ring", ring_write, ring_read, NULL, chunks[i]);
+    }
+
+    return checksum == 0xFFFFFFFF; // keep the copies from being optimised away
+}
@@ -0,0 +1,308 @@
+// Pushes synthetic loads through usb_dual_cdc on the simulated USB link and prints one CSV line per run:
+// throughput in virtual time (what the library sustains on a full speed bus with this main loop),
+// host CPU ns per cdc_write_buf / cdc_read_buf / cdc_task call (for spotting regressions in the code paths),
+// bytes lost to slow consumers under each overflow policy, and echo round trips.
+//   bench_usb_dual_cdc [--quick]
+// --quick runs short streams and fails on corrupted data, ctest uses it as a smoke test.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "pico/stdlib.h"
+#include "usb_dual_cdc.h"
+#include "mock_tusb.h"
+#include "mock_time.h"
+
+#define LOOP_US 10 // rest of the application's main loop pass
+
+static const char *policy_names[] = { "drop", "partial", "drop_oldest", "block" };
+
+static uint32_t stream_bytes = 1024 * 1024;
+static uint32_t echo_count = 1000;
+static uint32_t errors;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static uint8_t pattern(uint32_t pos, uint8_t itf) { return (uint8_t)(pos * 7 + itf * 101 + (pos >> 8)); }
+
+typedef struct {
+    const char *scenario;
+    int interfaces;
+    uint32_t chunk;
+    const char *policy;
+    uint64_t bytes;      // payload delivered
+    uint64_t elapsed_us; // virtual time
+    uint64_t write_ns, writes;
+    uint64_t read_ns, reads;
+    uint64_t task_ns, tasks;
+    uint32_t dropped;
+    uint32_t blocked_us;
+    uint32_t rtt_p50_us, rtt_max_us;
+} result_t;
+
+static void print_result(const result_t *r)
+{
+    printf("%s,%d,%u,%s,%.3f,%.0f,%.0f,%.0f,%u,%u,%u,%u,%u\n", r->scenario, r->interfaces, (unsigned)r->chunk, r->policy,
+           r->elapsed_us ? (double)r->bytes / r->elapsed_us : 0.0,
+           r->writes ? (double)r->write_ns / r->writes : 0.0,
+           r->reads ? (double)r->read_ns / r->reads : 0.0,
+           r->tasks ? (double)r->task_ns / r->tasks : 0.0,
+           r->dropped, r->blocked_us, r->rtt_p50_us, r->rtt_max_us, errors);
+}
+
+// ---- the host application, runs whenever the virtual clock moves ----
+static struct {
+    bool verify;
+    uint32_t rate_bytes_per_s; // 0: reads everything right away
+    uint64_t last_us;
+    uint64_t budget;
+    uint32_t got[CFG_TUD_CDC];
+} host;
+
+static void host_reader(uint64_t now_us)
+{
+    uint64_t limit = UINT64_MAX;
+
+    if (host.rate_bytes_per_s)
+    {
+        host.budget += (now_us - host.last_us) * host.rate_bytes_per_s / 1000000;
+        limit = host.budget;
+    }
+    host.last_us = now_us;
+
+    for (uint8_t itf = 0; itf < CFG_TUD_CDC; itf++)
+    {
+        uint8_t buf[256];
+        uint32_t n;
+        while (limit && (n = mock_tusb_host_read(itf, buf, MIN(sizeof(buf), limit))) > 0)
+        {
+            if (host.verify)
+                for (uint32_t i = 0; i < n; i++)
+                    errors += buf[i] != pattern(host.got[itf] + i, itf);
+            host.got[itf] += n;
+            limit -= n;
+            if (host.rate_bytes_per_s)
+                host.budget -= n;
+        }
+    }
+}
+
+static void setup(int interfaces)
+{
+    mock_time_reset();
+    mock_tusb_reset();
+    mock_time_add_hook(host_reader);
+    cdc_init();
+    for (uint8_t itf = 0; itf < CFG_TUD_CDC; itf++)
+        mock_tusb_connect(itf, itf < interfaces);
+    memset(&host, 0, sizeof(host));
+    host.verify = true;
+}
+
+static void timed_task(result_t *r)
+{
+    uint64_t t0 = now_ns();
+    cdc_task();
+    r->task_ns += now_ns() - t0;
+    r->tasks++;
+}
+
+// device to host and host to device streams, written / read chunk bytes at a time
+static void run_stream(const char *scenario, int interfaces, uint32_t chunk, bool tx, bool rx)
+{
+    result_t r = { .scenario = scenario, .interfaces = interfaces, .chunk = chunk, .policy = "partial" };
+    uint32_t sent[CFG_TUD_CDC] = {0}, host_sent[CFG_TUD_CDC] = {0}, recv[CFG_TUD_CDC] = {0};
+    static uint8_t buf[1024];
+
+    setup(interfaces);
+    for (uint8_t itf = 0; itf < interfaces; itf++)
+        cdc_set_overflow_policy(itf, CDC_OVERFLOW_PARTIAL, 0);
+
+    while (1)
+    {
+        bool done = true;
+        for (uint8_t itf = 0; itf < interfaces; itf++)
+            done &= (!tx || host.got[itf] >= stream_bytes) && (!rx || recv[itf] >= stream_bytes);
+        if (done)
+            break;
+
+        timed_task(&r);
+        for (uint8_t itf = 0; itf < interfaces; itf++)
+        {
+            if (tx && sent[itf] < stream_bytes)
+            {
+                uint32_t n = MIN(chunk, stream_bytes - sent[itf]);
+                for (uint32_t i = 0; i < n; i++)
+                    buf[i] = pattern(sent[itf] + i, itf);
+                uint64_t t0 = now_ns();
+                sent[itf] += cdc_write_buf(itf, buf, n);
+                r.write_ns += now_ns() - t0;
+                r.writes++;
+            }
+            if (rx)
+            {
+                if (host_sent[itf] < stream_bytes)
+                {
+                    uint32_t n = MIN(sizeof(buf), stream_bytes - host_sent[itf]);
+                    for (uint32_t i = 0; i < n; i++)
+                        buf[i] = pattern(host_sent[itf] + i, itf);
+                    host_sent[itf] += mock_tusb_host_write(itf, buf, n);
+                }
+                uint64_t t0 = now_ns();
+                uint32_t n = cdc_read_buf(itf, buf, chunk);
+                r.read_ns += now_ns() - t0;
+                r.reads++;
+                for (uint32_t i = 0; i < n; i++)
+                    errors += buf[i] != pattern(recv[itf] + i, itf);
+                recv[itf] += n;
+            }
+        }
+        sleep_us(LOOP_US);
+    }
+
+    r.elapsed_us = time_us_64();
+    r.bytes = (uint64_t)stream_bytes * interfaces * (tx + rx);
+    print_result(&r);
+}
+
+// the application logs at a fixed rate into a host that reads slower, for every overflow policy
+static void run_slow_consumer(cdc_overflow_policy_t policy)
+{
+    result_t r = { .scenario = "slow_consumer", .interfaces = 1, .chunk = 64, .policy = policy_names[policy] };
+    uint8_t line[64];
+    cdc_stats_t stats;
+
+    setup(1);
+    host.verify = false; // the lossy policies leave gaps
+    host.rate_bytes_per_s = 100000;
+    mock_tusb_host_set_room(0, 4096);
+    cdc_set_overflow_policy(0, policy, 1000);
+    memset(line, 'x', sizeof(line));
+
+    // 200 kB/s of 64 byte lines for a virtual half second
+    uint64_t next = 0;
+    while (time_us_64() < 500000)
+    {
+        timed_task(&r);
+        if (time_us_64() >= next)
+        {
+            uint64_t t0 = now_ns();
+            cdc_write_buf(0, line, sizeof(line));
+            r.write_ns += now_ns() - t0;
+            r.writes++;
+            next += 320;
+        }
+        sleep_us(LOOP_US);
+    }
+
+    cdc_get_stats(0, &stats);
+    r.elapsed_us = time_us_64();
+    r.bytes = host.got[0];
+    r.dropped = stats.dropped;
+    r.blocked_us = stats.blocked_us;
+    print_result(&r);
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+// the host sends size bytes and waits for the device main loop to echo them
+static void run_echo(int interfaces, uint32_t size)
+{
+    result_t r = { .scenario = "echo", .interfaces = interfaces, .chunk = size, .policy = "drop" };
+    static uint32_t rtt[10000];
+    uint8_t buf[1024];
+    uint32_t echoed[CFG_TUD_CDC] = {0};
+
+    setup(interfaces);
+    host.verify = true;
+
+    for (uint32_t e = 0; e < echo_count; e++)
+    {
+        uint64_t t0 = time_us_64();
+        uint32_t expect[CFG_TUD_CDC];
+
+        for (uint8_t itf = 0; itf < interfaces; itf++)
+        {
+            for (uint32_t i = 0; i < size; i++)
+                buf[i] = pattern(host.got[itf] + i, itf);
+            mock_tusb_host_write(itf, buf, size);
+            expect[itf] = host.got[itf] + size;
+        }
+
+        bool done = false;
+        while (!done)
+        {
+            timed_task(&r);
+            for (uint8_t itf = 0; itf < interfaces; itf++)
+            {
+                uint64_t t1 = now_ns();
+                uint32_t n = cdc_read_buf(itf, buf, sizeof(buf));
+                r.read_ns += now_ns() - t1;
+                r.reads++;
+                if (n)
+                {
+                    t1 = now_ns();
+                    cdc_write_buf(itf, buf, n);
+                    r.write_ns += now_ns() - t1;
+                    r.writes++;
+                    echoed[itf] += n;
+                }
+            }
+            sleep_us(LOOP_US);
+
+            done = true;
+            for (uint8_t itf = 0; itf < interfaces; itf++)
+                done &= host.got[itf] >= expect[itf];
+        }
+        rtt[e] = time_us_64() - t0;
+        r.bytes += 2 * size * interfaces;
+    }
+
+    cdc_stats_t stats;
+    for (uint8_t itf = 0; itf < interfaces; itf++)
+    {
+        cdc_get_stats(itf, &stats);
+        r.dropped += stats.dropped;
+    }
+    r.elapsed_us = time_us_64();
+    qsort(rtt, echo_count, sizeof(rtt[0]), compare_u32);
+    r.rtt_p50_us = rtt[echo_count / 2];
+    r.rtt_max_us = rtt[echo_count - 1];
+    print_result(&r);
+}
+
+int main(int argc, char **argv) {
+    static const uint32_t chunks[] = {1, 8, 64, 256, 1024};
+    static const uint32_t echo_sizes[] = {1, 32, 64, 256};
+
+    if (argc > 1 && strcmp(argv[1], "--quick") == 0)
+    {
+        stream_bytes = 16 * 1024;
+        echo_count = 50;
+    }
+
+    printf("scenario,interfaces,chunk_bytes,policy,MB_per_s,ns_per_write,ns_per_read,ns_per_task,"
+           "dropped_bytes,blocked_us,rtt_p50_us,rtt_max_us,errors\n");
+    for (unsigned int i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++)
+        run_stream("tx", 1, chunks[i], true, false);
+    for (unsigned int i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++)
+        run_stream("rx", 1, chunks[i], false, true);
+    run_stream("tx", 2, 256, true, false);
+    run_stream("duplex", 2, 256, true, true);
+    for (int p = CDC_OVERFLOW_DROP; p <= CDC_OVERFLOW_BLOCK; p++)
+        run_slow_consumer(p);
+    for (unsigned int i = 0; i < sizeof(echo_sizes) / sizeof(echo_sizes[0]); i++)
+        run_echo(1, echo_sizes[i]);
+    run_echo(2, 32);
+
+    return errors ? 1 : 0;
+}
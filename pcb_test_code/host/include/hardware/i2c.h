@@ -0,0 +1,25 @@
+#ifndef __HOST__HARDWARE__I2C__H__
+
+#define __HOST__HARDWARE__I2C__H__
+
+// Host stand-in for the Pico SDK hardware_i2c API, the transfers end up in mock_i2c.c
+
+#include "pico/stdlib.h"
+
+typedef struct i2c_inst i2c_inst_t;
+
+extern i2c_inst_t i2c0_inst;
+extern i2c_inst_t i2c1_inst;
+
+#define i2c0 (&i2c0_inst)
+#define i2c1 (&i2c1_inst)
+
+unsigned int i2c_hw_index(i2c_inst_t *i2c); // 0 or 1
+unsigned int i2c_init(i2c_inst_t *i2c, unsigned int baudrate);
+unsigned int i2c_set_baudrate(i2c_inst_t *i2c, unsigned int baudrate);
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop);
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop);
+int i2c_write_timeout_us(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop, unsigned int timeout_us);
+int i2c_read_timeout_us(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop, unsigned int timeout_us);
+
+#endif
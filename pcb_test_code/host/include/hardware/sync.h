@@ -0,0 +1,15 @@
+#ifndef __HOST__HARDWARE__SYNC__H__
+
+#define __HOST__HARDWARE__SYNC__H__
+
+// Host stand-in for hardware_sync, the simulated peripherals never preempt the caller
+
+#include "pico/stdlib.h"
+
+static inline uint32_t save_and_disable_interrupts(void) { return 0; }
+static inline void restore_interrupts(uint32_t status) { (void)status; }
+static inline void __wfe(void) {}
+static inline void __sev(void) {}
+static inline void __dmb(void) { __atomic_thread_fence(__ATOMIC_ACQ_REL); }
+
+#endif
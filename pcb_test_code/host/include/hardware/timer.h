@@ -0,0 +1,27 @@
+#ifndef __HOST__HARDWARE__TIMER__H__
+
+#define __HOST__HARDWARE__TIMER__H__
+
+// Host stand-in for the hardware alarms of hardware_timer, they fire while the virtual clock
+// moves (mock_time.c), in deadline order together with the repeating timers
+
+#include "pico/stdlib.h"
+
+#define NUM_TIMERS 4
+
+static inline void busy_wait_until(absolute_time_t t)
+{
+    if (t > time_us_64())
+        sleep_us(t - time_us_64());
+}
+
+typedef void (*hardware_alarm_callback_t)(uint alarm_num);
+
+int hardware_alarm_claim_unused(bool required);
+void hardware_alarm_unclaim(uint alarm_num);
+void hardware_alarm_set_callback(uint alarm_num, hardware_alarm_callback_t callback);
+// returns true if t has already passed, the alarm is not armed then
+bool hardware_alarm_set_target(uint alarm_num, absolute_time_t t);
+void hardware_alarm_cancel(uint alarm_num);
+
+#endif
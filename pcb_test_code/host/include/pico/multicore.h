@@ -0,0 +1,14 @@
+#ifndef __HOST__PICO__MULTICORE__H__
+
+#define __HOST__PICO__MULTICORE__H__
+
+// Host stand-in for pico_multicore, there is no second core: launching one ends the program
+
+#include "pico/stdlib.h"
+
+void multicore_launch_core1(void (*entry)(void));
+void multicore_fifo_push_blocking(uint32_t data);
+uint32_t multicore_fifo_pop_blocking(void);
+void multicore_lockout_victim_init(void);
+
+#endif
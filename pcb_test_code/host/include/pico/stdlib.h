@@ -0,0 +1,66 @@
+#ifndef __HOST__PICO__STDLIB__H__
+
+#define __HOST__PICO__STDLIB__H__
+
+// Host stand-in for the parts of pico_stdlib the libraries use, just enough to compile and run on a PC
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+enum pico_error_codes {
+    PICO_OK = 0,
+    PICO_ERROR_NONE = 0,
+    PICO_ERROR_TIMEOUT = -1,
+    PICO_ERROR_GENERIC = -2,
+};
+
+typedef unsigned int uint;
+
+#ifndef MIN
+#define MIN(a, b) ((b) > (a) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+#include "hardware/gpio.h"
+
+static inline void tight_loop_contents(void) {}
+static inline uint get_core_num(void) { return 0; }
+static inline uint __get_current_exception(void) { return 0; } // never in an interrupt handler
+
+// virtual clock, see mock_time.c; sleeping only moves the clock forward
+uint64_t time_us_64(void);
+static inline uint32_t time_us_32(void) { return (uint32_t)time_us_64(); }
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+static inline void busy_wait_us(uint64_t us) { sleep_us(us); }
+
+typedef uint64_t absolute_time_t;
+static inline absolute_time_t get_absolute_time(void) { return time_us_64(); }
+static inline absolute_time_t make_timeout_time_us(uint64_t us) { return time_us_64() + us; }
+static inline absolute_time_t make_timeout_time_ms(uint32_t ms) { return time_us_64() + (uint64_t)ms * 1000; }
+static inline int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to) { return (int64_t)(to - from); }
+static inline bool time_reached(absolute_time_t t) { return time_us_64() >= t; }
+// there are no events on the host, the wait just lets the virtual clock run a bit
+bool best_effort_wfe_or_timeout(absolute_time_t timeout_timestamp);
+
+// repeating timers fire while the virtual clock moves, like the SDK alarm IRQ would
+typedef struct repeating_timer repeating_timer_t;
+typedef bool (*repeating_timer_callback_t)(repeating_timer_t *rt);
+struct repeating_timer {
+    int64_t delay_us;
+    absolute_time_t next_us;
+    repeating_timer_callback_t callback;
+    void *user_data;
+    repeating_timer_t *next_timer; // mock_time.c bookkeeping
+};
+bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t callback, void *user_data, repeating_timer_t *out);
+static inline bool add_repeating_timer_ms(int32_t delay_ms, repeating_timer_callback_t callback, void *user_data, repeating_timer_t *out)
+{
+    return add_repeating_timer_us((int64_t)delay_ms * 1000, callback, user_data, out);
+}
+bool cancel_repeating_timer(repeating_timer_t *timer);
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef __HOST__PICO__SYNC__H__
+
+#define __HOST__PICO__SYNC__H__
+
+// Host stand-in for the critical sections of pico_sync, everything runs on one thread
+
+#include "pico/stdlib.h"
+
+typedef struct {
+    bool initialized;
+} critical_section_t;
+
+static inline void critical_section_init(critical_section_t *crit_sec) { crit_sec->initialized = true; }
+static inline bool critical_section_is_initialized(critical_section_t *crit_sec) { return crit_sec->initialized; }
+static inline void critical_section_enter_blocking(critical_section_t *crit_sec) { (void)crit_sec; }
+static inline void critical_section_exit(critical_section_t *crit_sec) { (void)crit_sec; }
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef __HOST__TUSB__H__
+
+#define __HOST__TUSB__H__
+
+// Host stand-in for the TinyUSB device CDC API usb_dual_cdc_lib uses, see mock_tusb.c for the simulated link
+
+#include "pico/stdlib.h"
+#include "usb_cdc_config.h"
+
+#define CFG_TUD_CDC USB_CDC_COUNT
+#define CFG_TUD_CDC_RX_BUFSIZE 1024
+#define CFG_TUD_CDC_TX_BUFSIZE 1024
+#define CFG_TUD_CDC_EP_BUFSIZE 64
+
+bool tusb_init(void);
+void tud_task(void);
+
+bool tud_cdc_n_connected(uint8_t itf);
+uint32_t tud_cdc_n_available(uint8_t itf);
+uint32_t tud_cdc_n_read(uint8_t itf, void *buffer, uint32_t bufsize);
+uint32_t tud_cdc_n_write(uint8_t itf, const void *buffer, uint32_t bufsize);
+uint32_t tud_cdc_n_write_flush(uint8_t itf);
+uint32_t tud_cdc_n_write_available(uint8_t itf);
+
+void usbd_id_init(void);
+
+// implemented by the application, called from tud_task()
+void tud_cdc_rx_cb(uint8_t itf);
+void tud_cdc_tx_complete_cb(uint8_t itf);
+
+#endif
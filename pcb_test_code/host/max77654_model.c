@@ -0,0 +1,166 @@
+#include "max77654_model.h"
+#include "mock_gpio.h"
+#include <string.h>
+
+#define REG_RO (1 << 0)  // writes are ignored
+#define REG_COR (1 << 1) // cleared after it was read
+
+static uint8_t reg_flags[MAX77654_MODEL_REGS] = {
+    [MODEL_REG_INT_GLBL0] = REG_RO | REG_COR,
+    [MODEL_REG_INT_CHG] = REG_RO | REG_COR,
+    [MODEL_REG_STAT_CHG_A] = REG_RO,
+    [MODEL_REG_STAT_CHG_B] = REG_RO,
+    [MODEL_REG_INT_GLBL1] = REG_RO | REG_COR,
+    [MODEL_REG_ERCFLAG] = REG_RO | REG_COR,
+    [MODEL_REG_STAT_GLBL] = REG_RO,
+    [MODEL_REG_CID] = REG_RO,
+};
+
+// reset values that differ from 0x00, everything else starts at 0x00
+static const struct {
+    uint8_t reg;
+    uint8_t value;
+} reset_values[] = {
+    {MODEL_REG_INTM_CHG, 0xFF},
+    {MODEL_REG_INTM_GLBL0, 0xFF},
+    {MODEL_REG_INTM_GLBL1, 0x7F},
+    {MODEL_REG_CID, 0x01},
+    {0x20, 0x0F},                             // CNFG_CHG_A: T_COLD 5C, T_COOL 0C, T_WARM 35C, T_HOT 45C
+    {0x22, 0xF8},                             // CNFG_CHG_C: pre-charge 3.0V, 15% term, no top-off
+    {0x23, 0x10},                             // CNFG_CHG_D: VSYS 4.1V
+    {0x24, 0x05},                             // CNFG_CHG_E: 15 mA, 3 h timer
+    {0x25, 0x04},                             // CNFG_CHG_F: JEITA 15 mA, thermistor off
+    {MODEL_REG_CNFG_CHG_I, 0xF0},             // AMUX off, discharge monitor 300 mA full scale
+    {0x2A, 0x04}, {0x2C, 0x04}, {0x2E, 0x04}, // CNFG_SBBx_B: off irrespective of FPS
+    {0x39, 0x04}, {0x3B, 0x04},               // CNFG_LDOx_B: off irrespective of FPS
+};
+
+
+static void update_irq(max77654_model_t *model)
+{
+    if (model->irq_gpio >= 0)
+        mock_gpio_set_level(model->irq_gpio, !max77654_model_irq_asserted(model));
+}
+
+static bool take_nack(max77654_model_t *model)
+{
+    if (model->nack_countdown > 0)
+    {
+        model->nack_countdown--;
+        return true;
+    }
+    return false;
+}
+
+static int model_write(void *ctx, const uint8_t *src, size_t len, bool nostop)
+{
+    max77654_model_t *model = ctx;
+
+    if (take_nack(model))
+        return PICO_ERROR_GENERIC;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        if (model->addr_phase)
+        {
+            model->pointer = src[i];
+            model->addr_phase = false;
+            continue;
+        }
+
+        uint8_t reg = model->pointer++;
+        if (reg >= MAX77654_MODEL_REGS)
+            continue;
+        if (!(reg_flags[reg] & REG_RO))
+            model->regs[reg] = src[i];
+        model->reg_writes[reg]++;
+    }
+
+    if (!nostop)
+        model->addr_phase = true;
+    update_irq(model); // INTM may have changed
+    return len;
+}
+
+static int model_read(void *ctx, uint8_t *dst, size_t len, bool nostop)
+{
+    max77654_model_t *model = ctx;
+
+    if (take_nack(model))
+        return PICO_ERROR_GENERIC;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        uint8_t reg = model->pointer++;
+        if (reg >= MAX77654_MODEL_REGS)
+        {
+            dst[i] = 0x00;
+            continue;
+        }
+        dst[i] = model->regs[reg];
+        if (reg_flags[reg] & REG_COR)
+            model->regs[reg] = 0x00;
+    }
+
+    // a read (after a repeated start) ends the register address phase
+    model->addr_phase = !nostop;
+    update_irq(model); // interrupt bits may have been cleared
+    return len;
+}
+
+static const mock_i2c_device_ops_t model_ops = {
+    .write = model_write,
+    .read = model_read,
+};
+
+
+void max77654_model_reset(max77654_model_t *model)
+{
+    memset(model, 0, sizeof(*model));
+    for (unsigned int i = 0; i < sizeof(reset_values) / sizeof(reset_values[0]); i++)
+        model->regs[reset_values[i].reg] = reset_values[i].value;
+    model->addr_phase = true;
+    model->irq_gpio = -1;
+}
+
+int max77654_model_attach(max77654_model_t *model, i2c_inst_t *i2c, uint8_t addr)
+{
+    return mock_i2c_attach(i2c, addr, &model_ops, model);
+}
+
+uint8_t max77654_model_peek(max77654_model_t *model, uint8_t reg)
+{
+    return reg < MAX77654_MODEL_REGS ? model->regs[reg] : 0x00;
+}
+
+void max77654_model_poke(max77654_model_t *model, uint8_t reg, uint8_t value)
+{
+    if (reg < MAX77654_MODEL_REGS)
+        model->regs[reg] = value;
+    update_irq(model);
+}
+
+void max77654_model_raise(max77654_model_t *model, uint8_t reg, uint8_t bits)
+{
+    if (reg < MAX77654_MODEL_REGS)
+        model->regs[reg] |= bits;
+    update_irq(model);
+}
+
+void max77654_model_inject_nack(max77654_model_t *model, int transfers)
+{
+    model->nack_countdown = transfers;
+}
+
+bool max77654_model_irq_asserted(max77654_model_t *model)
+{
+    return (model->regs[MODEL_REG_INT_GLBL0] & ~model->regs[MODEL_REG_INTM_GLBL0])
+        || (model->regs[MODEL_REG_INT_GLBL1] & ~model->regs[MODEL_REG_INTM_GLBL1])
+        || (model->regs[MODEL_REG_INT_CHG] & ~model->regs[MODEL_REG_INTM_CHG]);
+}
+
+void max77654_model_connect_irq(max77654_model_t *model, uint gpio)
+{
+    model->irq_gpio = gpio;
+    update_irq(model);
+}
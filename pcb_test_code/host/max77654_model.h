@@ -0,0 +1,49 @@
+#ifndef __MAX77654__MODEL__H__
+
+#define __MAX77654__MODEL__H__
+
+#include "mock_i2c.h"
+
+// Behavioural model of the MAX77654 register interface for the host build.
+// Holds the full register file, handles auto-increment reads and writes, read-only and
+// clear-on-read registers, and lets tests inject faults (ERCFLAG / interrupt bits, NACKs).
+
+#define MAX77654_MODEL_REGS 0x50
+
+#define MODEL_REG_INT_GLBL0 0x00
+#define MODEL_REG_INT_CHG 0x01
+#define MODEL_REG_STAT_CHG_A 0x02
+#define MODEL_REG_STAT_CHG_B 0x03
+#define MODEL_REG_INT_GLBL1 0x04
+#define MODEL_REG_ERCFLAG 0x05
+#define MODEL_REG_STAT_GLBL 0x06
+#define MODEL_REG_INTM_CHG 0x07
+#define MODEL_REG_INTM_GLBL0 0x08
+#define MODEL_REG_INTM_GLBL1 0x09
+#define MODEL_REG_CID 0x14
+#define MODEL_REG_CNFG_CHG_I 0x28
+
+typedef struct {
+    uint8_t regs[MAX77654_MODEL_REGS];
+    uint8_t pointer;     // register address for the next data byte
+    bool addr_phase;     // the next written byte is a register address
+    int nack_countdown;  // > 0: NACK that many transfers
+    uint32_t reg_writes[MAX77654_MODEL_REGS]; // writes per register, for the tests
+    int irq_gpio;        // MCU pin nIRQ is wired to, -1 = not connected
+} max77654_model_t;
+
+void max77654_model_reset(max77654_model_t *model); // power-on reset
+int max77654_model_attach(max77654_model_t *model, i2c_inst_t *i2c, uint8_t addr);
+
+uint8_t max77654_model_peek(max77654_model_t *model, uint8_t reg); // no side effects
+void max77654_model_poke(max77654_model_t *model, uint8_t reg, uint8_t value);
+
+// latch fault/interrupt bits in ERCFLAG, INT_GLBL0/1 or INT_CHG
+void max77654_model_raise(max77654_model_t *model, uint8_t reg, uint8_t bits);
+void max77654_model_inject_nack(max77654_model_t *model, int transfers);
+// nIRQ is asserted (low) while an unmasked interrupt bit is set
+bool max77654_model_irq_asserted(max77654_model_t *model);
+// wire nIRQ to a simulated GPIO, the pin follows the interrupt state from then on
+void max77654_model_connect_irq(max77654_model_t *model, uint gpio);
+
+#endif
@@ -0,0 +1,62 @@
+#include "max77654_amux_port.h"
+#include "mock_adc.h"
+#include "mock_time.h"
+
+static mock_adc_waveform_t wave;
+static void *wave_user;
+static uint input;
+static bool running;
+static uint64_t start_us;
+static uint32_t rate_hz;
+static uint16_t *buf;
+static uint32_t buf_mask;
+static uint32_t written;
+
+
+static void capture(uint64_t now_us)
+{
+    if (!running)
+        return;
+
+    uint64_t due = (now_us - start_us) * rate_hz / 1000000;
+    while (written < due)
+    {
+        uint64_t t = start_us + (uint64_t)written * 1000000 / rate_hz;
+        buf[written & buf_mask] = wave ? wave(t, wave_user) & 0x0FFF : 0;
+        written++;
+    }
+}
+
+void mock_adc_set_waveform(mock_adc_waveform_t waveform, void *user)
+{
+    wave = waveform;
+    wave_user = user;
+}
+
+uint mock_adc_input(void)
+{
+    return input;
+}
+
+int max77654_amux_port_start(uint adc_input, uint32_t sample_rate_hz, uint16_t *ring, uint32_t ring_len)
+{
+    mock_time_add_hook(capture);
+    input = adc_input;
+    rate_hz = sample_rate_hz;
+    buf = ring;
+    buf_mask = ring_len - 1;
+    written = 0;
+    start_us = time_us_64();
+    running = true;
+    return 0;
+}
+
+void max77654_amux_port_stop(void)
+{
+    running = false;
+}
+
+uint32_t max77654_amux_port_written(void)
+{
+    return written;
+}
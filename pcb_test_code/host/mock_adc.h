@@ -0,0 +1,15 @@
+#ifndef __MOCK__ADC__H__
+
+#define __MOCK__ADC__H__
+
+#include "pico/stdlib.h"
+
+// Host port of max77654_amux: samples a waveform function at the configured rate while the
+// virtual clock moves and writes them into the ring like the ADC DMA would
+
+typedef uint16_t (*mock_adc_waveform_t)(uint64_t t_us, void *user); // 12 bit ADC counts
+
+void mock_adc_set_waveform(mock_adc_waveform_t waveform, void *user);
+uint mock_adc_input(void); // ADC input selected by the last start
+
+#endif
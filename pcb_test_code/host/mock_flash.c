@@ -0,0 +1,87 @@
+#include "mock_flash.h"
+#include "max77654_store.h"
+#include "max77654_store_port.h"
+#include <string.h>
+
+#define AREA_SIZE (MAX77654_STORE_SECTORS * MAX77654_STORE_SECTOR_SIZE)
+
+static uint8_t area[AREA_SIZE];
+static bool initialized;
+static int64_t cut_after = -1; // bytes the next operation gets through, -1 = no power cut
+static uint32_t erase_counts[MAX77654_STORE_SECTORS];
+static uint32_t program_count;
+
+
+void mock_flash_reset(void)
+{
+    memset(area, 0xFF, sizeof(area));
+    memset(erase_counts, 0, sizeof(erase_counts));
+    program_count = 0;
+    cut_after = -1;
+    initialized = true;
+}
+
+void mock_flash_cut_power_after(uint32_t bytes)
+{
+    cut_after = bytes;
+}
+
+uint32_t mock_flash_erase_count(uint32_t sector)
+{
+    return sector < MAX77654_STORE_SECTORS ? erase_counts[sector] : 0;
+}
+
+uint32_t mock_flash_program_count(void)
+{
+    return program_count;
+}
+
+const uint8_t *max77654_store_port_area(void)
+{
+    if (!initialized)
+        mock_flash_reset();
+    return area;
+}
+
+int max77654_store_port_erase(uint32_t offset)
+{
+    uint32_t sector = offset / MAX77654_STORE_SECTOR_SIZE;
+
+    if (!initialized)
+        mock_flash_reset();
+    if (offset % MAX77654_STORE_SECTOR_SIZE || sector >= MAX77654_STORE_SECTORS)
+        return -1;
+
+    erase_counts[sector]++;
+    if (cut_after >= 0)
+    {
+        uint32_t n = cut_after < MAX77654_STORE_SECTOR_SIZE ? cut_after : MAX77654_STORE_SECTOR_SIZE;
+        memset(&area[offset], 0x00, n);
+        cut_after = -1;
+        return -1;
+    }
+    memset(&area[offset], 0xFF, MAX77654_STORE_SECTOR_SIZE);
+    return 0;
+}
+
+int max77654_store_port_program(uint32_t offset, const uint8_t *data, uint32_t len)
+{
+    if (!initialized)
+        mock_flash_reset();
+    if (offset + len > AREA_SIZE || offset / MAX77654_STORE_PAGE_SIZE != (offset + len - 1) / MAX77654_STORE_PAGE_SIZE)
+        return -1;
+
+    program_count++;
+    uint32_t n = len;
+    if (cut_after >= 0 && cut_after < len)
+        n = cut_after;
+    for (uint32_t i = 0; i < n; i++)
+        area[offset + i] &= data[i];
+
+    if (cut_after >= 0)
+    {
+        cut_after = -1;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,20 @@
+#ifndef __MOCK__FLASH__H__
+
+#define __MOCK__FLASH__H__
+
+#include "pico/stdlib.h"
+
+// Host port of max77654_store: NOR flash in RAM. Erasing sets a sector to 0xFF, programming ANDs
+// the data in, so programming a byte twice without an erase shows up like it would on the chip.
+// A power cut can be injected, the program or erase it hits only gets part way.
+
+void mock_flash_reset(void); // fresh chip, everything erased
+
+// the next program writes only the first bytes bytes of its data, the next erase only clears
+// the first bytes bytes of its sector (it leaves them 0x00 like a chip that was cut off), then fails
+void mock_flash_cut_power_after(uint32_t bytes);
+
+uint32_t mock_flash_erase_count(uint32_t sector);
+uint32_t mock_flash_program_count(void);
+
+#endif
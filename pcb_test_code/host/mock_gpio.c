@@ -0,0 +1,61 @@
+#include "mock_gpio.h"
+
+static bool levels[MOCK_GPIO_COUNT];
+static bool driven[MOCK_GPIO_COUNT]; // level set by mock_gpio_set_level, wins over the pull-up
+static uint32_t irq_events[MOCK_GPIO_COUNT];
+static gpio_irq_callback_t irq_callback;
+
+
+void gpio_init(uint gpio)
+{
+    irq_events[gpio] = 0;
+}
+
+void gpio_pull_up(uint gpio)
+{
+    if (gpio < MOCK_GPIO_COUNT && !driven[gpio])
+        levels[gpio] = true;
+}
+
+bool gpio_get(uint gpio)
+{
+    return gpio < MOCK_GPIO_COUNT ? levels[gpio] : false;
+}
+
+void gpio_put(uint gpio, bool value)
+{
+    if (gpio < MOCK_GPIO_COUNT)
+        levels[gpio] = value;
+}
+
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t event_mask, bool enabled, gpio_irq_callback_t callback)
+{
+    if (gpio >= MOCK_GPIO_COUNT)
+        return;
+
+    if (enabled)
+        irq_events[gpio] |= event_mask;
+    else
+        irq_events[gpio] &= ~event_mask;
+    irq_callback = callback;
+}
+
+void mock_gpio_set_level(uint gpio, bool level)
+{
+    if (gpio >= MOCK_GPIO_COUNT)
+        return;
+
+    bool old = levels[gpio];
+    levels[gpio] = level;
+    driven[gpio] = true;
+
+    uint32_t events = 0;
+    if (old && !level)
+        events |= GPIO_IRQ_EDGE_FALL;
+    if (!old && level)
+        events |= GPIO_IRQ_EDGE_RISE;
+
+    events &= irq_events[gpio];
+    if (events && irq_callback)
+        irq_callback(gpio, events);
+}
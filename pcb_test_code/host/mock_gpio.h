@@ -0,0 +1,12 @@
+#ifndef __MOCK__GPIO__H__
+
+#define __MOCK__GPIO__H__
+
+#include "pico/stdlib.h"
+
+#define MOCK_GPIO_COUNT 30
+
+// drive an input from the outside (a simulated chip), fires the edge interrupt if enabled
+void mock_gpio_set_level(uint gpio, bool level);
+
+#endif
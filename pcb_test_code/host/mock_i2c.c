@@ -0,0 +1,183 @@
+#include "mock_i2c.h"
+#include "mock_time.h"
+#include <string.h>
+
+struct i2c_inst {
+    unsigned int baudrate;
+    bool in_transaction; // the last transfer ended with nostop
+    uint32_t stretch_us;
+    bool irq_transfer;      // mock_i2c_set_irq_transfer()
+    bool blocking_transfer; // an i2c_*_blocking transfer is on the bus
+};
+
+i2c_inst_t i2c0_inst;
+i2c_inst_t i2c1_inst;
+
+static struct {
+    i2c_inst_t *i2c;
+    uint8_t addr;
+    const mock_i2c_device_ops_t *ops;
+    void *ctx;
+} devices[MOCK_I2C_MAX_DEVICES];
+static int device_count;
+
+static mock_i2c_stats_t stats;
+
+
+int mock_i2c_attach(i2c_inst_t *i2c, uint8_t addr, const mock_i2c_device_ops_t *ops, void *ctx)
+{
+    if (device_count >= MOCK_I2C_MAX_DEVICES)
+        return -1;
+
+    devices[device_count].i2c = i2c;
+    devices[device_count].addr = addr;
+    devices[device_count].ops = ops;
+    devices[device_count].ctx = ctx;
+    device_count++;
+    return 0;
+}
+
+void mock_i2c_detach_all(void)
+{
+    device_count = 0;
+}
+
+static int find_device(i2c_inst_t *i2c, uint8_t addr)
+{
+    for (int i = 0; i < device_count; i++)
+        if (devices[i].i2c == i2c && devices[i].addr == addr)
+            return i;
+    return -1;
+}
+
+// 9 clocks per byte (8 data + ACK), plus the address byte of the transfer
+uint32_t mock_i2c_transfer_time_us(i2c_inst_t *i2c, size_t len)
+{
+    unsigned int baudrate = i2c->baudrate ? i2c->baudrate : 100 * 1000;
+    return (uint32_t)(((uint64_t)(len + 1) * 9 * 1000000 + baudrate - 1) / baudrate) + i2c->stretch_us;
+}
+
+void mock_i2c_set_stretch_us(i2c_inst_t *i2c, uint32_t stretch_us)
+{
+    i2c->stretch_us = stretch_us;
+}
+
+static int count_transfer(i2c_inst_t *i2c, int ret, bool nostop)
+{
+    if (!i2c->in_transaction)
+        stats.transactions++;
+
+    if (ret < 0)
+    {
+        stats.nacks++;
+        i2c->in_transaction = false; // the controller sends STOP after a NACK
+    }
+    else
+    {
+        stats.bytes += ret;
+        i2c->in_transaction = nostop;
+    }
+    return ret;
+}
+
+int mock_i2c_write(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop)
+{
+    int dev = find_device(i2c, addr);
+    int ret = dev < 0 ? PICO_ERROR_GENERIC : devices[dev].ops->write(devices[dev].ctx, src, len, nostop);
+    return count_transfer(i2c, ret, nostop);
+}
+
+int mock_i2c_read(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop)
+{
+    int dev = find_device(i2c, addr);
+    int ret = dev < 0 ? PICO_ERROR_GENERIC : devices[dev].ops->read(devices[dev].ctx, dst, len, nostop);
+    return count_transfer(i2c, ret, nostop);
+}
+
+unsigned int i2c_hw_index(i2c_inst_t *i2c)
+{
+    return i2c == i2c1 ? 1 : 0;
+}
+
+unsigned int i2c_init(i2c_inst_t *i2c, unsigned int baudrate)
+{
+    i2c->baudrate = baudrate;
+    i2c->in_transaction = false;
+    i2c->irq_transfer = false;
+    return baudrate;
+}
+
+unsigned int i2c_set_baudrate(i2c_inst_t *i2c, unsigned int baudrate)
+{
+    i2c->baudrate = baudrate;
+    return baudrate;
+}
+
+void mock_i2c_set_irq_transfer(i2c_inst_t *i2c, bool active)
+{
+    if (active && i2c->blocking_transfer)
+        stats.collisions++;
+    i2c->irq_transfer = active;
+}
+
+// the bus time of a blocking transfer passes with the controller taken, timers and other transfers run meanwhile
+static void blocking_bus_time(i2c_inst_t *i2c, uint32_t us)
+{
+    if (i2c->irq_transfer)
+        stats.collisions++;
+    i2c->blocking_transfer = true;
+    mock_time_advance_us(us);
+    i2c->blocking_transfer = false;
+}
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop)
+{
+    int ret = mock_i2c_write(i2c, addr, src, len, nostop);
+    blocking_bus_time(i2c, mock_i2c_transfer_time_us(i2c, ret < 0 ? 0 : len));
+    return ret;
+}
+
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop)
+{
+    int ret = mock_i2c_read(i2c, addr, dst, len, nostop);
+    blocking_bus_time(i2c, mock_i2c_transfer_time_us(i2c, ret < 0 ? 0 : len));
+    return ret;
+}
+
+// a transfer that would take longer than the timeout is aborted before the device sees it
+static bool timed_out(i2c_inst_t *i2c, size_t len, unsigned int timeout_us)
+{
+    if (mock_i2c_transfer_time_us(i2c, len) <= timeout_us)
+        return false;
+
+    if (!i2c->in_transaction)
+        stats.transactions++;
+    stats.timeouts++;
+    i2c->in_transaction = false;
+    mock_time_advance_us(timeout_us);
+    return true;
+}
+
+int i2c_write_timeout_us(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop, unsigned int timeout_us)
+{
+    if (timed_out(i2c, len, timeout_us))
+        return PICO_ERROR_TIMEOUT;
+    return i2c_write_blocking(i2c, addr, src, len, nostop);
+}
+
+int i2c_read_timeout_us(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop, unsigned int timeout_us)
+{
+    if (timed_out(i2c, len, timeout_us))
+        return PICO_ERROR_TIMEOUT;
+    return i2c_read_blocking(i2c, addr, dst, len, nostop);
+}
+
+void mock_i2c_get_stats(mock_i2c_stats_t *s)
+{
+    *s = stats;
+}
+
+void mock_i2c_reset_stats(void)
+{
+    memset(&stats, 0, sizeof(stats));
+}
@@ -0,0 +1,43 @@
+#ifndef __MOCK__I2C__H__
+
+#define __MOCK__I2C__H__
+
+#include "hardware/i2c.h"
+
+// Simulated I2C buses. Devices attach to a bus/address pair and get every transfer
+// addressed to them, addresses with no device attached NACK like on a real bus.
+
+#define MOCK_I2C_MAX_DEVICES 16
+
+typedef struct {
+    // return len or a negative PICO_ERROR_* for a NACK
+    int (*write)(void *ctx, const uint8_t *src, size_t len, bool nostop);
+    int (*read)(void *ctx, uint8_t *dst, size_t len, bool nostop);
+} mock_i2c_device_ops_t;
+
+typedef struct {
+    uint32_t transactions; // START ... STOP, a repeated start does not open a new one
+    uint32_t bytes;        // payload bytes on the bus, address bytes excluded
+    uint32_t nacks;
+    uint32_t timeouts;     // i2c_*_timeout_us transfers that ran out of time
+    uint32_t collisions;   // blocking and interrupt driven transfers on one controller at the same time
+} mock_i2c_stats_t;
+
+int mock_i2c_attach(i2c_inst_t *i2c, uint8_t addr, const mock_i2c_device_ops_t *ops, void *ctx);
+void mock_i2c_detach_all(void);
+
+// bus time of one transfer of len bytes at the configured baudrate
+uint32_t mock_i2c_transfer_time_us(i2c_inst_t *i2c, size_t len);
+// extra time every transfer takes, like a device stretching the clock or slow pull-ups
+void mock_i2c_set_stretch_us(i2c_inst_t *i2c, uint32_t stretch_us);
+// same as i2c_*_blocking but without moving the virtual clock,
+// for simulated peripherals that keep their own timing
+int mock_i2c_write(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop);
+int mock_i2c_read(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop);
+// an interrupt driven transfer holds the controller (mock_i2c_async.c), blocking transfers meeting it are collisions
+void mock_i2c_set_irq_transfer(i2c_inst_t *i2c, bool active);
+
+void mock_i2c_get_stats(mock_i2c_stats_t *stats);
+void mock_i2c_reset_stats(void);
+
+#endif
@@ -0,0 +1,79 @@
+#include "max77654_async_port.h"
+#include "mock_i2c.h"
+#include "mock_time.h"
+
+// Simulated interrupt driven I2C controllers for max77654_async.c, one per bus.
+// A transfer completes once the virtual clock has passed its bus time,
+// the data itself goes through mock_i2c like a blocking transfer would.
+
+#define I2C_BUSES 2
+
+typedef struct {
+    max77654_async_req_t *xfer;
+    uint64_t xfer_done_us;
+    uint64_t bus_free_us; // end of the last transfer, back-to-back requests start there
+} async_bus_t;
+
+static async_bus_t buses[I2C_BUSES];
+
+
+static void finish_transfers(uint64_t now_us)
+{
+    for (int i = 0; i < I2C_BUSES; i++)
+    {
+        while (buses[i].xfer && now_us >= buses[i].xfer_done_us)
+        {
+            max77654_async_req_t *req = buses[i].xfer;
+            int ret;
+
+            buses[i].xfer = NULL;
+            buses[i].bus_free_us = buses[i].xfer_done_us;
+            mock_i2c_set_irq_transfer(req->i2c, false);
+            if (req->read)
+            {
+                ret = mock_i2c_write(req->i2c, req->addr, &req->reg, 1, true);
+                if (ret >= 0)
+                    ret = mock_i2c_read(req->i2c, req->addr, req->data, req->len, false);
+            }
+            else
+            {
+                uint8_t buf[1 + MAX77654_ASYNC_MAX_LEN];
+                buf[0] = req->reg;
+                for (int j = 0; j < req->len; j++)
+                    buf[1 + j] = req->data[j];
+                ret = mock_i2c_write(req->i2c, req->addr, buf, req->len + 1, false);
+            }
+
+            max77654_async_complete(req->i2c, ret < 0 ? -1 : 0); // may start the next transfer
+        }
+    }
+}
+
+
+void max77654_async_port_init(i2c_inst_t *i2c)
+{
+    buses[i2c_hw_index(i2c)].xfer = NULL;
+    mock_time_add_hook(finish_transfers);
+}
+
+void max77654_async_port_start(max77654_async_req_t *req)
+{
+    uint32_t bus_us;
+
+    if (req->read)
+        bus_us = mock_i2c_transfer_time_us(req->i2c, 1) + mock_i2c_transfer_time_us(req->i2c, req->len);
+    else
+        bus_us = mock_i2c_transfer_time_us(req->i2c, req->len + 1);
+
+    async_bus_t *bus = &buses[i2c_hw_index(req->i2c)];
+    uint64_t start_us = time_us_64() > bus->bus_free_us ? time_us_64() : bus->bus_free_us;
+
+    bus->xfer = req;
+    bus->xfer_done_us = start_us + bus_us;
+    mock_i2c_set_irq_transfer(req->i2c, true);
+}
+
+void max77654_async_port_idle(void)
+{
+    mock_time_advance_us(1);
+}
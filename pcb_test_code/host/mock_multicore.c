@@ -0,0 +1,27 @@
+#include "pico/multicore.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Code that needs core 1 cannot run on the host, fail loudly instead of hanging in the FIFO
+
+void multicore_launch_core1(void (*entry)(void))
+{
+    (void)entry;
+    fprintf(stderr, "multicore_launch_core1: core 1 is not simulated\n");
+    exit(1);
+}
+
+void multicore_fifo_push_blocking(uint32_t data)
+{
+    (void)data;
+}
+
+uint32_t multicore_fifo_pop_blocking(void)
+{
+    fprintf(stderr, "multicore_fifo_pop_blocking: core 1 is not simulated\n");
+    exit(1);
+}
+
+void multicore_lockout_victim_init(void)
+{
+}
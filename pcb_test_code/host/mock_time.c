@@ -0,0 +1,209 @@
+#include "mock_time.h"
+#include "hardware/timer.h"
+
+static uint64_t now_us;
+static mock_time_hook_t hooks[MOCK_TIME_MAX_HOOKS];
+static int hook_count;
+static repeating_timer_t *timers;
+static int advance_depth; // > 0 while timer callbacks run, nested advances do not fire timers
+
+static struct {
+    bool claimed;
+    bool armed;
+    absolute_time_t target;
+    hardware_alarm_callback_t callback;
+} alarms[NUM_TIMERS];
+
+
+uint64_t time_us_64(void)
+{
+    return now_us;
+}
+
+static void run_hooks(void)
+{
+    for (int i = 0; i < hook_count; i++)
+        hooks[i](now_us);
+}
+
+static repeating_timer_t *earliest_timer(void)
+{
+    repeating_timer_t *first = NULL;
+
+    for (repeating_timer_t *t = timers; t; t = t->next_timer)
+        if (first == NULL || t->next_us < first->next_us)
+            first = t;
+    return first;
+}
+
+static int earliest_alarm(void)
+{
+    int first = -1;
+
+    for (int i = 0; i < NUM_TIMERS; i++)
+        if (alarms[i].armed && (first < 0 || alarms[i].target < alarms[first].target))
+            first = i;
+    return first;
+}
+
+// Moves the clock in steps from one timer deadline to the next so callbacks see the right time
+void mock_time_advance_us(uint64_t us)
+{
+    uint64_t target = now_us + us;
+
+    if (advance_depth > 0)
+    {
+        now_us = target;
+        run_hooks();
+        return;
+    }
+
+    while (1)
+    {
+        repeating_timer_t *t = earliest_timer();
+        int a = earliest_alarm();
+
+        // a hardware alarm goes first if it is due no later than the next repeating timer
+        if (a >= 0 && alarms[a].target <= target && (t == NULL || alarms[a].target <= t->next_us))
+        {
+            if (alarms[a].target > now_us)
+                now_us = alarms[a].target;
+            run_hooks();
+
+            alarms[a].armed = false;
+            advance_depth++;
+            if (alarms[a].callback)
+                alarms[a].callback(a);
+            advance_depth--;
+
+            if (now_us > target)
+                target = now_us;
+            continue;
+        }
+
+        if (t == NULL || t->next_us > target)
+        {
+            now_us = target;
+            run_hooks();
+            return;
+        }
+
+        if (t->next_us > now_us)
+            now_us = t->next_us;
+        run_hooks();
+
+        // negative delay: fixed rate from the last deadline, positive: from the end of the callback
+        absolute_time_t deadline = t->next_us;
+        advance_depth++;
+        bool again = t->callback(t);
+        advance_depth--;
+
+        if (again && t->delay_us)
+            t->next_us = t->delay_us < 0 ? deadline - t->delay_us : now_us + t->delay_us;
+        else
+            cancel_repeating_timer(t);
+
+        if (now_us > target)
+            target = now_us;
+    }
+}
+
+bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t callback, void *user_data, repeating_timer_t *out)
+{
+    out->delay_us = delay_us;
+    out->next_us = now_us + (delay_us < 0 ? -delay_us : delay_us);
+    out->callback = callback;
+    out->user_data = user_data;
+    out->next_timer = timers;
+    timers = out;
+    return true;
+}
+
+bool cancel_repeating_timer(repeating_timer_t *timer)
+{
+    for (repeating_timer_t **t = &timers; *t; t = &(*t)->next_timer)
+    {
+        if (*t == timer)
+        {
+            *t = timer->next_timer;
+            return true;
+        }
+    }
+    return false;
+}
+
+int hardware_alarm_claim_unused(bool required)
+{
+    for (int i = 0; i < NUM_TIMERS; i++)
+    {
+        if (!alarms[i].claimed)
+        {
+            alarms[i].claimed = true;
+            return i;
+        }
+    }
+    return required ? PICO_ERROR_GENERIC : -1;
+}
+
+void hardware_alarm_unclaim(uint alarm_num)
+{
+    alarms[alarm_num].claimed = false;
+    alarms[alarm_num].armed = false;
+}
+
+void hardware_alarm_set_callback(uint alarm_num, hardware_alarm_callback_t callback)
+{
+    alarms[alarm_num].callback = callback;
+    if (callback == NULL)
+        alarms[alarm_num].armed = false;
+}
+
+bool hardware_alarm_set_target(uint alarm_num, absolute_time_t t)
+{
+    if (t <= now_us)
+    {
+        alarms[alarm_num].armed = false;
+        return true;
+    }
+
+    alarms[alarm_num].target = t;
+    alarms[alarm_num].armed = true;
+    return false;
+}
+
+void hardware_alarm_cancel(uint alarm_num)
+{
+    alarms[alarm_num].armed = false;
+}
+
+void mock_time_add_hook(mock_time_hook_t hook)
+{
+    for (int i = 0; i < hook_count; i++)
+        if (hooks[i] == hook)
+            return;
+
+    if (hook_count < MOCK_TIME_MAX_HOOKS)
+        hooks[hook_count++] = hook;
+}
+
+void mock_time_reset(void)
+{
+    now_us = 0;
+}
+
+void sleep_us(uint64_t us)
+{
+    mock_time_advance_us(us);
+}
+
+void sleep_ms(uint32_t ms)
+{
+    mock_time_advance_us((uint64_t)ms * 1000);
+}
+
+bool best_effort_wfe_or_timeout(absolute_time_t timeout_timestamp)
+{
+    if (now_us < timeout_timestamp)
+        mock_time_advance_us(timeout_timestamp - now_us < 10 ? timeout_timestamp - now_us : 10);
+    return now_us >= timeout_timestamp;
+}
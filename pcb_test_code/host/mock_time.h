@@ -0,0 +1,17 @@
+#ifndef __MOCK__TIME__H__
+
+#define __MOCK__TIME__H__
+
+#include "pico/stdlib.h"
+
+// Hook called every time the virtual clock moves, simulated peripherals use it to
+// finish transfers that are due. Only one hook per peripheral slot.
+typedef void (*mock_time_hook_t)(uint64_t now_us);
+
+#define MOCK_TIME_MAX_HOOKS 8
+
+void mock_time_advance_us(uint64_t us);
+void mock_time_add_hook(mock_time_hook_t hook);
+void mock_time_reset(void);
+
+#endif
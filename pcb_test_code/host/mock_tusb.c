@@ -0,0 +1,221 @@
+#include "mock_tusb.h"
+#include "mock_time.h"
+#include "cdc_ring.h"
+
+#define PIPES (2 * CFG_TUD_CDC) // OUT and IN of every interface, even index is OUT
+
+typedef struct {
+    bool connected;
+    bool rx_event; // OUT data arrived, tud_cdc_rx_cb() is due
+    bool tx_event; // an IN packet went out, tud_cdc_tx_complete_cb() is due
+
+    uint8_t rx_fifo_buf[CFG_TUD_CDC_RX_BUFSIZE];
+    cdc_ring_t rx_fifo; // OUT endpoint FIFO, read by tud_cdc_n_read()
+    uint8_t tx_fifo_buf[CFG_TUD_CDC_TX_BUFSIZE];
+    cdc_ring_t tx_fifo; // IN endpoint FIFO, filled by tud_cdc_n_write()
+
+    uint8_t host_out_buf[MOCK_TUSB_HOST_BUFFER];
+    cdc_ring_t host_out; // written by the host application, not sent yet
+    uint8_t host_in_buf[MOCK_TUSB_HOST_BUFFER];
+    cdc_ring_t host_in;  // received, not read by the host application yet
+    uint32_t host_room;
+} usb_itf_t;
+
+static usb_itf_t itfs[CFG_TUD_CDC];
+static uint64_t link_ns; // end of the packet on the bus right now
+static int next_pipe;
+static bool hooked;
+static mock_tusb_stats_t stats;
+
+
+uint32_t mock_tusb_packet_time_ns(uint32_t len)
+{
+    // token, data and handshake packets with SYNC, PID, CRC, EOP and turnaround come to about 13 bytes
+    return (len + 13) * 8 * 1000 / 12;
+}
+
+// Moves one packet on a pipe if both ends have room, returns its length
+static uint32_t move_packet(int pipe)
+{
+    usb_itf_t *u = &itfs[pipe / 2];
+    uint32_t n;
+
+    if (!u->connected)
+        return 0;
+
+    if (pipe & 1)
+    {
+        // IN: the host polls while it has room for a whole packet
+        n = MIN(cdc_ring_count(&u->tx_fifo), CFG_TUD_CDC_EP_BUFSIZE);
+        if (n == 0 || cdc_ring_count(&u->host_in) + CFG_TUD_CDC_EP_BUFSIZE > u->host_room)
+            return 0;
+
+        uint8_t packet[CFG_TUD_CDC_EP_BUFSIZE];
+        cdc_ring_read(&u->tx_fifo, packet, n);
+        cdc_ring_write(&u->host_in, packet, n);
+        u->tx_event = true;
+        stats.in_bytes += n;
+        stats.in_packets++;
+    }
+    else
+    {
+        // OUT: TinyUSB only arms the endpoint while its FIFO has room for a whole packet
+        n = MIN(cdc_ring_count(&u->host_out), CFG_TUD_CDC_EP_BUFSIZE);
+        if (n == 0 || cdc_ring_space(&u->rx_fifo) < CFG_TUD_CDC_EP_BUFSIZE)
+            return 0;
+
+        uint8_t packet[CFG_TUD_CDC_EP_BUFSIZE];
+        cdc_ring_read(&u->host_out, packet, n);
+        cdc_ring_write(&u->rx_fifo, packet, n);
+        u->rx_event = true;
+        stats.out_bytes += n;
+        stats.out_packets++;
+    }
+    return n;
+}
+
+// The USB controller works on its own, the bus catches up whenever the virtual clock moves
+static void link_run(uint64_t now_us)
+{
+    uint64_t now_ns = now_us * 1000;
+
+    while (link_ns < now_ns)
+    {
+        uint32_t n = 0;
+        int i;
+
+        for (i = 0; i < PIPES && n == 0; i++)
+            n = move_packet((next_pipe + i) % PIPES);
+
+        if (n == 0)
+        {
+            link_ns = now_ns; // idle, the next packet cannot start in the past
+            break;
+        }
+        next_pipe = (next_pipe + i) % PIPES;
+        link_ns += mock_tusb_packet_time_ns(n);
+    }
+}
+
+void mock_tusb_reset(void)
+{
+    for (uint8_t itf = 0; itf < CFG_TUD_CDC; itf++)
+    {
+        usb_itf_t *u = &itfs[itf];
+
+        u->connected = false;
+        u->rx_event = false;
+        u->tx_event = false;
+        cdc_ring_init(&u->rx_fifo, u->rx_fifo_buf, CFG_TUD_CDC_RX_BUFSIZE);
+        cdc_ring_init(&u->tx_fifo, u->tx_fifo_buf, CFG_TUD_CDC_TX_BUFSIZE);
+        cdc_ring_init(&u->host_out, u->host_out_buf, MOCK_TUSB_HOST_BUFFER);
+        cdc_ring_init(&u->host_in, u->host_in_buf, MOCK_TUSB_HOST_BUFFER);
+        u->host_room = MOCK_TUSB_HOST_BUFFER;
+    }
+    link_ns = time_us_64() * 1000;
+    next_pipe = 0;
+    mock_tusb_reset_stats();
+
+    if (!hooked)
+    {
+        mock_time_add_hook(link_run);
+        hooked = true;
+    }
+}
+
+void mock_tusb_connect(uint8_t itf, bool connected)
+{
+    itfs[itf].connected = connected;
+}
+
+uint32_t mock_tusb_host_write(uint8_t itf, const uint8_t *data, uint32_t len)
+{
+    return cdc_ring_write(&itfs[itf].host_out, data, len);
+}
+
+uint32_t mock_tusb_host_available(uint8_t itf)
+{
+    return cdc_ring_count(&itfs[itf].host_in);
+}
+
+uint32_t mock_tusb_host_read(uint8_t itf, uint8_t *data, uint32_t len)
+{
+    return cdc_ring_read(&itfs[itf].host_in, data, len);
+}
+
+void mock_tusb_host_set_room(uint8_t itf, uint32_t room)
+{
+    itfs[itf].host_room = MAX(MIN(room, MOCK_TUSB_HOST_BUFFER), CFG_TUD_CDC_EP_BUFSIZE);
+}
+
+void mock_tusb_get_stats(mock_tusb_stats_t *out)
+{
+    *out = stats;
+}
+
+void mock_tusb_reset_stats(void)
+{
+    stats = (mock_tusb_stats_t){0};
+}
+
+// ---- tusb.h ----
+
+bool tusb_init(void)
+{
+    return true;
+}
+
+void usbd_id_init(void)
+{
+}
+
+void tud_task(void)
+{
+    for (uint8_t itf = 0; itf < CFG_TUD_CDC; itf++)
+    {
+        usb_itf_t *u = &itfs[itf];
+
+        if (u->rx_event)
+        {
+            u->rx_event = false;
+            if (cdc_ring_count(&u->rx_fifo))
+                tud_cdc_rx_cb(itf);
+        }
+        if (u->tx_event)
+        {
+            u->tx_event = false;
+            tud_cdc_tx_complete_cb(itf);
+        }
+    }
+}
+
+bool tud_cdc_n_connected(uint8_t itf)
+{
+    return itfs[itf].connected;
+}
+
+uint32_t tud_cdc_n_available(uint8_t itf)
+{
+    return cdc_ring_count(&itfs[itf].rx_fifo);
+}
+
+uint32_t tud_cdc_n_read(uint8_t itf, void *buffer, uint32_t bufsize)
+{
+    return cdc_ring_read(&itfs[itf].rx_fifo, buffer, bufsize);
+}
+
+uint32_t tud_cdc_n_write(uint8_t itf, const void *buffer, uint32_t bufsize)
+{
+    return cdc_ring_write(&itfs[itf].tx_fifo, buffer, bufsize);
+}
+
+uint32_t tud_cdc_n_write_flush(uint8_t itf)
+{
+    // the IN endpoint is always armed, link_run() sends whatever is in the FIFO
+    return cdc_ring_count(&itfs[itf].tx_fifo);
+}
+
+uint32_t tud_cdc_n_write_available(uint8_t itf)
+{
+    return cdc_ring_space(&itfs[itf].tx_fifo);
+}
@@ -0,0 +1,38 @@
+#ifndef __MOCK__TUSB__H__
+
+#define __MOCK__TUSB__H__
+
+#include "tusb.h"
+
+// Simulated full speed USB link behind the tusb.h stand-in. The device side has TinyUSB's
+// endpoint FIFOs, the host side a queue per direction that the test plays the PC application on.
+// Packets of up to 64 bytes move while the virtual clock runs, round robin over all IN and OUT pipes,
+// each taking its time on the 12 Mbit/s bus; tud_task() then runs the rx / tx complete callbacks.
+// A slow consumer is a host that keeps only a little room for IN data, the device FIFO backs up then.
+
+#define MOCK_TUSB_HOST_BUFFER 65536 // largest host side queue per direction, a power of two
+
+typedef struct {
+    uint64_t in_bytes;      // device to host
+    uint64_t out_bytes;     // host to device
+    uint32_t in_packets;
+    uint32_t out_packets;
+} mock_tusb_stats_t;
+
+void mock_tusb_reset(void);
+void mock_tusb_connect(uint8_t itf, bool connected);
+
+// bus time of one packet of len bytes including token, handshake and bit stuffing overhead
+uint32_t mock_tusb_packet_time_ns(uint32_t len);
+
+// host application side of an interface
+uint32_t mock_tusb_host_write(uint8_t itf, const uint8_t *data, uint32_t len);
+uint32_t mock_tusb_host_available(uint8_t itf);
+uint32_t mock_tusb_host_read(uint8_t itf, uint8_t *data, uint32_t len);
+// bytes of IN data the host takes before it stops reading the endpoint (NAKs), at most MOCK_TUSB_HOST_BUFFER
+void mock_tusb_host_set_room(uint8_t itf, uint32_t room);
+
+void mock_tusb_get_stats(mock_tusb_stats_t *stats);
+void mock_tusb_reset_stats(void);
+
+#endif
@@ -0,0 +1,11 @@
+// Must not compile: 5600 mV is above the SBB range, the profile macros turn it into a build error.
+// Built by the profile_rejects_out_of_range test only.
+#include <stdbool.h>
+#include "max77654_profile.h"
+
+const max77654_profile_t out_of_range = MAX77654_PROFILE(
+    MAX77654_SBB(5600, true, MAX77654_SBB_IPK_330MA, MAX77654_SBB_MODE_BUCK_BOOST, false),
+    MAX77654_SBB(3300, true, MAX77654_SBB_IPK_330MA, MAX77654_SBB_MODE_BUCK_BOOST, false),
+    MAX77654_SBB(3300, true, MAX77654_SBB_IPK_330MA, MAX77654_SBB_MODE_BUCK_BOOST, false),
+    MAX77654_LDO(1800, true, 0, false),
+    MAX77654_LDO(1800, true, 0, false));
@@ -0,0 +1,11 @@
+#ifndef __TEST_CDC_CONFIG_H__
+
+#define __TEST_CDC_CONFIG_H__
+
+// three unequal interfaces for test_usb_cdc_config, see usb_cdc_config.h
+#define USB_CDC_INTERFACES(X) \
+    X(0, "control", 64, 128) \
+    X(1, "telemetry", 256, 8192) \
+    X(2, "debug", 2048, 64)
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef __TEST_CHECK_H__
+
+#define __TEST_CHECK_H__
+
+// Checks of the host tests: a failed CHECK prints where and why and is counted,
+// main() ends with return test_report(); so ctest sees the result.
+
+#include <stdio.h>
+
+static int failures;
+
+#define CHECK(cond, ...) { if (!(cond)) { failures++; printf("FAIL %s:%d ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); } }
+// a register of the MAX77654 model, the test calls it pmic
+#define CHECK_REG(reg, expected) { uint8_t v = max77654_model_peek(&pmic, reg); CHECK(v == (expected), "reg 0x%02x = 0x%02x, expected 0x%02x", reg, v, expected); }
+
+static inline int test_report(void)
+{
+    printf("%s (%d failures)\n", failures ? "FAILED" : "PASSED", failures);
+    return failures ? 1 : 0;
+}
+
+#endif
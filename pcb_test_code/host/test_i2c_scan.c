@@ -0,0 +1,102 @@
+// Scans a simulated bus with a MAX77654 model and two plain devices: addresses found at 1MHz,
+// reserved ranges, register 0 identification, scan time, a stuck bus and both output formats
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "i2c_scan.h"
+#include "max77654_model.h"
+#include "mock_i2c.h"
+#include "test_check.h"
+
+static max77654_model_t pmic;
+
+// a device with 4 registers, register address byte then auto-increment
+typedef struct {
+    uint8_t regs[4];
+    uint8_t pointer;
+} plain_dev_t;
+
+static int plain_write(void *ctx, const uint8_t *src, size_t len, bool nostop)
+{
+    (void)nostop;
+    plain_dev_t *d = ctx;
+    d->pointer = src[0] & 3;
+    for (size_t i = 1; i < len; i++)
+        d->regs[d->pointer++ & 3] = src[i];
+    return len;
+}
+
+static int plain_read(void *ctx, uint8_t *dst, size_t len, bool nostop)
+{
+    (void)nostop;
+    plain_dev_t *d = ctx;
+    for (size_t i = 0; i < len; i++)
+        dst[i] = d->regs[d->pointer++ & 3];
+    return len;
+}
+
+static const mock_i2c_device_ops_t plain_ops = { plain_write, plain_read };
+static plain_dev_t sensor = { .regs = { 0xA7 } };
+static plain_dev_t reserved = { .regs = { 0x5C } };
+
+int main() {
+    i2c_scan_config_t cfg = { .baudrate = 1000 * 1000 };
+    i2c_scan_result_t res;
+
+    max77654_model_reset(&pmic);
+    max77654_model_attach(&pmic, i2c1, 0x48);
+    mock_i2c_attach(i2c1, 0x10, &plain_ops, &sensor);
+    mock_i2c_attach(i2c1, 0x03, &plain_ops, &reserved);
+
+    // reserved ranges are skipped, only the address byte goes out for an empty address
+    CHECK(i2c_scan(i2c1, &cfg, &res) == 2, "found %d devices", res.count);
+    CHECK(i2c_scan_bit(res.found, 0x10) && i2c_scan_bit(res.found, 0x48) && !i2c_scan_bit(res.found, 0x03), "found map");
+    CHECK(res.probes == 112 && res.baudrate == 1000 * 1000, "%u probes at %u Hz", res.probes, (unsigned)res.baudrate);
+    uint32_t expect_us = 110 * mock_i2c_transfer_time_us(i2c1, 0) + 2 * mock_i2c_transfer_time_us(i2c1, 1);
+    CHECK(res.elapsed_us == expect_us, "scan took %u us, expected %u", (unsigned)res.elapsed_us, (unsigned)expect_us);
+    CHECK(!i2c_scan_bit(res.id_valid, 0x10), "register 0 read without identify");
+
+    // 100kHz when no speed is given, not 100Hz
+    cfg.baudrate = 0;
+    i2c_scan(i2c1, &cfg, &res);
+    CHECK(res.baudrate == 100 * 1000 && res.elapsed_us < 20000, "%u Hz, %u us", (unsigned)res.baudrate, (unsigned)res.elapsed_us);
+
+    // everything, with identification
+    cfg.baudrate = 1000 * 1000;
+    cfg.include_reserved = true;
+    cfg.identify = true;
+    max77654_model_poke(&pmic, 0x00, 0x00);
+    CHECK(i2c_scan(i2c1, &cfg, &res) == 3 && res.probes == 128, "%d devices in %u probes", res.count, res.probes);
+    CHECK(i2c_scan_bit(res.id_valid, 0x10) && res.id[0x10] == 0xA7, "sensor id 0x%02x", res.id[0x10]);
+    CHECK(i2c_scan_bit(res.id_valid, 0x03) && res.id[0x03] == 0x5C, "reserved id 0x%02x", res.id[0x03]);
+    CHECK(i2c_scan_bit(res.id_valid, 0x48) && res.id[0x48] == 0x00, "pmic id 0x%02x", res.id[0x48]);
+
+    char csv[1024];
+    i2c_scan_format_csv(&res, csv, sizeof(csv));
+    char expect_csv[256];
+    snprintf(expect_csv, sizeof(expect_csv), "addr,status,reg0\n0x03,ack,0x5c\n0x10,ack,0xa7\n0x48,ack,0x00\n"
+             "# 3 devices, 128 probes in %u us at 1000000 Hz\n", (unsigned)res.elapsed_us);
+    CHECK(strcmp(csv, expect_csv) == 0, "csv:\n%s", csv);
+
+    uint8_t bin[I2C_SCAN_BIN_MAX];
+    size_t len = i2c_scan_format_binary(&res, bin);
+    CHECK(len == I2C_SCAN_BIN_HEADER + 6, "binary length %zu", len);
+    CHECK(bin[0] == 'I' && bin[1] == 0x01 && bin[2] == 3 && (bin[3] | (bin[4] << 8)) == 1000, "binary header");
+    CHECK((bin[5] | (bin[6] << 8) | (bin[7] << 16) | ((uint32_t)bin[8] << 24)) == res.elapsed_us, "binary elapsed");
+    CHECK(bin[9] == (0x03 | 0x80) && bin[10] == 0x5C && bin[11] == (0x10 | 0x80) && bin[12] == 0xA7
+          && bin[13] == (0x48 | 0x80) && bin[14] == 0x00, "binary devices");
+
+    // SCL held low: a few timeouts and the scan gives up
+    mock_i2c_set_stretch_us(i2c1, 100000);
+    cfg.timeout_us = 500;
+    CHECK(i2c_scan(i2c1, &cfg, &res) == 0 && res.bus_stuck, "stuck bus not detected");
+    CHECK(res.probes == I2C_SCAN_MAX_TIMEOUTS && res.elapsed_us == I2C_SCAN_MAX_TIMEOUTS * 500, "%u probes in %u us",
+          res.probes, (unsigned)res.elapsed_us);
+    i2c_scan_format_csv(&res, csv, sizeof(csv));
+    CHECK(strstr(csv, "0x00,timeout,\n") && strstr(csv, ", bus stuck\n"), "csv:\n%s", csv);
+    len = i2c_scan_format_binary(&res, bin);
+    CHECK(len == I2C_SCAN_BIN_HEADER && bin[1] == 0x02, "stuck flag");
+
+    return test_report();
+}
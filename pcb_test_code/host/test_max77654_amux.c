@@ -0,0 +1,188 @@
+// Feeds synthetic AMUX waveforms through the capture ring and the fixed-point filter chain:
+// DC accuracy with ripple and noise, step response, output rate, channel selection in
+// CNFG_CHG_I, the discharge monitor scale and ring overruns
+#include <stdio.h>
+#include <stdlib.h>
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "max77654.h"
+#include "max77654_amux.h"
+#include "max77654_model.h"
+#include "mock_adc.h"
+#include "mock_time.h"
+#include "test_check.h"
+
+#define PMIC_ADDR 0x48
+
+static max77654_model_t pmic;
+
+// the quantity on the channel, in mV or uA, and its full scale on the AMUX pin
+typedef struct {
+    int32_t level;
+    int32_t step_level; // level after step_us, when step_us != 0
+    uint64_t step_us;
+    int32_t ripple;     // peak, square wave at 5 kHz
+    int32_t noise;      // peak, uniform
+    int32_t full_scale;
+    uint32_t lcg;
+} wave_t;
+
+static uint16_t wave_fn(uint64_t t_us, void *user)
+{
+    wave_t *w = user;
+    int32_t v = (w->step_us && t_us >= w->step_us) ? w->step_level : w->level;
+
+    v += (t_us / 100) % 2 ? w->ripple : -w->ripple;
+    w->lcg = w->lcg * 1664525u + 1013904223u;
+    if (w->noise)
+        v += (int32_t)(w->lcg >> 8) % (2 * w->noise + 1) - w->noise;
+
+    // AMUX pin mV, then ADC counts, rounded
+    int64_t pin_uV = (int64_t)v * MAX77654_AMUX_FULL_SCALE_MV * 1000 / w->full_scale;
+    int64_t counts = (pin_uV * 4096 + MAX77654_AMUX_VREF_MV * 500) / (MAX77654_AMUX_VREF_MV * 1000);
+    return counts < 0 ? 0 : counts > 4095 ? 4095 : counts;
+}
+
+// run the clock for us, polling every poll_us, collect the outputs
+static uint32_t run(uint32_t us, uint32_t poll_us, int32_t *out, uint32_t max)
+{
+    uint32_t n = 0;
+
+    for (uint32_t t = 0; t < us; t += poll_us)
+    {
+        mock_time_advance_us(poll_us);
+        n += max77654_amux_poll(&out[n], max - n);
+    }
+    return n;
+}
+
+static void test_filter(void)
+{
+    max77654_amux_filter_t f;
+    uint16_t samples[256];
+    int32_t out[8];
+
+    // the mean of 2048 and 2049 needs the Q8 fraction
+    for (int i = 0; i < 256; i++)
+        samples[i] = 2048 + (i & 1);
+    max77654_amux_filter_init(&f, 64, 0);
+    CHECK(max77654_amux_filter_feed(&f, samples, 256, out, 8) == 4, "decimation by 64");
+    CHECK(out[0] == 2048 * 256 + 128, "mean 0x%x", (unsigned)out[0]);
+
+    // outputs that do not fit are dropped, the state still advances
+    max77654_amux_filter_init(&f, 16, 0);
+    CHECK(max77654_amux_filter_feed(&f, samples, 256, out, 8) == 8, "max_out");
+
+    // IIR starts at the first mean and moves a quarter of the way per output
+    for (int i = 0; i < 64; i++)
+        samples[i] = 1000;
+    for (int i = 64; i < 128; i++)
+        samples[i] = 2000;
+    max77654_amux_filter_init(&f, 32, 2);
+    CHECK(max77654_amux_filter_feed(&f, samples, 128, out, 8) == 4, "iir outputs");
+    CHECK(out[1] == 1000 * 256 && out[2] == 1250 * 256 && out[3] == 1437 * 256 + 128, "iir %d %d %d",
+          (int)out[1] >> 8, (int)out[2] >> 8, (int)out[3] >> 8);
+}
+
+static void test_battery_voltage(void)
+{
+    static int32_t out[512];
+    wave_t w = {.level = 3800, .ripple = 40, .noise = 30, .full_scale = 4600, .lcg = 1};
+    max77654_amux_config_t cfg = {
+        .channel = MAX77654_AMUX_BATT_V,
+        .sample_rate_hz = 100000,
+        .decimation = 100, // 1 kHz out
+        .ema_shift = 2,
+        .settle_samples = 50,
+    };
+
+    mock_adc_set_waveform(wave_fn, &w);
+    CHECK(max77654_amux_start(&cfg) == 0, "start failed");
+    CHECK(max77654_model_peek(&pmic, MODEL_REG_CNFG_CHG_I) == 0xF3, "CNFG_CHG_I 0x%02x", max77654_model_peek(&pmic, MODEL_REG_CNFG_CHG_I));
+    CHECK(mock_adc_input() == MAX77654_AMUX_ADC_INPUT, "ADC input %u", mock_adc_input());
+
+    // 100 ms, polled every 2 ms
+    uint32_t n = run(100000, 2000, out, 512);
+    CHECK(n >= 99 && n <= 100, "%u outputs in 100 ms", (unsigned)n);
+
+    int32_t worst = 0;
+    for (uint32_t i = 4; i < n; i++)
+        if (abs(out[i] - 3800) > worst)
+            worst = abs(out[i] - 3800);
+    printf("BATT 3800 mV: %u outputs, worst error %d mV\n", (unsigned)n, (int)worst);
+    CHECK(worst <= 4, "error %d mV", (int)worst);
+
+    // step to 3600 mV: within 5 mV after 20 outputs (IIR 1/4, tau about 3.5 outputs)
+    w.step_level = 3600;
+    w.step_us = time_us_64() + 10000;
+    n = run(40000, 1000, out, 512);
+    CHECK(n >= 39 && n <= 40, "%u outputs in 40 ms", (unsigned)n);
+    CHECK(out[5] > 3790, "moved before the step: %d", (int)out[5]);
+    CHECK(abs(out[31] - 3600) <= 5, "after the step: %d", (int)out[31]);
+}
+
+static void test_discharge_current(void)
+{
+    static int32_t out[64];
+    wave_t w = {.level = 4100, .full_scale = 8200, .lcg = 7}; // half of the 8.2 mA range
+    max77654_amux_config_t cfg = {
+        .channel = MAX77654_AMUX_BATT_DISCHG_I,
+        .sample_rate_hz = 50000,
+        .decimation = 500,
+    };
+
+    CHECK(max77654_amux_set_discharge_scale(0) == 0, "scale");
+    mock_adc_set_waveform(wave_fn, &w);
+    CHECK(max77654_amux_start(&cfg) == 0, "start failed");
+    CHECK(max77654_model_peek(&pmic, MODEL_REG_CNFG_CHG_I) == 0x05, "CNFG_CHG_I 0x%02x", max77654_model_peek(&pmic, MODEL_REG_CNFG_CHG_I));
+
+    uint32_t n = run(20000, 1000, out, 64);
+    CHECK(n == 2, "%u outputs at 100 Hz", (unsigned)n);
+    CHECK(abs(out[n - 1] - 4100) <= 3, "discharge %d uA", (int)out[n - 1]);
+
+    // board calibration replaces the nominal one
+    max77654_amux_cal_t cal = {.gain_q16 = 1 << 16, .offset = -100};
+    max77654_amux_set_calibration(MAX77654_AMUX_BATT_DISCHG_I, &cal);
+    max77654_amux_start(&cfg);
+    n = run(10000, 1000, out, 64);
+    CHECK(n > 0 && abs(out[n - 1] - (int32_t)(4100 * 1250LL * 4096 / (8200 * 3300)) + 100) <= 1, "calibrated %d", (int)out[n - 1]);
+    max77654_amux_set_calibration(MAX77654_AMUX_BATT_DISCHG_I, NULL);
+}
+
+static void test_overrun(void)
+{
+    static int32_t out[64];
+    max77654_amux_stats_t before, after;
+    wave_t w = {.level = 1000, .full_scale = 1250, .lcg = 3};
+    max77654_amux_config_t cfg = {
+        .channel = MAX77654_AMUX_THM_V,
+        .sample_rate_hz = 500000,
+        .decimation = 1000,
+    };
+
+    mock_adc_set_waveform(wave_fn, &w);
+    max77654_amux_start(&cfg);
+    max77654_amux_get_stats(&before);
+    mock_time_advance_us(10000); // 5000 samples, the ring holds 1024
+    uint32_t n = max77654_amux_poll(out, 64);
+    max77654_amux_get_stats(&after);
+    CHECK(after.overruns == before.overruns + 1, "overrun not counted");
+    CHECK(n == 0, "%u outputs from half a ring", (unsigned)n);
+    n = run(4000, 500, out, 64);
+    CHECK(n >= 1 && abs(out[n - 1] - 1000) <= 1, "after overrun %d", n ? (int)out[n - 1] : 0);
+    max77654_amux_stop();
+    CHECK(max77654_amux_poll(out, 64) == 0, "poll after stop");
+}
+
+int main() {
+    max77654_model_reset(&pmic);
+    max77654_model_attach(&pmic, i2c1, PMIC_ADDR);
+    max77654_init(i2c1);
+
+    test_filter();
+    test_battery_voltage();
+    test_discharge_current();
+    test_overrun();
+
+    return test_report();
+}
@@ -0,0 +1,135 @@
+// Records the boot phases of max77654_store_boot() against the MAX77654 model, checks that runs
+// survive a soft reset (begin again without clearing RAM), that steady state writes are not recorded,
+// and that the packed report matches what PMIC_CMD_BOOT_REPORT sends
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "max77654.h"
+#include "max77654_boot.h"
+#include "max77654_store.h"
+#include "max77654_model.h"
+#include "mock_flash.h"
+#include "mock_i2c.h"
+#include "mock_time.h"
+#include "pmic_protocol.h"
+#include "test_check.h"
+
+static max77654_model_t pmic;
+
+static uint8_t response[PMIC_PROTO_MAX_PAYLOAD];
+static uint32_t response_len;
+
+static uint32_t collect(const uint8_t *data, uint32_t len)
+{
+    uint32_t in = 0, o = 0;
+
+    while (in < len - 1)
+    {
+        uint8_t code = data[in++];
+        for (uint8_t i = 1; i < code; i++)
+            response[o++] = data[in++];
+        if (code < 0xFF && in < len - 1)
+            response[o++] = 0;
+    }
+    response_len = o - 2;
+    return len;
+}
+
+static void call(uint8_t cmd, const uint8_t *args, uint32_t len)
+{
+    uint8_t payload[PMIC_PROTO_MAX_PAYLOAD], encoded[PMIC_PROTO_MAX_PAYLOAD + 4];
+
+    payload[0] = 1;
+    payload[1] = cmd;
+    memcpy(&payload[2], args, len);
+    response_len = 0;
+    pmic_proto_feed(encoded, pmic_proto_encode(payload, len + 2, encoded));
+}
+
+int main() {
+    static const uint8_t expected[][2] = {
+        {MAX77654_BOOT_MAIN, 0}, {MAX77654_BOOT_STORE, 0}, {MAX77654_BOOT_I2C_INIT, 0}, {MAX77654_BOOT_ON_BUS, 0},
+        {MAX77654_BOOT_ERCFLAG, 0}, {MAX77654_BOOT_REG_WRITE, 0x29}, {MAX77654_BOOT_REG_WRITE, 0x38},
+        {MAX77654_BOOT_RAILS_UP, 0}, {MAX77654_BOOT_USB_INIT, 0}, {MAX77654_BOOT_DONE, 0},
+    };
+    const max77654_boot_run_t *run;
+
+    mock_flash_reset();
+    mock_i2c_detach_all();
+    max77654_model_reset(&pmic);
+    max77654_model_attach(&pmic, i2c1, MAX77654_I2C_ADDR);
+
+    // nothing before the first begin
+    max77654_boot_mark(MAX77654_BOOT_APP, 1);
+    CHECK(!max77654_boot_recording() && max77654_boot_get_run(0) == NULL, "run before begin");
+
+    // boot 1: every phase of bringing the rails up
+    mock_time_advance_us(1500); // runtime init before main
+    max77654_boot_begin();
+    CHECK(max77654_store_boot(i2c1) == 0, "boot");
+    mock_time_advance_us(200);
+    max77654_boot_mark(MAX77654_BOOT_USB_INIT, 0);
+    max77654_boot_done();
+    SSBx_set_voltage(0, 1800); // after done, not recorded
+
+    run = max77654_boot_get_run(0);
+    CHECK(run && run->boot == 1 && run->finished && !run->overflow, "run 1");
+    CHECK(run && run->count == sizeof(expected) / sizeof(expected[0]), "%u marks", run ? run->count : 0);
+    for (unsigned int i = 0; run && i < run->count && i < sizeof(expected) / sizeof(expected[0]); i++)
+    {
+        CHECK(run->marks[i].phase == expected[i][0] && run->marks[i].arg == expected[i][1], "mark %u: phase %u arg 0x%02x",
+              i, run->marks[i].phase, run->marks[i].arg);
+        CHECK(i == 0 || run->marks[i].time_us >= run->marks[i - 1].time_us, "mark %u goes back in time", i);
+    }
+    if (run)
+    {
+        // the rail bursts take bus time at 100 kHz: 7 and 5 bytes
+        uint32_t rails_us = run->marks[7].time_us - run->marks[4].time_us;
+        uint32_t bus_us = mock_i2c_transfer_time_us(i2c1, 7) + mock_i2c_transfer_time_us(i2c1, 5);
+        CHECK(run->marks[0].time_us == 1500, "begin at %u us", run->marks[0].time_us);
+        CHECK(rails_us >= bus_us && rails_us < bus_us + 100, "rails took %u us, the bursts %u us", rails_us, bus_us);
+    }
+
+    // packed report
+    uint8_t report[256];
+    uint32_t n = max77654_boot_report(0, report, sizeof(report));
+    CHECK(run && n == (uint32_t)(6 + run->count * MAX77654_BOOT_MARK_SIZE), "report length %u", n);
+    CHECK(report[0] == 1 && report[4] == run->count && report[5] == 0x02, "report header");
+    CHECK(report[6 + 7 * 6] == MAX77654_BOOT_RAILS_UP
+          && (uint32_t)(report[8 + 7 * 6] | report[9 + 7 * 6] << 8 | report[10 + 7 * 6] << 16 | report[11 + 7 * 6] << 24)
+             == run->marks[7].time_us, "report mark");
+    CHECK(max77654_boot_report(0, report, 20) == 0, "report into a short buffer");
+
+    // soft reset, the PMIC is gone this time: boot 1 is still there behind boot 2
+    mock_i2c_detach_all();
+    max77654_boot_begin();
+    CHECK(max77654_store_boot(i2c1) == -1, "boot without the PMIC");
+    run = max77654_boot_get_run(0);
+    CHECK(run && run->boot == 2 && !run->finished, "run 2");
+    CHECK(run && run->marks[run->count - 1].phase == MAX77654_BOOT_ERROR && run->marks[run->count - 1].arg == MAX77654_BOOT_ON_BUS,
+          "failed probe not recorded");
+    run = max77654_boot_get_run(1);
+    CHECK(run && run->boot == 1 && run->finished, "run 1 lost in the soft reset");
+
+    // over the protocol
+    pmic_proto_init(collect);
+    uint8_t age = 1;
+    call(PMIC_CMD_BOOT_REPORT, &age, 1);
+    n = max77654_boot_report(1, report, sizeof(report));
+    CHECK(response[1] == PMIC_STATUS_OK && response_len == 2 + n && memcmp(&response[2], report, n) == 0, "BOOT_REPORT");
+    age = 2;
+    call(PMIC_CMD_BOOT_REPORT, &age, 1);
+    CHECK(response[1] == PMIC_STATUS_BAD_ARGS, "BOOT_REPORT of a boot that never happened");
+
+    // the oldest runs make room, overflowing marks are counted
+    for (int i = 0; i < MAX77654_BOOT_RUNS; i++)
+        max77654_boot_begin();
+    for (int i = 0; i < 2 * MAX77654_BOOT_MAX_MARKS; i++)
+        max77654_boot_mark(MAX77654_BOOT_APP + 1, i);
+    run = max77654_boot_get_run(0);
+    CHECK(run && run->boot == 2 + MAX77654_BOOT_RUNS && run->count == MAX77654_BOOT_MAX_MARKS && run->overflow, "overflow");
+    CHECK(max77654_boot_get_run(MAX77654_BOOT_RUNS - 1) != NULL && max77654_boot_get_run(MAX77654_BOOT_RUNS) == NULL, "run ring");
+
+    return test_report();
+}
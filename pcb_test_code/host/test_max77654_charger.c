@@ -0,0 +1,190 @@
+// Checks the charger settings encoding against the MAX77654 model, that a charge profile is one burst,
+// and that status queries are served from the cache until it ages out, is invalidated or an nIRQ refreshes it
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "max77654.h"
+#include "max77654_async.h"
+#include "max77654_charger.h"
+#include "max77654_irq.h"
+#include "max77654_model.h"
+#include "mock_i2c.h"
+#include "mock_time.h"
+#include "test_check.h"
+
+#define NIRQ_GPIO 28
+
+static max77654_model_t pmic;
+
+static void settle(void)
+{
+    for (int i = 0; i < 1000; i++)
+        mock_time_advance_us(1);
+}
+
+static uint32_t transactions(void)
+{
+    mock_i2c_stats_t stats;
+    mock_i2c_get_stats(&stats);
+    return stats.transactions;
+}
+
+int main() {
+    max77654_charger_config_t config;
+    max77654_charger_status_t status;
+    max77654_charger_stats_t stats;
+
+    max77654_model_reset(&pmic);
+    max77654_model_attach(&pmic, i2c1, 0x48);
+    max77654_model_connect_irq(&pmic, NIRQ_GPIO);
+    max77654_init(i2c1);
+    i2c_set_baudrate(i2c1, 1000 * 1000);
+    max77654_async_init(i2c1);
+    max77654_irq_init(NIRQ_GPIO, MAX77654_EVT_MASK(MAX77654_EVT_CHG_I) | MAX77654_EVT_MASK(MAX77654_EVT_CHGIN_I));
+    settle();
+
+    // the whole configuration block in one read
+    mock_i2c_reset_stats();
+    CHECK(max77654_charger_init() == 0, "init");
+    CHECK(transactions() <= 1, "init took %u transactions", (unsigned)transactions());
+
+    // reset values, decoded without the bus
+    mock_i2c_reset_stats();
+    CHECK(max77654_charger_get_config(&config) == 0, "get config");
+    CHECK(transactions() == 0, "get config used the bus");
+    CHECK(config.fast_charge_uA == 15000 && config.timer_h == 3, "CNFG_CHG_E %u uA %u h", (unsigned)config.fast_charge_uA, config.timer_h);
+    CHECK(config.precharge_mV == 3000 && config.term_permille == 150 && config.topoff_min == 0, "CNFG_CHG_C");
+    CHECK(config.vsys_mV == 4100 && config.jeita.cold_C == 5 && config.jeita.hot_C == 45, "CNFG_CHG_A/D");
+
+    // a complete charge profile is one burst
+    config = (max77654_charger_config_t){
+        .enable = true,
+        .fast_charge_uA = 150000,
+        .charge_mV = 4200,
+        .precharge_mV = 2500,
+        .precharge_percent = 20,
+        .term_permille = 100,
+        .topoff_min = 10,
+        .timer_h = 5,
+        .input_limit_mA = 475,
+        .input_min_mV = 4500,
+        .vsys_mV = 4500,
+        .tj_reg_C = 80,
+        .jeita = {.enable = true, .cold_C = -5, .cool_C = 10, .warm_C = 45, .hot_C = 55,
+                  .current_uA = 75000, .voltage_mV = 4100},
+    };
+    mock_i2c_reset_stats();
+    CHECK(max77654_charger_configure(&config) == 0, "configure");
+    CHECK(transactions() == 1, "configure took %u transactions", (unsigned)transactions());
+    CHECK(max77654_model_peek(&pmic, 0x20) == 0xA5, "CNFG_CHG_A 0x%02x", max77654_model_peek(&pmic, 0x20));
+    CHECK(max77654_model_peek(&pmic, 0x21) == 0xB3, "CNFG_CHG_B 0x%02x", max77654_model_peek(&pmic, 0x21));
+    CHECK(max77654_model_peek(&pmic, 0x22) == 0x52, "CNFG_CHG_C 0x%02x", max77654_model_peek(&pmic, 0x22));
+    CHECK(max77654_model_peek(&pmic, 0x23) == 0x58, "CNFG_CHG_D 0x%02x", max77654_model_peek(&pmic, 0x23));
+    CHECK(max77654_model_peek(&pmic, 0x24) == 0x4E, "CNFG_CHG_E 0x%02x", max77654_model_peek(&pmic, 0x24));
+    CHECK(max77654_model_peek(&pmic, 0x25) == 0x26, "CNFG_CHG_F 0x%02x", max77654_model_peek(&pmic, 0x25));
+    CHECK(max77654_model_peek(&pmic, 0x26) == 0x60, "CNFG_CHG_G 0x%02x", max77654_model_peek(&pmic, 0x26));
+    CHECK(max77654_model_peek(&pmic, 0x27) == 0x50, "CNFG_CHG_H 0x%02x", max77654_model_peek(&pmic, 0x27));
+
+    max77654_charger_config_t back;
+    max77654_charger_get_config(&back);
+    CHECK(back.fast_charge_uA == 150000 && back.charge_mV == 4200 && back.input_limit_mA == 475
+          && back.jeita.voltage_mV == 4100 && back.jeita.cool_C == 10 && back.tj_reg_C == 80, "config read back");
+
+    // values the chip cannot represent are rejected, not clamped
+    mock_i2c_reset_stats();
+    CHECK(max77654_charger_set_fast_charge_current(7000) < 0, "7000 uA accepted");
+    CHECK(max77654_charger_set_fast_charge_current(307500) < 0, "307500 uA accepted");
+    CHECK(max77654_charger_set_charge_voltage(4612) < 0, "4612 mV accepted");
+    CHECK(max77654_charger_set_input_limit(100, 4500) < 0, "100 mA accepted");
+    CHECK(max77654_charger_set_termination(80, 10) < 0, "8 percent accepted");
+    CHECK(max77654_charger_set_tj_reg(110) < 0, "110 C accepted");
+    config.jeita.cold_C = 3;
+    CHECK(max77654_charger_set_jeita(&config.jeita) < 0, "3 C accepted");
+    CHECK(transactions() == 0, "rejected values used the bus");
+    CHECK(max77654_model_peek(&pmic, 0x24) == 0x4E, "CNFG_CHG_E changed");
+
+    // a profile with one bad field changes nothing, charging stays on
+    max77654_charger_config_t bad = back;
+    bad.enable = false;
+    bad.fast_charge_uA = 75000;
+    bad.vsys_mV = 4525;
+    CHECK(max77654_charger_configure(&bad) < 0, "4525 mV vsys accepted");
+    CHECK(transactions() == 0, "a rejected profile used the bus");
+    CHECK(max77654_model_peek(&pmic, 0x21) == 0xB3 && max77654_model_peek(&pmic, 0x24) == 0x4E, "a rejected profile was applied");
+    max77654_charger_get_config(&back);
+    CHECK(back.enable && back.fast_charge_uA == 150000, "a rejected profile changed the shadow map");
+
+    // single settings only touch their field
+    CHECK(max77654_charger_usb_suspend(true) == 0, "usb suspend");
+    CHECK(max77654_model_peek(&pmic, 0x26) == 0x62, "CNFG_CHG_G 0x%02x", max77654_model_peek(&pmic, 0x26));
+    CHECK(max77654_charger_set_timer(0) == 0, "timer");
+    CHECK(max77654_model_peek(&pmic, 0x24) == 0x4C, "CNFG_CHG_E 0x%02x", max77654_model_peek(&pmic, 0x24));
+
+    // codes past the end of a range read back as the value the chip applies, so they configure again
+    uint8_t top[5];
+    max77654_read_regs(0x23, top, sizeof(top));
+    top[0] |= 0x1F; // VSYS_REG 4.8 V
+    for (int i = 1; i < 5; i++)
+        top[i] |= 0xFC; // CHG_CC 300 mA, CHG_CC_JEITA 300 mA, CHG_CV 4.6 V, CHG_CV_JEITA 4.6 V
+    CHECK(max77654_write_regs(0x23, top, sizeof(top)) == 0, "raw write of the top codes");
+    CHECK(max77654_charger_get_config(&back) == 0, "get config");
+    CHECK(back.vsys_mV == 4800 && back.fast_charge_uA == 300000 && back.charge_mV == 4600, "top codes %u mV %u uA %u mV",
+          back.vsys_mV, (unsigned)back.fast_charge_uA, back.charge_mV);
+    CHECK(back.jeita.current_uA == 300000 && back.jeita.voltage_mV == 4600, "top JEITA codes");
+    CHECK(max77654_charger_configure(&back) == 0, "configure with what get config returned");
+
+    // status: one read, then the cache
+    max77654_model_poke(&pmic, MODEL_REG_STAT_CHG_A, (1 << 5) | MAX77654_THM_NORMAL);
+    max77654_model_poke(&pmic, MODEL_REG_STAT_CHG_B, (MAX77654_CHG_FAST_CC << 4) | (MAX77654_CHGIN_OK << 2) | (1 << 1));
+    max77654_charger_set_status_policy(false, 0);
+    mock_i2c_reset_stats();
+    for (int i = 0; i < 100; i++)
+        CHECK(max77654_charger_get_status(&status) == 0, "status");
+    CHECK(transactions() == 1, "100 queries took %u transactions", (unsigned)transactions());
+    CHECK(status.state == MAX77654_CHG_FAST_CC && status.chgin == MAX77654_CHGIN_OK && status.charging, "STAT_CHG_B");
+    CHECK(status.thermistor == MAX77654_THM_NORMAL && status.ichgin_lim && !status.vsys_min, "STAT_CHG_A");
+
+    max77654_model_poke(&pmic, MODEL_REG_STAT_CHG_B, (MAX77654_CHG_DONE << 4) | (MAX77654_CHGIN_OK << 2));
+    max77654_charger_get_status(&status);
+    CHECK(status.state == MAX77654_CHG_FAST_CC, "cache bypassed");
+    max77654_charger_invalidate_status();
+    max77654_charger_get_status(&status);
+    CHECK(status.state == MAX77654_CHG_DONE && !status.charging, "invalidated status not read");
+
+    // volatile: every query reads
+    max77654_charger_set_status_policy(true, 0);
+    mock_i2c_reset_stats();
+    for (int i = 0; i < 10; i++)
+        max77654_charger_get_status(&status);
+    CHECK(transactions() == 10, "volatile took %u transactions", (unsigned)transactions());
+
+    // max age
+    max77654_charger_set_status_policy(false, 1000);
+    max77654_charger_invalidate_status();
+    mock_i2c_reset_stats();
+    max77654_charger_get_status(&status);
+    mock_time_advance_us(500);
+    max77654_charger_get_status(&status);
+    CHECK(transactions() == 1, "read before max age");
+    mock_time_advance_us(600);
+    max77654_charger_get_status(&status);
+    CHECK(transactions() == 2, "no read after max age");
+
+    // a charger interrupt refreshes the cache from the nIRQ burst, the query itself stays off the bus
+    max77654_charger_set_status_policy(false, 0);
+    max77654_charger_get_status(&status);
+    max77654_model_poke(&pmic, MODEL_REG_STAT_CHG_B, (MAX77654_CHG_TOPOFF << 4) | (MAX77654_CHGIN_OK << 2) | (1 << 1));
+    max77654_model_raise(&pmic, MODEL_REG_INT_CHG, 1 << 1); // CHG_I
+    settle();
+    mock_i2c_reset_stats();
+    max77654_charger_get_status(&status);
+    CHECK(transactions() == 0, "query after nIRQ used the bus");
+    CHECK(status.state == MAX77654_CHG_TOPOFF, "state after nIRQ %d", status.state);
+
+    max77654_charger_get_stats(&stats);
+    printf("%u queries, %u cache hits, %u bus reads, %u nIRQ updates\n", (unsigned)stats.queries,
+           (unsigned)stats.cache_hits, (unsigned)stats.bus_reads, (unsigned)stats.irq_updates);
+    CHECK(stats.irq_updates >= 1, "no nIRQ update");
+
+    return test_report();
+}
@@ -0,0 +1,57 @@
+// Counts the I2C traffic of the MAX77654 driver against the mock bus,
+// once with one commit per call and once batched with max77654_begin()/max77654_commit()
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "max77654.h"
+#include "max77654_model.h"
+
+static void reconfigure_all_rails(void)
+{
+    SSBx_set_voltage(0, 1800);
+    SSBx_set_voltage(1, 2500);
+    SSBx_set_voltage(2, 3300);
+    SSBx_enable(0, true);
+    SSBx_enable(1, true);
+    SSBx_enable(2, true);
+
+    LDOx_set_voltage(0, 1200);
+    LDOx_set_voltage(1, 900);
+    LDOx_enable(0, true);
+    LDOx_enable(1, true);
+}
+
+static void report(const char *name, mock_i2c_stats_t *stats)
+{
+    printf("%-12s %3u transactions %4u bytes\n", name, (unsigned)stats->transactions, (unsigned)stats->bytes);
+}
+
+static max77654_model_t pmic;
+
+int main() {
+    mock_i2c_stats_t single, batched;
+
+    max77654_model_reset(&pmic);
+    max77654_model_attach(&pmic, i2c1, 0x48);
+
+    if (max77654_init(i2c1) < 0)
+    {
+        printf("max77654_init failed\n");
+        return 1;
+    }
+
+    mock_i2c_reset_stats();
+    reconfigure_all_rails();
+    mock_i2c_get_stats(&single);
+
+    mock_i2c_reset_stats();
+    max77654_begin();
+    reconfigure_all_rails();
+    max77654_commit();
+    mock_i2c_get_stats(&batched);
+
+    report("single", &single);
+    report("batched", &batched);
+
+    return batched.transactions < single.transactions ? 0 : 1;
+}
@@ -0,0 +1,249 @@
+// Runs DVS ramps against the MAX77654 model and watches the rail registers on every
+// microsecond of the virtual clock: each step has to land one period after the previous
+// one, steps due together have to share a burst, the shadow map has to follow the ramp,
+// changes staged in an open transaction have to survive the bursts, and so do commits still in the queue
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "max77654.h"
+#include "max77654_async.h"
+#include "max77654_dvs.h"
+#include "max77654_model.h"
+#include "mock_i2c.h"
+#include "mock_time.h"
+#include "test_check.h"
+
+#define PMIC_ADDR 0x48
+#define MAX_CHANGES 256
+
+static max77654_model_t pmic;
+
+static const uint8_t rail_reg[MAX77654_DVS_RAILS] = {0x29, 0x2B, 0x2D, 0x38, 0x3A};
+
+typedef struct {
+    int rail;
+    uint8_t code;
+    uint64_t t;
+} change_t;
+
+static change_t changes[MAX_CHANGES];
+static int n_changes;
+
+// step the clock 1 us at a time and log every change of a voltage register
+static void run_for(uint32_t us)
+{
+    uint8_t last[MAX77654_DVS_RAILS];
+
+    for (int i = 0; i < MAX77654_DVS_RAILS; i++)
+        last[i] = max77654_model_peek(&pmic, rail_reg[i]);
+
+    for (uint32_t n = 0; n < us; n++)
+    {
+        mock_time_advance_us(1);
+        for (int i = 0; i < MAX77654_DVS_RAILS; i++)
+        {
+            uint8_t v = max77654_model_peek(&pmic, rail_reg[i]);
+            if (v != last[i] && n_changes < MAX_CHANGES)
+                changes[n_changes++] = (change_t){i, v, time_us_64()};
+            last[i] = v;
+        }
+    }
+}
+
+// checks the steps of one rail: codes from..to in step_codes, step k is due at t0 + k * period_us and
+// lands on the chip between min_bus_us and max_bus_us later (bus time, plus waiting behind other bursts)
+static void check_ramp(const char *name, int rail, uint8_t from, uint8_t to, uint8_t step_codes, uint32_t period_us, uint64_t t0,
+                       uint32_t min_bus_us, uint32_t max_bus_us)
+{
+    int steps = 0;
+    uint8_t expected = from;
+    uint64_t due = t0;
+
+    for (int i = 0; i < n_changes; i++)
+    {
+        if (changes[i].rail != rail)
+            continue;
+
+        expected = expected < to ? (to - expected > step_codes ? expected + step_codes : to)
+                                 : (expected - to > step_codes ? expected - step_codes : to);
+        due += period_us;
+        steps++;
+
+        CHECK(changes[i].code == expected, "%s step %d: code 0x%02x, expected 0x%02x", name, steps, changes[i].code, expected);
+        CHECK(changes[i].t >= due + min_bus_us && changes[i].t <= due + max_bus_us, "%s step %d at %u us, due at %u us",
+              name, steps, (unsigned)(changes[i].t - t0), (unsigned)(due - t0));
+    }
+    CHECK(expected == to, "%s ended at 0x%02x after %d steps", name, expected, steps);
+}
+
+static void power_on(void)
+{
+    mock_i2c_detach_all();
+    max77654_model_reset(&pmic);
+    max77654_model_attach(&pmic, i2c1, PMIC_ADDR);
+    max77654_init(i2c1);
+    i2c_set_baudrate(i2c1, 1000 * 1000);
+    max77654_async_init(i2c1);
+    n_changes = 0;
+}
+
+static void test_single_ramp(void)
+{
+    power_on();
+    uint64_t t0 = time_us_64();
+    uint32_t bus_us = mock_i2c_transfer_time_us(i2c1, 2); // register address + one value
+
+    // SSB0 3100 -> 3300 mV at 50 mV/ms: 4 steps, 1 ms apart
+    CHECK(max77654_dvs_ramp(0, 3300, 50, 1) == 0, "ramp rejected");
+    run_for(6000);
+    check_ramp("SSB0 up", 0, 0x2E, 0x32, 1, 1000, t0, bus_us, bus_us);
+    CHECK(!max77654_dvs_busy(-1), "still busy");
+    CHECK_REG(0x2A, 0x37); // B register untouched
+
+    // LDO0 1200 -> 900 mV at 10 mV/ms in 50 mV steps: 6 steps, 5 ms apart
+    n_changes = 0;
+    t0 = time_us_64();
+    CHECK(max77654_dvs_ramp(3, 900, 10, 2) == 0, "ramp rejected");
+    run_for(32000);
+    check_ramp("LDO0 down", 3, 0x10, 0x04, 2, 5000, t0, bus_us, bus_us);
+
+    // the shadow map followed the ramp, another rail call does not undo it
+    SSBx_enable(0, false);
+    CHECK_REG(0x29, 0x32);
+    LDOx_enable(0, false);
+    CHECK_REG(0x38, 0x04);
+}
+
+static void test_concurrent_ramps(void)
+{
+    max77654_dvs_stats_t before, after;
+
+    power_on();
+    max77654_dvs_get_stats(&before);
+    uint64_t t0 = time_us_64();
+
+    // same period on SSB0, SSB2 and LDO1: each tick is one SSB burst (0x29..0x2D) and one LDO burst
+    max77654_dvs_ramp(0, 2700, 100, 1);  // 8 steps down, 500 us
+    max77654_dvs_ramp(2, 3500, 100, 1);  // 4 steps up
+    max77654_dvs_ramp(4, 1100, 100, 2);  // LDO1 900 -> 1100, 4 steps of 50 mV, 500 us
+    // a rail with its own pace in between
+    max77654_dvs_ramp(1, 3000, 40, 1);   // 4 steps down, 1250 us
+    run_for(6000);
+
+    max77654_dvs_get_stats(&after);
+    uint32_t steps = after.steps - before.steps;
+    uint32_t bursts = after.bursts - before.bursts;
+    printf("concurrent: %u steps in %u bursts, %u deferred, max delay %u us\n", (unsigned)steps, (unsigned)bursts,
+           (unsigned)(after.deferred - before.deferred), (unsigned)after.max_delay_us);
+    CHECK(steps == 8 + 4 + 4 + 4, "%u steps", (unsigned)steps);
+    CHECK(bursts < steps, "steps were not coalesced (%u bursts)", (unsigned)bursts);
+    CHECK(after.max_delay_us == 0, "a step went out %u us late", (unsigned)after.max_delay_us);
+
+    // one value is the shortest write, the worst case is behind a full SSB burst (0x29..0x2D) and an LDO one
+    uint32_t min_bus_us = mock_i2c_transfer_time_us(i2c1, 2);
+    uint32_t max_bus_us = mock_i2c_transfer_time_us(i2c1, 6) + mock_i2c_transfer_time_us(i2c1, 4);
+    check_ramp("SSB0", 0, 0x2E, 0x26, 1, 500, t0, min_bus_us, max_bus_us);
+    check_ramp("SSB1", 1, 0x30, 0x2C, 1, 1250, t0, min_bus_us, max_bus_us);
+    check_ramp("SSB2", 2, 0x32, 0x36, 1, 500, t0, min_bus_us, max_bus_us);
+    check_ramp("LDO1", 4, 0x04, 0x0C, 2, 500, t0, min_bus_us, max_bus_us);
+
+    CHECK_REG(0x2A, 0x37); // B registers inside the bursts kept their values
+    CHECK_REG(0x2C, 0x37);
+    CHECK(after.bus_errors == before.bus_errors, "bus errors");
+}
+
+static void test_open_transaction(void)
+{
+    mock_i2c_stats_t stats;
+
+    power_on();
+
+    // SSB1 changes staged while SSB0 and SSB2 ramp, their bursts (0x29..0x2D) cover both SSB1 registers
+    max77654_begin();
+    SSBx_set_voltage(1, 1200);
+    SSBx_enable(1, false);
+    max77654_dvs_ramp(0, 3300, 100, 1);
+    max77654_dvs_ramp(2, 3700, 100, 1);
+    run_for(5000);
+    CHECK(!max77654_dvs_busy(-1), "still busy");
+    CHECK_REG(0x29, 0x32);
+    CHECK_REG(0x2D, 0x3A);
+    CHECK_REG(0x2B, 0x30); // staged, not on the chip yet
+    CHECK_REG(0x2C, 0x37);
+    max77654_commit();
+    CHECK_REG(0x2B, 0x08);
+    CHECK_REG(0x2C, 0x34);
+
+    // a commit next to a ramping rail leaves its register to the ramp: two bursts around SSB1, not one over it
+    max77654_dvs_ramp(1, 1500, 100, 1);
+    run_for(600); // first step landed, the next one is due at 1000 us
+    max77654_begin();
+    SSBx_enable(0, false);
+    SSBx_enable(2, false);
+    mock_i2c_reset_stats();
+    max77654_commit();
+    mock_i2c_get_stats(&stats);
+    CHECK(stats.transactions == 2 && stats.bytes == 4, "commit next to the ramp: %u transactions, %u bytes",
+          (unsigned)stats.transactions, (unsigned)stats.bytes);
+    run_for(3000);
+    CHECK_REG(0x2B, 0x0E);
+    CHECK_REG(0x2A, 0x34);
+    CHECK_REG(0x2E, 0x34);
+    CHECK(!max77654_dvs_busy(-1), "still busy");
+
+    // the ramp is over, commits may use the register again
+    max77654_begin();
+    SSBx_enable(0, true);
+    SSBx_enable(2, true);
+    mock_i2c_reset_stats();
+    max77654_commit();
+    mock_i2c_get_stats(&stats);
+    CHECK(stats.transactions == 1, "commit after the ramp: %u transactions", (unsigned)stats.transactions);
+}
+
+static void test_commit_during_ramp(void)
+{
+    power_on();
+    uint64_t t0 = time_us_64();
+
+    // SSB0 and SSB1 step together, every burst covers 0x29..0x2B and so SSB0's B register
+    max77654_dvs_ramp(0, 3300, 100, 1);
+    max77654_dvs_ramp(1, 3400, 100, 1);
+    run_for(t0 + 495 - time_us_64());
+
+    // the write of 0x2A is still queued when the first step comes due, the burst behind it must carry it
+    SSBx_enable(0, false);
+    run_for(t0 + 600 - time_us_64());
+    CHECK_REG(0x2A, 0x34); // turned back on by the first step burst
+    run_for(3000);
+    CHECK(!max77654_dvs_busy(-1), "still busy");
+    CHECK_REG(0x29, 0x32);
+    CHECK_REG(0x2B, 0x34);
+    CHECK_REG(0x2A, 0x34);
+    uint8_t b0;
+    max77654_shadow_get(0x2A, &b0, 1);
+    CHECK(b0 == 0x34, "shadow of 0x2A 0x%02x", b0);
+}
+
+static void test_bad_args(void)
+{
+    CHECK(max77654_dvs_ramp(5, 1000, 10, 1) < 0, "bad rail accepted");
+    CHECK(max77654_dvs_ramp(0, 1000, 0, 1) < 0, "zero slew accepted");
+    CHECK(max77654_dvs_ramp(0, 1000, 10, 0) < 0, "zero step accepted");
+}
+
+int main() {
+    if (max77654_dvs_init() < 0)
+    {
+        printf("no hardware alarm\n");
+        return 1;
+    }
+
+    test_single_ramp();
+    test_concurrent_ramps();
+    test_open_transaction();
+    test_commit_during_ramp();
+    test_bad_args();
+
+    return test_report();
+}
@@ -0,0 +1,117 @@
+// Four modelled PMICs, two on each bus: every handle keeps its own shadow map and address,
+// a fleet commit writes both buses at the same time, a device that NACKs keeps its changes
+// pending while the others are done, and a DVS ramp stays on its device while another is selected
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "max77654.h"
+#include "max77654_async.h"
+#include "max77654_dvs.h"
+#include "max77654_model.h"
+#include "mock_i2c.h"
+#include "mock_time.h"
+#include "test_check.h"
+
+#define DEVICES 4
+
+static max77654_model_t models[DEVICES];
+static max77654_t devs[DEVICES];
+static max77654_t *const fleet[DEVICES] = { &devs[0], &devs[1], &devs[2], &devs[3] };
+
+static const max77654_profile_t profile = MAX77654_PROFILE(
+    MAX77654_SBB(1800, true, MAX77654_SBB_IPK_500MA, MAX77654_SBB_MODE_BUCK, false),
+    MAX77654_SBB(2500, true, MAX77654_SBB_IPK_500MA, MAX77654_SBB_MODE_BUCK, false),
+    MAX77654_SBB(5000, false, MAX77654_SBB_IPK_1000MA, MAX77654_SBB_MODE_BUCK_BOOST, true),
+    MAX77654_LDO(3300, true, LDO_MODE_LDO, false),
+    MAX77654_LDO(1000, false, LDO_MODE_LSW, true));
+
+static void check_profile(int d)
+{
+    for (unsigned int i = 0; i < sizeof(profile.sbb); i++)
+        CHECK(max77654_model_peek(&models[d], 0x29 + i) == profile.sbb[i], "device %d SBB reg 0x%02x", d, 0x29 + i);
+    for (unsigned int i = 0; i < sizeof(profile.ldo); i++)
+        CHECK(max77654_model_peek(&models[d], 0x38 + i) == profile.ldo[i], "device %d LDO reg 0x%02x", d, 0x38 + i);
+}
+
+int main() {
+    // i2c0 on GPIO 0/1, i2c1 on GPIO 26/27, addresses 0x48 and 0x49 on each
+    mock_i2c_detach_all();
+    for (int d = 0; d < DEVICES; d++)
+    {
+        i2c_inst_t *i2c = d < 2 ? i2c0 : i2c1;
+        uint8_t addr = MAX77654_I2C_ADDR + (d & 1);
+
+        max77654_model_reset(&models[d]);
+        max77654_model_attach(&models[d], i2c, addr);
+        max77654_config(&devs[d], i2c, d < 2 ? 0 : 26, d < 2 ? 1 : 27, addr);
+        CHECK(max77654_dev_init(&devs[d], NULL) == 0, "device %d init", d);
+    }
+    CHECK(max77654_selected() == &devs[3], "init selects the device");
+
+    // the selected device only
+    max77654_select(&devs[1]);
+    SSBx_set_voltage(0, 1800);
+    for (int d = 0; d < DEVICES; d++)
+        CHECK((max77654_model_peek(&models[d], 0x29) == 0x14) == (d == 1), "device %d SBB0", d);
+    max77654_select(&devs[2]);
+    max77654_begin();
+    LDOx_set_voltage(1, 1200);
+    max77654_select(&devs[0]);
+    CHECK(devs[2].transaction_depth == 1 && devs[0].transaction_depth == 0, "transactions are per device");
+    CHECK(max77654_commit() == 0 && devs[2].shadow_dirty != 0, "commit of a device without a transaction");
+    max77654_select(&devs[2]);
+    max77654_commit();
+    CHECK(max77654_model_peek(&models[2], 0x3A) == 0x10 && max77654_model_peek(&models[3], 0x3A) != 0x10, "LDO1 of device 2");
+
+    // all four at once, both buses busy at the same time
+    max77654_async_init(i2c0);
+    max77654_async_init(i2c1);
+    uint32_t bus_us = 2 * (mock_i2c_transfer_time_us(i2c0, 7) + mock_i2c_transfer_time_us(i2c0, 5)); // two devices per bus
+    uint64_t t0 = time_us_64();
+    CHECK(max77654_fleet_apply_profile(fleet, DEVICES, &profile) == 0, "fleet profile");
+    uint64_t elapsed = time_us_64() - t0;
+    for (int d = 0; d < DEVICES; d++)
+    {
+        check_profile(d);
+        CHECK(devs[d].shadow_dirty == 0, "device %d left dirty", d);
+    }
+    CHECK(elapsed >= bus_us && elapsed < bus_us + 50, "fleet took %llu us, one bus needs %u us", (unsigned long long)elapsed, bus_us);
+
+    // changes staged in a transaction on every device, one device NACKs:
+    // the others are written and its change stays pending
+    for (int d = 0; d < DEVICES; d++)
+    {
+        max77654_select(&devs[d]);
+        max77654_begin();
+        SSBx_set_voltage(2, 3000 + 100 * d);
+    }
+    max77654_model_inject_nack(&models[3], 1);
+    CHECK(max77654_fleet_commit(fleet, DEVICES) == -1, "a NACK has to fail the fleet");
+    CHECK(devs[0].transaction_depth == 0, "the fleet commit ends the transactions");
+    for (int d = 0; d < 3; d++)
+        CHECK(max77654_model_peek(&models[d], 0x2D) == (3000 + 100 * d - 800) / 50, "device %d SBB2", d);
+    CHECK(devs[3].shadow_dirty != 0 && max77654_model_peek(&models[3], 0x2D) == profile.sbb[4], "device 3 should keep its change");
+    CHECK(max77654_fleet_commit(fleet, DEVICES) == 0, "retry");
+    CHECK(max77654_model_peek(&models[3], 0x2D) == (3300 - 800) / 50, "device 3 SBB2 after the retry");
+
+    // the ramp keeps going to device 0 while the application works on device 1 of the same bus
+    max77654_select(&devs[0]);
+    CHECK(max77654_dvs_init() == 0, "dvs init");
+    CHECK(max77654_dvs_ramp(0, 1000, 10, 1) == 0, "ramp on device 0");
+    max77654_select(&devs[1]);
+    uint8_t sbb0 = max77654_model_peek(&models[1], 0x29);
+    for (int n = 0; n < 200 && max77654_dvs_busy(-1); n++)
+    {
+        mock_time_advance_us(1000);
+        SSBx_set_voltage(1, 1000 + 50 * (n % 2));
+    }
+    uint8_t code;
+    max77654_shadow_get_dev(&devs[0], 0x29, &code, 1);
+    CHECK(!max77654_dvs_busy(-1), "ramp still running");
+    CHECK(max77654_model_peek(&models[0], 0x29) == 0x04 && code == 0x04, "device 0 SBB0 0x%02x, shadow 0x%02x",
+          max77654_model_peek(&models[0], 0x29), code);
+    CHECK(max77654_model_peek(&models[1], 0x29) == sbb0, "the ramp reached device 1");
+    CHECK(max77654_selected() == &devs[1], "the ramp changed the selection");
+
+    return test_report();
+}
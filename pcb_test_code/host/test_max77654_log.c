@@ -0,0 +1,132 @@
+// Records MAX77654_LOG() lines, drains them in batches and rebuilds the text from the format section,
+// checks that only whole records are dropped and shipped, and that the driver logs through it
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "max77654.h"
+#include "max77654_log.h"
+#include "max77654_model.h"
+#include "mock_time.h"
+#include "test_check.h"
+
+static max77654_model_t pmic;
+
+static uint8_t out[8192];
+static uint32_t out_len;
+static uint32_t batches;
+static uint32_t max_batch;
+static bool accept = true;
+
+static uint32_t collect(const uint8_t *data, uint32_t len)
+{
+    if (!accept)
+        return 0;
+    memcpy(&out[out_len], data, len);
+    out_len += len;
+    batches++;
+    if (len > max_batch)
+        max_batch = len;
+    return len;
+}
+
+static uint32_t word(uint32_t pos)
+{
+    return out[pos] | (out[pos + 1] << 8) | (out[pos + 2] << 16) | ((uint32_t)out[pos + 3] << 24);
+}
+
+// decodes the record at *pos into text, returns its seq
+static int decode(uint32_t *pos, char *text, size_t size, uint32_t *ts)
+{
+    uint32_t header = word(*pos);
+    uint32_t nargs = (header >> 16) & 0xFF;
+    uint32_t a[MAX77654_LOG_MAX_ARGS] = {0};
+
+    *ts = word(*pos + 4);
+    for (uint32_t i = 0; i < nargs; i++)
+        a[i] = word(*pos + 8 + 4 * i);
+    *pos += 8 + 4 * nargs;
+
+    const char *fmt = max77654_log_format(header & 0xFFFF);
+    if (!fmt)
+        return -1;
+    fmt = strchr(fmt, ']') + 2; // skip "[file:line] "
+    snprintf(text, size, fmt, a[0], a[1], a[2], a[3], a[4], a[5]);
+    return header >> 24;
+}
+
+int main() {
+    max77654_log_counters_t counters;
+    char text[128];
+    uint32_t pos = 0, ts;
+
+    // text and timestamps come back, arguments are raw words
+    mock_time_advance_us(1234);
+    MAX77654_LOG("no arguments");
+    MAX77654_LOG("rail %d at %u mV", 2, 3300u);
+    mock_time_advance_us(10);
+    MAX77654_LOG("six %d %d %d %d %d 0x%08x", 1, 2, 3, 4, -5, 0xDEADBEEFu);
+    CHECK(max77654_log_drain(collect, MAX77654_LOG_MAX_BATCH) == 3, "drain count");
+    CHECK(batches == 1 && out_len == 4 * (2 + 4 + 8), "one batch of %u bytes", (unsigned)out_len);
+
+    int seq0 = decode(&pos, text, sizeof(text), &ts);
+    CHECK(strcmp(text, "no arguments") == 0 && ts == 1234, "record 0 '%s' at %u", text, (unsigned)ts);
+    CHECK(decode(&pos, text, sizeof(text), &ts) == seq0 + 1 && strcmp(text, "rail 2 at 3300 mV") == 0, "record 1 '%s'", text);
+    CHECK(decode(&pos, text, sizeof(text), &ts) == seq0 + 2 && strcmp(text, "six 1 2 3 4 -5 0xdeadbeef") == 0 && ts == 1244,
+          "record 2 '%s'", text);
+
+    // the prefix is built by the compiler
+    const char *fmt = max77654_log_format(word(0) & 0xFFFF);
+    CHECK(strstr(fmt, "test_max77654_log.c:") != NULL, "prefix '%s'", fmt);
+    CHECK(max77654_log_format(0xFFFF) == NULL, "unknown id");
+
+    // a full ring drops whole records, the seq gap shows it
+    max77654_log_get_counters(&counters);
+    uint32_t records = counters.records;
+    for (int i = 0; i < MAX77654_LOG_RING_WORDS / 8 + 3; i++)
+        MAX77654_LOG("fill %d %d %d %d %d %d", i, i, i, i, i, i);
+    MAX77654_LOG("after %d", 1);
+    max77654_log_get_counters(&counters);
+    CHECK(counters.records - records == MAX77654_LOG_RING_WORDS / 8, "stored %u", (unsigned)(counters.records - records));
+    CHECK(counters.dropped == 4, "dropped %u", (unsigned)counters.dropped);
+
+    // a writer that refuses keeps everything queued
+    accept = false;
+    CHECK(max77654_log_drain(collect, MAX77654_LOG_MAX_BATCH) == 0, "refused batch consumed");
+    accept = true;
+
+    // batches respect the limit and hold whole records
+    out_len = pos = batches = max_batch = 0;
+    CHECK(max77654_log_drain(collect, 100) == MAX77654_LOG_RING_WORDS / 8, "drain after fill");
+    CHECK(max_batch <= 100 && max_batch % 32 == 0, "batch of %u bytes", (unsigned)max_batch);
+    int seq = decode(&pos, text, sizeof(text), &ts);
+    CHECK(strcmp(text, "fill 0 0 0 0 0 0") == 0, "first '%s'", text);
+    for (int i = 1; i < MAX77654_LOG_RING_WORDS / 8; i++)
+        seq = decode(&pos, text, sizeof(text), &ts);
+    CHECK(pos == out_len, "record boundaries");
+
+    // the record after the drops
+    MAX77654_LOG("after %d", 2);
+    out_len = pos = 0;
+    max77654_log_drain(collect, MAX77654_LOG_MAX_BATCH);
+    CHECK(((decode(&pos, text, sizeof(text), &ts) - seq) & 0xFF) == 5, "no seq gap for 4 drops");
+    CHECK(strcmp(text, "after 2") == 0, "'%s'", text);
+
+    // the driver logs rail changes without formatting them
+    max77654_model_reset(&pmic);
+    max77654_model_attach(&pmic, i2c1, 0x48);
+    max77654_init(i2c1);
+    max77654_log_drain(collect, MAX77654_LOG_MAX_BATCH);
+    out_len = pos = 0;
+    SSBx_set_voltage(1, 1800);
+    max77654_log_drain(collect, MAX77654_LOG_MAX_BATCH);
+    bool found = false;
+    while (pos < out_len)
+    {
+        decode(&pos, text, sizeof(text), &ts);
+        found |= strcmp(text, "SSB1 voltage set to 1800 mV") == 0;
+    }
+    CHECK(found, "driver log line missing");
+
+    return test_report();
+}
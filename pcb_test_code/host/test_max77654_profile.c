@@ -0,0 +1,96 @@
+// Checks that compile-time rail profiles fold into the same register values the runtime
+// encoders produce, that a profile goes out in one burst per register block, and that the
+// shadow register map follows the profile so later rail calls only touch what they change
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "max77654.h"
+#include "max77654_model.h"
+#include "mock_i2c.h"
+#include "test_check.h"
+
+#define PMIC_ADDR 0x48
+
+static const max77654_profile_t low_power = MAX77654_PROFILE(
+    MAX77654_SBB(1800, true, MAX77654_SBB_IPK_500MA, MAX77654_SBB_MODE_BUCK, true),
+    MAX77654_SBB(5500, false, MAX77654_SBB_IPK_1000MA, MAX77654_SBB_MODE_BUCK_BOOST, false),
+    MAX77654_SBB(800, true, MAX77654_SBB_IPK_750MA, MAX77654_SBB_MODE_BUCK_BOOST, false),
+    MAX77654_LDO(3975, true, LDO_MODE_LSW, false),
+    MAX77654_LDO(1025, false, LDO_MODE_LDO, true));
+
+static max77654_model_t pmic;
+
+
+static void test_encoding(void)
+{
+    CHECK(low_power.sbb[0] == calculate_ssb_voltage_reg(1800), "SBB0 voltage 0x%02x", low_power.sbb[0]);
+    CHECK(low_power.sbb[1] == 0x6F, "SBB0 config 0x%02x", low_power.sbb[1]); // on, discharge, 500 mA, buck
+    CHECK(low_power.sbb[2] == calculate_ssb_voltage_reg(5500), "SBB1 voltage 0x%02x", low_power.sbb[2]);
+    CHECK(low_power.sbb[3] == 0x04, "SBB1 config 0x%02x", low_power.sbb[3]);
+    CHECK(low_power.sbb[4] == 0x00, "SBB2 voltage 0x%02x", low_power.sbb[4]);
+    CHECK(low_power.sbb[5] == 0x17, "SBB2 config 0x%02x", low_power.sbb[5]);
+    CHECK(low_power.ldo[0] == calculate_ldo_voltage_reg(3975), "LDO0 voltage 0x%02x", low_power.ldo[0]);
+    CHECK(low_power.ldo[1] == 0x17, "LDO0 config 0x%02x", low_power.ldo[1]);
+    CHECK(low_power.ldo[2] == calculate_ldo_voltage_reg(1025), "LDO1 voltage 0x%02x", low_power.ldo[2]);
+    CHECK(low_power.ldo[3] == 0x0C, "LDO1 config 0x%02x", low_power.ldo[3]);
+}
+
+static void test_apply(void)
+{
+    mock_i2c_stats_t stats;
+
+    max77654_model_reset(&pmic);
+    max77654_model_attach(&pmic, i2c1, PMIC_ADDR);
+    CHECK(max77654_init_with_profile(i2c1, &low_power) == 0, "init with profile failed");
+
+    for (int i = 0; i < 6; i++)
+        CHECK_REG(0x29 + i, low_power.sbb[i]);
+    for (int i = 0; i < 4; i++)
+        CHECK_REG(0x38 + i, low_power.ldo[i]);
+
+    // applying again is exactly two bursts
+    mock_i2c_reset_stats();
+    CHECK(max77654_apply_profile(&low_power) == 0, "apply failed");
+    mock_i2c_get_stats(&stats);
+    printf("apply: %u transactions, %u bytes\n", (unsigned)stats.transactions, (unsigned)stats.bytes);
+    CHECK(stats.transactions == 2, "apply took %u transactions", (unsigned)stats.transactions);
+    CHECK(stats.bytes == 2 + 6 + 4, "apply took %u bytes", (unsigned)stats.bytes);
+
+    // the shadow map now holds the profile: a single change writes a single register
+    mock_i2c_reset_stats();
+    SSBx_enable(1, true);
+    mock_i2c_get_stats(&stats);
+    CHECK(stats.transactions == 1, "enable took %u transactions", (unsigned)stats.transactions);
+    CHECK_REG(0x2C, 0x07);
+    CHECK_REG(0x2A, low_power.sbb[1]);
+    CHECK_REG(0x2B, low_power.sbb[2]);
+
+    LDOx_set_voltage(1, 1100);
+    CHECK_REG(0x3B, low_power.ldo[3]); // LSW / discharge settings kept
+    CHECK_REG(0x3A, calculate_ldo_voltage_reg(1100));
+}
+
+static void test_apply_nack(void)
+{
+    max77654_model_reset(&pmic);
+    max77654_model_attach(&pmic, i2c1, PMIC_ADDR);
+    max77654_init(i2c1);
+
+    max77654_model_inject_nack(&pmic, 1); // the SBB burst fails
+    CHECK(max77654_apply_profile(&low_power) < 0, "NACK not reported");
+    CHECK_REG(0x29, 0x2E); // still the default profile
+    CHECK_REG(0x38, 0x10); // LDO burst not attempted
+
+    // the rail calls keep working from the last good shadow values
+    LDOx_enable(1, false);
+    CHECK_REG(0x3B, 0x04);
+    CHECK_REG(0x3A, 0x04);
+}
+
+int main() {
+    test_encoding();
+    test_apply();
+    test_apply_nack();
+
+    return test_report();
+}
@@ -0,0 +1,180 @@
+// Brings the rails up and down with the sequencer against the MAX77654 model and watches the
+// enable bits on every microsecond: dependencies and minimum delays have to hold, independent
+// rails have to share a commit, and bring-up must not take longer than the graph requires
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "max77654.h"
+#include "max77654_model.h"
+#include "max77654_seq.h"
+#include "mock_i2c.h"
+#include "mock_time.h"
+#include "test_check.h"
+
+#define PMIC_ADDR 0x48
+#define COMMIT_MAX_US 100 // SSB and LDO burst at 1 MHz
+#define SSB0 0
+#define SSB1 1
+#define SSB2 2
+#define LDO0 3
+#define LDO1 4
+
+static max77654_model_t pmic;
+
+static const uint8_t enable_reg[MAX77654_SEQ_RAILS] = {0x2A, 0x2C, 0x2E, 0x39, 0x3B};
+
+static const max77654_profile_t all_off = MAX77654_PROFILE(
+    MAX77654_SBB(1800, false, MAX77654_SBB_IPK_330MA, MAX77654_SBB_MODE_BUCK_BOOST, true),
+    MAX77654_SBB(2500, false, MAX77654_SBB_IPK_330MA, MAX77654_SBB_MODE_BUCK_BOOST, true),
+    MAX77654_SBB(3300, false, MAX77654_SBB_IPK_330MA, MAX77654_SBB_MODE_BUCK_BOOST, true),
+    MAX77654_LDO(1000, false, LDO_MODE_LDO, true),
+    MAX77654_LDO(1800, false, LDO_MODE_LDO, true));
+
+// FPGA: core (LDO0) first, then aux (SSB0), then the IO banks (SSB1, SSB2); LDO1 (PLL) on its own
+static int pg_polls;
+static bool pg_after_polls(int rail, void *user)
+{
+    (void)rail;
+    return ++pg_polls >= *(int *)user;
+}
+static int pg_needed = 3;
+
+static const max77654_seq_step_t fpga[] = {
+    {.rail = SSB1, .depends_on = MAX77654_SEQ_RAIL(SSB0), .delay_us = 200, .settle_us = 300},
+    {.rail = SSB2, .depends_on = MAX77654_SEQ_RAIL(SSB0), .delay_us = 200, .settle_us = 300},
+    {.rail = SSB0, .depends_on = MAX77654_SEQ_RAIL(LDO0), .delay_us = 500, .settle_us = 400,
+     .power_good = pg_after_polls, .user = &pg_needed, .pg_timeout_us = 1000},
+    {.rail = LDO0, .settle_us = 250},
+    {.rail = LDO1, .settle_us = 100},
+};
+#define FPGA_STEPS (sizeof(fpga) / sizeof(fpga[0]))
+
+static uint64_t on_at[MAX77654_SEQ_RAILS];
+static uint64_t off_at[MAX77654_SEQ_RAILS];
+
+static void watch(uint64_t now_us)
+{
+    for (int i = 0; i < MAX77654_SEQ_RAILS; i++)
+    {
+        bool on = (max77654_model_peek(&pmic, enable_reg[i]) & 0x07) == 0x07;
+        if (on && on_at[i] == 0)
+            on_at[i] = now_us;
+        if (!on && on_at[i] && off_at[i] == 0)
+            off_at[i] = now_us;
+    }
+}
+
+static void power_on(void)
+{
+    mock_i2c_detach_all();
+    max77654_model_reset(&pmic);
+    max77654_model_attach(&pmic, i2c1, PMIC_ADDR);
+    max77654_init_with_profile(i2c1, &all_off);
+    i2c_set_baudrate(i2c1, 1000 * 1000);
+    for (int i = 0; i < MAX77654_SEQ_RAILS; i++)
+        on_at[i] = off_at[i] = 0;
+}
+
+static void test_power_up_down(void)
+{
+    max77654_seq_result_t res;
+
+    power_on();
+    pg_polls = 0;
+    uint64_t t0 = time_us_64();
+    int ret = max77654_seq_power_up(fpga, FPGA_STEPS, &res);
+    CHECK(ret == 0, "power up returned %d", ret);
+    watch(time_us_64());
+
+    for (int i = 0; i < MAX77654_SEQ_RAILS; i++)
+        CHECK(on_at[i] != 0, "rail %d not on", i);
+
+    // reported times are the end of the commit, the write of the rail itself may land a burst earlier
+    for (int i = 0; i < MAX77654_SEQ_RAILS; i++)
+        CHECK(on_at[i] - t0 <= res.on_us[i] && on_at[i] - t0 + COMMIT_MAX_US >= res.on_us[i], "rail %d on at %u us, reported %u us",
+              i, (unsigned)(on_at[i] - t0), (unsigned)res.on_us[i]);
+    for (int i = 0; i < MAX77654_SEQ_RAILS; i++)
+        printf("rail %d: on %5u us, up %5u us\n", i, (unsigned)res.on_us[i], (unsigned)res.up_us[i]);
+    printf("power up: %u us, %u commits\n", (unsigned)res.total_us, (unsigned)res.commits);
+
+    CHECK(res.up_us[LDO0] == res.on_us[LDO0] + 250, "LDO0 settle");
+    CHECK(res.on_us[SSB0] >= res.up_us[LDO0] + 500, "SSB0 on %u us before LDO0 up + 500", (unsigned)res.on_us[SSB0]);
+    CHECK(res.up_us[SSB0] >= res.on_us[SSB0] + 400, "SSB0 up before settle");
+    CHECK(pg_polls == pg_needed, "power good polled %d times", pg_polls);
+    CHECK(res.on_us[SSB1] >= res.up_us[SSB0] + 200 && res.on_us[SSB2] >= res.up_us[SSB0] + 200, "IO banks early");
+
+    // independent rails together: LDO0 + LDO1, then SSB0, then SSB1 + SSB2
+    CHECK(res.on_us[LDO0] == res.on_us[LDO1], "LDO0 and LDO1 not in one commit");
+    CHECK(res.on_us[SSB1] == res.on_us[SSB2], "SSB1 and SSB2 not in one commit");
+    CHECK(res.commits == 3, "%u commits", (unsigned)res.commits);
+
+    // no padding: the critical path is LDO0 settle, delay, SSB0 settle + 2 polls, delay, IO settle,
+    // plus the bus time of the three commits
+    uint32_t critical = 250 + 500 + 400 + 2 * MAX77654_SEQ_POLL_US + 200 + 300;
+    CHECK(res.total_us <= critical + 3 * COMMIT_MAX_US, "bring-up took %u us, critical path %u us", (unsigned)res.total_us, (unsigned)critical);
+    CHECK(time_us_64() - t0 == res.total_us, "total time");
+
+    // power down: IO banks first, SSB0 200 us later, LDO0 500 us after that, LDO1 right away
+    t0 = time_us_64();
+    ret = max77654_seq_power_down(fpga, FPGA_STEPS, &res);
+    CHECK(ret == 0, "power down returned %d", ret);
+    for (int i = 0; i < MAX77654_SEQ_RAILS; i++)
+        CHECK(off_at[i] - t0 <= res.on_us[i] && off_at[i] - t0 + COMMIT_MAX_US >= res.on_us[i], "rail %d off at %u us, reported %u us",
+              i, (unsigned)(off_at[i] - t0), (unsigned)res.on_us[i]);
+    CHECK(res.on_us[SSB1] == res.on_us[LDO1] && res.on_us[SSB2] == res.on_us[LDO1], "first commit");
+    CHECK(res.on_us[SSB0] >= res.on_us[SSB1] + 200, "SSB0 off too early");
+    CHECK(res.on_us[LDO0] >= res.on_us[SSB0] + 500, "LDO0 off too early");
+    printf("power down: %u us, %u commits\n", (unsigned)res.total_us, (unsigned)res.commits);
+}
+
+static void test_power_good_timeout(void)
+{
+    max77654_seq_result_t res;
+    int never = 1000000;
+    max77654_seq_step_t steps[] = {
+        {.rail = LDO0, .settle_us = 100, .power_good = pg_after_polls, .user = &never, .pg_timeout_us = 500},
+        {.rail = SSB0, .depends_on = MAX77654_SEQ_RAIL(LDO0)},
+    };
+
+    power_on();
+    pg_polls = 0;
+    CHECK(max77654_seq_power_up(steps, 2, &res) == MAX77654_SEQ_ERR_POWER_GOOD, "timeout not reported");
+    CHECK(res.failed_rail == LDO0, "failed rail %d", res.failed_rail);
+    CHECK((max77654_model_peek(&pmic, 0x2A) & 0x07) == 0x04, "SSB0 enabled after a failed dependency");
+    CHECK(res.total_us >= 600 && res.total_us <= 600 + MAX77654_SEQ_POLL_US + 100, "gave up after %u us", (unsigned)res.total_us);
+}
+
+static void test_bad_graphs(void)
+{
+    mock_i2c_stats_t stats;
+    max77654_seq_step_t cycle[] = {
+        {.rail = SSB0, .depends_on = MAX77654_SEQ_RAIL(SSB1)},
+        {.rail = SSB1, .depends_on = MAX77654_SEQ_RAIL(SSB0)},
+        {.rail = LDO0},
+    };
+    max77654_seq_step_t missing[] = {
+        {.rail = SSB0, .depends_on = MAX77654_SEQ_RAIL(LDO1)},
+    };
+    max77654_seq_step_t twice[] = {
+        {.rail = SSB0},
+        {.rail = SSB0},
+    };
+
+    power_on();
+    mock_i2c_reset_stats();
+    CHECK(max77654_seq_power_up(cycle, 3, NULL) == MAX77654_SEQ_ERR_GRAPH, "cycle accepted");
+    CHECK(max77654_seq_power_up(missing, 1, NULL) == MAX77654_SEQ_ERR_GRAPH, "missing dependency accepted");
+    CHECK(max77654_seq_power_up(twice, 2, NULL) == MAX77654_SEQ_ERR_GRAPH, "rail listed twice accepted");
+    mock_i2c_get_stats(&stats);
+    CHECK(stats.transactions == 0, "bad graph touched the bus");
+}
+
+int main() {
+    mock_time_add_hook(watch);
+
+    test_power_up_down();
+    test_power_good_timeout();
+    test_bad_graphs();
+
+    return test_report();
+}
@@ -0,0 +1,121 @@
+// Drives the MAX77654 driver against the register-level model: checks the register file
+// after max77654_init and the SSBx_* / LDOx_* calls, the fault paths (ERCFLAG, NACK),
+// and reports bus transactions and bus time against the budgets below
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "max77654.h"
+#include "max77654_model.h"
+#include "mock_i2c.h"
+#include "test_check.h"
+
+#define PMIC_ADDR 0x48
+
+#define INIT_MAX_TRANSACTIONS 4
+#define INIT_MAX_BUS_US 2000 // at 100 kHz
+
+static max77654_model_t pmic;
+
+
+static void power_on(void)
+{
+    mock_i2c_detach_all();
+    max77654_model_reset(&pmic);
+    max77654_model_attach(&pmic, i2c1, PMIC_ADDR);
+    mock_i2c_reset_stats();
+}
+
+static void test_init(void)
+{
+    mock_i2c_stats_t stats;
+
+    power_on();
+    uint64_t t0 = time_us_64();
+    int ret = max77654_init(i2c1);
+    uint64_t bus_us = time_us_64() - t0;
+    mock_i2c_get_stats(&stats);
+
+    CHECK(ret == 0, "max77654_init returned %d", ret);
+    CHECK_REG(0x29, 0x2E); // SSB0 3100 mV
+    CHECK_REG(0x2A, 0x37); // on, 330 mA, buck-boost
+    CHECK_REG(0x2B, 0x30); // SSB1 3200 mV
+    CHECK_REG(0x2C, 0x37);
+    CHECK_REG(0x2D, 0x32); // SSB2 3300 mV
+    CHECK_REG(0x2E, 0x37);
+    CHECK_REG(0x38, 0x10); // LDO0 1200 mV
+    CHECK_REG(0x39, 0x07);
+    CHECK_REG(0x3A, 0x04); // LDO1 900 mV
+    CHECK_REG(0x3B, 0x07);
+
+    printf("init: %u transactions, %u bytes, %u us bus time\n",
+           (unsigned)stats.transactions, (unsigned)stats.bytes, (unsigned)bus_us);
+    CHECK(stats.transactions <= INIT_MAX_TRANSACTIONS, "init took %u transactions", (unsigned)stats.transactions);
+    CHECK(bus_us <= INIT_MAX_BUS_US, "init took %u us", (unsigned)bus_us);
+}
+
+static void test_init_faults(void)
+{
+    power_on();
+    max77654_model_raise(&pmic, MODEL_REG_ERCFLAG, 1 << 2); // SYSUVLO
+    CHECK(max77654_init(i2c1) < 0, "init ignored SYSUVLO");
+    CHECK_REG(MODEL_REG_ERCFLAG, 0x00); // cleared by the read
+    CHECK_REG(0x2A, 0x04);             // rails untouched
+
+    power_on();
+    max77654_model_raise(&pmic, MODEL_REG_ERCFLAG, 1 << 0); // TOVLD
+    CHECK(max77654_init(i2c1) < 0, "init ignored TOVLD");
+
+    power_on();
+    max77654_model_inject_nack(&pmic, 1);
+    CHECK(max77654_init(i2c1) < 0, "init ignored a NACK on the probe");
+
+    power_on();
+    mock_i2c_detach_all();
+    CHECK(max77654_init(i2c1) < 0, "init succeeded with no device on the bus");
+}
+
+static void test_rails(void)
+{
+    mock_i2c_stats_t stats;
+    uint8_t readback[6];
+
+    power_on();
+    max77654_init(i2c1);
+
+    mock_i2c_reset_stats();
+    SSBx_set_voltage(1, 1800);
+    mock_i2c_get_stats(&stats);
+    CHECK_REG(0x2B, 0x14);
+    CHECK(stats.transactions == 1, "single set_voltage took %u transactions", (unsigned)stats.transactions);
+
+    SSBx_enable(2, false);
+    CHECK_REG(0x2E, 0x34);
+
+    LDOx_set_mode(1, LDO_MODE_LSW);
+    CHECK_REG(0x3B, 0x17);
+    LDOx_enable_active_discharge(1, true);
+    CHECK_REG(0x3B, 0x1F);
+    LDOx_enable(1, false);
+    CHECK_REG(0x3B, 0x1C);
+    LDOx_set_voltage(0, 3300);
+    CHECK_REG(0x38, 0x64);
+
+    // voltages out of range are clamped
+    SSBx_set_voltage(0, 9000);
+    CHECK_REG(0x29, 0x5E);
+    LDOx_set_voltage(1, 100);
+    CHECK_REG(0x3A, 0x00);
+
+    // auto-increment read back
+    CHECK(max77654_read_regs(0x29, readback, 6) == 0, "burst read failed");
+    for (int i = 0; i < 6; i++)
+        CHECK(readback[i] == max77654_model_peek(&pmic, 0x29 + i), "read back 0x%02x differs", 0x29 + i);
+}
+
+int main() {
+    test_init();
+    test_init_faults();
+    test_rails();
+
+    return test_report();
+}
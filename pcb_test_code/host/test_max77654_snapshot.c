@@ -0,0 +1,156 @@
+// Checks that snapshots are read in whole-block bursts and leave the clear-on-read registers alone,
+// that the diff reports drifted fields and ignores reserved bits, unknown and uncommitted registers,
+// and that verify restores a PMIC that went through a reset or adopts values changed behind its back
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "max77654.h"
+#include "max77654_shadow.h"
+#include "max77654_snapshot.h"
+#include "max77654_model.h"
+#include "mock_i2c.h"
+#include "mock_time.h"
+#include "test_check.h"
+
+static max77654_model_t pmic;
+
+static uint32_t transactions(void)
+{
+    mock_i2c_stats_t stats;
+    mock_i2c_get_stats(&stats);
+    return stats.transactions;
+}
+
+static bool config_matches_shadow(void)
+{
+    uint8_t shadow[0x3C - 0x29];
+
+    max77654_shadow_get(0x29, shadow, 6);
+    max77654_shadow_get(0x38, &shadow[6], 4);
+    for (int i = 0; i < 6; i++)
+        if ((max77654_model_peek(&pmic, 0x29 + i) & 0x7F) != (shadow[i] & 0x7F))
+            return false;
+    for (int i = 0; i < 4; i++)
+        if (max77654_model_peek(&pmic, 0x38 + i) != shadow[6 + i])
+            return false;
+    return true;
+}
+
+int main() {
+    max77654_snapshot_t snap;
+    max77654_drift_t drifts[64];
+    max77654_snapshot_stats_t stats;
+
+    mock_i2c_detach_all();
+    max77654_model_reset(&pmic);
+    max77654_model_attach(&pmic, i2c1, MAX77654_I2C_ADDR);
+    if (max77654_init(i2c1) < 0)
+    {
+        printf("max77654_init failed\n");
+        return 1;
+    }
+
+    // full snapshot: 5 bursts, register address + repeated start + read each
+    max77654_model_raise(&pmic, 0x05, 0x01); // ERCFLAG must survive the snapshot
+    mock_i2c_reset_stats();
+    CHECK(max77654_snapshot(&snap) == 0, "snapshot");
+    CHECK(transactions() == 5, "snapshot took %u transactions", transactions());
+    CHECK(max77654_model_peek(&pmic, 0x05) == 0x01, "ERCFLAG was cleared by the snapshot");
+    CHECK(!(snap.valid & MAX77654_SNAPSHOT_BIT(0x05)) && !(snap.valid & MAX77654_SNAPSHOT_BIT(0x00)), "interrupt registers read");
+    for (int reg = 0; reg < MAX77654_SNAPSHOT_REGS; reg++)
+        if (snap.valid & MAX77654_SNAPSHOT_BIT(reg))
+            CHECK(snap.regs[reg] == max77654_model_peek(&pmic, reg), "reg 0x%02x", reg);
+    CHECK(snap.valid & MAX77654_SNAPSHOT_BIT(0x14), "CID missing");
+    CHECK(snap.regs[0x14] == 0x01, "CID 0x%02x", snap.regs[0x14]);
+
+    // configuration snapshot: 2 bursts, nothing drifted after init
+    mock_i2c_reset_stats();
+    CHECK(max77654_snapshot_config(&snap) == 0, "config snapshot");
+    CHECK(transactions() == 2, "config snapshot took %u transactions", transactions());
+    CHECK(max77654_diff(&snap, drifts, 64) == 0, "drift right after init");
+
+    // one field changed on the chip, a reserved bit does not count
+    max77654_model_poke(&pmic, 0x2B, 0x80 | max77654_model_peek(&pmic, 0x2B));
+    max77654_model_poke(&pmic, 0x3B, max77654_model_peek(&pmic, 0x3B) ^ 0x08);
+    max77654_snapshot_config(&snap);
+    CHECK(max77654_diff(&snap, drifts, 64) == 1, "one drifted field expected");
+    CHECK(drifts[0].reg == 0x3B && drifts[0].mask == 0x08 && strcmp(drifts[0].name, "LDO1_ADE") == 0, "drift %s", drifts[0].name);
+    CHECK(drifts[0].chip == 1 && drifts[0].shadow == 0, "field values %u/%u", drifts[0].chip, drifts[0].shadow);
+    CHECK(max77654_diff(&snap, NULL, 0) == 1, "count without storage");
+
+    // uncommitted changes and registers the shadow does not know are skipped
+    max77654_begin();
+    LDOx_enable_active_discharge(1, false);
+    SSBx_set_voltage(0, 1000);
+    max77654_snapshot_config(&snap);
+    CHECK(max77654_diff(&snap, drifts, 64) == 0, "dirty registers have to be skipped");
+    max77654_commit();
+    max77654_model_poke(&pmic, 0x21, 0x01); // charger enabled behind the MCU's back, not in the shadow yet
+    max77654_snapshot_config(&snap);
+    CHECK(max77654_diff(&snap, drifts, 64) == 0, "unknown charger registers have to be skipped");
+    max77654_shadow_fetch(0x20, 9);
+    max77654_model_poke(&pmic, 0x21, 0x00);
+    max77654_snapshot_config(&snap);
+    CHECK(max77654_diff(&snap, drifts, 64) == 1 && strcmp(drifts[0].name, "CHG_EN") == 0, "charger drift");
+    max77654_model_poke(&pmic, 0x21, 0x01);
+
+    // report only
+    max77654_snapshot_reset_stats();
+    max77654_model_poke(&pmic, 0x29, 0x00);
+    CHECK(max77654_verify(drifts, 64) == 1, "verify report");
+    CHECK(max77654_model_peek(&pmic, 0x29) == 0x00, "report must not write");
+
+    // PMIC reset: every rail register is back at its reset value, one commit puts them all back
+    max77654_set_resync_policy(MAX77654_RESYNC_RESTORE);
+    uint8_t cid = max77654_model_peek(&pmic, 0x14);
+    max77654_model_reset(&pmic);
+    max77654_model_poke(&pmic, 0x14, cid);
+    max77654_model_poke(&pmic, 0x21, 0x01);
+    mock_i2c_reset_stats();
+    int count = max77654_verify(drifts, 64);
+    CHECK(count > 10, "only %d drifted fields after a reset", count);
+    CHECK(transactions() == 2 + 2, "verify and restore took %u transactions", transactions());
+    CHECK(config_matches_shadow(), "rails not restored");
+    CHECK(max77654_model_peek(&pmic, 0x20) == 0x0F, "CNFG_CHG_A matched, it has to stay");
+    CHECK(max77654_verify(drifts, 64) == 0, "drift left after the restore");
+    max77654_snapshot_get_stats(&stats);
+    CHECK(stats.checks == 3 && stats.drifts == 2 && stats.fields == (uint32_t)count + 1, "stats %u %u %u", stats.checks, stats.drifts, stats.fields);
+    CHECK(stats.resyncs >= 10 && stats.bus_errors == 0, "resyncs %u", stats.resyncs);
+
+    // adopt: the chip value becomes the shadow value, nothing is written
+    max77654_set_resync_policy(MAX77654_RESYNC_ADOPT);
+    max77654_model_poke(&pmic, 0x38, 0x20);
+    uint32_t writes = pmic.reg_writes[0x38];
+    CHECK(max77654_verify(drifts, 64) == 1, "verify adopt");
+    uint8_t ldo0;
+    max77654_shadow_get(0x38, &ldo0, 1);
+    CHECK(ldo0 == 0x20 && pmic.reg_writes[0x38] == writes, "LDO0 not adopted");
+    CHECK(max77654_verify(NULL, 0) == 0, "drift left after adopting");
+
+    // a NACK fails the check
+    max77654_model_inject_nack(&pmic, 1);
+    CHECK(max77654_verify(NULL, 0) == -1, "verify has to fail on a NACK");
+
+    // periodic check
+    max77654_set_resync_policy(MAX77654_RESYNC_RESTORE);
+    max77654_snapshot_reset_stats();
+    max77654_set_verify_period(10000);
+    uint64_t t0 = time_us_64();
+    bool poked = false;
+    while (time_us_64() - t0 < 100000)
+    {
+        if (!poked && time_us_64() - t0 >= 50000)
+        {
+            max77654_model_poke(&pmic, 0x2D, 0x00);
+            poked = true;
+        }
+        max77654_verify_task();
+        mock_time_advance_us(1000);
+    }
+    max77654_snapshot_get_stats(&stats);
+    CHECK(stats.checks == 9 || stats.checks == 10, "%u periodic checks", stats.checks);
+    CHECK(stats.drifts == 1 && config_matches_shadow(), "periodic restore");
+
+    return test_report();
+}
@@ -0,0 +1,164 @@
+// Saves rail profiles into the NOR flash model: boot applies the newest one within a few ms of
+// virtual time, erases are spread over both sectors, a save or erase cut off by a power loss keeps
+// the previous profile active, and profiles can be saved and read back over pmic_protocol
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "max77654.h"
+#include "max77654_store.h"
+#include "max77654_model.h"
+#include "mock_flash.h"
+#include "mock_i2c.h"
+#include "pmic_protocol.h"
+#include "test_check.h"
+
+static max77654_model_t pmic;
+
+static const max77654_profile_t profile_a = MAX77654_PROFILE(
+    MAX77654_SBB(1800, true, MAX77654_SBB_IPK_500MA, MAX77654_SBB_MODE_BUCK, false),
+    MAX77654_SBB(3300, true, MAX77654_SBB_IPK_330MA, MAX77654_SBB_MODE_BUCK_BOOST, false),
+    MAX77654_SBB(5000, false, MAX77654_SBB_IPK_1000MA, MAX77654_SBB_MODE_BUCK_BOOST, true),
+    MAX77654_LDO(1200, true, LDO_MODE_LDO, false),
+    MAX77654_LDO(2500, true, LDO_MODE_LSW, true));
+
+static const max77654_profile_t profile_b = MAX77654_PROFILE(
+    MAX77654_SBB(1000, true, MAX77654_SBB_IPK_330MA, MAX77654_SBB_MODE_BUCK, false),
+    MAX77654_SBB(1200, true, MAX77654_SBB_IPK_330MA, MAX77654_SBB_MODE_BUCK, false),
+    MAX77654_SBB(1500, true, MAX77654_SBB_IPK_330MA, MAX77654_SBB_MODE_BUCK, false),
+    MAX77654_LDO(900, true, LDO_MODE_LDO, false),
+    MAX77654_LDO(1000, true, LDO_MODE_LDO, false));
+
+static uint8_t response[PMIC_PROTO_MAX_PAYLOAD];
+static uint32_t response_len;
+
+static uint32_t collect(const uint8_t *data, uint32_t len)
+{
+    uint32_t in = 0, o = 0;
+
+    while (in < len - 1)
+    {
+        uint8_t code = data[in++];
+        for (uint8_t i = 1; i < code; i++)
+            response[o++] = data[in++];
+        if (code < 0xFF && in < len - 1)
+            response[o++] = 0;
+    }
+    response_len = o - 2;
+    return len;
+}
+
+static void call(uint8_t cmd, const uint8_t *args, uint32_t len)
+{
+    uint8_t payload[PMIC_PROTO_MAX_PAYLOAD], encoded[PMIC_PROTO_MAX_PAYLOAD + 4];
+
+    payload[0] = 1;
+    payload[1] = cmd;
+    memcpy(&payload[2], args, len);
+    response_len = 0;
+    pmic_proto_feed(encoded, pmic_proto_encode(payload, len + 2, encoded));
+}
+
+static bool profile_on_chip(const max77654_profile_t *p)
+{
+    for (unsigned int i = 0; i < sizeof(p->sbb); i++)
+        if (max77654_model_peek(&pmic, 0x29 + i) != p->sbb[i])
+            return false;
+    for (unsigned int i = 0; i < sizeof(p->ldo); i++)
+        if (max77654_model_peek(&pmic, 0x38 + i) != p->ldo[i])
+            return false;
+    return true;
+}
+
+// power cycle of the board: fresh PMIC, then boot from flash
+static int reboot(void)
+{
+    max77654_model_reset(&pmic);
+    return max77654_store_boot(i2c1);
+}
+
+int main() {
+    max77654_profile_t p;
+    max77654_store_info_t info;
+
+    mock_flash_reset();
+    mock_i2c_detach_all();
+    max77654_model_reset(&pmic);
+    max77654_model_attach(&pmic, i2c1, MAX77654_I2C_ADDR);
+
+    // empty store: the built-in profile, SSB0 at 3.1 V
+    CHECK(max77654_store_load(&p) == -1, "load from an empty store");
+    CHECK(reboot() == 0, "boot without a stored profile");
+    CHECK(max77654_model_peek(&pmic, 0x29) == (3100 - 800) / 50, "built-in SSB0");
+
+    // saved profile comes up at boot, within a few ms
+    CHECK(max77654_store_save(&profile_a) == 0, "save");
+    CHECK(max77654_store_load(&p) == 0 && memcmp(&p, &profile_a, sizeof(p)) == 0, "load");
+    max77654_store_get_info(&info);
+    CHECK(info.stored && info.seq == 1 && info.slot == 0 && info.free == 255, "info %u %u %u", info.seq, info.slot, info.free);
+    uint64_t t0 = time_us_64();
+    CHECK(reboot() == 1, "boot with the stored profile");
+    uint64_t boot_us = time_us_64() - t0;
+    CHECK(profile_on_chip(&profile_a), "stored profile not applied");
+    CHECK(boot_us < 5000, "boot took %llu us", (unsigned long long)boot_us);
+
+    // values the chip does not define are rejected
+    p = profile_a;
+    p.sbb[0] = 0x5F;
+    CHECK(!max77654_profile_check(&p) && max77654_store_save(&p) == -1, "SBB0 above 5.5 V accepted");
+    p = profile_a;
+    p.ldo[3] |= 0x20;
+    CHECK(!max77654_profile_check(&p) && max77654_store_save(&p) == -1, "LDO1 reserved bit accepted");
+
+    // wear levelling: 128 saves per erase, alternating between the sectors
+    for (int i = 0; i < 600; i++)
+        CHECK(max77654_store_save(i & 1 ? &profile_a : &profile_b) == 0, "save %d", i);
+    max77654_store_get_info(&info);
+    CHECK(info.seq == 601 && info.slot == 600 % 256, "after 601 saves: seq %u slot %u", info.seq, info.slot);
+    uint32_t e0 = mock_flash_erase_count(0), e1 = mock_flash_erase_count(1);
+    CHECK(e0 + e1 == 3 && (e0 > e1 ? e0 - e1 : e1 - e0) <= 1, "erases %u / %u", e0, e1);
+    CHECK(max77654_store_load(&p) == 0 && memcmp(&p, &profile_a, sizeof(p)) == 0, "newest profile after wrapping");
+
+    // power lost in the middle of programming a slot: the previous profile stays active
+    mock_flash_cut_power_after(12);
+    CHECK(max77654_store_save(&profile_b) == -1, "cut save has to fail");
+    CHECK(reboot() == 1 && profile_on_chip(&profile_a), "previous profile after a cut save");
+    CHECK(max77654_store_save(&profile_b) == 0, "save after a cut one");
+    CHECK(reboot() == 1 && profile_on_chip(&profile_b), "profile after a cut save");
+    max77654_store_get_info(&info);
+    CHECK(info.slot == (600 + 2) % 256, "the torn slot has to be skipped, slot %u", info.slot);
+
+    // power lost while erasing the next sector
+    while (info.free > 0)
+    {
+        CHECK(max77654_store_save(&profile_a) == 0, "fill");
+        max77654_store_get_info(&info);
+    }
+    mock_flash_cut_power_after(100);
+    CHECK(max77654_store_save(&profile_b) == -1, "cut erase has to fail");
+    CHECK(reboot() == 1 && profile_on_chip(&profile_a), "previous profile after a cut erase");
+    CHECK(max77654_store_save(&profile_b) == 0 && max77654_store_load(&p) == 0 && memcmp(&p, &profile_b, sizeof(p)) == 0,
+          "save after a cut erase");
+
+    // over the protocol: save and apply right away, read back, clear
+    pmic_proto_init(collect);
+    uint8_t args[1 + sizeof(max77654_profile_t)];
+    args[0] = 0x01;
+    memcpy(&args[1], &profile_a, sizeof(profile_a));
+    call(PMIC_CMD_PROFILE_SAVE, args, sizeof(args));
+    CHECK(response_len == 2 && response[1] == PMIC_STATUS_OK, "PROFILE_SAVE status %u", response[1]);
+    CHECK(profile_on_chip(&profile_a), "PROFILE_SAVE did not apply");
+    args[1] = 0x7F;
+    call(PMIC_CMD_PROFILE_SAVE, args, sizeof(args));
+    CHECK(response[1] == PMIC_STATUS_BAD_ARGS, "bad profile status %u", response[1]);
+    call(PMIC_CMD_PROFILE_GET, NULL, 0);
+    CHECK(response[1] == PMIC_STATUS_OK && response_len == 2 + 7 + sizeof(profile_a), "PROFILE_GET length %u", response_len);
+    CHECK(response[2] == 1 && memcmp(&response[9], &profile_a, sizeof(profile_a)) == 0, "PROFILE_GET profile");
+    call(PMIC_CMD_PROFILE_CLEAR, NULL, 0);
+    CHECK(response[1] == PMIC_STATUS_OK, "PROFILE_CLEAR status %u", response[1]);
+    call(PMIC_CMD_PROFILE_GET, NULL, 0);
+    CHECK(response_len == 2 + 7 && response[2] == 0, "PROFILE_GET after clear");
+    CHECK(reboot() == 0, "boot after clear");
+
+    return test_report();
+}
@@ -0,0 +1,129 @@
+// Samples the MAX77654 model with two telemetry streams on the simulated timers and I2C
+// controller, injects a brown-out (SYSUVLO) and checks it shows up in the records, runs
+// blocking register access from the main loop next to the streams, then overloads the bus
+// to check the drop counters
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "max77654.h"
+#include "max77654_async.h"
+#include "max77654_telemetry.h"
+#include "max77654_model.h"
+#include "mock_time.h"
+#include "mock_i2c.h"
+#include "test_check.h"
+
+static max77654_model_t pmic;
+
+static uint32_t records[MAX77654_TELEM_MAX_STREAMS];
+static uint32_t last_timestamp[MAX77654_TELEM_MAX_STREAMS];
+static uint16_t first_seq[MAX77654_TELEM_MAX_STREAMS];
+static uint16_t last_seq[MAX77654_TELEM_MAX_STREAMS];
+static uint32_t seq_gaps;
+static uint32_t uvlo_seen_us;
+
+static uint32_t consume(const uint8_t *data, uint32_t len)
+{
+    uint8_t stream = data[0];
+    uint16_t seq = data[2] | (data[3] << 8);
+    uint32_t ts = data[4] | (data[5] << 8) | (data[6] << 16) | ((uint32_t)data[7] << 24);
+
+    if (records[stream] && seq != (uint16_t)(last_seq[stream] + 1))
+        seq_gaps++;
+    if (!records[stream])
+        first_seq[stream] = seq;
+    records[stream]++;
+    last_seq[stream] = seq;
+    last_timestamp[stream] = ts;
+
+    // stream 0 starts at ERCFLAG
+    if (stream == 0 && (data[MAX77654_TELEM_RECORD_HEADER] & (1 << 2)) && !uvlo_seen_us)
+        uvlo_seen_us = ts;
+    return len;
+}
+
+static void run_for_us(uint64_t us)
+{
+    uint64_t end = time_us_64() + us;
+    while (time_us_64() < end)
+    {
+        mock_time_advance_us(50); // one pass of the main loop
+        max77654_telem_drain(consume);
+    }
+}
+
+int main() {
+    max77654_telem_counters_t c0, c1;
+
+    max77654_model_reset(&pmic);
+    max77654_model_attach(&pmic, i2c1, 0x48);
+    max77654_init(i2c1);
+    i2c_set_baudrate(i2c1, 1000 * 1000);
+    max77654_async_init(i2c1);
+
+    int s0 = max77654_telem_add_stream(MODEL_REG_ERCFLAG, 2, 2000);   // ERCFLAG, STAT_GLBL at 2 kHz
+    int s1 = max77654_telem_add_stream(MODEL_REG_STAT_CHG_A, 2, 500); // STAT_CHG_A/B at 500 Hz
+    CHECK(s0 == 0 && s1 == 1, "stream ids %d %d", s0, s1);
+    max77654_telem_start();
+
+    run_for_us(100000);
+    uint64_t fault_us = time_us_64();
+    max77654_model_raise(&pmic, MODEL_REG_ERCFLAG, 1 << 2); // SYSUVLO, cleared by the next read
+    run_for_us(100000);
+
+    max77654_telem_get_counters(s0, &c0);
+    max77654_telem_get_counters(s1, &c1);
+    printf("stream 0: %u records, %u samples, busy %u, full %u\n", (unsigned)records[0], (unsigned)c0.samples,
+           (unsigned)c0.dropped_busy, (unsigned)c0.dropped_full);
+    printf("stream 1: %u records, %u samples\n", (unsigned)records[1], (unsigned)c1.samples);
+    printf("SYSUVLO latched at %u us, first seen in a sample triggered %u us later\n",
+           (unsigned)fault_us, (unsigned)(uvlo_seen_us - fault_us));
+
+    CHECK(records[0] >= 399 && records[0] <= 401, "stream 0 rate, %u records", (unsigned)records[0]);
+    CHECK(records[1] >= 99 && records[1] <= 101, "stream 1 rate, %u records", (unsigned)records[1]);
+    CHECK(seq_gaps == 0 && c0.dropped_busy == 0 && c0.dropped_full == 0, "drops at nominal load");
+    CHECK(uvlo_seen_us >= fault_us && uvlo_seen_us - fault_us <= 500, "brown-out caught after %u us", (unsigned)(uvlo_seen_us - fault_us));
+
+    // blocking register access of the main loop (protocol commands, rail changes) waits behind the samples
+    mock_i2c_stats_t stats;
+    int read_errors = 0, write_errors = 0;
+    int16_t mv = 0;
+    mock_i2c_reset_stats();
+    for (int i = 0; i < 50; i++)
+    {
+        uint8_t regs[6];
+        if (max77654_read_regs(0x29, regs, sizeof(regs)) < 0 || regs[0] != max77654_model_peek(&pmic, 0x29))
+            read_errors++;
+        mv = 1000 + (i % 4) * 100;
+        if (SSBx_set_voltage(0, mv) < 0)
+            write_errors++;
+        run_for_us(1000);
+    }
+    mock_i2c_get_stats(&stats);
+    printf("blocking access next to the streams: %u collisions\n", (unsigned)stats.collisions);
+    CHECK(stats.collisions == 0, "%u blocking transfers met a transfer of the IRQ", (unsigned)stats.collisions);
+    CHECK(read_errors == 0 && write_errors == 0, "%d reads, %d writes failed", read_errors, write_errors);
+    CHECK_REG(0x29, calculate_ssb_voltage_reg(mv));
+
+    // a stream faster than the bus can serve counts busy drops instead of piling up requests
+    int s2 = max77654_telem_add_stream(0x29, 16, 50000);
+    run_for_us(10000);
+    max77654_telem_counters_t c2;
+    max77654_telem_get_counters(s2, &c2);
+    printf("overloaded stream: %u samples, busy %u\n", (unsigned)c2.samples, (unsigned)c2.dropped_busy);
+    CHECK(c2.dropped_busy > 0, "no busy drops on an overloaded stream");
+    // triggers dropped while the first read was on the bus do not renumber it
+    CHECK(records[s2] > 0 && first_seq[s2] == 1, "first sample of the overloaded stream has seq %u", first_seq[s2]);
+    max77654_telem_get_counters(MAX77654_TELEM_MAX_STREAMS, &c2);
+    CHECK(c2.samples == 0 && c2.dropped_busy == 0, "counters of a stream out of range");
+
+    // the ring fills when nobody drains
+    max77654_telem_remove_stream(s2);
+    mock_time_advance_us(200000);
+    max77654_telem_get_counters(s0, &c0);
+    CHECK(c0.dropped_full > 0, "no full drops without draining");
+
+    max77654_telem_stop();
+
+    return test_report();
+}
@@ -0,0 +1,143 @@
+// Times MAX77654 transfers against the bus model: blocking and async latency histograms per operation and
+// per register, NACK and timeout counts, a slowed-down bus showing up in the percentiles, and the CDC query
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "max77654.h"
+#include "max77654_async.h"
+#include "max77654_model.h"
+#include "max77654_trace.h"
+#include "mock_i2c.h"
+#include "mock_time.h"
+#include "pmic_protocol.h"
+#include "test_check.h"
+
+static max77654_model_t pmic;
+
+static uint8_t response[PMIC_PROTO_MAX_PAYLOAD];
+static uint32_t response_len;
+
+// decodes the one response frame, CRC stripped
+static uint32_t collect(const uint8_t *data, uint32_t len)
+{
+    uint32_t in = 0, o = 0;
+
+    while (in < len - 1)
+    {
+        uint8_t code = data[in++];
+        for (uint8_t i = 1; i < code; i++)
+            response[o++] = data[in++];
+        if (code < 0xFF && in < len - 1)
+            response[o++] = 0;
+    }
+    response_len = o - 2;
+    return len;
+}
+
+static uint32_t resp_u32(int i)
+{
+    const uint8_t *p = &response[2 + 4 * i];
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+int main() {
+    max77654_trace_op_t op;
+    max77654_trace_reg_t reg;
+    uint8_t data[4];
+
+    max77654_model_reset(&pmic);
+    max77654_model_attach(&pmic, i2c1, 0x48);
+    max77654_init(i2c1);
+    i2c_set_baudrate(i2c1, 1000 * 1000);
+    max77654_trace_reset();
+
+    // blocking writes: only CNFG_SBB1_A changes, one register per commit
+    for (int i = 0; i < 10; i++)
+        SSBx_set_voltage(1, i & 1 ? 1800 : 3300);
+    max77654_trace_get_op(MAX77654_OP_WRITE, &op);
+    uint32_t write_us = mock_i2c_transfer_time_us(i2c1, 2);
+    CHECK(op.count == 10 && op.nacks == 0 && op.timeouts == 0, "writes %u", (unsigned)op.count);
+    CHECK(op.min_us == write_us && op.max_us == write_us && op.total_us == 10 * write_us,
+          "write latency %u..%u us, expected %u", (unsigned)op.min_us, (unsigned)op.max_us, (unsigned)write_us);
+    CHECK(op.hist[max77654_trace_bucket(write_us)] == 10, "write histogram");
+    max77654_trace_get_reg(0x2B, &reg);
+    CHECK(reg.count == 10 && reg.max_us == write_us, "CNFG_SBB1_A count %u", (unsigned)reg.count);
+
+    // blocking read: address write plus data read
+    max77654_read_regs(0x02, data, 2);
+    max77654_trace_get_op(MAX77654_OP_READ, &op);
+    uint32_t read_us = mock_i2c_transfer_time_us(i2c1, 1) + mock_i2c_transfer_time_us(i2c1, 2);
+    CHECK(op.count == 1 && op.max_us == read_us, "read latency %u us, expected %u", (unsigned)op.max_us, (unsigned)read_us);
+    max77654_trace_get_reg(0x02, &reg);
+    CHECK(reg.count == 1 && reg.errors == 0, "STAT_CHG_A");
+
+    // a NACK
+    max77654_model_inject_nack(&pmic, 1);
+    CHECK(max77654_write_regs(0x2B, data, 1) < 0, "NACK not reported");
+    max77654_trace_get_op(MAX77654_OP_WRITE, &op);
+    max77654_trace_get_reg(0x2B, &reg);
+    CHECK(op.nacks == 1 && op.timeouts == 0 && reg.errors == 1, "nacks %u, reg errors %u", (unsigned)op.nacks, (unsigned)reg.errors);
+
+    // a device holding the clock beyond the timeout
+    mock_i2c_set_stretch_us(i2c1, 10000);
+    CHECK(max77654_read_regs(0x02, data, 2) < 0, "timeout not reported");
+    mock_i2c_set_stretch_us(i2c1, 0);
+    max77654_trace_get_op(MAX77654_OP_READ, &op);
+    CHECK(op.timeouts == 1 && op.nacks == 0, "timeouts %u nacks %u", (unsigned)op.timeouts, (unsigned)op.nacks);
+    CHECK(op.max_us >= 2000 && op.max_us < 10000, "timeout after %u us", (unsigned)op.max_us);
+
+    // slow pull-ups: every transfer 150 us longer moves the 99th percentile up
+    max77654_trace_reset();
+    for (int i = 0; i < 100; i++)
+        max77654_read_regs(0x06, data, 1);
+    max77654_trace_get_op(MAX77654_OP_READ, &op);
+    uint32_t p99_healthy = max77654_trace_percentile(op.hist, 990);
+    mock_i2c_set_stretch_us(i2c1, 150);
+    max77654_trace_reset();
+    for (int i = 0; i < 100; i++)
+        max77654_read_regs(0x06, data, 1);
+    mock_i2c_set_stretch_us(i2c1, 0);
+    max77654_trace_get_op(MAX77654_OP_READ, &op);
+    uint32_t p99_slow = max77654_trace_percentile(op.hist, 990);
+    printf("read p99 %u us healthy, %u us with 150 us stretch\n", (unsigned)p99_healthy, (unsigned)p99_slow);
+    CHECK(p99_slow > p99_healthy && p99_healthy >= read_us / 2, "p99 %u -> %u", (unsigned)p99_healthy, (unsigned)p99_slow);
+    CHECK(max77654_trace_percentile(op.hist, 500) >= op.min_us, "median below minimum");
+
+    // async: latency from submission to completion, queueing included
+    max77654_async_init(i2c1);
+    max77654_async_req_t req[2];
+    uint8_t buf[2][2];
+    max77654_async_read(&req[0], 0x02, buf[0], 2, NULL, NULL);
+    max77654_async_read(&req[1], 0x02, buf[1], 2, NULL, NULL);
+    max77654_async_flush();
+    max77654_trace_get_op(MAX77654_OP_ASYNC_READ, &op);
+    CHECK(op.count == 2 && op.max_us == (uint32_t)(req[1].done_us - req[1].submit_us) && op.max_us > op.min_us,
+          "async %u requests, %u..%u us", (unsigned)op.count, (unsigned)op.min_us, (unsigned)op.max_us);
+
+    // CDC query of the read statistics and of one register
+    uint8_t frame[64];
+    uint8_t payload[8] = {7, PMIC_CMD_TRACE, 0, MAX77654_OP_READ};
+    pmic_proto_init(collect);
+    pmic_proto_feed(frame, pmic_proto_encode(payload, 4, frame));
+    CHECK(response_len == 2 + 4 * (7 + MAX77654_TRACE_BUCKETS) && response[1] == PMIC_STATUS_OK, "op response %u bytes", (unsigned)response_len);
+    CHECK(resp_u32(0) == 100, "op response count %u", (unsigned)resp_u32(0));
+    max77654_trace_get_op(MAX77654_OP_READ, &op);
+    CHECK(resp_u32(3) == op.min_us && resp_u32(4) == op.max_us && resp_u32(5) == (uint32_t)op.total_us, "op response times");
+
+    payload[2] = 1;
+    payload[3] = 0x02;
+    pmic_proto_feed(frame, pmic_proto_encode(payload, 4, frame));
+    CHECK(response_len == 2 + 4 * (3 + MAX77654_TRACE_BUCKETS) && resp_u32(0) == 2, "reg response, count %u", (unsigned)resp_u32(0));
+
+    payload[3] = MAX77654_TRACE_REGS;
+    pmic_proto_feed(frame, pmic_proto_encode(payload, 4, frame));
+    CHECK(response[1] == PMIC_STATUS_BAD_ARGS, "register out of range accepted");
+
+    payload[1] = PMIC_CMD_TRACE_RESET;
+    pmic_proto_feed(frame, pmic_proto_encode(payload, 2, frame));
+    max77654_trace_get_op(MAX77654_OP_READ, &op);
+    CHECK(response[1] == PMIC_STATUS_OK && op.count == 0, "reset");
+
+    return test_report();
+}
@@ -0,0 +1,188 @@
+// Feeds pipelined pmic_protocol frames (several per USB packet, one corrupted) through the
+// decoder against the MAX77654 model, checks responses and register file, and reports the
+// bus cost of a batched full-rail reconfiguration
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "max77654.h"
+#include "max77654_model.h"
+#include "mock_i2c.h"
+#include "pmic_protocol.h"
+#include "test_check.h"
+
+static max77654_model_t pmic;
+
+// responses as decoded payloads (request id, status, data), CRC stripped
+static uint8_t responses[8][PMIC_PROTO_MAX_PAYLOAD];
+static uint32_t response_len[8];
+static int n_responses;
+
+static uint32_t collect(const uint8_t *data, uint32_t len)
+{
+    uint32_t frame_len = len;
+    uint8_t *out = responses[n_responses];
+    uint32_t in = 0, o = 0;
+
+    len--; // delimiter
+    while (in < len)
+    {
+        uint8_t code = data[in++];
+        for (uint8_t i = 1; i < code; i++)
+            out[o++] = data[in++];
+        if (code < 0xFF && in < len)
+            out[o++] = 0;
+    }
+    CHECK(pmic_proto_crc16(out, o - 2) == (out[o - 2] | (out[o - 1] << 8)), "response CRC");
+    response_len[n_responses++] = o - 2;
+    return frame_len;
+}
+
+static uint32_t frame(uint8_t *dst, uint8_t id, uint8_t cmd, const uint8_t *args, uint32_t len)
+{
+    uint8_t payload[PMIC_PROTO_MAX_PAYLOAD];
+    payload[0] = id;
+    payload[1] = cmd;
+    memcpy(&payload[2], args, len);
+    return pmic_proto_encode(payload, len + 2, dst);
+}
+
+int main() {
+    uint8_t packet[512];
+    uint32_t n = 0;
+    mock_i2c_stats_t stats;
+
+    max77654_model_reset(&pmic);
+    max77654_model_attach(&pmic, i2c1, 0x48);
+    max77654_init(i2c1);
+    pmic_proto_init(collect);
+
+    // batch: SSB0..2 to 1.0 V / 1.8 V / 0.8 V, LDO1 off
+    const uint8_t batch[] = {
+        PMIC_CMD_SET_VOLTAGE, 3, 0, 0xE8, 0x03,
+        PMIC_CMD_SET_VOLTAGE, 3, 1, 0x08, 0x07,
+        PMIC_CMD_SET_VOLTAGE, 3, 2, 0x20, 0x03,
+        PMIC_CMD_ENABLE, 2, 4, 0,
+    };
+    const uint8_t read[] = {0x29, 6};
+    const uint8_t ping[] = {0x00, 0x11, 0x00};
+
+    n += frame(&packet[n], 1, PMIC_CMD_BATCH, batch, sizeof(batch));
+    n += frame(&packet[n], 2, PMIC_CMD_READ_REGS, read, sizeof(read));
+    uint32_t bad = n;
+    n += frame(&packet[n], 3, PMIC_CMD_PING, ping, sizeof(ping));
+    packet[bad + 2] ^= 0x40; // corrupt frame 3
+    n += frame(&packet[n], 4, 0x7E, NULL, 0);
+    n += frame(&packet[n], 5, PMIC_CMD_PING, ping, sizeof(ping));
+
+    pmic_proto_feed(packet, n);
+
+    CHECK(n_responses == 4, "%d responses", n_responses);
+    CHECK(pmic_proto_dropped_frames() == 1, "dropped %u", (unsigned)pmic_proto_dropped_frames());
+
+    CHECK(responses[0][0] == 1 && responses[0][1] == PMIC_STATUS_OK, "batch status %d", responses[0][1]);
+    CHECK(max77654_model_peek(&pmic, 0x29) == 0x04, "SSB0 voltage");
+    CHECK(max77654_model_peek(&pmic, 0x2B) == 0x14, "SSB1 voltage");
+    CHECK(max77654_model_peek(&pmic, 0x2D) == 0x00, "SSB2 voltage");
+    CHECK(max77654_model_peek(&pmic, 0x3B) == 0x04, "LDO1 off");
+
+    CHECK(responses[1][0] == 2 && responses[1][1] == PMIC_STATUS_OK && response_len[1] == 8, "read response");
+    for (int i = 0; i < 6; i++)
+        CHECK(responses[1][2 + i] == max77654_model_peek(&pmic, 0x29 + i), "read data 0x%02x", 0x29 + i);
+
+    CHECK(responses[2][0] == 4 && responses[2][1] == PMIC_STATUS_UNKNOWN_CMD, "unknown command");
+    CHECK(responses[3][0] == 5 && response_len[3] == 5 && memcmp(&responses[3][2], ping, 3) == 0, "ping echo with zeros");
+
+    // byte by byte gives the same result
+    n_responses = 0;
+    for (uint32_t i = 0; i < n; i++)
+        pmic_proto_feed(&packet[i], 1);
+    CHECK(n_responses == 4, "%d responses byte by byte", n_responses);
+
+    // a raw write is taken over into the shadow map: SBB0 switched off behind the rail functions
+    // stays off when a later burst over 0x29..0x2B covers its enable register
+    const uint8_t sbb0_off[] = {0x2A, 0x04};
+    n_responses = 0;
+    n = frame(packet, 6, PMIC_CMD_WRITE_REGS, sbb0_off, sizeof(sbb0_off));
+    pmic_proto_feed(packet, n);
+    CHECK(n_responses == 1 && responses[0][1] == PMIC_STATUS_OK, "raw write status %d", responses[0][1]);
+    max77654_begin();
+    SSBx_set_voltage(0, 1800);
+    SSBx_set_voltage(1, 1900);
+    CHECK(max77654_commit() == 0, "commit after a raw write");
+    CHECK(max77654_model_peek(&pmic, 0x2A) == 0x04, "stale shadow wrote SBB0_B back: 0x%02x", max77654_model_peek(&pmic, 0x2A));
+    CHECK(max77654_model_peek(&pmic, 0x29) == 0x14 && max77654_model_peek(&pmic, 0x2B) == 0x16, "rails around the raw write");
+
+    // longer than one burst is a bad request, not a bus error
+    uint8_t long_write[1 + MAX77654_MAX_BURST_LEN + 1] = {0x29};
+    n_responses = 0;
+    n = frame(packet, 7, PMIC_CMD_WRITE_REGS, long_write, sizeof(long_write));
+    pmic_proto_feed(packet, n);
+    CHECK(n_responses == 1 && responses[0][1] == PMIC_STATUS_BAD_ARGS, "long WRITE_REGS status %d", responses[0][1]);
+
+    // bus cost of the batch alone
+    n = frame(packet, 8, PMIC_CMD_BATCH, batch, sizeof(batch));
+    mock_i2c_reset_stats();
+    uint64_t t0 = time_us_64();
+    pmic_proto_feed(packet, n);
+    uint64_t batch_us = time_us_64() - t0;
+    mock_i2c_get_stats(&stats);
+    printf("batch of 4 rail commands: %u transactions, %u us bus time at 100 kHz -> %u batches/s\n",
+           (unsigned)stats.transactions, (unsigned)batch_us, (unsigned)(1000000 / batch_us));
+    CHECK(stats.transactions <= 2, "batch took %u transactions", (unsigned)stats.transactions);
+
+    // voltages outside the range of the rail are refused, not clamped or wrapped
+    uint8_t regs[0x3C];
+    for (uint8_t r = 0x20; r < 0x3C; r++)
+        regs[r] = max77654_model_peek(&pmic, r);
+    const uint8_t out_of_range[][3] = {
+        {0, 0x7D, 0x15}, // SSB0 5501 mV
+        {1, 0x40, 0x9C}, // SSB1 40000 mV, negative as int16_t
+        {2, 0x1F, 0x03}, // SSB2 799 mV
+        {3, 0xA0, 0x0F}, // LDO0 4000 mV
+    };
+    n = 0;
+    for (int i = 0; i < 4; i++)
+        n += frame(&packet[n], 9 + i, PMIC_CMD_SET_VOLTAGE, out_of_range[i], 3);
+    n_responses = 0;
+    mock_i2c_reset_stats();
+    pmic_proto_feed(packet, n);
+    mock_i2c_get_stats(&stats);
+    CHECK(n_responses == 4, "%d responses", n_responses);
+    for (int i = 0; i < n_responses; i++)
+        CHECK(responses[i][1] == PMIC_STATUS_BAD_ARGS, "out of range voltage %d status %d", i, responses[i][1]);
+    CHECK(stats.transactions == 0, "out of range voltages took %u transactions", (unsigned)stats.transactions);
+
+    // a batch whose last command fails commits nothing, later commits do not pick its changes up
+    const uint8_t bad_last[] = {
+        PMIC_CMD_SET_VOLTAGE, 3, 0, 0xB0, 0x04, // SSB0 1.2 V
+        PMIC_CMD_SET_VOLTAGE, 3, 1, 0xDC, 0x05, // SSB1 1.5 V
+        PMIC_CMD_SET_VOLTAGE, 3, 2, 0x70, 0x17, // SSB2 6.0 V
+    };
+    n_responses = 0;
+    mock_i2c_reset_stats();
+    n = frame(packet, 13, PMIC_CMD_BATCH, bad_last, sizeof(bad_last));
+    pmic_proto_feed(packet, n);
+    mock_i2c_get_stats(&stats);
+    CHECK(n_responses == 1 && responses[0][1] == PMIC_STATUS_BAD_ARGS && response_len[0] == 2,
+          "bad last entry status %d, %u bytes", responses[0][1], (unsigned)response_len[0]);
+    CHECK(stats.transactions == 0, "failed batch took %u transactions", (unsigned)stats.transactions);
+    CHECK(LDOx_set_voltage(0, 1800) == 0, "commit after the failed batch");
+    regs[0x38] = max77654_model_peek(&pmic, 0x38);
+    for (uint8_t r = 0x20; r < 0x3C; r++)
+        CHECK(max77654_model_peek(&pmic, r) == regs[r], "register 0x%02x changed to 0x%02x", r, max77654_model_peek(&pmic, r));
+
+    // a malformed batch runs none of its commands, register commands included
+    const uint8_t truncated[] = {
+        PMIC_CMD_WRITE_REGS, 2, 0x2A, 0x04,
+        PMIC_CMD_SET_VOLTAGE, 3, 0, 0xB0,
+    };
+    max77654_model_poke(&pmic, 0x2A, 0x06);
+    n_responses = 0;
+    n = frame(packet, 14, PMIC_CMD_BATCH, truncated, sizeof(truncated));
+    pmic_proto_feed(packet, n);
+    CHECK(n_responses == 1 && responses[0][1] == PMIC_STATUS_BAD_ARGS, "truncated batch status %d", responses[0][1]);
+    CHECK(max77654_model_peek(&pmic, 0x2A) == 0x06, "truncated batch wrote 0x2A");
+
+    return test_report();
+}
@@ -0,0 +1,145 @@
+// usb_dual_cdc built from test_cdc_config.h: three interfaces with their own receive and transmit
+// ring sizes, each ring holds exactly what it was configured for and all three carry data at once
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "usb_dual_cdc.h"
+#include "mock_tusb.h"
+#include "mock_time.h"
+#include "test_check.h"
+
+#define STREAM 10000
+
+static const struct {
+    uint32_t rx_size;
+    uint32_t tx_size;
+} sizes[] = {{64, 128}, {256, 8192}, {2048, 64}};
+
+_Static_assert(CFG_TUD_CDC == 3, "CFG_TUD_CDC comes from the interface list");
+_Static_assert(USB_CDC_RAM_BYTES == 64 + 128 + 256 + 8192 + 2048 + 64, "ring storage");
+
+static uint8_t pattern(uint32_t pos, uint8_t itf) { return (uint8_t)(pos * 13 + itf * 71 + (pos >> 9)); }
+
+static void run(uint32_t us)
+{
+    for (uint32_t t = 0; t < us; t += 100)
+    {
+        cdc_task();
+        sleep_us(100);
+    }
+}
+
+static void setup(void)
+{
+    mock_time_reset();
+    mock_tusb_reset();
+    cdc_init();
+    for (uint8_t itf = 0; itf < CFG_TUD_CDC; itf++)
+    {
+        mock_tusb_connect(itf, true);
+        cdc_set_overflow_policy(itf, CDC_OVERFLOW_PARTIAL, 0);
+    }
+    cdc_task();
+}
+
+int main() {
+    uint8_t buf[512];
+
+    // receive: the device does not read, its ring fills up to the configured size and TinyUSB's FIFO behind it
+    setup();
+    for (uint8_t itf = 0; itf < CFG_TUD_CDC; itf++)
+    {
+        uint32_t sent = 0;
+        while (sent < 4096)
+        {
+            for (uint32_t i = 0; i < sizeof(buf); i++)
+                buf[i] = pattern(sent + i, itf);
+            sent += mock_tusb_host_write(itf, buf, sizeof(buf));
+        }
+    }
+    run(20000);
+    for (uint8_t itf = 0; itf < CFG_TUD_CDC; itf++)
+        CHECK(cdc_available_bytes(itf) == sizes[itf].rx_size, "itf %d receive ring holds %u", itf, cdc_available_bytes(itf));
+    // and everything comes through in order once it reads
+    for (uint8_t itf = 0; itf < CFG_TUD_CDC; itf++)
+    {
+        uint32_t got = 0, errors = 0;
+        for (int loop = 0; loop < 1000 && got < 4096; loop++)
+        {
+            uint32_t n = cdc_read_buf(itf, buf, sizeof(buf));
+            for (uint32_t i = 0; i < n; i++)
+                errors += buf[i] != pattern(got + i, itf);
+            got += n;
+            run(200);
+        }
+        CHECK(got == 4096 && errors == 0, "itf %d received %u, %u corrupted", itf, got, errors);
+    }
+
+    // transmit: a stalled host, the path holds the configured ring, TinyUSB's FIFO and one packet at the host
+    setup();
+    for (uint8_t itf = 0; itf < CFG_TUD_CDC; itf++)
+    {
+        uint32_t queued = 0;
+        mock_tusb_host_set_room(itf, 64);
+        for (int i = 0; i < 400; i++)
+        {
+            for (uint32_t j = 0; j < 64; j++)
+                buf[j] = pattern(queued + j, itf);
+            queued += cdc_write_buf(itf, buf, 64);
+            run(100);
+        }
+        CHECK(queued == sizes[itf].tx_size + CFG_TUD_CDC_TX_BUFSIZE + 64, "itf %d transmit path holds %u", itf, queued);
+
+        uint32_t got = 0, errors = 0, n;
+        mock_tusb_host_set_room(itf, MOCK_TUSB_HOST_BUFFER);
+        run(20000);
+        while ((n = mock_tusb_host_read(itf, buf, sizeof(buf))) > 0)
+        {
+            for (uint32_t i = 0; i < n; i++)
+                errors += buf[i] != pattern(got + i, itf);
+            got += n;
+        }
+        CHECK(got == queued && errors == 0, "itf %d host got %u of %u, %u corrupted", itf, got, queued, errors);
+    }
+
+    // all three streaming both ways at once
+    setup();
+    uint32_t sent[CFG_TUD_CDC] = {0}, host_sent[CFG_TUD_CDC] = {0}, recv[CFG_TUD_CDC] = {0}, host_got[CFG_TUD_CDC] = {0};
+    uint32_t errors = 0;
+    bool done = false;
+    for (int loop = 0; loop < 100000 && !done; loop++)
+    {
+        cdc_task();
+        done = true;
+        for (uint8_t itf = 0; itf < CFG_TUD_CDC; itf++)
+        {
+            uint32_t n = MIN(sizeof(buf), STREAM - sent[itf]);
+            for (uint32_t i = 0; i < n; i++)
+                buf[i] = pattern(sent[itf] + i, itf);
+            sent[itf] += cdc_write_buf(itf, buf, n);
+
+            n = MIN(sizeof(buf), STREAM - host_sent[itf]);
+            for (uint32_t i = 0; i < n; i++)
+                buf[i] = pattern(host_sent[itf] + i, itf);
+            host_sent[itf] += mock_tusb_host_write(itf, buf, n);
+
+            n = cdc_read_buf(itf, buf, 100);
+            for (uint32_t i = 0; i < n; i++)
+                errors += buf[i] != pattern(recv[itf] + i, itf);
+            recv[itf] += n;
+
+            n = mock_tusb_host_read(itf, buf, sizeof(buf));
+            for (uint32_t i = 0; i < n; i++)
+                errors += buf[i] != pattern(host_got[itf] + i, itf);
+            host_got[itf] += n;
+
+            done &= recv[itf] == STREAM && host_got[itf] == STREAM;
+        }
+        sleep_us(20);
+    }
+    for (uint8_t itf = 0; itf < CFG_TUD_CDC; itf++)
+        CHECK(recv[itf] == STREAM && host_got[itf] == STREAM, "itf %d device got %u, host got %u", itf, recv[itf], host_got[itf]);
+    CHECK(errors == 0, "%u corrupted bytes", errors);
+
+    return test_report();
+}
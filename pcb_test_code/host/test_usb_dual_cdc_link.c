@@ -0,0 +1,238 @@
+// Runs usb_dual_cdc over the simulated USB link: data integrity in both directions on both interfaces,
+// link speed, a closed interface and the four overflow policies, cdc_flush() against a stalled host and the
+// non-waiting stdio flush
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "usb_dual_cdc.h"
+#include "mock_tusb.h"
+#include "mock_time.h"
+#include "test_check.h"
+
+#define STREAM 20000
+
+static uint8_t pattern(uint32_t pos, uint8_t itf) { return (uint8_t)(pos * 7 + itf * 101 + (pos >> 8)); }
+
+// the host application reading everything, runs whenever the virtual clock moves
+static bool host_reading;
+static uint32_t host_got[CFG_TUD_CDC];
+static uint32_t host_errors;
+static uint8_t host_last[CFG_TUD_CDC][4096];
+static uint32_t host_last_len[CFG_TUD_CDC];
+
+static void host_reader(uint64_t now_us)
+{
+    (void)now_us;
+    if (!host_reading)
+        return;
+
+    for (uint8_t itf = 0; itf < CFG_TUD_CDC; itf++)
+    {
+        uint8_t buf[256];
+        uint32_t n;
+        while ((n = mock_tusb_host_read(itf, buf, sizeof(buf))) > 0)
+        {
+            for (uint32_t i = 0; i < n; i++)
+                host_errors += buf[i] != pattern(host_got[itf] + i, itf);
+            host_got[itf] += n;
+        }
+    }
+}
+
+// takes what the stalled host has queued, for the tests that look at what survived
+static uint32_t host_drain(uint8_t itf)
+{
+    host_last_len[itf] = 0;
+    while (1)
+    {
+        for (int i = 0; i < 100; i++)
+        {
+            cdc_task();
+            sleep_us(100);
+        }
+        uint32_t n = mock_tusb_host_read(itf, &host_last[itf][host_last_len[itf]], sizeof(host_last[itf]) - host_last_len[itf]);
+        if (n == 0)
+            return host_last_len[itf];
+        host_last_len[itf] += n;
+    }
+}
+
+static void setup(void)
+{
+    mock_time_reset();
+    mock_tusb_reset();
+    mock_time_add_hook(host_reader);
+    cdc_init();
+    for (uint8_t itf = 0; itf < CFG_TUD_CDC; itf++)
+    {
+        mock_tusb_connect(itf, true);
+        host_got[itf] = 0;
+    }
+    host_errors = 0;
+    host_reading = true;
+}
+
+// fills the whole transmit path of a stalled host, returns the bytes queued
+static uint32_t fill(uint8_t itf)
+{
+    uint8_t buf[64];
+    uint32_t queued = 0;
+
+    mock_tusb_host_set_room(itf, 64);
+    host_reading = false;
+    cdc_set_overflow_policy(itf, CDC_OVERFLOW_PARTIAL, 0);
+    for (int i = 0; i < 200; i++)
+    {
+        for (uint32_t j = 0; j < sizeof(buf); j++)
+            buf[j] = pattern(queued + j, itf);
+        queued += cdc_write_buf(itf, buf, sizeof(buf));
+        cdc_task();
+        sleep_us(100);
+    }
+    return queued;
+}
+
+int main() {
+    uint8_t buf[512];
+    cdc_stats_t stats;
+
+    // both interfaces, both directions at once
+    setup();
+    uint32_t sent[CFG_TUD_CDC] = {0}, host_sent[CFG_TUD_CDC] = {0}, recv[CFG_TUD_CDC] = {0};
+    uint32_t recv_errors = 0;
+    for (uint8_t itf = 0; itf < CFG_TUD_CDC; itf++)
+        cdc_set_overflow_policy(itf, CDC_OVERFLOW_PARTIAL, 0);
+    uint64_t start = time_us_64();
+    for (int loop = 0; loop < 100000 && (host_got[0] < STREAM || host_got[1] < STREAM || recv[0] < STREAM || recv[1] < STREAM); loop++)
+    {
+        cdc_task();
+        for (uint8_t itf = 0; itf < CFG_TUD_CDC; itf++)
+        {
+            uint32_t n = MIN(sizeof(buf), STREAM - sent[itf]);
+            for (uint32_t i = 0; i < n; i++)
+                buf[i] = pattern(sent[itf] + i, itf);
+            sent[itf] += cdc_write_buf(itf, buf, n);
+
+            n = MIN(sizeof(buf), STREAM - host_sent[itf]);
+            for (uint32_t i = 0; i < n; i++)
+                buf[i] = pattern(host_sent[itf] + i, itf);
+            host_sent[itf] += mock_tusb_host_write(itf, buf, n);
+
+            n = cdc_read_buf(itf, buf, 100);
+            for (uint32_t i = 0; i < n; i++)
+                recv_errors += buf[i] != pattern(recv[itf] + i, itf);
+            recv[itf] += n;
+        }
+        sleep_us(20);
+    }
+    uint64_t elapsed = time_us_64() - start;
+    for (uint8_t itf = 0; itf < CFG_TUD_CDC; itf++)
+    {
+        CHECK(host_got[itf] == STREAM, "itf %d host got %u", itf, host_got[itf]);
+        CHECK(recv[itf] == STREAM, "itf %d device got %u", itf, recv[itf]);
+    }
+    CHECK(host_errors == 0 && recv_errors == 0, "%u / %u corrupted bytes", host_errors, recv_errors);
+    // four streams share one bus, the last packet of each is short
+    uint64_t bus_us = 4ull * STREAM / 64 * mock_tusb_packet_time_ns(64) / 1000;
+    CHECK(elapsed >= bus_us * 99 / 100 && elapsed < bus_us * 3 / 2, "%llu us for %llu us of bus time",
+          (unsigned long long)elapsed, (unsigned long long)bus_us);
+    cdc_get_stats(0, &stats);
+    CHECK(stats.written == STREAM, "written %u", stats.written); // the rest of every call counts as dropped with PARTIAL
+
+    // a closed interface takes nothing
+    setup();
+    mock_tusb_connect(1, false);
+    cdc_task();
+    CHECK(cdc_write_buf(1, buf, 10) == 0, "closed interface accepted data");
+    cdc_get_stats(1, &stats);
+    CHECK(stats.dropped == 10, "dropped %u", stats.dropped);
+
+    // DROP keeps writes whole: all or nothing
+    setup();
+    uint32_t queued = fill(0);
+    CHECK(queued == 1024 + CFG_TUD_CDC_TX_BUFSIZE + 64, "transmit path holds %u", queued);
+    cdc_set_overflow_policy(0, CDC_OVERFLOW_DROP, 0);
+    cdc_reset_stats(0);
+    CHECK(cdc_write_buf(0, buf, 100) == 0, "DROP queued part of a write");
+    cdc_get_stats(0, &stats);
+    CHECK(stats.dropped == 100 && stats.written == 0, "DROP dropped %u", stats.dropped);
+
+    // PARTIAL queues what fits
+    setup();
+    fill(0);
+    mock_tusb_host_read(0, buf, 64); // the host takes one packet
+    for (int i = 0; i < 10; i++)
+    {
+        cdc_task();
+        sleep_us(100);
+    }
+    cdc_reset_stats(0);
+    CHECK(cdc_write_buf(0, buf, 100) == 64, "PARTIAL should queue one packet's worth");
+    cdc_get_stats(0, &stats);
+    CHECK(stats.written == 64 && stats.dropped == 36, "PARTIAL written %u dropped %u", stats.written, stats.dropped);
+
+    // DROP_OLDEST discards queued bytes and keeps the newest
+    setup();
+    queued = fill(0);
+    cdc_set_overflow_policy(0, CDC_OVERFLOW_DROP_OLDEST, 0);
+    cdc_reset_stats(0);
+    for (uint32_t i = 0; i < 300; i++)
+        buf[i] = pattern(queued + i, 0);
+    CHECK(cdc_write_buf(0, buf, 300) == 300, "DROP_OLDEST refused a write");
+    cdc_get_stats(0, &stats);
+    CHECK(stats.written == 300 && stats.dropped == 300, "DROP_OLDEST written %u dropped %u", stats.written, stats.dropped);
+    uint32_t drained = host_drain(0);
+    CHECK(drained == queued, "host got %u of %u", drained, queued);
+    CHECK(memcmp(&host_last[0][drained - 300], buf, 300) == 0, "newest bytes lost");
+
+    // BLOCK waits for the timeout while the host is stalled
+    setup();
+    fill(0);
+    cdc_set_overflow_policy(0, CDC_OVERFLOW_BLOCK, 5000);
+    cdc_reset_stats(0);
+    start = time_us_64();
+    CHECK(cdc_write_buf(0, buf, 100) == 0, "BLOCK queued into a full path");
+    elapsed = time_us_64() - start;
+    cdc_get_stats(0, &stats);
+    CHECK(elapsed >= 5000 && elapsed < 5100, "BLOCK waited %llu us", (unsigned long long)elapsed);
+    CHECK(stats.blocked_us == elapsed && stats.dropped == 100, "blocked %u us dropped %u", stats.blocked_us, stats.dropped);
+
+    // and loses nothing while the host reads
+    setup();
+    cdc_set_overflow_policy(0, CDC_OVERFLOW_BLOCK, 100000);
+    for (uint32_t sent0 = 0; sent0 < STREAM; )
+    {
+        for (uint32_t i = 0; i < sizeof(buf); i++)
+            buf[i] = pattern(sent0 + i, 0);
+        uint32_t n = cdc_write_buf(0, buf, sizeof(buf));
+        CHECK(n == sizeof(buf), "BLOCK queued %u", n);
+        sent0 += sizeof(buf);
+    }
+    CHECK(cdc_flush(0, 100000), "flush timed out");
+    sleep_us(100); // the last packet on the bus
+    CHECK(host_got[0] >= STREAM && host_errors == 0, "host got %u, %u corrupted", host_got[0], host_errors);
+
+    // cdc_flush gives up on a stalled host
+    setup();
+    fill(0);
+    start = time_us_64();
+    CHECK(!cdc_flush(0, 2000), "flush into a stalled host");
+    CHECK(time_us_64() - start >= 2000, "flush returned early");
+    start = time_us_64();
+    cdc_write_flush(0); // the stdio flush, after every printf
+    CHECK(time_us_64() == start, "cdc_write_flush waited");
+    host_reading = true;
+    mock_tusb_host_set_room(0, MOCK_TUSB_HOST_BUFFER);
+    CHECK(cdc_flush(0, 100000), "flush after the host woke up");
+
+    // the stdio flush moves the ring to TinyUSB, the bytes reach the host without another cdc_task()
+    setup();
+    for (uint32_t i = 0; i < 100; i++)
+        buf[i] = pattern(i, 0);
+    CHECK(cdc_write_buf(0, buf, 100) == 100, "queued for the stdio flush");
+    cdc_write_flush(0);
+    sleep_us(1000);
+    CHECK(host_got[0] == 100 && host_errors == 0, "host got %u after cdc_write_flush", host_got[0]);
+
+    return test_report();
+}
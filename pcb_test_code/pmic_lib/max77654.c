@@ -1,15 +1,20 @@
 #include "pico/stdlib.h"
 #include "hardware/i2c.h"
+#include "hardware/sync.h"
 #include "max77654.h"
 #include "max77654_types.h"
-#include <stdio.h>
+#include "max77654_shadow.h"
+#include "max77654_log.h"
+#include "max77654_trace.h"
+#include "max77654_boot.h"
+#include <string.h>
 
-#define __FILENAME__ (__builtin_strrchr(__FILE__, '/') ? __builtin_strrchr(__FILE__, '/') + 1 : __FILE__)
-#define PRINT(fmt,...) {printf("[%s:%d <%s>]",__FILENAME__,__LINE__, __FUNCTION__); printf(fmt, ##__VA_ARGS__);printf("\n");}
 
 
-#define MAX77654_SLAVE_ADDR 0x48
 #define REG_ADDR_ERCFLAG 0x05
+#define REG_ADDR_CID 0x11
+#define REG_ADDR_CNFG_CHG_A 0x20 //0x20..0x28, CNFG_CHG_A..CNFG_CHG_I
+#define REG_ADDR_CNFG_CHG_I 0x28
 #define REG_ADDR_CNFG_SSBx_A 0x29 //0x29,0x2A for SSB0, 
 #define REG_ADDR_CNFG_SSBx_B 0x2A //0x2B,0x2C for SSB1, 
                                   //0x2D,0x2E for SSB2
@@ -20,9 +25,34 @@
 #define OFF_IRRESPECTIVE_OF_FPS 0x04
 #define ON_IRRESPECTIVE_OF_FPS 0x07
 
+// The shadowed registers live in 0x20..0x3B, one bit per register in the dirty/valid masks
+#define REG_ADDR_SHADOW_FIRST REG_ADDR_CNFG_CHG_A
+#define REG_ADDR_SHADOW_LAST (REG_ADDR_CNFG_LDOx_B + 2)
+#define SHADOW_BIT(reg) (1u << ((reg) - REG_ADDR_SHADOW_FIRST))
 
-static i2c_inst_t *I2C_CH_MAX77654;
-static reg_map_max77654_t reg_map_max77654;
+_Static_assert(REG_ADDR_SHADOW_LAST - REG_ADDR_SHADOW_FIRST + 1 == MAX77654_SHADOW_REGS, "MAX77654_SHADOW_REGS");
+
+#define MAX_BURST_LEN MAX77654_MAX_BURST_LEN
+
+// a transfer of len bytes gives up after this, 90 us per byte at 100 kHz plus room for clock stretching
+#define I2C_TIMEOUT_US(len) (2000 + 100 * (len))
+
+
+#define DEFAULT_SDA_PIN 26
+#define DEFAULT_SCL_PIN 27
+
+static max77654_t default_dev; // max77654_init()
+static max77654_t *cur = &default_dev; // the selected device
+
+// Contiguous shadowed register blocks, each one can be written in a single burst
+static const struct {
+    uint8_t first;
+    uint8_t count;
+} shadow_blocks[] = {
+    {REG_ADDR_CNFG_CHG_A, 9},  // charger, CNFG_CHG_I also selects the AMUX channel
+    {REG_ADDR_CNFG_SSBx_A, 6}, // SSB0..SSB2, A and B
+    {REG_ADDR_CNFG_LDOx_A, 4}, // LDO0..LDO1, A and B
+};
 
 
 typedef enum {
@@ -56,36 +86,547 @@ uint8_t calculate_ldo_voltage_reg(int16_t voltage_in_mV)
     return reg;
 }
 
-void default_configure_max77654(void)
+// Rails at power up, folded into register values by the compiler
+static const max77654_profile_t default_profile = MAX77654_PROFILE(
+    MAX77654_SBB(3100, true, MAX77654_SBB_IPK_330MA, MAX77654_SBB_MODE_BUCK_BOOST, false), // SSB0
+    MAX77654_SBB(3200, true, MAX77654_SBB_IPK_330MA, MAX77654_SBB_MODE_BUCK_BOOST, false), // SSB1
+    MAX77654_SBB(3300, true, MAX77654_SBB_IPK_330MA, MAX77654_SBB_MODE_BUCK_BOOST, false), // SSB2
+    MAX77654_LDO(1200, true, LDO_MODE_LDO, false),                                        // LDO0
+    MAX77654_LDO(900, true, LDO_MODE_LDO, false));                                        // LDO1
+
+
+// Charger registers CNFG_CHG_A..CNFG_CHG_I, see shadow_reg_value
+static uint8_t charger_reg_value(const max77654_t *dev, uint8_t reg)
+{
+    const reg_map_max77654_t *m = &dev->reg_map;
+
+    switch (reg - REG_ADDR_CNFG_CHG_A)
+    {
+    case 0: return m->chg_a.thm_cold | (m->chg_a.thm_cool << 2) | (m->chg_a.thm_warm << 4) | (m->chg_a.thm_hot << 6);
+    case 1: return m->chg_b.chg_en | (m->chg_b.i_pq << 1) | (m->chg_b.ichgin_lim << 2) | (m->chg_b.vchgin_min << 5);
+    case 2: return m->chg_c.t_topoff | (m->chg_c.i_term << 3) | (m->chg_c.chg_pq << 5);
+    case 3: return m->chg_d.vsys_reg | (m->chg_d.tj_reg << 5);
+    case 4: return m->chg_e.t_fast_chg | (m->chg_e.chg_cc << 2);
+    case 5: return m->chg_f.reserved | (m->chg_f.thm_en << 1) | (m->chg_f.chg_cc_jeita << 2);
+    case 6: return m->chg_g.reserved | (m->chg_g.usbs << 1) | (m->chg_g.chg_cv << 2);
+    case 7: return m->chg_h.reserved | (m->chg_h.chg_cv_jeita << 2);
+    default: return m->chg_i.mux_sel | (m->chg_i.imon_dischg_scale << 4);
+    }
+}
+
+static void charger_load_reg(max77654_t *dev, uint8_t reg, uint8_t v)
+{
+    reg_map_max77654_t *m = &dev->reg_map;
+
+    switch (reg - REG_ADDR_CNFG_CHG_A)
+    {
+    case 0:
+        m->chg_a.thm_cold = v & 0x03;
+        m->chg_a.thm_cool = (v >> 2) & 0x03;
+        m->chg_a.thm_warm = (v >> 4) & 0x03;
+        m->chg_a.thm_hot = v >> 6;
+        break;
+    case 1:
+        m->chg_b.chg_en = v & 0x01;
+        m->chg_b.i_pq = (v >> 1) & 0x01;
+        m->chg_b.ichgin_lim = (v >> 2) & 0x07;
+        m->chg_b.vchgin_min = v >> 5;
+        break;
+    case 2:
+        m->chg_c.t_topoff = v & 0x07;
+        m->chg_c.i_term = (v >> 3) & 0x03;
+        m->chg_c.chg_pq = v >> 5;
+        break;
+    case 3:
+        m->chg_d.vsys_reg = v & 0x1F;
+        m->chg_d.tj_reg = v >> 5;
+        break;
+    case 4:
+        m->chg_e.t_fast_chg = v & 0x03;
+        m->chg_e.chg_cc = v >> 2;
+        break;
+    case 5:
+        m->chg_f.reserved = v & 0x01;
+        m->chg_f.thm_en = (v >> 1) & 0x01;
+        m->chg_f.chg_cc_jeita = v >> 2;
+        break;
+    case 6:
+        m->chg_g.reserved = v & 0x01;
+        m->chg_g.usbs = (v >> 1) & 0x01;
+        m->chg_g.chg_cv = v >> 2;
+        break;
+    case 7:
+        m->chg_h.reserved = v & 0x03;
+        m->chg_h.chg_cv_jeita = v >> 2;
+        break;
+    default:
+        m->chg_i.mux_sel = v & 0x0F;
+        m->chg_i.imon_dischg_scale = v >> 4;
+        break;
+    }
+}
+
+// Encode the shadow copy of a register into the byte the chip expects
+static uint8_t shadow_reg_value(const max77654_t *dev, uint8_t reg)
+{
+    if (reg <= REG_ADDR_CNFG_CHG_I)
+    {
+        return charger_reg_value(dev, reg);
+    }
+    else if (reg >= REG_ADDR_CNFG_LDOx_A)
+    {
+        int ch = (reg - REG_ADDR_CNFG_LDOx_A) / 2;
+        if ((reg - REG_ADDR_CNFG_LDOx_A) % 2 == 0)
+            return dev->reg_map.ldos[ch].reg_a.target_voltage;
+
+        const reg_cnfg_ldox_b_t *b = &dev->reg_map.ldos[ch].reg_b;
+        return b->enable_control | (b->active_discharge << 3) | (b->operation_mode << 4);
+    }
+    else
+    {
+        int ch = (reg - REG_ADDR_CNFG_SSBx_A) / 2;
+        if ((reg - REG_ADDR_CNFG_SSBx_A) % 2 == 0)
+            return dev->reg_map.ssbs[ch].reg_a.target_voltage;
+
+        const reg_cnfg_ssbx_b_t *b = &dev->reg_map.ssbs[ch].reg_b;
+        return b->enable_control | (b->active_discharge << 3) | (b->peak_current_limit << 4) | (b->operation_mode << 6);
+    }
+}
+
+// Decode a register value read from (or written to) the chip into the shadow copy
+static void shadow_load_reg(max77654_t *dev, uint8_t reg, uint8_t value)
+{
+    if (reg <= REG_ADDR_CNFG_CHG_I)
+    {
+        charger_load_reg(dev, reg, value);
+    }
+    else if (reg >= REG_ADDR_CNFG_LDOx_A)
+    {
+        int ch = (reg - REG_ADDR_CNFG_LDOx_A) / 2;
+        if ((reg - REG_ADDR_CNFG_LDOx_A) % 2 == 0)
+        {
+            dev->reg_map.ldos[ch].reg_a.target_voltage = value & 0x7F;
+            return;
+        }
+
+        reg_cnfg_ldox_b_t *b = &dev->reg_map.ldos[ch].reg_b;
+        b->enable_control = value & 0x07;
+        b->active_discharge = (value >> 3) & 0x01;
+        b->operation_mode = (value >> 4) & 0x01;
+    }
+    else
+    {
+        int ch = (reg - REG_ADDR_CNFG_SSBx_A) / 2;
+        if ((reg - REG_ADDR_CNFG_SSBx_A) % 2 == 0)
+        {
+            dev->reg_map.ssbs[ch].reg_a.target_voltage = value & 0x7F;
+            return;
+        }
+
+        reg_cnfg_ssbx_b_t *b = &dev->reg_map.ssbs[ch].reg_b;
+        b->enable_control = value & 0x07;
+        b->active_discharge = (value >> 3) & 0x01;
+        b->peak_current_limit = (value >> 4) & 0x03;
+        b->operation_mode = (value >> 6) & 0x01;
+    }
+}
+
+// The dirty/valid masks are also changed from interrupt context (max77654_dvs.c takes its steps over),
+// every read-modify-write of them runs with interrupts off
+static void shadow_set_dirty(max77654_t *dev, uint32_t regs)
+{
+    uint32_t irq = save_and_disable_interrupts();
+    dev->shadow_dirty |= regs;
+    restore_interrupts(irq);
+}
+
+// The chip holds data at reg..reg+len-1 now
+static void shadow_on_chip(max77654_t *dev, uint8_t reg, const uint8_t *data, size_t len)
+{
+    uint32_t irq = save_and_disable_interrupts();
+    for (size_t i = 0; i < len; i++)
+    {
+        dev->chip_regs[reg + i - REG_ADDR_SHADOW_FIRST] = data[i];
+        dev->shadow_dirty &= ~SHADOW_BIT(reg + i);
+        dev->shadow_valid |= SHADOW_BIT(reg + i);
+    }
+    restore_interrupts(irq);
+}
+
+// Write out the dirty shadow registers unless a transaction is still open
+static int shadow_mark_dirty(uint8_t reg)
+{
+    shadow_set_dirty(cur, SHADOW_BIT(reg));
+
+    if (cur->transaction_depth > 0)
+        return 0;
+
+    return max77654_commit();
+}
+
+
+static bool is_shadowed(uint8_t reg)
+{
+    for (unsigned int i = 0; i < sizeof(shadow_blocks) / sizeof(shadow_blocks[0]); i++)
+        if (reg >= shadow_blocks[i].first && reg < shadow_blocks[i].first + shadow_blocks[i].count)
+            return true;
+    return false;
+}
+
+// A queued write reaches the chip after everything queued before it and before everything queued after it.
+// DVS bursts queued behind it take the chip values of the registers they do not step (chip_regs), so those
+// have to be the written ones from submission on; a failed write leaves the registers unknown.
+static void shadow_write_queued(max77654_t *dev, uint8_t reg, const uint8_t *data, size_t len)
+{
+    uint32_t irq = save_and_disable_interrupts();
+    for (size_t i = 0; i < len; i++)
+        if (is_shadowed(reg + i))
+            dev->chip_regs[reg + i - REG_ADDR_SHADOW_FIRST] = data[i];
+    restore_interrupts(irq);
+}
+
+static void shadow_write_failed(max77654_t *dev, uint8_t reg, size_t len)
+{
+    uint32_t irq = save_and_disable_interrupts();
+    for (size_t i = 0; i < len; i++)
+        if (is_shadowed(reg + i))
+            dev->shadow_valid &= ~SHADOW_BIT(reg + i);
+    restore_interrupts(irq);
+}
+
+// Once the interrupt driven queue runs on the bus (max77654_async_init()), a blocking SDK transfer
+// would take the controller from under it: queue the transfer behind the others and wait for it.
+// The queue traces it as an async operation.
+static int queued_transfer(bool read, uint8_t reg, uint8_t *data, size_t len)
+{
+    max77654_async_req_t req;
+
+    for (size_t done = 0; done < len; done += req.len)
+    {
+        uint8_t chunk = len - done > MAX77654_ASYNC_MAX_LEN ? MAX77654_ASYNC_MAX_LEN : len - done;
+        int ret = read ? max77654_async_read_dev(cur, &req, reg + done, data + done, chunk, NULL, NULL)
+                       : max77654_async_write_dev(cur, &req, reg + done, data + done, chunk, NULL, NULL);
+        if (ret < 0 || max77654_async_wait(&req) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+int max77654_write_regs(uint8_t reg, const uint8_t *data, size_t len)
+{
+    uint8_t cmd[1 + MAX_BURST_LEN];
+    int ret;
+
+    if (len > MAX_BURST_LEN)
+        return -1;
+
+    cmd[0] = reg;
+    memcpy(&cmd[1], data, len);
+    if (max77654_async_enabled(cur->i2c))
+    {
+        shadow_write_queued(cur, reg, data, len);
+        ret = queued_transfer(false, reg, &cmd[1], len);
+        if (ret < 0)
+            shadow_write_failed(cur, reg, len);
+    }
+    else
+    {
+        uint32_t start = time_us_32();
+        ret = i2c_write_timeout_us(cur->i2c, cur->addr, cmd, len + 1, false, I2C_TIMEOUT_US(len + 1));
+        max77654_trace_record(MAX77654_OP_WRITE, reg, time_us_32() - start, ret);
+    }
+    if (ret < 0)
+        return -1;
+
+    // the chip holds these now, a later burst over them must not write the old shadow values back
+    max77654_shadow_put(reg, data, len);
+    max77654_boot_mark(MAX77654_BOOT_REG_WRITE, reg);
+    return 0;
+}
+
+int max77654_read_regs(uint8_t reg, uint8_t *data, size_t len)
+{
+    int ret;
+
+    if (max77654_async_enabled(cur->i2c))
+        return queued_transfer(true, reg, data, len);
+
+    // register address, repeated start, then auto-increment read
+    uint32_t start = time_us_32();
+    ret = i2c_write_timeout_us(cur->i2c, cur->addr, &reg, 1, true, I2C_TIMEOUT_US(1));
+    if (ret >= 0)
+        ret = i2c_read_timeout_us(cur->i2c, cur->addr, data, len, false, I2C_TIMEOUT_US(len));
+    max77654_trace_record(MAX77654_OP_READ, reg, time_us_32() - start, ret);
+
+    return ret < 0 ? -1 : 0;
+}
+
+
+void max77654_begin(void)
+{
+    cur->transaction_depth++;
+}
+
+// Splits the dirty registers of dev into bursts, one block at a time. A burst extends over dirty registers,
+// and over clean ones that are known to match the chip as long as another dirty register follows.
+// Returns the number of bursts, first[i]..last[i] each.
+static int plan_bursts(const max77654_t *dev, uint8_t *first, uint8_t *last)
+{
+    int count = 0;
+
+    for (unsigned int i = 0; i < sizeof(shadow_blocks) / sizeof(shadow_blocks[0]); i++)
+    {
+        uint8_t reg = shadow_blocks[i].first;
+        uint8_t block_last = shadow_blocks[i].first + shadow_blocks[i].count - 1;
+
+        while (reg <= block_last)
+        {
+            // skip to the next dirty register
+            if (!(dev->shadow_dirty & SHADOW_BIT(reg)))
+            {
+                reg++;
+                continue;
+            }
+
+            uint8_t end = reg;
+            for (uint8_t r = reg + 1; r <= block_last; r++)
+            {
+                if (dev->shadow_dirty & SHADOW_BIT(r))
+                    end = r;
+                else if (!(dev->shadow_valid & SHADOW_BIT(r)) || (dev->shadow_owned & SHADOW_BIT(r)))
+                    break;
+            }
+
+            first[count] = reg;
+            last[count] = end;
+            count++;
+            reg = end + 1;
+        }
+    }
+    return count;
+}
+
+int max77654_commit(void)
+{
+    uint8_t burst[MAX_BURST_LEN];
+    uint8_t first[MAX77654_FLEET_BURSTS], last[MAX77654_FLEET_BURSTS];
+    int ret = 0;
+
+    if (cur->transaction_depth > 0)
+        cur->transaction_depth--;
+    if (cur->transaction_depth > 0)
+        return 0; // the outermost commit writes everything
+
+    int count = plan_bursts(cur, first, last);
+    for (int i = 0; i < count; i++)
+    {
+        for (uint8_t r = first[i]; r <= last[i]; r++)
+            burst[r - first[i]] = shadow_reg_value(cur, r);
+
+        if (max77654_write_regs(first[i], burst, last[i] - first[i] + 1) < 0)
+            ret = -1;
+        else
+            shadow_on_chip(cur, first[i], burst, last[i] - first[i] + 1);
+        MAX77654_LOG("burst 0x%02x..0x%02x", first[i], last[i]);
+    }
+
+    return ret;
+}
+
+void max77654_discard(void)
+{
+    if (cur->transaction_depth > 0)
+        cur->transaction_depth--;
+
+    // registers whose chip value is not known keep the dropped value, but neither dirty nor valid:
+    // commits do not write them and max77654_shadow_fetch() reads them again
+    uint32_t irq = save_and_disable_interrupts();
+    for (uint8_t r = REG_ADDR_SHADOW_FIRST; r <= REG_ADDR_SHADOW_LAST; r++)
+        if ((cur->shadow_dirty & cur->shadow_valid) & SHADOW_BIT(r))
+            shadow_load_reg(cur, r, cur->chip_regs[r - REG_ADDR_SHADOW_FIRST]);
+    cur->shadow_dirty = 0;
+    restore_interrupts(irq);
+}
+
+
+int max77654_fleet_commit(max77654_t *const *devs, int count)
+{
+    uint8_t first[MAX77654_FLEET_BURSTS], last[MAX77654_FLEET_BURSTS];
+    int ret = 0;
+
+    // queue everything first, every bus works through its own queue
+    for (int d = 0; d < count; d++)
+    {
+        max77654_t *dev = devs[d];
+
+        dev->transaction_depth = 0;
+        dev->fleet_count = plan_bursts(dev, first, last);
+        for (int i = 0; i < dev->fleet_count; i++)
+        {
+            uint8_t *image = &dev->fleet_image[first[i] - REG_ADDR_SHADOW_FIRST];
+            for (uint8_t r = first[i]; r <= last[i]; r++)
+                image[r - first[i]] = shadow_reg_value(dev, r);
+
+            shadow_write_queued(dev, first[i], image, last[i] - first[i] + 1);
+            if (max77654_async_write_dev(dev, &dev->fleet_reqs[i], first[i], image, last[i] - first[i] + 1, NULL, NULL) < 0)
+                dev->fleet_reqs[i].status = -1;
+        }
+    }
+
+    for (int d = 0; d < count; d++)
+    {
+        max77654_t *dev = devs[d];
+
+        for (int i = 0; i < dev->fleet_count; i++)
+        {
+            max77654_async_req_t *req = &dev->fleet_reqs[i];
+            if (max77654_async_wait(req) < 0)
+            {
+                shadow_write_failed(dev, req->reg, req->len);
+                ret = -1;
+            }
+            else
+            {
+                shadow_on_chip(dev, req->reg, req->data, req->len);
+            }
+        }
+        dev->fleet_count = 0;
+    }
+
+    return ret;
+}
+
+int max77654_fleet_apply_profile(max77654_t *const *devs, int count, const max77654_profile_t *profile)
 {
-    reg_map_max77654.ssbs[0].reg_a.target_voltage = calculate_ssb_voltage_reg(3100);
-    reg_map_max77654.ssbs[0].reg_b.enable_control = ON_IRRESPECTIVE_OF_FPS; // 0x00 = ON
-    reg_map_max77654.ssbs[0].reg_b.active_discharge = 0x00; // 0x00 = Disable
-    reg_map_max77654.ssbs[0].reg_b.peak_current_limit = 0x03; // 330mA
-    reg_map_max77654.ssbs[0].reg_b.operation_mode = 0x00; // 0x00 = Buck-boost
+    for (int d = 0; d < count; d++)
+    {
+        for (unsigned int i = 0; i < sizeof(profile->sbb); i++)
+        {
+            shadow_load_reg(devs[d], REG_ADDR_CNFG_SSBx_A + i, profile->sbb[i]);
+            shadow_set_dirty(devs[d], SHADOW_BIT(REG_ADDR_CNFG_SSBx_A + i));
+        }
+        for (unsigned int i = 0; i < sizeof(profile->ldo); i++)
+        {
+            shadow_load_reg(devs[d], REG_ADDR_CNFG_LDOx_A + i, profile->ldo[i]);
+            shadow_set_dirty(devs[d], SHADOW_BIT(REG_ADDR_CNFG_LDOx_A + i));
+        }
+    }
 
-    reg_map_max77654.ssbs[1].reg_a.target_voltage = calculate_ssb_voltage_reg(3200);
-    reg_map_max77654.ssbs[1].reg_b.enable_control = ON_IRRESPECTIVE_OF_FPS; // 0x00 = ON
-    reg_map_max77654.ssbs[1].reg_b.active_discharge = 0x00; // 0x00 = Disable
-    reg_map_max77654.ssbs[1].reg_b.peak_current_limit = 0x03; // 330mA
-    reg_map_max77654.ssbs[1].reg_b.operation_mode = 0x00; // 0x00 = Buck-boost
+    return max77654_fleet_commit(devs, count);
+}
+
+
+void max77654_shadow_get_dev(max77654_t *dev, uint8_t reg, uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+        data[i] = is_shadowed(reg + i) ? shadow_reg_value(dev, reg + i) : 0;
+}
 
-    reg_map_max77654.ssbs[2].reg_a.target_voltage = calculate_ssb_voltage_reg(3300);
-    reg_map_max77654.ssbs[2].reg_b.enable_control = ON_IRRESPECTIVE_OF_FPS; // 0x00 = ON
-    reg_map_max77654.ssbs[2].reg_b.active_discharge = 0x00; // 0x00 = Disable
-    reg_map_max77654.ssbs[2].reg_b.peak_current_limit = 0x03; // 330mA
-    reg_map_max77654.ssbs[2].reg_b.operation_mode = 0x00; // 0x00 = Buck-boost
-   
+// registers with changes still waiting for a commit hold something else on the chip
+void max77654_shadow_get_committed_dev(max77654_t *dev, uint8_t reg, uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        uint8_t r = reg + i;
+        if (!is_shadowed(r))
+            data[i] = 0;
+        else if (dev->shadow_valid & SHADOW_BIT(r))
+            data[i] = dev->chip_regs[r - REG_ADDR_SHADOW_FIRST];
+        else
+            data[i] = shadow_reg_value(dev, r);
+    }
+}
 
-    reg_map_max77654.ldos[0].reg_a.target_voltage = calculate_ldo_voltage_reg(1100); // set to 1100mV
-    reg_map_max77654.ldos[0].reg_b.enable_control = ON_IRRESPECTIVE_OF_FPS; // 0x00 = ON
-    reg_map_max77654.ldos[0].reg_b.active_discharge = 0x00; // 0x00 = Disable
-    reg_map_max77654.ldos[0].reg_b.operation_mode = 0x00; // 0x00 = LDO
+void max77654_shadow_put_dev(max77654_t *dev, uint8_t reg, const uint8_t *data, size_t len)
+{
+    uint32_t irq = save_and_disable_interrupts();
+    for (size_t i = 0; i < len; i++)
+    {
+        uint8_t r = reg + i;
+        if (!is_shadowed(r))
+            continue;
 
-    reg_map_max77654.ldos[1].reg_a.target_voltage = calculate_ldo_voltage_reg(900); // set to 900mV
-    reg_map_max77654.ldos[1].reg_b.enable_control = ON_IRRESPECTIVE_OF_FPS; // 0x00 = ON
-    reg_map_max77654.ldos[1].reg_b.active_discharge = 0x00; // 0x00 = Disable
-    reg_map_max77654.ldos[1].reg_b.operation_mode = 0x00; // 0x00 = LDO
+        shadow_load_reg(dev, r, data[i]);
+        shadow_on_chip(dev, r, &data[i], 1);
+    }
+    restore_interrupts(irq);
+}
+
+void max77654_shadow_own_dev(max77654_t *dev, uint8_t reg, bool own)
+{
+    uint32_t irq = save_and_disable_interrupts();
+    if (own)
+        dev->shadow_owned |= SHADOW_BIT(reg);
+    else
+        dev->shadow_owned &= ~SHADOW_BIT(reg);
+    restore_interrupts(irq);
+}
+
+void max77654_shadow_get(uint8_t reg, uint8_t *data, size_t len)
+{
+    max77654_shadow_get_dev(cur, reg, data, len);
+}
+
+void max77654_shadow_put(uint8_t reg, const uint8_t *data, size_t len)
+{
+    max77654_shadow_put_dev(cur, reg, data, len);
+}
+
+
+int max77654_shadow_fetch(uint8_t reg, size_t len)
+{
+    uint8_t data[MAX_BURST_LEN];
+    uint32_t wanted = 0;
+
+    for (size_t i = 0; i < len; i++)
+        if (is_shadowed(reg + i))
+            wanted |= SHADOW_BIT(reg + i);
+
+    if ((cur->shadow_valid & wanted) == wanted)
+        return 0;
+    if (len > MAX_BURST_LEN || max77654_read_regs(reg, data, len) < 0)
+        return -1;
+
+    // registers with pending changes keep them
+    for (size_t i = 0; i < len; i++)
+    {
+        uint8_t r = reg + i;
+        if (is_shadowed(r) && !(cur->shadow_valid & SHADOW_BIT(r)) && !(cur->shadow_dirty & SHADOW_BIT(r)))
+        {
+            shadow_load_reg(cur, r, data[i]);
+            shadow_on_chip(cur, r, &data[i], 1);
+        }
+    }
+    return 0;
+}
+
+reg_map_max77654_t *max77654_shadow_map(void)
+{
+    return &cur->reg_map;
+}
+
+int max77654_shadow_changed(uint8_t reg)
+{
+    return shadow_mark_dirty(reg);
+}
+
+
+int max77654_apply_profile(const max77654_profile_t *profile)
+{
+    uint32_t profile_regs = (SHADOW_BIT(REG_ADDR_CNFG_SSBx_A + sizeof(profile->sbb)) - SHADOW_BIT(REG_ADDR_CNFG_SSBx_A))
+                          | (SHADOW_BIT(REG_ADDR_CNFG_LDOx_A + sizeof(profile->ldo)) - SHADOW_BIT(REG_ADDR_CNFG_LDOx_A));
+
+    // registers are only taken over into the shadow map once they are known to be on the chip
+    uint32_t irq = save_and_disable_interrupts();
+    cur->shadow_valid &= ~profile_regs;
+    restore_interrupts(irq);
+
+    if (max77654_write_regs(REG_ADDR_CNFG_SSBx_A, profile->sbb, sizeof(profile->sbb)) < 0)
+        return -1;
+    if (max77654_write_regs(REG_ADDR_CNFG_LDOx_A, profile->ldo, sizeof(profile->ldo)) < 0)
+        return -1;
+
+    return 0; // max77654_write_regs() took both bursts over into the shadow map
 }
 
 
@@ -93,154 +634,179 @@ int max77654_on_bus(void)
 {
     int ret;
     uint8_t readbuffer[1];
-    ret = i2c_read_blocking(I2C_CH_MAX77654, MAX77654_SLAVE_ADDR, readbuffer, 1, false);
+
+    // the queue has no bare reads, CID answers the same way and has no side effects
+    if (max77654_async_enabled(cur->i2c))
+        return queued_transfer(true, REG_ADDR_CID, readbuffer, 1) < 0 ? PICO_ERROR_GENERIC : 1;
+
+    uint32_t start = time_us_32();
+    ret = i2c_read_timeout_us(cur->i2c, cur->addr, readbuffer, 1, false, I2C_TIMEOUT_US(1));
+    max77654_trace_record(MAX77654_OP_PROBE, MAX77654_TRACE_REGS, time_us_32() - start, ret);
     return ret;
 }
 
 
-int max77654_init(i2c_inst_t *i2c) 
+void max77654_config(max77654_t *dev, i2c_inst_t *i2c, uint sda_pin, uint scl_pin, uint8_t addr)
+{
+    memset(dev, 0, sizeof(*dev));
+    dev->i2c = i2c;
+    dev->sda_pin = sda_pin;
+    dev->scl_pin = scl_pin;
+    dev->addr = addr;
+}
+
+void max77654_select(max77654_t *dev)
+{
+    cur = dev;
+}
+
+max77654_t *max77654_selected(void)
+{
+    return cur;
+}
+
+int max77654_init(i2c_inst_t *i2c)
+{
+    return max77654_init_with_profile(i2c, &default_profile);
+}
+
+int max77654_init_with_profile(i2c_inst_t *i2c, const max77654_profile_t *profile)
+{
+    max77654_config(&default_dev, i2c, DEFAULT_SDA_PIN, DEFAULT_SCL_PIN, MAX77654_I2C_ADDR);
+    return max77654_dev_init(&default_dev, profile);
+}
+
+int max77654_dev_init(max77654_t *dev, const max77654_profile_t *profile)
 {
     int ret;
-    
-    default_configure_max77654(); // does nothing but change the reg_map_max77654 on MCU
 
-    I2C_CH_MAX77654 = i2c;
+    cur = dev;
 
-    i2c_init(i2c, 100 * 1000);
-    gpio_set_function(26, GPIO_FUNC_I2C);
-    gpio_set_function(27, GPIO_FUNC_I2C);
-    gpio_pull_up(26);
-    gpio_pull_up(27);
+    i2c_init(dev->i2c, 100 * 1000);
+    gpio_set_function(dev->sda_pin, GPIO_FUNC_I2C);
+    gpio_set_function(dev->scl_pin, GPIO_FUNC_I2C);
+    gpio_pull_up(dev->sda_pin);
+    gpio_pull_up(dev->scl_pin);
+    max77654_boot_mark(MAX77654_BOOT_I2C_INIT, 0);
 
     ret = max77654_on_bus();
     if (ret < 0) 
     {
+        max77654_boot_mark(MAX77654_BOOT_ERROR, MAX77654_BOOT_ON_BUS);
         return -1;
     }
-    // PRINT("MAX77654 is on the bus\n");
-    
-    uint8_t cmd = REG_ADDR_ERCFLAG;
-    i2c_write_blocking(I2C_CH_MAX77654, MAX77654_SLAVE_ADDR, &cmd, 1, false);
-    
-    ercflag_type erc;
-    ret = i2c_read_blocking(I2C_CH_MAX77654, MAX77654_SLAVE_ADDR, &erc, 1, false);
+    max77654_boot_mark(MAX77654_BOOT_ON_BUS, 0);
+    // MAX77654_LOG("MAX77654 is on the bus");
+
+    uint8_t erc;
+    ret = max77654_read_regs(REG_ADDR_ERCFLAG, &erc, 1);
 
     if (ret < 0) 
     {
+        max77654_boot_mark(MAX77654_BOOT_ERROR, MAX77654_BOOT_ERCFLAG);
         return -1;
     }
     else
     {   
-        // PRINT("ERCFLAG: 0x%02x\n", erc);
+        max77654_boot_mark(MAX77654_BOOT_ERCFLAG, erc);
+        // MAX77654_LOG("ERCFLAG: 0x%02x", erc);
         if (erc & TOVLD || erc & SYSOVLO || erc & SYSUVLO)
         {
              return -1;
         }
     }
 
-    SSBx_set_voltage(0, 3100);
-    SSBx_set_voltage(1, 3200);
-    SSBx_set_voltage(2, 3300);
-    SSBx_enable(0, true);
-    SSBx_enable(1, true);
-    SSBx_enable(2, true);
-
-    LDOx_set_voltage(0, 1200);
-    LDOx_set_voltage(1, 900);
-    LDOx_enable(0, true);
-    LDOx_enable(1, true);
-
-    return 0;
+    // the profile is already a register image, two bursts (SSBs, LDOs) bring every rail up
+    ret = max77654_apply_profile(profile ? profile : &default_profile);
+    if (ret < 0)
+        max77654_boot_mark(MAX77654_BOOT_ERROR, MAX77654_BOOT_RAILS_UP);
+    else
+        max77654_boot_mark(MAX77654_BOOT_RAILS_UP, 0);
+    return ret;
 }
 
 
 
 int SSBx_enable(int ch, bool enable)
 {
-    uint8_t cmd[2];
-
     // first update the reg_map on MCU
-    reg_map_max77654.ssbs[ch].reg_b.enable_control = enable ? ON_IRRESPECTIVE_OF_FPS : OFF_IRRESPECTIVE_OF_FPS;
+    cur->reg_map.ssbs[ch].reg_b.enable_control = enable ? ON_IRRESPECTIVE_OF_FPS : OFF_IRRESPECTIVE_OF_FPS;
 
-    cmd[0] = REG_ADDR_CNFG_SSBx_B + ch * 2;
-    cmd[1] = reg_map_max77654.ssbs[ch].reg_b.enable_control | (reg_map_max77654.ssbs[ch].reg_b.active_discharge<<3) | (reg_map_max77654.ssbs[ch].reg_b.peak_current_limit<<4) | (reg_map_max77654.ssbs[ch].reg_b.operation_mode<<5);
-    i2c_write_blocking(I2C_CH_MAX77654, MAX77654_SLAVE_ADDR, cmd, 2, false);
-
-    PRINT("SSB%d %s", ch, enable ? "enabled" : "disabled\n");
-    PRINT("%02x %02x\n", cmd[0], cmd[1]);
-    return 0;
+    MAX77654_LOG("SSB%d enable %d", ch, enable);
+    return shadow_mark_dirty(REG_ADDR_CNFG_SSBx_B + ch * 2);
 }
 
 int SSBx_set_voltage(int ch, int16_t voltage_in_mV)
 {
-    uint8_t cmd[2];
-
     // first update the reg_map on MCU
-    reg_map_max77654.ssbs[ch].reg_a.target_voltage = calculate_ssb_voltage_reg(voltage_in_mV);
+    cur->reg_map.ssbs[ch].reg_a.target_voltage = calculate_ssb_voltage_reg(voltage_in_mV);
 
-    cmd[0] = REG_ADDR_CNFG_SSBx_A + ch * 2;
-    cmd[1] = reg_map_max77654.ssbs[ch].reg_a.target_voltage;
-    i2c_write_blocking(I2C_CH_MAX77654, MAX77654_SLAVE_ADDR, cmd, 2, false);
-    PRINT("SSB%d voltage set to %d mV", ch, voltage_in_mV);
-    PRINT("%02x %02x\n", cmd[0], cmd[1]);
-    return 0;
+    MAX77654_LOG("SSB%d voltage set to %d mV", ch, voltage_in_mV);
+    return shadow_mark_dirty(REG_ADDR_CNFG_SSBx_A + ch * 2);
 }
 
 int LDOx_set_mode(int ch, int mode)
 {
-    uint8_t cmd[2];
-    
-    reg_map_max77654.ldos[ch].reg_b.operation_mode = mode;
-    
-    cmd[0] = REG_ADDR_CNFG_LDOx_B + ch * 2;
-    cmd[1] = reg_map_max77654.ldos[ch].reg_b.operation_mode|(reg_map_max77654.ldos[ch].reg_b.active_discharge<<3)|(reg_map_max77654.ldos[ch].reg_b.operation_mode<<4);
-    i2c_write_blocking(I2C_CH_MAX77654, MAX77654_SLAVE_ADDR, cmd, 2, false);
-    // PRINT("SSB%d %s", ch, enable ? "enabled" : "disabled\n");
-    // PRINT("%02x %02x\n", cmd[0], cmd[1]);
-    return 0;
+    cur->reg_map.ldos[ch].reg_b.operation_mode = mode;
+
+    return shadow_mark_dirty(REG_ADDR_CNFG_LDOx_B + ch * 2);
 }
 
 int LDOx_enable_active_discharge(int ch, bool enable)
 {
-    uint8_t cmd[2];
+    cur->reg_map.ldos[ch].reg_b.active_discharge = enable ? 0x01 : 0x00;
 
-    reg_map_max77654.ldos[ch].reg_b.active_discharge = enable ? ON_IRRESPECTIVE_OF_FPS : OFF_IRRESPECTIVE_OF_FPS;
-
-    cmd[0] = REG_ADDR_CNFG_LDOx_B + ch * 2;
-    cmd[1] = reg_map_max77654.ldos[ch].reg_b.operation_mode|(reg_map_max77654.ldos[ch].reg_b.active_discharge<<3)|(reg_map_max77654.ldos[ch].reg_b.operation_mode<<4);
-    
-    i2c_write_blocking(I2C_CH_MAX77654, MAX77654_SLAVE_ADDR, cmd, 2, false);
-    // PRINT("SSB%d %s", ch, enable ? "enabled" : "disabled\n");
-    // PRINT("%02x %02x\n", cmd[0], cmd[1]);
-    return 0;
+    return shadow_mark_dirty(REG_ADDR_CNFG_LDOx_B + ch * 2);
 }
 
 int LDOx_enable(int ch, bool enable)
 {
-    uint8_t cmd[2];
+    cur->reg_map.ldos[ch].reg_b.enable_control = enable ? ON_IRRESPECTIVE_OF_FPS : OFF_IRRESPECTIVE_OF_FPS;
 
-    reg_map_max77654.ldos[ch].reg_b.enable_control = enable ? ON_IRRESPECTIVE_OF_FPS : OFF_IRRESPECTIVE_OF_FPS;
-
-    cmd[0] = REG_ADDR_CNFG_LDOx_B + ch * 2;
-    cmd[1] = reg_map_max77654.ldos[ch].reg_b.operation_mode|(reg_map_max77654.ldos[ch].reg_b.active_discharge<<3)|(reg_map_max77654.ldos[ch].reg_b.operation_mode<<4);
-    
-    i2c_write_blocking(I2C_CH_MAX77654, MAX77654_SLAVE_ADDR, cmd, 2, false);
-    // PRINT("SSB%d %s", ch, enable ? "enabled" : "disabled\n");
-    // PRINT("%02x %02x\n", cmd[0], cmd[1]);
-    return 0;
+    return shadow_mark_dirty(REG_ADDR_CNFG_LDOx_B + ch * 2);
 }
 
 int LDOx_set_voltage(int ch, int16_t voltage_in_mV)
 {
-    uint8_t cmd[2];
-
     // first update the reg_map on MCU
-    reg_map_max77654.ldos[ch].reg_a.target_voltage = calculate_ldo_voltage_reg(voltage_in_mV);
+    cur->reg_map.ldos[ch].reg_a.target_voltage = calculate_ldo_voltage_reg(voltage_in_mV);
 
-    cmd[0] = REG_ADDR_CNFG_LDOx_A + ch * 2;
-    cmd[1] = reg_map_max77654.ldos[ch].reg_a.target_voltage;
-    i2c_write_blocking(I2C_CH_MAX77654, MAX77654_SLAVE_ADDR, cmd, 2, false);
-    PRINT("LDO%d voltage set to %d mV", ch, voltage_in_mV);
-    PRINT("%02x %02x\n", cmd[0], cmd[1]);
-    return 0;
-}
\ No newline at end of file
+    MAX77654_LOG("LDO%d voltage set to %d mV", ch, voltage_in_mV);
+    return shadow_mark_dirty(REG_ADDR_CNFG_LDOx_A + ch * 2);
+}
+
+
+// CNFG_CHG_I also holds the discharge monitor scale, fetch it once before the first change
+static int amux_load(void)
+{
+    return max77654_shadow_fetch(REG_ADDR_CNFG_CHG_I, 1);
+}
+
+int max77654_amux_select(int channel)
+{
+    if (channel < MAX77654_AMUX_OFF || channel > MAX77654_AMUX_SYS_V || amux_load() < 0)
+        return -1;
+
+    cur->reg_map.chg_i.mux_sel = channel;
+
+    MAX77654_LOG("AMUX channel %d", channel);
+    return shadow_mark_dirty(REG_ADDR_CNFG_CHG_I);
+}
+
+int max77654_amux_set_discharge_scale(int code)
+{
+    if (code < 0 || code > 0x0F || amux_load() < 0)
+        return -1;
+
+    cur->reg_map.chg_i.imon_dischg_scale = code;
+
+    return shadow_mark_dirty(REG_ADDR_CNFG_CHG_I);
+}
+
+int max77654_amux_get_discharge_scale(void)
+{
+    if (amux_load() < 0)
+        return -1;
+
+    return cur->reg_map.chg_i.imon_dischg_scale;
+}
@@ -2,12 +2,112 @@
 
 #define __MAX__77654__H__
 
+#include "hardware/i2c.h"
+#include "max77654_types.h"
+#include "max77654_async.h"
+#include "max77654_profile.h"
+
 // Types needs to be defined in the header file
 #define LDO_MODE_LDO 0x00
 #define LDO_MODE_LSW 0x01
 
+// AMUX channels (CNFG_CHG_I MUX_SEL)
+#define MAX77654_AMUX_OFF 0x00
+#define MAX77654_AMUX_CHGIN_V 0x01
+#define MAX77654_AMUX_CHGIN_I 0x02
+#define MAX77654_AMUX_BATT_V 0x03
+#define MAX77654_AMUX_BATT_CHG_I 0x04   // only valid while charging
+#define MAX77654_AMUX_BATT_DISCHG_I 0x05
+#define MAX77654_AMUX_BATT_NULL 0x06    // discharge monitor nulling (offset) measurement
+#define MAX77654_AMUX_THM_V 0x07
+#define MAX77654_AMUX_TBIAS_V 0x08
+#define MAX77654_AMUX_AGND_V 0x09
+#define MAX77654_AMUX_SYS_V 0x0A
+
+#define MAX77654_I2C_ADDR 0x48
+#define MAX77654_SHADOW_REGS 28  // CNFG_CHG_A (0x20) .. CNFG_LDO1_B (0x3B)
+#define MAX77654_FLEET_BURSTS 10 // most bursts one commit can need, every other register dirty
+#define MAX77654_MAX_BURST_LEN 32 // longest max77654_write_regs(), register address excluded
+
+// ========Devices========
+// One PMIC with its own bus, pins, address and shadow register map. Fill it in with max77654_config()
+// and bring it up with max77654_dev_init(). The functions further down work on the selected device;
+// max77654_init() sets up and selects a built-in device on GPIO 26/27 for boards with one PMIC.
+// The charger, irq, dvs, seq and telemetry modules keep their own state for one device. The charger and
+// seq calls work on the selected device; irq, dvs and telemetry stay with the device selected at their
+// init (max77654_irq_init(), max77654_dvs_init(), max77654_telem_add_stream()), whatever is selected later.
+typedef struct max77654 {
+    i2c_inst_t *i2c;
+    uint8_t addr;
+    uint8_t sda_pin;
+    uint8_t scl_pin;
+    reg_map_max77654_t reg_map;
+    uint32_t shadow_dirty; // registers changed on the MCU but not yet written to the chip
+    uint32_t shadow_valid; // registers whose shadow value is known to match the chip
+    uint32_t shadow_owned; // registers written from interrupt context (DVS ramps), commits do not extend bursts over them
+    uint8_t chip_regs[MAX77654_SHADOW_REGS]; // values read from the chip or written/queued to it, for the shadow_valid registers
+    int transaction_depth; // > 0 between max77654_begin() and max77654_commit()
+
+    // bursts of max77654_fleet_commit() in flight
+    uint8_t fleet_image[MAX77654_SHADOW_REGS];
+    max77654_async_req_t fleet_reqs[MAX77654_FLEET_BURSTS];
+    int fleet_count;
+} max77654_t;
+
+void max77654_config(max77654_t *dev, i2c_inst_t *i2c, uint sda_pin, uint scl_pin, uint8_t addr); // no bus traffic
+int max77654_dev_init(max77654_t *dev, const max77654_profile_t *profile); // NULL: default profile, selects dev
+void max77654_select(max77654_t *dev);
+max77654_t *max77654_selected(void);
+
+int max77654_init(i2c_inst_t *i2c); // brings the rails up with the built-in default profile
+int max77654_init_with_profile(i2c_inst_t *i2c, const max77654_profile_t *profile);
+
+// ========Fleets========
+// Ends the transactions of count devices (stage the changes with max77654_begin() on each) and writes
+// them through the async queues (max77654_async_init() for every bus involved). Devices on i2c0 and i2c1
+// are written at the same time, so a fleet takes as long as its busiest bus.
+// Failed bursts stay pending for the next call. Returns -1 if any device failed.
+int max77654_fleet_commit(max77654_t *const *devs, int count);
+// Loads a rail profile into the shadow map of every device and commits them all, see above
+int max77654_fleet_apply_profile(max77654_t *const *devs, int count, const max77654_profile_t *profile);
 
-int max77654_init(i2c_inst_t *i2c);
+// ========Profiles========
+// Writes a whole rail profile (see max77654_profile.h), one burst for the SBBs and one for the LDOs.
+// The shadow register map is reloaded from the profile, pending changes of an open transaction are dropped.
+int max77654_apply_profile(const max77654_profile_t *profile);
+
+// ========Transactions========
+// Between begin and commit the rail functions below only update the shadow register map on the MCU.
+// Commit writes every changed register, neighbouring registers are merged into auto-increment bursts.
+// Outside of a transaction every rail function commits right away. Transactions can be nested.
+// Discard ends a transaction like commit, but drops every change still pending on the device (those of
+// enclosing transactions too): the shadow map goes back to what the chip holds, nothing is written.
+void max77654_begin(void);
+int max77654_commit(void);
+void max77654_discard(void);
+
+// raw register access, len registers starting at reg (auto-increment).
+// Shadowed registers written this way are taken over into the shadow map, pending changes to them are dropped.
+// Blocking; on a bus with max77654_async_init() done they wait their turn in the async queue (main loop only).
+int max77654_write_regs(uint8_t reg, const uint8_t *data, size_t len);
+int max77654_read_regs(uint8_t reg, uint8_t *data, size_t len);
+
+// Encoded shadow values for modules that write the rail registers themselves (max77654_dvs.c).
+// put takes over values that are already on the chip, registers outside 0x20..0x2E / 0x38..0x3B are skipped.
+// get_committed returns what the chip holds, without the changes still waiting for a commit.
+// put and own may be called from interrupt context.
+void max77654_shadow_get(uint8_t reg, uint8_t *data, size_t len);
+void max77654_shadow_put(uint8_t reg, const uint8_t *data, size_t len);
+void max77654_shadow_get_dev(max77654_t *dev, uint8_t reg, uint8_t *data, size_t len);
+void max77654_shadow_get_committed_dev(max77654_t *dev, uint8_t reg, uint8_t *data, size_t len);
+void max77654_shadow_put_dev(max77654_t *dev, uint8_t reg, const uint8_t *data, size_t len);
+void max77654_shadow_own_dev(max77654_t *dev, uint8_t reg, bool own); // keep commit bursts off reg
+
+// register codes for a voltage, clamped to the range of the rail
+uint8_t calculate_ssb_voltage_reg(int16_t voltage_in_mV);
+uint8_t calculate_ldo_voltage_reg(int16_t voltage_in_mV);
+
+// ========SSB========
 int SSBx_enable(int ch, bool enable);
 int SSBx_set_voltage(int ch, int16_t voltage_in_mV);
 
@@ -16,4 +116,10 @@ int LDOx_set_mode(int ch, int mode); //mode: LDO_MODE_LDO or LDO_MODE_LSW
 int LDOx_enable_active_discharge(int ch, bool enable);
 int LDOx_enable(int ch, bool enable);
 int LDOx_set_voltage(int ch, int16_t voltage_in_mV);
+
+// ========AMUX========
+// channel routed to the AMUX pin, see max77654_amux.h for the measurement side
+int max77654_amux_select(int channel); // MAX77654_AMUX_*
+int max77654_amux_set_discharge_scale(int code); // IMON_DISCHG_SCALE, 0x00 = 8.2mA .. 0x0A = 300mA full scale
+int max77654_amux_get_discharge_scale(void);
 #endif
@@ -0,0 +1,153 @@
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "max77654.h"
+#include "max77654_amux.h"
+#include "max77654_amux_port.h"
+
+#define N_CHANNELS (MAX77654_AMUX_SYS_V + 1)
+#define ADC_COUNTS 4096
+
+// units at full scale on the AMUX pin, nominal; 0 = scale from IMON_DISCHG_SCALE
+static const int32_t full_scale[N_CHANNELS] = {
+    [MAX77654_AMUX_OFF] = MAX77654_AMUX_FULL_SCALE_MV,
+    [MAX77654_AMUX_CHGIN_V] = 7000,        // mV
+    [MAX77654_AMUX_CHGIN_I] = 475000,      // uA
+    [MAX77654_AMUX_BATT_V] = 4600,         // mV
+    [MAX77654_AMUX_BATT_CHG_I] = 300000,   // uA at the highest fast-charge current, calibrate for the one in use
+    [MAX77654_AMUX_BATT_DISCHG_I] = 0,
+    [MAX77654_AMUX_BATT_NULL] = 0,
+    [MAX77654_AMUX_THM_V] = MAX77654_AMUX_FULL_SCALE_MV,
+    [MAX77654_AMUX_TBIAS_V] = MAX77654_AMUX_FULL_SCALE_MV,
+    [MAX77654_AMUX_AGND_V] = MAX77654_AMUX_FULL_SCALE_MV,
+    [MAX77654_AMUX_SYS_V] = 5500,          // mV
+};
+
+// IMON_DISCHG_SCALE in uA, codes 0x0A..0x0F are all 300 mA
+static const int32_t discharge_scale[16] = {
+    8200, 40500, 72300, 103400, 134100, 164100, 193700, 222700,
+    251200, 279300, 300000, 300000, 300000, 300000, 300000, 300000,
+};
+
+static uint16_t ring[MAX77654_AMUX_RING_SAMPLES] __attribute__((aligned(MAX77654_AMUX_RING_SAMPLES * sizeof(uint16_t))));
+static uint32_t tail; // next sample to filter, free running like the port's count
+
+static bool running;
+static uint16_t settle;
+static max77654_amux_filter_t filter;
+static max77654_amux_cal_t cal;
+static max77654_amux_cal_t board_cal[N_CHANNELS];
+static bool board_cal_set[N_CHANNELS];
+static max77654_amux_stats_t stats;
+
+
+static max77654_amux_cal_t default_calibration(int channel)
+{
+    int32_t fs = full_scale[channel];
+
+    if (fs == 0)
+    {
+        int code = max77654_amux_get_discharge_scale();
+        fs = discharge_scale[code < 0 ? 0x0F : code];
+    }
+
+    // units per count = fs / full scale mV * vref mV / counts
+    max77654_amux_cal_t c = {
+        .gain_q16 = (int32_t)(((int64_t)fs * MAX77654_AMUX_VREF_MV << 16) / ((int64_t)MAX77654_AMUX_FULL_SCALE_MV * ADC_COUNTS)),
+        .offset = 0,
+    };
+    return c;
+}
+
+
+int max77654_amux_start(const max77654_amux_config_t *config)
+{
+    if (config->channel < MAX77654_AMUX_OFF || config->channel >= N_CHANNELS || config->sample_rate_hz == 0
+        || config->sample_rate_hz > 500000 || config->decimation == 0)
+        return -1;
+
+    max77654_amux_stop();
+
+    if (max77654_amux_select(config->channel) < 0)
+        return -1;
+
+    cal = board_cal_set[config->channel] ? board_cal[config->channel] : default_calibration(config->channel);
+    max77654_amux_filter_init(&filter, config->decimation, config->ema_shift);
+    settle = config->settle_samples;
+    tail = 0;
+
+    if (max77654_amux_port_start(MAX77654_AMUX_ADC_INPUT, config->sample_rate_hz, ring, MAX77654_AMUX_RING_SAMPLES) < 0)
+        return -1;
+
+    running = true;
+    return 0;
+}
+
+void max77654_amux_stop(void)
+{
+    if (!running)
+        return;
+
+    max77654_amux_port_stop();
+    running = false;
+}
+
+uint32_t max77654_amux_poll(int32_t *values, uint32_t max)
+{
+    uint32_t produced = 0;
+
+    if (!running)
+        return 0;
+
+    uint32_t written = max77654_amux_port_written();
+
+    // lapped: the oldest half of the ring may already be overwritten, continue from the newer half
+    if (written - tail > MAX77654_AMUX_RING_SAMPLES)
+    {
+        stats.overruns++;
+        tail = written - MAX77654_AMUX_RING_SAMPLES / 2;
+    }
+
+    while (tail != written && produced < max)
+    {
+        uint32_t offset = tail & (MAX77654_AMUX_RING_SAMPLES - 1);
+        uint32_t chunk = MIN(written - tail, MAX77654_AMUX_RING_SAMPLES - offset);
+
+        if (settle > 0)
+        {
+            chunk = MIN(chunk, settle);
+            settle -= chunk;
+            tail += chunk;
+            continue;
+        }
+
+        // only take the samples whose outputs fit into values, the rest stays for the next call
+        uint64_t room = (uint64_t)(max - produced) * filter.decimation - filter.count;
+        chunk = MIN(chunk, room);
+
+        uint32_t got = max77654_amux_filter_feed(&filter, &ring[offset], chunk, &values[produced], max - produced);
+        for (uint32_t i = produced; i < produced + got; i++)
+            values[i] = max77654_amux_calibrate(&cal, values[i]);
+
+        produced += got;
+        tail += chunk;
+        stats.samples += chunk;
+    }
+
+    stats.outputs += produced;
+    return produced;
+}
+
+void max77654_amux_set_calibration(int channel, const max77654_amux_cal_t *c)
+{
+    if (channel < 0 || channel >= N_CHANNELS)
+        return;
+
+    board_cal_set[channel] = c != NULL;
+    if (c)
+        board_cal[channel] = *c;
+}
+
+void max77654_amux_get_stats(max77654_amux_stats_t *out)
+{
+    *out = stats;
+}
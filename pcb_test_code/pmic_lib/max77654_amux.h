@@ -0,0 +1,46 @@
+#ifndef __MAX__77654__AMUX__H__
+
+#define __MAX__77654__AMUX__H__
+
+#include "pico/stdlib.h"
+#include "max77654_amux_filter.h"
+
+// AMUX measurements: the channel is selected through the driver (max77654_amux_select), the ADC
+// samples the AMUX pin continuously and DMA writes into a ring buffer without any CPU per sample.
+// max77654_amux_poll() runs what arrived since the last call through the fixed-point filter chain
+// (max77654_amux_filter.h) and returns calibrated values: mV for voltages, uA for currents.
+// Output rate = sample_rate_hz / decimation.
+//
+// Default calibrations use the nominal AMUX transfer functions (full scale of each channel at
+// MAX77654_AMUX_FULL_SCALE_MV on the pin) and the ADC reference, override them per board with
+// max77654_amux_set_calibration(). The discharge current channels follow IMON_DISCHG_SCALE.
+
+#define MAX77654_AMUX_RING_SAMPLES 1024 // power of two, the DMA ring needs the buffer aligned to its size
+#define MAX77654_AMUX_ADC_INPUT 2       // ADC2 = GPIO28, GPIO26/27 carry I2C1
+#define MAX77654_AMUX_VREF_MV 3300
+#define MAX77654_AMUX_FULL_SCALE_MV 1250
+
+typedef struct {
+    int channel;             // MAX77654_AMUX_*
+    uint32_t sample_rate_hz; // ADC rate, 500 kHz at most
+    uint16_t decimation;     // samples per output
+    uint8_t ema_shift;       // IIR after decimation, 0 = off
+    uint16_t settle_samples; // dropped after the channel switch
+} max77654_amux_config_t;
+
+typedef struct {
+    uint32_t samples;  // samples filtered
+    uint32_t outputs;  // values returned by max77654_amux_poll
+    uint32_t overruns; // the DMA lapped the reader, samples were lost
+} max77654_amux_stats_t;
+
+int max77654_amux_start(const max77654_amux_config_t *config); // stops a running measurement first
+void max77654_amux_stop(void);
+
+// filters the captured samples, writes up to max values, returns how many
+uint32_t max77654_amux_poll(int32_t *values, uint32_t max);
+
+void max77654_amux_set_calibration(int channel, const max77654_amux_cal_t *cal);
+void max77654_amux_get_stats(max77654_amux_stats_t *stats);
+
+#endif
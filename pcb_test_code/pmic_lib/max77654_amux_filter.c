@@ -0,0 +1,49 @@
+#include "max77654_amux_filter.h"
+
+#define ADC_MASK 0x0FFF // 12 bit samples, bit 15 is the ADC error flag when it is kept in the FIFO
+
+
+void max77654_amux_filter_init(max77654_amux_filter_t *f, uint16_t decimation, uint8_t ema_shift)
+{
+    f->decimation = decimation ? decimation : 1;
+    f->ema_shift = ema_shift;
+    f->count = 0;
+    f->sum = 0;
+    f->ema = 0;
+    f->primed = false;
+}
+
+uint32_t max77654_amux_filter_feed(max77654_amux_filter_t *f, const uint16_t *samples, uint32_t n, int32_t *out, uint32_t max_out)
+{
+    uint32_t produced = 0;
+
+    for (uint32_t i = 0; i < n; i++)
+    {
+        f->sum += samples[i] & ADC_MASK;
+        if (++f->count < f->decimation)
+            continue;
+
+        // one division per output, not per sample
+        int32_t mean = (int32_t)(((uint64_t)f->sum << 8) / f->decimation);
+        f->sum = 0;
+        f->count = 0;
+
+        if (f->ema_shift == 0)
+        {
+            f->ema = mean;
+        }
+        else if (!f->primed)
+        {
+            f->ema = mean; // start at the first mean instead of ramping up from 0
+        }
+        else
+        {
+            f->ema += (mean - f->ema) >> f->ema_shift;
+        }
+        f->primed = true;
+
+        if (produced < max_out)
+            out[produced++] = f->ema;
+    }
+    return produced;
+}
@@ -0,0 +1,38 @@
+#ifndef __MAX__77654__AMUX__FILTER__H__
+
+#define __MAX__77654__AMUX__FILTER__H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Fixed-point filter chain for the AMUX samples, no floats and no per-sample division:
+//  1. boxcar decimation, the mean of every `decimation` raw 12 bit samples
+//  2. optional single-pole IIR, y += (x - y) >> ema_shift (ema_shift = 0 turns it off)
+//  3. calibration to engineering units, units = counts * gain_q16 / 65536 + offset
+// Outputs of stage 1 and 2 are ADC counts in Q8, so averaging gains resolution beyond 12 bits.
+
+typedef struct {
+    uint16_t decimation;
+    uint8_t ema_shift;
+    uint16_t count; // samples in the running sum
+    uint32_t sum;
+    int32_t ema;    // Q8 counts
+    bool primed;    // ema holds a value
+} max77654_amux_filter_t;
+
+typedef struct {
+    int32_t gain_q16; // units per ADC count, Q16
+    int32_t offset;   // units
+} max77654_amux_cal_t;
+
+void max77654_amux_filter_init(max77654_amux_filter_t *f, uint16_t decimation, uint8_t ema_shift);
+
+// runs n raw samples through stage 1 and 2, writes at most max_out Q8 results to out, returns how many
+uint32_t max77654_amux_filter_feed(max77654_amux_filter_t *f, const uint16_t *samples, uint32_t n, int32_t *out, uint32_t max_out);
+
+static inline int32_t max77654_amux_calibrate(const max77654_amux_cal_t *cal, int32_t counts_q8)
+{
+    return (int32_t)(((int64_t)counts_q8 * cal->gain_q16) >> 24) + cal->offset;
+}
+
+#endif
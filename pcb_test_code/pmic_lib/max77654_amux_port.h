@@ -0,0 +1,18 @@
+#ifndef __MAX__77654__AMUX__PORT__H__
+
+#define __MAX__77654__AMUX__PORT__H__
+
+#include "pico/stdlib.h"
+
+// Sample source of max77654_amux.c: max77654_amux_rp2040.c (ADC + DMA) on the board,
+// a waveform generator in the host build. The port fills the ring continuously and on its own,
+// max77654_amux.c only looks at how far it got.
+
+// capture 12 bit samples into ring (ring_len samples, a power of two) until stopped
+int max77654_amux_port_start(uint adc_input, uint32_t sample_rate_hz, uint16_t *ring, uint32_t ring_len);
+void max77654_amux_port_stop(void);
+
+// free running count of samples written since start, sample k is at ring[k % ring_len]
+uint32_t max77654_amux_port_written(void);
+
+#endif
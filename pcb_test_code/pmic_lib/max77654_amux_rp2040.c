@@ -0,0 +1,87 @@
+#include "pico/stdlib.h"
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "max77654_amux_port.h"
+
+// RP2040 port of max77654_amux: the ADC runs free at the requested rate and paces a DMA channel
+// (DREQ_ADC) that writes into the ring with address wrapping. The transfer count is a multiple
+// of the ring size, so the ring position keeps counting across the rare restart in the DMA IRQ.
+
+#define CAPTURE_COUNT 0x80000000u // samples per DMA run, about 70 minutes at 500 kS/s
+#define ADC_CLOCK_HZ 48000000
+
+static int dma_chan = -1;
+static volatile uint32_t runs; // completed DMA runs
+
+
+static void on_dma_done(void)
+{
+    if (dma_chan < 0 || !dma_channel_get_irq1_status(dma_chan))
+        return;
+
+    dma_channel_acknowledge_irq1(dma_chan);
+    runs++;
+    dma_channel_set_trans_count(dma_chan, CAPTURE_COUNT, true); // write address continues in the ring
+}
+
+int max77654_amux_port_start(uint adc_input, uint32_t sample_rate_hz, uint16_t *ring, uint32_t ring_len)
+{
+    if (dma_chan < 0)
+    {
+        dma_chan = dma_claim_unused_channel(false);
+        if (dma_chan < 0)
+            return -1;
+
+        irq_add_shared_handler(DMA_IRQ_1, on_dma_done, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled(DMA_IRQ_1, true);
+    }
+
+    adc_init();
+    adc_gpio_init(26 + adc_input);
+    adc_select_input(adc_input);
+    adc_fifo_setup(true, true, 1, false, false); // FIFO on, DREQ at one sample, no error bit, 12 bit samples
+    // a sample every 1 + div ADC clocks, a conversion takes 96 of them
+    adc_set_clkdiv((float)ADC_CLOCK_HZ / sample_rate_hz - 1.0f);
+
+    dma_channel_config c = dma_channel_get_default_config(dma_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_ring(&c, true, __builtin_ctz(ring_len * sizeof(uint16_t)));
+    channel_config_set_dreq(&c, DREQ_ADC);
+
+    runs = 0;
+    dma_channel_set_irq1_enabled(dma_chan, true);
+    adc_fifo_drain();
+    dma_channel_configure(dma_chan, &c, ring, &adc_hw->fifo, CAPTURE_COUNT, true);
+    adc_run(true);
+    return 0;
+}
+
+void max77654_amux_port_stop(void)
+{
+    adc_run(false);
+    if (dma_chan >= 0)
+    {
+        // an abort can raise the completion IRQ, which would restart the channel
+        dma_channel_set_irq1_enabled(dma_chan, false);
+        dma_channel_abort(dma_chan);
+        dma_channel_acknowledge_irq1(dma_chan);
+    }
+    adc_fifo_drain();
+}
+
+uint32_t max77654_amux_port_written(void)
+{
+    uint32_t r, remaining;
+
+    // the IRQ may restart the channel between the two reads
+    do
+    {
+        r = runs;
+        remaining = dma_channel_hw_addr(dma_chan)->transfer_count;
+    } while (r != runs);
+
+    return r * CAPTURE_COUNT + (CAPTURE_COUNT - remaining);
+}
@@ -0,0 +1,138 @@
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "max77654.h"
+#include "max77654_async.h"
+#include "max77654_async_port.h"
+#include "max77654_trace.h"
+
+#define I2C_BUSES 2 // i2c0, i2c1
+
+
+typedef struct {
+    max77654_async_req_t *head; // transfer in flight
+    max77654_async_req_t *tail;
+    bool enabled; // max77654_async_init() ran, the IRQ owns the controller from now on
+} async_queue_t;
+
+static async_queue_t queues[I2C_BUSES];
+
+
+static int submit(max77654_t *dev, max77654_async_req_t *req)
+{
+    if (req->len == 0 || req->len > MAX77654_ASYNC_MAX_LEN)
+        return -1;
+
+    req->i2c = dev->i2c;
+    req->addr = dev->addr;
+    req->status = MAX77654_ASYNC_PENDING;
+    req->submit_us = time_us_64();
+    req->next = NULL;
+
+    uint32_t irq = save_and_disable_interrupts();
+    async_queue_t *q = &queues[i2c_hw_index(req->i2c)];
+
+    if (q->tail)
+    {
+        q->tail->next = req;
+        q->tail = req;
+    }
+    else
+    {
+        // bus idle, start right away
+        q->head = q->tail = req;
+        max77654_async_port_start(req);
+    }
+
+    restore_interrupts(irq);
+    return 0;
+}
+
+
+void max77654_async_init(i2c_inst_t *i2c)
+{
+    queues[i2c_hw_index(i2c)].head = queues[i2c_hw_index(i2c)].tail = NULL;
+    max77654_async_port_init(i2c);
+    queues[i2c_hw_index(i2c)].enabled = true;
+}
+
+bool max77654_async_enabled(i2c_inst_t *i2c)
+{
+    return queues[i2c_hw_index(i2c)].enabled;
+}
+
+int max77654_async_write_dev(max77654_t *dev, max77654_async_req_t *req, uint8_t reg, uint8_t *data, uint8_t len, max77654_async_cb_t callback, void *user)
+{
+    req->reg = reg;
+    req->data = data;
+    req->len = len;
+    req->read = false;
+    req->callback = callback;
+    req->user = user;
+    return submit(dev, req);
+}
+
+int max77654_async_read_dev(max77654_t *dev, max77654_async_req_t *req, uint8_t reg, uint8_t *data, uint8_t len, max77654_async_cb_t callback, void *user)
+{
+    req->reg = reg;
+    req->data = data;
+    req->len = len;
+    req->read = true;
+    req->callback = callback;
+    req->user = user;
+    return submit(dev, req);
+}
+
+int max77654_async_write(max77654_async_req_t *req, uint8_t reg, uint8_t *data, uint8_t len, max77654_async_cb_t callback, void *user)
+{
+    return max77654_async_write_dev(max77654_selected(), req, reg, data, len, callback, user);
+}
+
+int max77654_async_read(max77654_async_req_t *req, uint8_t reg, uint8_t *data, uint8_t len, max77654_async_cb_t callback, void *user)
+{
+    return max77654_async_read_dev(max77654_selected(), req, reg, data, len, callback, user);
+}
+
+bool max77654_async_busy(void)
+{
+    for (int i = 0; i < I2C_BUSES; i++)
+        if (queues[i].head != NULL)
+            return true;
+    return false;
+}
+
+int max77654_async_wait(max77654_async_req_t *req)
+{
+    while (req->status == MAX77654_ASYNC_PENDING)
+        max77654_async_port_idle();
+    return req->status;
+}
+
+void max77654_async_flush(void)
+{
+    while (max77654_async_busy())
+        max77654_async_port_idle();
+}
+
+// Runs in interrupt context on the device
+void max77654_async_complete(i2c_inst_t *i2c, int result)
+{
+    async_queue_t *q = &queues[i2c_hw_index(i2c)];
+    max77654_async_req_t *req = q->head;
+
+    if (req == NULL)
+        return;
+
+    q->head = req->next;
+    if (q->head == NULL)
+        q->tail = NULL;
+    else
+        max77654_async_port_start(q->head); // keep the bus busy before running the callback
+
+    req->done_us = time_us_64();
+    req->status = result;
+    max77654_trace_record(req->read ? MAX77654_OP_ASYNC_READ : MAX77654_OP_ASYNC_WRITE, req->reg,
+                          (uint32_t)(req->done_us - req->submit_us), result);
+
+    if (req->callback)
+        req->callback(req, req->user);
+}
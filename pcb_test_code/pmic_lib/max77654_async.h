@@ -0,0 +1,53 @@
+#ifndef __MAX__77654__ASYNC__H__
+
+#define __MAX__77654__ASYNC__H__
+
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+
+// Non-blocking register access for the MAX77654.
+// Requests are owned by the caller and queued in submission order, the I2C peripheral
+// works through the queue from its interrupt so the main loop keeps running (cdc_task() etc.).
+// Every bus has its own queue, requests for devices on i2c0 and i2c1 are transferred at the same time.
+// The request must stay untouched until its status is no longer MAX77654_ASYNC_PENDING.
+
+#define MAX77654_ASYNC_PENDING 1
+#define MAX77654_ASYNC_MAX_LEN 32 // longest auto-increment transfer, register address excluded
+
+struct max77654;
+struct max77654_async_req;
+typedef void (*max77654_async_cb_t)(struct max77654_async_req *req, void *user);
+
+typedef struct max77654_async_req {
+    i2c_inst_t *i2c; // bus and address of the device, set on submission
+    uint8_t addr;
+    uint8_t reg;
+    uint8_t *data;
+    uint8_t len;
+    bool read;
+    volatile int status; // MAX77654_ASYNC_PENDING, 0 = done, -1 = NACK/abort
+    max77654_async_cb_t callback; // optional, runs in interrupt context
+    void *user;
+    uint64_t submit_us; // time_us_64() at submission
+    uint64_t done_us;   // time_us_64() at completion
+    struct max77654_async_req *next;
+} max77654_async_req_t;
+
+// once per bus, i2c must already be initialised (max77654_init). From then on the register access
+// of max77654.h on that bus is queued here as well and waits for its turn, so it never meets a transfer
+// of the IRQ on the controller; call it from the main loop only, never from a callback.
+void max77654_async_init(i2c_inst_t *i2c);
+bool max77654_async_enabled(i2c_inst_t *i2c);
+
+// for the selected device (max77654_select())
+int max77654_async_write(max77654_async_req_t *req, uint8_t reg, uint8_t *data, uint8_t len, max77654_async_cb_t callback, void *user);
+int max77654_async_read(max77654_async_req_t *req, uint8_t reg, uint8_t *data, uint8_t len, max77654_async_cb_t callback, void *user);
+// for a given device
+int max77654_async_write_dev(struct max77654 *dev, max77654_async_req_t *req, uint8_t reg, uint8_t *data, uint8_t len, max77654_async_cb_t callback, void *user);
+int max77654_async_read_dev(struct max77654 *dev, max77654_async_req_t *req, uint8_t reg, uint8_t *data, uint8_t len, max77654_async_cb_t callback, void *user);
+
+bool max77654_async_busy(void); // any bus
+int max77654_async_wait(max77654_async_req_t *req); // spin until req is done, returns its status
+void max77654_async_flush(void); // spin until the queues of all buses are empty
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef __MAX__77654__ASYNC__PORT__H__
+
+#define __MAX__77654__ASYNC__PORT__H__
+
+// Glue between the request queue (max77654_async.c) and the I2C peripheral that moves the bytes.
+// max77654_async_rp2040.c drives the RP2040 controller from its IRQ, the host build simulates one.
+
+#include "max77654_async.h"
+
+void max77654_async_port_init(i2c_inst_t *i2c);
+// start the transfer of req on req->i2c to req->addr, called with interrupts disabled while that peripheral is idle
+void max77654_async_port_start(max77654_async_req_t *req);
+// called while spinning on a pending request
+void max77654_async_port_idle(void);
+
+// called by the port when the running transfer of a bus has ended
+void max77654_async_complete(i2c_inst_t *i2c, int result);
+
+#endif
@@ -0,0 +1,166 @@
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "hardware/irq.h"
+#include "max77654_async_port.h"
+
+// Interrupt driven transfers on the RP2040 I2C controllers, each one with its own state and IRQ.
+// The whole transfer is queued as IC_DATA_CMD words: register address, then either the data
+// bytes (write) or read commands behind a RESTART (read), the last word carries STOP.
+// TX_EMPTY refills the 16 deep TX FIFO, RX_FULL drains read data, STOP_DET / TX_ABRT end it.
+
+#define I2C_FIFO_DEPTH 16
+
+typedef struct {
+    i2c_inst_t *i2c;
+    i2c_hw_t *hw;
+    max77654_async_req_t *xfer;
+    uint8_t xfer_cmds_sent; // register address included
+    uint8_t xfer_rx_count;
+    bool xfer_aborted;
+} async_ctrl_t;
+
+static async_ctrl_t ctrls[2];
+
+
+static void fill_tx_fifo(async_ctrl_t *c)
+{
+    max77654_async_req_t *xfer = c->xfer;
+    uint8_t total = xfer->len + 1;
+
+    while (c->xfer_cmds_sent < total && c->hw->txflr < I2C_FIFO_DEPTH)
+    {
+        uint32_t cmd;
+
+        if (c->xfer_cmds_sent == 0)
+        {
+            cmd = xfer->reg;
+        }
+        else if (xfer->read)
+        {
+            cmd = I2C_IC_DATA_CMD_CMD_BITS;
+            if (c->xfer_cmds_sent == 1)
+                cmd |= I2C_IC_DATA_CMD_RESTART_BITS;
+        }
+        else
+        {
+            cmd = xfer->data[c->xfer_cmds_sent - 1];
+        }
+
+        if (c->xfer_cmds_sent == total - 1)
+            cmd |= I2C_IC_DATA_CMD_STOP_BITS;
+
+        c->hw->data_cmd = cmd;
+        c->xfer_cmds_sent++;
+    }
+
+    if (c->xfer_cmds_sent == total)
+        hw_clear_bits(&c->hw->intr_mask, I2C_IC_INTR_MASK_M_TX_EMPTY_BITS);
+}
+
+static void drain_rx_fifo(async_ctrl_t *c)
+{
+    while (c->hw->rxflr)
+    {
+        uint8_t byte = (uint8_t)c->hw->data_cmd;
+        if (c->xfer->read && c->xfer_rx_count < c->xfer->len)
+            c->xfer->data[c->xfer_rx_count++] = byte;
+    }
+}
+
+static void i2c_irq_handler(async_ctrl_t *c)
+{
+    uint32_t stat = c->hw->intr_stat;
+
+    if (c->xfer == NULL)
+    {
+        c->hw->intr_mask = 0;
+        return;
+    }
+
+    if (stat & I2C_IC_INTR_STAT_R_TX_ABRT_BITS)
+    {
+        (void)c->hw->clr_tx_abrt; // also flushes the TX FIFO
+        c->xfer_aborted = true;
+        hw_clear_bits(&c->hw->intr_mask, I2C_IC_INTR_MASK_M_TX_EMPTY_BITS);
+    }
+
+    if (stat & I2C_IC_INTR_STAT_R_RX_FULL_BITS)
+        drain_rx_fifo(c);
+
+    if ((stat & I2C_IC_INTR_STAT_R_TX_EMPTY_BITS) && !c->xfer_aborted)
+        fill_tx_fifo(c);
+
+    if (stat & I2C_IC_INTR_STAT_R_STOP_DET_BITS)
+    {
+        (void)c->hw->clr_stop_det;
+        drain_rx_fifo(c);
+
+        int result = 0;
+        if (c->xfer_aborted || (c->xfer->read && c->xfer_rx_count < c->xfer->len))
+            result = -1;
+
+        c->hw->intr_mask = 0;
+        c->xfer = NULL;
+        max77654_async_complete(c->i2c, result); // may start the next transfer
+    }
+}
+
+static void i2c0_irq_handler(void)
+{
+    i2c_irq_handler(&ctrls[0]);
+}
+
+static void i2c1_irq_handler(void)
+{
+    i2c_irq_handler(&ctrls[1]);
+}
+
+
+void max77654_async_port_init(i2c_inst_t *i2c)
+{
+    uint index = i2c_hw_index(i2c);
+    async_ctrl_t *c = &ctrls[index];
+
+    c->i2c = i2c;
+    c->hw = i2c_get_hw(i2c);
+    c->xfer = NULL;
+
+    c->hw->enable = 0;
+    c->hw->tx_tl = I2C_FIFO_DEPTH / 2;
+    c->hw->rx_tl = 0; // RX_FULL as soon as one byte arrived
+    c->hw->intr_mask = 0;
+    c->hw->enable = 1;
+
+    irq_set_exclusive_handler(index ? I2C1_IRQ : I2C0_IRQ, index ? i2c1_irq_handler : i2c0_irq_handler);
+    irq_set_enabled(index ? I2C1_IRQ : I2C0_IRQ, true);
+}
+
+void max77654_async_port_start(max77654_async_req_t *req)
+{
+    async_ctrl_t *c = &ctrls[i2c_hw_index(req->i2c)];
+
+    c->xfer = req;
+    c->xfer_cmds_sent = 0;
+    c->xfer_rx_count = 0;
+    c->xfer_aborted = false;
+
+    // another device on this bus, or blocking SDK calls in between, may have retargeted the controller
+    if (c->hw->tar != req->addr)
+    {
+        c->hw->enable = 0;
+        c->hw->tar = req->addr;
+        c->hw->enable = 1;
+    }
+
+    (void)c->hw->clr_intr;
+    fill_tx_fifo(c);
+
+    c->hw->intr_mask = I2C_IC_INTR_MASK_M_TX_ABRT_BITS | I2C_IC_INTR_MASK_M_STOP_DET_BITS
+                     | I2C_IC_INTR_MASK_M_RX_FULL_BITS
+                     | (c->xfer_cmds_sent < req->len + 1 ? I2C_IC_INTR_MASK_M_TX_EMPTY_BITS : 0);
+}
+
+void max77654_async_port_idle(void)
+{
+    tight_loop_contents();
+}
@@ -0,0 +1,105 @@
+#include "pico/stdlib.h"
+#include "max77654_boot.h"
+#include <string.h>
+
+#define BOOT_MAGIC 0x42544D50u // "PMTB"
+
+// Kept across soft resets, so it starts out as whatever the RAM held: only trusted with both magics
+typedef struct {
+    uint32_t magic;
+    uint32_t boots;
+    uint32_t current; // index of the current run in runs
+    max77654_boot_run_t runs[MAX77654_BOOT_RUNS];
+    uint32_t magic_inv;
+} boot_log_t;
+
+static boot_log_t boot_log __attribute__((section(".uninitialized_data.max77654_boot")));
+static max77654_boot_run_t *run; // recording into, NULL outside of begin/done (cleared by the runtime)
+
+
+static bool log_valid(void)
+{
+    return boot_log.magic == BOOT_MAGIC && boot_log.magic_inv == ~BOOT_MAGIC && boot_log.current < MAX77654_BOOT_RUNS;
+}
+
+void max77654_boot_begin(void)
+{
+    uint32_t now = time_us_32();
+
+    if (!log_valid())
+    {
+        // power on, the RAM is random
+        memset(&boot_log, 0, sizeof(boot_log));
+        boot_log.magic = BOOT_MAGIC;
+        boot_log.magic_inv = ~BOOT_MAGIC;
+        boot_log.current = MAX77654_BOOT_RUNS - 1;
+    }
+
+    boot_log.current = (boot_log.current + 1) % MAX77654_BOOT_RUNS;
+    run = &boot_log.runs[boot_log.current];
+    memset(run, 0, sizeof(*run));
+    run->boot = ++boot_log.boots;
+
+    run->marks[0].phase = MAX77654_BOOT_MAIN;
+    run->marks[0].time_us = now;
+    run->count = 1;
+}
+
+void max77654_boot_mark(uint8_t phase, uint8_t arg)
+{
+    if (!run)
+        return;
+    if (run->count == MAX77654_BOOT_MAX_MARKS)
+    {
+        run->overflow = true;
+        return;
+    }
+
+    max77654_boot_mark_t *m = &run->marks[run->count++];
+    m->phase = phase;
+    m->arg = arg;
+    m->time_us = time_us_32();
+}
+
+void max77654_boot_done(void)
+{
+    if (!run)
+        return;
+    max77654_boot_mark(MAX77654_BOOT_DONE, 0);
+    run->finished = true;
+    run = NULL;
+}
+
+bool max77654_boot_recording(void)
+{
+    return run != NULL;
+}
+
+const max77654_boot_run_t *max77654_boot_get_run(int age)
+{
+    if (!log_valid() || age < 0 || age >= MAX77654_BOOT_RUNS || (uint32_t)age >= boot_log.boots)
+        return NULL;
+    return &boot_log.runs[(boot_log.current + MAX77654_BOOT_RUNS - age) % MAX77654_BOOT_RUNS];
+}
+
+uint32_t max77654_boot_report(int age, uint8_t *buf, uint32_t room)
+{
+    const max77654_boot_run_t *r = max77654_boot_get_run(age);
+    uint32_t n = 0;
+
+    if (!r || room < (uint32_t)(6 + r->count * MAX77654_BOOT_MARK_SIZE))
+        return 0;
+
+    for (int i = 0; i < 4; i++)
+        buf[n++] = r->boot >> (8 * i);
+    buf[n++] = r->count;
+    buf[n++] = (r->overflow ? 0x01 : 0) | (r->finished ? 0x02 : 0);
+    for (int k = 0; k < r->count; k++)
+    {
+        buf[n++] = r->marks[k].phase;
+        buf[n++] = r->marks[k].arg;
+        for (int i = 0; i < 4; i++)
+            buf[n++] = r->marks[k].time_us >> (8 * i);
+    }
+    return n;
+}
@@ -0,0 +1,65 @@
+#ifndef __MAX__77654__BOOT__H__
+
+#define __MAX__77654__BOOT__H__
+
+#include "pico/stdlib.h"
+
+// Boot phase timestamps, from reset to the rails being up and USB running.
+// The application calls max77654_boot_begin() first thing in main() and max77654_boot_done() once it
+// considers the boot finished; in between the driver marks its own phases (I2C init, the on-bus probe,
+// the ERCFLAG read, every register write) and the application adds its own with max77654_boot_mark().
+// Outside of begin/done a mark does nothing, steady state register writes are not recorded.
+//
+// Timestamps are time_us_32(), the RP2040 timer starts counting when the SDK runtime brings up the
+// clocks, so time 0 is a few hundred us after the reset itself.
+// The records live in RAM the C runtime does not clear: the last MAX77654_BOOT_RUNS boots survive a
+// watchdog or soft reset and can be read out after the fact, a power cycle starts over.
+// max77654_boot_report() packs a run for pmic_protocol (PMIC_CMD_BOOT_REPORT), app/pmic_ctrl.py boot
+// prints it and app/boot_compare.py compares runs against a budget.
+
+#define MAX77654_BOOT_MAX_MARKS 40
+#define MAX77654_BOOT_RUNS 4
+#define MAX77654_BOOT_MARK_SIZE 6 // packed report entry: phase, arg, time us (u32)
+
+typedef enum {
+    MAX77654_BOOT_MAIN = 0x00,      // max77654_boot_begin()
+    MAX77654_BOOT_STDIO = 0x01,     // stdio up
+    MAX77654_BOOT_STORE = 0x02,     // profile loaded from flash, arg 1 = stored, 0 = built-in
+    MAX77654_BOOT_I2C_INIT = 0x03,  // controller and pins set up
+    MAX77654_BOOT_ON_BUS = 0x04,    // the PMIC answered its address
+    MAX77654_BOOT_ERCFLAG = 0x05,   // ERCFLAG read, arg = its value
+    MAX77654_BOOT_REG_WRITE = 0x06, // a register burst written, arg = first register
+    MAX77654_BOOT_RAILS_UP = 0x07,  // profile applied
+    MAX77654_BOOT_USB_INIT = 0x08,  // USB stack started
+    MAX77654_BOOT_USB_HOST = 0x09,  // first sign of the host: CDC opened or first data received
+    MAX77654_BOOT_DONE = 0x0A,      // max77654_boot_done()
+    MAX77654_BOOT_ERROR = 0x0B,     // a phase failed, arg = the phase
+    MAX77654_BOOT_APP = 0x80,       // application phases from here on
+} max77654_boot_phase_t;
+
+typedef struct {
+    uint8_t phase;
+    uint8_t arg;
+    uint32_t time_us;
+} max77654_boot_mark_t;
+
+typedef struct {
+    uint32_t boot;  // boot number since the last power cycle, 1 = first one
+    uint8_t count;  // marks recorded
+    bool overflow;  // marks dropped, MAX77654_BOOT_MAX_MARKS was too small
+    bool finished;  // max77654_boot_done() was reached
+    max77654_boot_mark_t marks[MAX77654_BOOT_MAX_MARKS];
+} max77654_boot_run_t;
+
+void max77654_boot_begin(void);
+void max77654_boot_mark(uint8_t phase, uint8_t arg);
+void max77654_boot_done(void);
+bool max77654_boot_recording(void);
+
+// run 0 is the current boot, 1 the one before, ... NULL if there is no such run
+const max77654_boot_run_t *max77654_boot_get_run(int age);
+// [boot u32][count][flags: bit 0 overflow, bit 1 finished][count x (phase, arg, time us u32)], little endian;
+// returns the length, 0 if there is no such run or room is too small
+uint32_t max77654_boot_report(int age, uint8_t *buf, uint32_t room);
+
+#endif
@@ -0,0 +1,372 @@
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "hardware/sync.h"
+#include "max77654.h"
+#include "max77654_charger.h"
+#include "max77654_irq.h"
+#include "max77654_shadow.h"
+
+#define REG_ADDR_STAT_CHG_A 0x02 // STAT_CHG_A, STAT_CHG_B
+#define REG_ADDR_CNFG_CHG_A 0x20
+#define REG_ADDR_CNFG_CHG_B 0x21
+#define REG_ADDR_CNFG_CHG_C 0x22
+#define REG_ADDR_CNFG_CHG_D 0x23
+#define REG_ADDR_CNFG_CHG_E 0x24
+#define REG_ADDR_CNFG_CHG_F 0x25
+#define REG_ADDR_CNFG_CHG_G 0x26
+#define REG_ADDR_CNFG_CHG_H 0x27
+#define CNFG_CHG_COUNT 9 // CNFG_CHG_A..CNFG_CHG_I
+
+#define DEFAULT_STATUS_MAX_AGE_US 1000000
+
+// events that come with a change of STAT_CHG_A/B
+#define CHARGER_EVENTS (MAX77654_EVT_MASK(MAX77654_EVT_THM_I) | MAX77654_EVT_MASK(MAX77654_EVT_CHG_I) \
+                        | MAX77654_EVT_MASK(MAX77654_EVT_CHGIN_I) | MAX77654_EVT_MASK(MAX77654_EVT_TJ_REG_I) \
+                        | MAX77654_EVT_MASK(MAX77654_EVT_CHGIN_CTRL_I) | MAX77654_EVT_MASK(MAX77654_EVT_SYS_CTRL_I))
+
+static const int8_t thm_cold_C[4] = {-10, -5, 0, 5};
+static const int8_t thm_cool_C[4] = {15, 10, 5, 0};
+static const int8_t thm_warm_C[4] = {35, 40, 45, 50};
+static const int8_t thm_hot_C[4] = {45, 50, 55, 60};
+static const uint16_t term_permille[4] = {50, 75, 100, 150};
+static const uint8_t timer_h[4] = {0, 3, 5, 7};
+
+// written by the nIRQ handler, read by the main loop
+static uint8_t status_raw[2];
+static bool status_valid;
+static uint64_t status_read_us;
+static bool status_volatile;
+static uint32_t status_max_age_us = DEFAULT_STATUS_MAX_AGE_US;
+static max77654_charger_stats_t stats;
+
+
+// value = first + code * step for code 0..max_code, -1 if value is not one of them
+static int linear_code(uint32_t value, uint32_t first, uint32_t step, int max_code)
+{
+    if (value < first || (value - first) % step != 0 || (value - first) / step > (uint32_t)max_code)
+        return -1;
+    return (value - first) / step;
+}
+
+static int table_code(int value, const int8_t *table)
+{
+    for (int i = 0; i < 4; i++)
+        if (table[i] == value)
+            return i;
+    return -1;
+}
+
+static int term_code(uint16_t permille)
+{
+    for (int i = 0; i < 4; i++)
+        if (term_permille[i] == permille)
+            return i;
+    return -1;
+}
+
+static int timer_code(uint8_t hours)
+{
+    for (int i = 0; i < 4; i++)
+        if (timer_h[i] == hours)
+            return i;
+    return -1;
+}
+
+// the same checks the setters do, before any of them changes something
+static bool config_valid(const max77654_charger_config_t *c)
+{
+    return linear_code(c->fast_charge_uA, 7500, 7500, 0x27) >= 0
+        && linear_code(c->charge_mV, 3600, 25, 0x28) >= 0
+        && linear_code(c->precharge_mV, 2300, 100, 7) >= 0
+        && (c->precharge_percent == 10 || c->precharge_percent == 20)
+        && term_code(c->term_permille) >= 0
+        && linear_code(c->topoff_min, 0, 5, 7) >= 0
+        && timer_code(c->timer_h) >= 0
+        && linear_code(c->input_limit_mA, 95, 95, 4) >= 0
+        && linear_code(c->input_min_mV, 4000, 100, 7) >= 0
+        && linear_code(c->vsys_mV, 3300, 50, 0x1E) >= 0
+        && linear_code(c->tj_reg_C, 60, 10, 4) >= 0
+        && table_code(c->jeita.cold_C, thm_cold_C) >= 0
+        && table_code(c->jeita.cool_C, thm_cool_C) >= 0
+        && table_code(c->jeita.warm_C, thm_warm_C) >= 0
+        && table_code(c->jeita.hot_C, thm_hot_C) >= 0
+        && linear_code(c->jeita.current_uA, 7500, 7500, 0x27) >= 0
+        && linear_code(c->jeita.voltage_mV, 3600, 25, 0x28) >= 0;
+}
+
+static reg_map_max77654_t *map(void)
+{
+    return max77654_shadow_map();
+}
+
+// nIRQ burst, interrupt context: STAT_CHG_A/B were read together with the interrupt registers
+static void on_charger_event(const max77654_event_t *event, void *user)
+{
+    (void)user;
+    status_raw[0] = event->regs[2];
+    status_raw[1] = event->regs[3];
+    status_read_us = event->read_us;
+    status_valid = true;
+    stats.irq_updates++;
+}
+
+
+int max77654_charger_init(void)
+{
+    static bool subscribed;
+
+    if (max77654_shadow_fetch(REG_ADDR_CNFG_CHG_A, CNFG_CHG_COUNT) < 0)
+        return -1;
+
+    if (!subscribed)
+        subscribed = max77654_irq_add_handler(CHARGER_EVENTS, on_charger_event, NULL) == 0;
+    return 0;
+}
+
+int max77654_charger_enable(bool enable)
+{
+    if (max77654_shadow_fetch(REG_ADDR_CNFG_CHG_B, 1) < 0)
+        return -1;
+
+    map()->chg_b.chg_en = enable;
+    return max77654_shadow_changed(REG_ADDR_CNFG_CHG_B);
+}
+
+int max77654_charger_set_fast_charge_current(uint32_t uA)
+{
+    int code = linear_code(uA, 7500, 7500, 0x27);
+    if (code < 0 || max77654_shadow_fetch(REG_ADDR_CNFG_CHG_E, 1) < 0)
+        return -1;
+
+    map()->chg_e.chg_cc = code;
+    return max77654_shadow_changed(REG_ADDR_CNFG_CHG_E);
+}
+
+int max77654_charger_set_charge_voltage(uint16_t mV)
+{
+    int code = linear_code(mV, 3600, 25, 0x28);
+    if (code < 0 || max77654_shadow_fetch(REG_ADDR_CNFG_CHG_G, 1) < 0)
+        return -1;
+
+    map()->chg_g.chg_cv = code;
+    return max77654_shadow_changed(REG_ADDR_CNFG_CHG_G);
+}
+
+int max77654_charger_set_precharge(uint16_t threshold_mV, uint8_t percent)
+{
+    int code = linear_code(threshold_mV, 2300, 100, 7);
+    if (code < 0 || (percent != 10 && percent != 20))
+        return -1;
+    if (max77654_shadow_fetch(REG_ADDR_CNFG_CHG_B, 2) < 0)
+        return -1;
+
+    map()->chg_c.chg_pq = code;
+    map()->chg_b.i_pq = percent == 20;
+    max77654_begin();
+    max77654_shadow_changed(REG_ADDR_CNFG_CHG_B);
+    max77654_shadow_changed(REG_ADDR_CNFG_CHG_C);
+    return max77654_commit();
+}
+
+int max77654_charger_set_termination(uint16_t permille, uint8_t topoff_min)
+{
+    int term = term_code(permille);
+    int topoff = linear_code(topoff_min, 0, 5, 7);
+    if (term < 0 || topoff < 0 || max77654_shadow_fetch(REG_ADDR_CNFG_CHG_C, 1) < 0)
+        return -1;
+
+    map()->chg_c.i_term = term;
+    map()->chg_c.t_topoff = topoff;
+    return max77654_shadow_changed(REG_ADDR_CNFG_CHG_C);
+}
+
+int max77654_charger_set_timer(uint8_t hours)
+{
+    int code = timer_code(hours);
+    if (code < 0 || max77654_shadow_fetch(REG_ADDR_CNFG_CHG_E, 1) < 0)
+        return -1;
+
+    map()->chg_e.t_fast_chg = code;
+    return max77654_shadow_changed(REG_ADDR_CNFG_CHG_E);
+}
+
+int max77654_charger_set_input_limit(uint16_t mA, uint16_t min_mV)
+{
+    int lim = linear_code(mA, 95, 95, 4);
+    int vmin = linear_code(min_mV, 4000, 100, 7);
+    if (lim < 0 || vmin < 0 || max77654_shadow_fetch(REG_ADDR_CNFG_CHG_B, 1) < 0)
+        return -1;
+
+    map()->chg_b.ichgin_lim = lim;
+    map()->chg_b.vchgin_min = vmin;
+    return max77654_shadow_changed(REG_ADDR_CNFG_CHG_B);
+}
+
+int max77654_charger_set_vsys(uint16_t mV)
+{
+    int code = linear_code(mV, 3300, 50, 0x1E);
+    if (code < 0 || max77654_shadow_fetch(REG_ADDR_CNFG_CHG_D, 1) < 0)
+        return -1;
+
+    map()->chg_d.vsys_reg = code;
+    return max77654_shadow_changed(REG_ADDR_CNFG_CHG_D);
+}
+
+int max77654_charger_set_tj_reg(uint8_t C)
+{
+    int code = linear_code(C, 60, 10, 4);
+    if (code < 0 || max77654_shadow_fetch(REG_ADDR_CNFG_CHG_D, 1) < 0)
+        return -1;
+
+    map()->chg_d.tj_reg = code;
+    return max77654_shadow_changed(REG_ADDR_CNFG_CHG_D);
+}
+
+int max77654_charger_set_jeita(const max77654_jeita_t *jeita)
+{
+    int cold = table_code(jeita->cold_C, thm_cold_C);
+    int cool = table_code(jeita->cool_C, thm_cool_C);
+    int warm = table_code(jeita->warm_C, thm_warm_C);
+    int hot = table_code(jeita->hot_C, thm_hot_C);
+    int cc = linear_code(jeita->current_uA, 7500, 7500, 0x27);
+    int cv = linear_code(jeita->voltage_mV, 3600, 25, 0x28);
+
+    if (cold < 0 || cool < 0 || warm < 0 || hot < 0 || cc < 0 || cv < 0)
+        return -1;
+    if (max77654_shadow_fetch(REG_ADDR_CNFG_CHG_A, CNFG_CHG_COUNT) < 0)
+        return -1;
+
+    reg_map_max77654_t *m = map();
+    m->chg_a.thm_cold = cold;
+    m->chg_a.thm_cool = cool;
+    m->chg_a.thm_warm = warm;
+    m->chg_a.thm_hot = hot;
+    m->chg_f.thm_en = jeita->enable;
+    m->chg_f.chg_cc_jeita = cc;
+    m->chg_h.chg_cv_jeita = cv;
+
+    max77654_begin();
+    max77654_shadow_changed(REG_ADDR_CNFG_CHG_A);
+    max77654_shadow_changed(REG_ADDR_CNFG_CHG_F);
+    max77654_shadow_changed(REG_ADDR_CNFG_CHG_H);
+    return max77654_commit();
+}
+
+int max77654_charger_usb_suspend(bool suspend)
+{
+    if (max77654_shadow_fetch(REG_ADDR_CNFG_CHG_G, 1) < 0)
+        return -1;
+
+    map()->chg_g.usbs = suspend;
+    return max77654_shadow_changed(REG_ADDR_CNFG_CHG_G);
+}
+
+int max77654_charger_configure(const max77654_charger_config_t *c)
+{
+    // all or nothing: one bad field must not leave the rest (chg_en among them) half applied
+    if (!config_valid(c) || max77654_shadow_fetch(REG_ADDR_CNFG_CHG_A, CNFG_CHG_COUNT) < 0)
+        return -1;
+
+    // the values are valid and the registers known, the setters only stage their fields
+    max77654_begin();
+    max77654_charger_set_fast_charge_current(c->fast_charge_uA);
+    max77654_charger_set_charge_voltage(c->charge_mV);
+    max77654_charger_set_precharge(c->precharge_mV, c->precharge_percent);
+    max77654_charger_set_termination(c->term_permille, c->topoff_min);
+    max77654_charger_set_timer(c->timer_h);
+    max77654_charger_set_input_limit(c->input_limit_mA, c->input_min_mV);
+    max77654_charger_set_vsys(c->vsys_mV);
+    max77654_charger_set_tj_reg(c->tj_reg_C);
+    max77654_charger_set_jeita(&c->jeita);
+    max77654_charger_enable(c->enable);
+    return max77654_commit();
+}
+
+int max77654_charger_get_config(max77654_charger_config_t *c)
+{
+    if (max77654_shadow_fetch(REG_ADDR_CNFG_CHG_A, CNFG_CHG_COUNT) < 0)
+        return -1;
+
+    const reg_map_max77654_t *m = map();
+    c->enable = m->chg_b.chg_en;
+    c->fast_charge_uA = 7500 + MIN(m->chg_e.chg_cc, 0x27) * 7500;
+    c->charge_mV = 3600 + MIN(m->chg_g.chg_cv, 0x28) * 25;
+    c->precharge_mV = 2300 + m->chg_c.chg_pq * 100;
+    c->precharge_percent = m->chg_b.i_pq ? 20 : 10;
+    c->term_permille = term_permille[m->chg_c.i_term];
+    c->topoff_min = m->chg_c.t_topoff * 5;
+    c->timer_h = timer_h[m->chg_e.t_fast_chg];
+    c->input_limit_mA = 95 + MIN(m->chg_b.ichgin_lim, 4) * 95;
+    c->input_min_mV = 4000 + m->chg_b.vchgin_min * 100;
+    c->vsys_mV = 3300 + MIN(m->chg_d.vsys_reg, 0x1E) * 50;
+    c->tj_reg_C = 60 + MIN(m->chg_d.tj_reg, 4) * 10;
+    c->jeita.enable = m->chg_f.thm_en;
+    c->jeita.cold_C = thm_cold_C[m->chg_a.thm_cold];
+    c->jeita.cool_C = thm_cool_C[m->chg_a.thm_cool];
+    c->jeita.warm_C = thm_warm_C[m->chg_a.thm_warm];
+    c->jeita.hot_C = thm_hot_C[m->chg_a.thm_hot];
+    c->jeita.current_uA = 7500 + MIN(m->chg_f.chg_cc_jeita, 0x27) * 7500;
+    c->jeita.voltage_mV = 3600 + MIN(m->chg_h.chg_cv_jeita, 0x28) * 25;
+    return 0;
+}
+
+
+int max77654_charger_get_status(max77654_charger_status_t *status)
+{
+    uint8_t raw[2];
+
+    uint32_t irq = save_and_disable_interrupts();
+    bool hit = status_valid && !status_volatile
+               && (status_max_age_us == 0 || time_us_64() - status_read_us < status_max_age_us);
+    raw[0] = status_raw[0];
+    raw[1] = status_raw[1];
+    stats.queries++;
+    if (hit)
+        stats.cache_hits++;
+    restore_interrupts(irq);
+
+    if (!hit)
+    {
+        if (max77654_read_regs(REG_ADDR_STAT_CHG_A, raw, 2) < 0)
+            return -1;
+
+        irq = save_and_disable_interrupts();
+        status_raw[0] = raw[0];
+        status_raw[1] = raw[1];
+        status_read_us = time_us_64();
+        status_valid = true;
+        stats.bus_reads++;
+        restore_interrupts(irq);
+    }
+
+    status->raw[0] = raw[0];
+    status->raw[1] = raw[1];
+    status->thermistor = raw[0] & 0x07;
+    status->tj_reg = raw[0] & (1 << 3);
+    status->vsys_min = raw[0] & (1 << 4);
+    status->ichgin_lim = raw[0] & (1 << 5);
+    status->vchgin_min = raw[0] & (1 << 6);
+    status->timer_suspended = raw[1] & (1 << 0);
+    status->charging = raw[1] & (1 << 1);
+    status->chgin = (raw[1] >> 2) & 0x03;
+    status->state = raw[1] >> 4;
+    return 0;
+}
+
+void max77654_charger_set_status_policy(bool volatile_status, uint32_t max_age_us)
+{
+    status_volatile = volatile_status;
+    status_max_age_us = max_age_us;
+}
+
+void max77654_charger_invalidate_status(void)
+{
+    status_valid = false;
+}
+
+void max77654_charger_get_stats(max77654_charger_stats_t *out)
+{
+    uint32_t irq = save_and_disable_interrupts();
+    *out = stats;
+    restore_interrupts(irq);
+}
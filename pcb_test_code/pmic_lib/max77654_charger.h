@@ -0,0 +1,121 @@
+#ifndef __MAX__77654__CHARGER__H__
+
+#define __MAX__77654__CHARGER__H__
+
+#include "pico/stdlib.h"
+
+// Charger block of the MAX77654 (CNFG_CHG_A..CNFG_CHG_H, STAT_CHG_A/B).
+// Settings go through the shadow register map: every setter checks that the value is one the
+// chip can represent (-1 otherwise, nothing is clamped) and only touches its field; inside
+// max77654_begin()/max77654_commit(), or with max77654_charger_configure(), a whole charge
+// profile is one burst. Reading the settings back never uses the bus.
+//
+// The status (STAT_CHG_A/B) is cached: a query only reads the chip when the cache is older than
+// max_age_us, when it was invalidated, or always when the status is marked volatile. With
+// max77654_irq running, every charger interrupt refreshes the cache from the registers the IRQ
+// burst already read, so polling the status costs no bus traffic at all.
+
+// CHG_DTLS
+typedef enum {
+    MAX77654_CHG_OFF = 0,
+    MAX77654_CHG_PREQUAL,
+    MAX77654_CHG_FAST_CC,
+    MAX77654_CHG_FAST_CC_JEITA,
+    MAX77654_CHG_FAST_CV,
+    MAX77654_CHG_FAST_CV_JEITA,
+    MAX77654_CHG_TOPOFF,
+    MAX77654_CHG_TOPOFF_JEITA,
+    MAX77654_CHG_DONE,
+    MAX77654_CHG_DONE_JEITA,
+    MAX77654_CHG_FAULT_PREQUAL_TIMER,
+    MAX77654_CHG_FAULT_FAST_TIMER,
+    MAX77654_CHG_FAULT_BATT_TEMP,
+} max77654_chg_state_t;
+
+// CHGIN_DTLS
+#define MAX77654_CHGIN_UVLO 0x00
+#define MAX77654_CHGIN_OVP 0x01
+#define MAX77654_CHGIN_DEBOUNCE 0x02
+#define MAX77654_CHGIN_OK 0x03
+
+// THM_DTLS
+#define MAX77654_THM_OFF 0x00
+#define MAX77654_THM_COLD 0x01 // below T_COLD
+#define MAX77654_THM_COOL 0x02 // T_COLD..T_COOL
+#define MAX77654_THM_NORMAL 0x03
+#define MAX77654_THM_WARM 0x04 // T_WARM..T_HOT
+#define MAX77654_THM_HOT 0x05  // above T_HOT
+
+typedef struct {
+    max77654_chg_state_t state;
+    uint8_t chgin;      // MAX77654_CHGIN_*
+    uint8_t thermistor; // MAX77654_THM_*
+    bool charging;
+    bool timer_suspended;
+    bool vchgin_min;    // input voltage regulation loop active
+    bool ichgin_lim;    // input current limit active
+    bool vsys_min;      // SYS regulation loop active
+    bool tj_reg;        // die temperature regulation active
+    uint8_t raw[2];     // STAT_CHG_A, STAT_CHG_B
+} max77654_charger_status_t;
+
+// JEITA temperature thresholds, each one of the four values listed
+typedef struct {
+    bool enable;    // thermistor monitoring
+    int8_t cold_C;  // -10, -5, 0, 5
+    int8_t cool_C;  // 15, 10, 5, 0
+    int8_t warm_C;  // 35, 40, 45, 50
+    int8_t hot_C;   // 45, 50, 55, 60
+    uint32_t current_uA;  // fast-charge current between cold..cool and warm..hot
+    uint16_t voltage_mV;  // charge voltage there
+} max77654_jeita_t;
+
+// A complete charge profile for max77654_charger_configure / max77654_charger_get_config
+typedef struct {
+    bool enable;
+    uint32_t fast_charge_uA;     // 7500 .. 300000, 7500 steps
+    uint16_t charge_mV;          // 3600 .. 4600, 25 steps
+    uint16_t precharge_mV;       // 2300 .. 3000, 100 steps, pre-charge below
+    uint8_t precharge_percent;   // 10 or 20, of fast_charge_uA
+    uint16_t term_permille;      // 50, 75, 100 or 150, of fast_charge_uA
+    uint8_t topoff_min;          // 0 .. 35, 5 steps
+    uint8_t timer_h;             // fast-charge safety timer, 0 (off), 3, 5 or 7
+    uint16_t input_limit_mA;     // 95, 190, 285, 380 or 475
+    uint16_t input_min_mV;       // 4000 .. 4700, 100 steps
+    uint16_t vsys_mV;            // 3300 .. 4800, 50 steps
+    uint8_t tj_reg_C;            // 60 .. 100, 10 steps
+    max77654_jeita_t jeita;
+} max77654_charger_config_t;
+
+typedef struct {
+    uint32_t queries;
+    uint32_t cache_hits;
+    uint32_t bus_reads;
+    uint32_t irq_updates; // status refreshed from an nIRQ burst
+} max77654_charger_stats_t;
+
+// loads CNFG_CHG_A..CNFG_CHG_I in one burst and subscribes to the charger interrupts
+int max77654_charger_init(void);
+
+int max77654_charger_configure(const max77654_charger_config_t *config); // one commit, nothing changes if a field is invalid
+int max77654_charger_get_config(max77654_charger_config_t *config);      // from the shadow map
+
+int max77654_charger_enable(bool enable);
+int max77654_charger_set_fast_charge_current(uint32_t uA);
+int max77654_charger_set_charge_voltage(uint16_t mV);
+int max77654_charger_set_precharge(uint16_t threshold_mV, uint8_t percent);
+int max77654_charger_set_termination(uint16_t permille, uint8_t topoff_min);
+int max77654_charger_set_timer(uint8_t hours);
+int max77654_charger_set_input_limit(uint16_t mA, uint16_t min_mV);
+int max77654_charger_set_vsys(uint16_t mV);
+int max77654_charger_set_tj_reg(uint8_t C);
+int max77654_charger_set_jeita(const max77654_jeita_t *jeita);
+int max77654_charger_usb_suspend(bool suspend);
+
+int max77654_charger_get_status(max77654_charger_status_t *status);
+// volatile: every query reads the chip; otherwise the cache is used for up to max_age_us (0 = until invalidated)
+void max77654_charger_set_status_policy(bool volatile_status, uint32_t max_age_us);
+void max77654_charger_invalidate_status(void);
+void max77654_charger_get_stats(max77654_charger_stats_t *stats);
+
+#endif
@@ -0,0 +1,255 @@
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+#include "max77654.h"
+#include "max77654_async.h"
+#include "max77654_dvs.h"
+
+#define N_SSB 3
+#define SSB_CODE_MV 50
+#define LDO_CODE_MV 25
+
+typedef struct {
+    bool active;
+    uint8_t code;   // last code handed to the bus
+    uint8_t target;
+    uint8_t step;   // codes per step
+    uint32_t period_us;
+    uint64_t due_us; // next step
+} dvs_rail_t;
+
+// One burst per register block, the A (voltage) registers of the rails are every other register
+typedef struct {
+    uint8_t first_reg;
+    uint8_t first_rail;
+    uint8_t pending;         // rails with a step waiting for the bus, bit per rail of the block
+    uint8_t stepped;         // rails whose step the burst on the bus carries
+    uint64_t pending_due_us; // deadline of the oldest waiting step
+    max77654_async_req_t req;
+    uint8_t data[2 * N_SSB - 1];
+} dvs_block_t;
+
+static dvs_rail_t rails[MAX77654_DVS_RAILS];
+static dvs_block_t blocks[2] = {
+    {.first_reg = 0x29, .first_rail = 0}, // CNFG_SBB0_A
+    {.first_reg = 0x38, .first_rail = N_SSB}, // CNFG_LDO0_A
+};
+static int alarm_num = -1;
+static max77654_t *dvs_dev; // selected at max77654_dvs_init()
+static max77654_dvs_stats_t stats;
+
+
+static dvs_block_t *block_of(int rail)
+{
+    return rail < N_SSB ? &blocks[0] : &blocks[1];
+}
+
+static uint8_t voltage_reg(int rail)
+{
+    dvs_block_t *b = block_of(rail);
+    return b->first_reg + (rail - b->first_rail) * 2;
+}
+
+static void flush_block(dvs_block_t *b);
+
+// I2C completion, interrupt context
+static void on_written(max77654_async_req_t *req, void *user)
+{
+    dvs_block_t *b = user;
+    int lo = (req->reg - b->first_reg) / 2;
+
+    for (int i = 0; i < N_SSB; i++)
+    {
+        if (!(b->stepped & (1 << i)))
+            continue;
+
+        // only the steps are taken over, the other registers of the burst were written as the chip had them
+        if (req->status == 0)
+            max77654_shadow_put_dev(dvs_dev, b->first_reg + i * 2, &req->data[(i - lo) * 2], 1);
+        if (!rails[b->first_rail + i].active && !(b->pending & (1 << i)))
+            max77654_shadow_own_dev(dvs_dev, b->first_reg + i * 2, false);
+    }
+    if (req->status != 0)
+        stats.bus_errors++;
+
+    // steps that came due while this burst was on the bus
+    flush_block(b);
+}
+
+// Write all waiting steps of a block in one burst, unless its previous burst is still queued
+static void flush_block(dvs_block_t *b)
+{
+    if (b->pending == 0 || b->req.status == MAX77654_ASYNC_PENDING)
+        return;
+
+    int lo = __builtin_ctz(b->pending);
+    int hi = 31 - __builtin_clz(b->pending);
+    uint8_t reg = b->first_reg + lo * 2;
+    uint8_t len = (hi - lo) * 2 + 1;
+
+    // B registers and idle rails in between keep the values the chip has, changes waiting for a commit stay waiting
+    max77654_shadow_get_committed_dev(dvs_dev, reg, b->data, len);
+    b->stepped = 0;
+    for (int i = lo; i <= hi; i++)
+    {
+        dvs_rail_t *r = &rails[b->first_rail + i];
+        if (r->active || (b->pending & (1 << i)))
+        {
+            b->data[(i - lo) * 2] = r->code;
+            b->stepped |= 1 << i;
+        }
+    }
+
+    uint64_t delay = time_us_64() - b->pending_due_us;
+    if (delay > stats.max_delay_us)
+        stats.max_delay_us = delay;
+
+    stats.steps += __builtin_popcount(b->pending);
+    stats.bursts++;
+    b->pending = 0;
+    max77654_async_write_dev(dvs_dev, &b->req, reg, b->data, len, on_written, b);
+}
+
+static uint64_t next_due_us(void)
+{
+    uint64_t due = 0;
+
+    for (int i = 0; i < MAX77654_DVS_RAILS; i++)
+        if (rails[i].active && (due == 0 || rails[i].due_us < due))
+            due = rails[i].due_us;
+    return due;
+}
+
+static void take_due_steps(uint64_t now)
+{
+    for (int i = 0; i < MAX77654_DVS_RAILS; i++)
+    {
+        dvs_rail_t *r = &rails[i];
+        if (!r->active || r->due_us > now)
+            continue;
+
+        dvs_block_t *b = block_of(i);
+        if (b->pending == 0 || r->due_us < b->pending_due_us)
+            b->pending_due_us = r->due_us;
+        b->pending |= 1 << (i - b->first_rail);
+
+        if (r->code < r->target)
+            r->code = r->target - r->code > r->step ? r->code + r->step : r->target;
+        else
+            r->code = r->code - r->target > r->step ? r->code - r->step : r->target;
+
+        // fixed rate, a late step does not push the rest of the ramp out
+        if (r->code == r->target)
+            r->active = false;
+        else
+            r->due_us += r->period_us;
+    }
+
+    for (int i = 0; i < 2; i++)
+    {
+        if (blocks[i].pending && blocks[i].req.status == MAX77654_ASYNC_PENDING)
+            stats.deferred++;
+        flush_block(&blocks[i]);
+    }
+}
+
+// hardware alarm, interrupt context
+static void on_alarm(uint alarm)
+{
+    uint64_t due;
+
+    do
+    {
+        take_due_steps(time_us_64());
+        due = next_due_us();
+    } while (due && hardware_alarm_set_target(alarm, due)); // already passed: take it right away
+}
+
+
+int max77654_dvs_init(void)
+{
+    dvs_dev = max77654_selected();
+    if (alarm_num >= 0)
+        return 0;
+
+    alarm_num = hardware_alarm_claim_unused(false);
+    if (alarm_num < 0)
+        return -1;
+
+    hardware_alarm_set_callback(alarm_num, on_alarm);
+    return 0;
+}
+
+int max77654_dvs_ramp(int rail, int16_t target_mV, uint32_t slew_mV_per_ms, uint8_t step_codes)
+{
+    if (alarm_num < 0 || rail < 0 || rail >= MAX77654_DVS_RAILS || slew_mV_per_ms == 0 || step_codes == 0)
+        return -1;
+
+    bool ssb = rail < N_SSB;
+    dvs_rail_t *r = &rails[rail];
+    dvs_block_t *b = block_of(rail);
+    uint8_t start;
+
+    // an idle rail starts from the chip value, wait for a last step still on the bus to land there
+    if (!r->active)
+        max77654_async_wait(&b->req);
+    max77654_shadow_get_committed_dev(dvs_dev, voltage_reg(rail), &start, 1);
+
+    uint32_t irq = save_and_disable_interrupts();
+
+    if (!r->active && !(b->pending & (1 << (rail - b->first_rail))))
+        r->code = start;
+    r->target = ssb ? calculate_ssb_voltage_reg(target_mV) : calculate_ldo_voltage_reg(target_mV);
+    r->step = step_codes;
+    r->period_us = step_codes * (ssb ? SSB_CODE_MV : LDO_CODE_MV) * 1000 / slew_mV_per_ms;
+    if (r->period_us == 0)
+        r->period_us = 1;
+    r->due_us = time_us_64() + r->period_us;
+    r->active = r->code != r->target;
+    if (r->active)
+        max77654_shadow_own_dev(dvs_dev, voltage_reg(rail), true);
+
+    uint64_t due = next_due_us();
+    if (due && hardware_alarm_set_target(alarm_num, due))
+        on_alarm(alarm_num);
+
+    restore_interrupts(irq);
+    return 0;
+}
+
+void max77654_dvs_cancel(int rail)
+{
+    if (rail < 0 || rail >= MAX77654_DVS_RAILS)
+        return;
+
+    dvs_block_t *b = block_of(rail);
+    uint8_t bit = 1 << (rail - b->first_rail);
+    uint32_t irq = save_and_disable_interrupts();
+    rails[rail].active = false;
+    // otherwise the burst with its last step gives the register back
+    if (!(b->pending & bit) && !(b->req.status == MAX77654_ASYNC_PENDING && (b->stepped & bit)))
+        max77654_shadow_own_dev(dvs_dev, voltage_reg(rail), false);
+    restore_interrupts(irq);
+}
+
+bool max77654_dvs_busy(int rail)
+{
+    for (int i = 0; i < MAX77654_DVS_RAILS; i++)
+    {
+        if (rail >= 0 && i != rail)
+            continue;
+
+        dvs_block_t *b = block_of(i);
+        if (rails[i].active || (b->pending & (1 << (i - b->first_rail))) || b->req.status == MAX77654_ASYNC_PENDING)
+            return true;
+    }
+    return false;
+}
+
+void max77654_dvs_get_stats(max77654_dvs_stats_t *out)
+{
+    uint32_t irq = save_and_disable_interrupts();
+    *out = stats;
+    restore_interrupts(irq);
+}
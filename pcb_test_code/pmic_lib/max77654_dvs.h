@@ -0,0 +1,38 @@
+#ifndef __MAX__77654__DVS__H__
+
+#define __MAX__77654__DVS__H__
+
+#include "pico/stdlib.h"
+
+// Dynamic voltage scaling: ramps a rail to a new voltage in steps of step_codes register codes
+// (50 mV SSB / 25 mV LDO each) spaced so the average slope is slew_mV_per_ms. The steps are
+// issued from one RP2040 hardware alarm through the async queue (max77654_async_init() must
+// have been called), every rail ramps on its own schedule and ramps on several rails run at
+// the same time. Steps of one register block (SSBs, LDOs) that are due on the same alarm go
+// out as one burst; B registers inside the burst are rewritten with the values the chip holds,
+// so changes staged in an open transaction stay pending, and only the steps enter the shadow map.
+// Commits do not extend their bursts over a ramping rail.
+// The first step is due one period after the ramp starts, so the rail never runs ahead of the
+// slope. Do not call SSBx_set_voltage / LDOx_set_voltage on a rail while it is ramping.
+//
+// Rails: 0..2 = SSB0..SSB2, 3..4 = LDO0..LDO1 (same numbering as pmic_protocol)
+
+#define MAX77654_DVS_RAILS 5
+
+typedef struct {
+    uint32_t steps;        // rail steps written
+    uint32_t bursts;       // I2C writes, steps due together share one
+    uint32_t deferred;     // bursts that had to wait for the previous one of their block
+    uint32_t max_delay_us; // longest time from a step's deadline to its submission
+    uint32_t bus_errors;
+} max77654_dvs_stats_t;
+
+int max77654_dvs_init(void); // ramps the selected device, claims a hardware alarm, returns -1 if none is free
+
+// starts a ramp from the current voltage, or from where a running ramp of the rail is
+int max77654_dvs_ramp(int rail, int16_t target_mV, uint32_t slew_mV_per_ms, uint8_t step_codes);
+void max77654_dvs_cancel(int rail); // the rail stays at the last step
+bool max77654_dvs_busy(int rail);   // rail < 0: any rail
+void max77654_dvs_get_stats(max77654_dvs_stats_t *stats);
+
+#endif
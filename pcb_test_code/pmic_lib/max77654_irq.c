@@ -0,0 +1,154 @@
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/i2c.h"
+#include "hardware/sync.h"
+#include "max77654.h"
+#include "max77654_async.h"
+#include "max77654_irq.h"
+
+#define REG_ADDR_INT_GLBL0 0x00
+#define REG_ADDR_INTM_CHG 0x07 // INTM_CHG, INTM_GLBL0, INTM_GLBL1
+#define IRQ_BURST_LEN 6       // INT_GLBL0 .. ERCFLAG
+#define ERCFLAG_EVENTS (0xFFu << (8 * MAX77654_EVT_GROUP_ERCFLAG))
+
+// burst offset of each event group
+static const uint8_t group_offset[4] = {0, 1, 4, 5};
+
+static uint irq_gpio;
+static max77654_t *irq_dev; // selected at max77654_irq_init(), the reads run whatever is selected then
+static uint32_t irq_enabled; // events dispatched, the INT registers latch masked sources too
+static max77654_async_req_t irq_req;
+static uint8_t irq_regs[IRQ_BURST_LEN];
+static uint64_t irq_edge_us;
+static max77654_irq_stats_t irq_stats;
+
+static struct {
+    uint32_t mask;
+    max77654_event_handler_t handler;
+    void *user;
+} handlers[MAX77654_IRQ_MAX_HANDLERS];
+
+
+static void on_read(max77654_async_req_t *req, void *user);
+
+static void start_read(void)
+{
+    irq_stats.reads++;
+    max77654_async_read_dev(irq_dev, &irq_req, REG_ADDR_INT_GLBL0, irq_regs, IRQ_BURST_LEN, on_read, NULL);
+}
+
+static void dispatch(void)
+{
+    max77654_event_t event;
+
+    for (int i = 0; i < IRQ_BURST_LEN; i++)
+        event.regs[i] = irq_regs[i];
+    event.irq_us = irq_edge_us;
+    event.read_us = time_us_64();
+
+    uint32_t latency = (uint32_t)(event.read_us - event.irq_us);
+    if (latency > irq_stats.max_latency_us)
+        irq_stats.max_latency_us = latency;
+
+    for (int group = 0; group < 4; group++)
+    {
+        uint8_t bits = irq_regs[group_offset[group]] & (irq_enabled >> (8 * group));
+
+        while (bits)
+        {
+            int bit = __builtin_ctz(bits);
+            bits &= bits - 1;
+
+            event.type = group * 8 + bit;
+            irq_stats.events++;
+            for (int h = 0; h < MAX77654_IRQ_MAX_HANDLERS; h++)
+                if (handlers[h].handler && (handlers[h].mask & MAX77654_EVT_MASK(event.type)))
+                    handlers[h].handler(&event, handlers[h].user);
+        }
+    }
+}
+
+// I2C completion, interrupt context
+static void on_read(max77654_async_req_t *req, void *user)
+{
+    (void)user;
+
+    if (req->status != 0)
+        irq_stats.bus_errors++;
+    else
+        dispatch();
+
+    // a new event during the read keeps nIRQ low without another edge
+    if (!gpio_get(irq_gpio))
+        start_read();
+}
+
+// GPIO interrupt
+static void on_nirq(uint gpio, uint32_t events)
+{
+    if (gpio != irq_gpio || !(events & GPIO_IRQ_EDGE_FALL))
+        return;
+
+    irq_stats.irqs++;
+    irq_edge_us = time_us_64();
+    if (irq_req.status != MAX77654_ASYNC_PENDING)
+        start_read();
+}
+
+
+int max77654_irq_init(uint gpio, uint32_t enable_mask)
+{
+    // INTM bits: 1 = masked
+    uint8_t intm[3] = {
+        ~(enable_mask >> (8 * MAX77654_EVT_GROUP_CHG)) & 0x7F,
+        ~(enable_mask >> (8 * MAX77654_EVT_GROUP_GLBL0)) & 0xFF,
+        ~(enable_mask >> (8 * MAX77654_EVT_GROUP_GLBL1)) & 0x7F,
+    };
+
+    irq_gpio = gpio;
+    irq_dev = max77654_selected();
+    irq_enabled = enable_mask | ERCFLAG_EVENTS;
+    irq_req.status = 0;
+
+    // clear what is latched already, then unmask
+    if (max77654_read_regs(REG_ADDR_INT_GLBL0, irq_regs, IRQ_BURST_LEN) < 0)
+        return -1;
+    if (max77654_write_regs(REG_ADDR_INTM_CHG, intm, sizeof(intm)) < 0)
+        return -1;
+
+    gpio_init(gpio);
+    gpio_set_dir(gpio, GPIO_IN);
+    gpio_pull_up(gpio);
+    gpio_set_irq_enabled_with_callback(gpio, GPIO_IRQ_EDGE_FALL, true, on_nirq);
+    return 0;
+}
+
+int max77654_irq_add_handler(uint32_t event_mask, max77654_event_handler_t handler, void *user)
+{
+    for (int h = 0; h < MAX77654_IRQ_MAX_HANDLERS; h++)
+    {
+        if (handlers[h].handler == NULL)
+        {
+            handlers[h].mask = event_mask;
+            handlers[h].user = user;
+            __dmb();
+            handlers[h].handler = handler;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+void max77654_irq_remove_handler(max77654_event_handler_t handler)
+{
+    for (int h = 0; h < MAX77654_IRQ_MAX_HANDLERS; h++)
+        if (handlers[h].handler == handler)
+            handlers[h].handler = NULL;
+}
+
+void max77654_irq_get_stats(max77654_irq_stats_t *stats)
+{
+    uint32_t irq = save_and_disable_interrupts();
+    *stats = irq_stats;
+    restore_interrupts(irq);
+}
@@ -0,0 +1,63 @@
+#ifndef __MAX__77654__IRQ__H__
+
+#define __MAX__77654__IRQ__H__
+
+#include "pico/stdlib.h"
+
+// Interrupt driven event handling for the MAX77654 nIRQ line.
+// A falling edge on nIRQ starts one async burst read of INT_GLBL0..ERCFLAG (0x00..0x05), which also
+// clears the latched bits. Every set bit is decoded into an event and passed to the handlers registered
+// for it, from the I2C interrupt. If nIRQ is still low afterwards (a new event arrived during the read)
+// the registers are read again. Needs max77654_async_init() first.
+
+// event = group * 8 + bit, the groups follow the register order of the burst
+#define MAX77654_EVT_GROUP_GLBL0 0   // INT_GLBL0
+#define MAX77654_EVT_GROUP_CHG 1     // INT_CHG
+#define MAX77654_EVT_GROUP_GLBL1 2   // INT_GLBL1
+#define MAX77654_EVT_GROUP_ERCFLAG 3 // ERCFLAG, reset/fault reasons, not an nIRQ source on its own
+
+typedef enum {
+    MAX77654_EVT_GPI0_F = 0, MAX77654_EVT_GPI0_R, MAX77654_EVT_nEN_F, MAX77654_EVT_nEN_R,
+    MAX77654_EVT_TJAL1_R, MAX77654_EVT_TJAL2_R, MAX77654_EVT_DOD1_R, MAX77654_EVT_DOD0_R,
+
+    MAX77654_EVT_THM_I = 8, MAX77654_EVT_CHG_I, MAX77654_EVT_CHGIN_I, MAX77654_EVT_TJ_REG_I,
+    MAX77654_EVT_CHGIN_CTRL_I, MAX77654_EVT_SYS_CTRL_I, MAX77654_EVT_SYS_CNFG_I,
+
+    MAX77654_EVT_GPI1_F = 16, MAX77654_EVT_GPI1_R, MAX77654_EVT_SBB0_F, MAX77654_EVT_SBB1_F,
+    MAX77654_EVT_SBB2_F, MAX77654_EVT_LDO0_F, MAX77654_EVT_LDO1_F,
+
+    MAX77654_EVT_TOVLD = 24, MAX77654_EVT_SYSOVLO, MAX77654_EVT_SYSUVLO, MAX77654_EVT_MRST,
+    MAX77654_EVT_SFT_OFF_F, MAX77654_EVT_SFT_CRST_F, MAX77654_EVT_WDT_OFF, MAX77654_EVT_WDT_RST,
+} max77654_event_type_t;
+
+#define MAX77654_EVT_MASK(evt) (1u << (evt))
+#define MAX77654_EVT_MASK_ALL 0xFFFFFFFFu
+
+typedef struct {
+    max77654_event_type_t type;
+    uint8_t regs[6];   // INT_GLBL0, INT_CHG, STAT_CHG_A, STAT_CHG_B, INT_GLBL1, ERCFLAG as read
+    uint64_t irq_us;   // nIRQ falling edge
+    uint64_t read_us;  // registers read, handlers called
+} max77654_event_t;
+
+typedef void (*max77654_event_handler_t)(const max77654_event_t *event, void *user);
+
+#define MAX77654_IRQ_MAX_HANDLERS 8
+
+// gpio: MCU pin wired to nIRQ (open drain, pulled up here). enable_mask: events to unmask in the INTM registers,
+// only these are dispatched. Bits of the ERCFLAG group are ignored there (always reported when set).
+int max77654_irq_init(uint gpio, uint32_t enable_mask);
+int max77654_irq_add_handler(uint32_t event_mask, max77654_event_handler_t handler, void *user);
+void max77654_irq_remove_handler(max77654_event_handler_t handler);
+
+typedef struct {
+    uint32_t irqs;        // nIRQ edges
+    uint32_t reads;       // burst reads, more than irqs when nIRQ stayed low
+    uint32_t events;      // events dispatched
+    uint32_t bus_errors;
+    uint32_t max_latency_us; // longest edge to dispatch
+} max77654_irq_stats_t;
+
+void max77654_irq_get_stats(max77654_irq_stats_t *stats);
+
+#endif
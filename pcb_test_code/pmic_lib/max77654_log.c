@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "max77654_log.h"
+
+#define RING_MASK (MAX77654_LOG_RING_WORDS - 1)
+
+_Static_assert((MAX77654_LOG_RING_WORDS & RING_MASK) == 0, "MAX77654_LOG_RING_WORDS must be a power of two");
+
+// start and end of the format strings, provided by the linker for the section
+extern const char __start_max77654_log[];
+extern const char __stop_max77654_log[];
+
+// producers: main loop and interrupts of one core, consumer: max77654_log_drain
+static uint32_t ring[MAX77654_LOG_RING_WORDS];
+static volatile uint32_t ring_head;
+static volatile uint32_t ring_tail;
+static uint8_t seq;
+static max77654_log_counters_t counters;
+
+
+void max77654_log_record(const char *fmt, const uint32_t *args, uint32_t nargs)
+{
+    uint32_t irq = save_and_disable_interrupts();
+    uint32_t head = ring_head;
+
+    if (MAX77654_LOG_RING_WORDS - (head - ring_tail) < nargs + 2)
+    {
+        counters.dropped++;
+        seq++;
+        restore_interrupts(irq);
+        return;
+    }
+
+    ring[head++ & RING_MASK] = (uint32_t)(fmt - __start_max77654_log) | (nargs << 16) | ((uint32_t)seq++ << 24);
+    ring[head++ & RING_MASK] = time_us_32();
+    for (uint32_t i = 0; i < nargs; i++)
+        ring[head++ & RING_MASK] = args[i];
+
+    __dmb(); // record visible before the new head
+    ring_head = head;
+    counters.records++;
+    restore_interrupts(irq);
+}
+
+uint32_t max77654_log_drain(max77654_log_write_t write, uint32_t max_len)
+{
+    uint8_t batch[MAX77654_LOG_MAX_BATCH];
+    uint32_t sent = 0;
+
+    max_len = MIN(max_len, sizeof(batch));
+    while (1)
+    {
+        uint32_t tail = ring_tail;
+        uint32_t head = ring_head;
+        uint32_t len = 0;
+        uint32_t records = 0;
+
+        __dmb(); // head was read before the records
+        while (tail != head)
+        {
+            uint32_t words = 2 + ((ring[tail & RING_MASK] >> 16) & 0xFF);
+            if (len + 4 * words > max_len)
+                break;
+
+            for (uint32_t i = 0; i < words; i++, tail++, len += 4)
+            {
+                uint32_t w = ring[tail & RING_MASK];
+                batch[len] = w;
+                batch[len + 1] = w >> 8;
+                batch[len + 2] = w >> 16;
+                batch[len + 3] = w >> 24;
+            }
+            records++;
+        }
+
+        if (records == 0 || write(batch, len) < len)
+            break;
+
+        __dmb(); // finish reading before the space is handed back
+        ring_tail = tail;
+        sent += records;
+    }
+    return sent;
+}
+
+void max77654_log_get_counters(max77654_log_counters_t *out)
+{
+    uint32_t irq = save_and_disable_interrupts();
+    *out = counters;
+    restore_interrupts(irq);
+}
+
+const char *max77654_log_format(uint16_t id)
+{
+    if (id >= __stop_max77654_log - __start_max77654_log)
+        return NULL;
+    return &__start_max77654_log[id];
+}
+
+// formats every record of a batch, always accepts it
+static uint32_t print_batch(const uint8_t *data, uint32_t len)
+{
+    uint32_t words[2 + MAX77654_LOG_MAX_ARGS];
+
+    for (uint32_t pos = 0; pos < len; )
+    {
+        uint32_t nargs = data[pos + 2];
+        for (uint32_t i = 0; i < 2 + nargs; i++, pos += 4)
+            words[i] = data[pos] | (data[pos + 1] << 8) | (data[pos + 2] << 16) | ((uint32_t)data[pos + 3] << 24);
+        for (uint32_t i = 2 + nargs; i < 2 + MAX77654_LOG_MAX_ARGS; i++)
+            words[i] = 0;
+
+        const char *fmt = max77654_log_format(words[0] & 0xFFFF);
+        if (fmt)
+            printf(fmt, words[2], words[3], words[4], words[5], words[6], words[7]);
+        printf("\n");
+    }
+    return len;
+}
+
+uint32_t max77654_log_print(void)
+{
+    return max77654_log_drain(print_batch, MAX77654_LOG_MAX_BATCH);
+}
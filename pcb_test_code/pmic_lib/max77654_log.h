@@ -0,0 +1,61 @@
+#ifndef __MAX__77654__LOG__H__
+
+#define __MAX__77654__LOG__H__
+
+#include "pico/stdlib.h"
+
+// Deferred binary logging. A call site does not format anything: MAX77654_LOG() stores the id of its format
+// string and the raw 32-bit arguments in a word ring, max77654_log_drain() hands whole records to a writer
+// from the main loop and the host rebuilds the text.
+//
+// The format strings ("[file:line] " prefix included, concatenated by the compiler) are collected in the
+// section max77654_log, the id of a string is its offset there. The section dumped from the ELF after the
+// build (max77654_log_table() in pmic_lib/CMakeLists.txt) is the decoder's table, see app/pmic_ctrl.py.
+// Arguments are integers only, up to MAX77654_LOG_MAX_ARGS, formatted on the host with the usual %d %u %x.
+//
+// Record, little endian 32-bit words: [id u16 | nargs u8 | seq u8][timestamp_us][nargs arguments]
+// seq counts records, a gap means records were dropped because the ring was full.
+// Producers are the main loop and interrupt handlers of one core.
+
+#define MAX77654_LOG_RING_WORDS 512 // power of two
+#define MAX77654_LOG_MAX_ARGS 6
+#define MAX77654_LOG_MAX_BATCH 256 // bytes, at least one record of MAX77654_LOG_MAX_ARGS (32 bytes)
+#define MAX77654_LOG_SECTION "max77654_log"
+
+#ifdef __FILE_NAME__
+#define MAX77654_LOG_FILE __FILE_NAME__
+#else
+#define MAX77654_LOG_FILE __FILE__
+#endif
+#define MAX77654_LOG_STR2(x) #x
+#define MAX77654_LOG_STR(x) MAX77654_LOG_STR2(x)
+
+#define MAX77654_LOG(fmt, ...) do { \
+        static const char __attribute__((section(MAX77654_LOG_SECTION), used)) log_fmt_[] = \
+            "[" MAX77654_LOG_FILE ":" MAX77654_LOG_STR(__LINE__) "] " fmt; \
+        const uint32_t log_args_[] = {0, ##__VA_ARGS__}; \
+        _Static_assert(sizeof(log_args_) / 4 - 1 <= MAX77654_LOG_MAX_ARGS, "too many log arguments"); \
+        max77654_log_record(log_fmt_, &log_args_[1], sizeof(log_args_) / 4 - 1); \
+    } while (0)
+
+typedef struct {
+    uint32_t records; // stored in the ring
+    uint32_t dropped; // lost, the ring was full
+} max77654_log_counters_t;
+
+// returns the writer's accepted byte count, records are only taken out of the ring when the whole batch was accepted
+typedef uint32_t (*max77654_log_write_t)(const uint8_t *data, uint32_t len);
+
+void max77654_log_record(const char *fmt, const uint32_t *args, uint32_t nargs);
+
+// hand queued records to write in batches of whole records, at most max_len (<= MAX77654_LOG_MAX_BATCH) bytes each,
+// until it stops accepting; returns the number of records sent
+uint32_t max77654_log_drain(max77654_log_write_t write, uint32_t max_len);
+void max77654_log_get_counters(max77654_log_counters_t *counters);
+
+// the format string of an id, for decoding on the device itself, NULL for an unknown id
+const char *max77654_log_format(uint16_t id);
+// drains the ring through printf, for applications without the host decoder; returns the number of records printed
+uint32_t max77654_log_print(void);
+
+#endif
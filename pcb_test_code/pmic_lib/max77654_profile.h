@@ -0,0 +1,58 @@
+#ifndef __MAX__77654__PROFILE__H__
+
+#define __MAX__77654__PROFILE__H__
+
+#include <stdint.h>
+
+// A rail profile is the finished register image of the SBB (0x29..0x2E) and LDO (0x38..0x3B) blocks.
+// It is built by the compiler from the macros below, every argument is range checked at compile time,
+// an out of range value is a build error (negative array size) instead of being clamped at runtime.
+// max77654_apply_profile() writes it with one auto-increment burst per block, no arithmetic at boot.
+//
+//  static const max77654_profile_t profile = MAX77654_PROFILE(
+//      MAX77654_SBB(3300, true, MAX77654_SBB_IPK_330MA, MAX77654_SBB_MODE_BUCK_BOOST, false), // SBB0
+//      ...
+//      MAX77654_LDO(1200, true, LDO_MODE_LDO, false));                                        // LDO1
+
+typedef struct {
+    uint8_t sbb[6]; // CNFG_SBB0_A .. CNFG_SBB2_B
+    uint8_t ldo[4]; // CNFG_LDO0_A .. CNFG_LDO1_B
+} max77654_profile_t;
+
+#define MAX77654_SBB_IPK_1000MA 0x00
+#define MAX77654_SBB_IPK_750MA 0x01
+#define MAX77654_SBB_IPK_500MA 0x02
+#define MAX77654_SBB_IPK_330MA 0x03
+
+#define MAX77654_SBB_MODE_BUCK_BOOST 0x00
+#define MAX77654_SBB_MODE_BUCK 0x01
+
+// 0 if cond holds, otherwise the build fails
+#define MAX77654_PROFILE_CHECK(cond) (0 * sizeof(char[(cond) ? 1 : -1]))
+
+// 0.8V .. 5.5V in 50mV steps
+#define MAX77654_SBB_MV(mv) \
+    ((uint8_t)(((mv) - 800) / 50 + MAX77654_PROFILE_CHECK((mv) >= 800 && (mv) <= 5500 && ((mv) - 800) % 50 == 0)))
+
+// 0.8V .. 3.975V in 25mV steps
+#define MAX77654_LDO_MV(mv) \
+    ((uint8_t)(((mv) - 800) / 25 + MAX77654_PROFILE_CHECK((mv) >= 800 && (mv) <= 3975 && ((mv) - 800) % 25 == 0)))
+
+#define MAX77654_RAIL_EN(on) ((on) ? 0x07 : 0x04) // on / off irrespective of FPS
+
+// CNFG_SBBx_A, CNFG_SBBx_B
+#define MAX77654_SBB(mv, on, ipk, mode, discharge) \
+    MAX77654_SBB_MV(mv), \
+    ((uint8_t)((MAX77654_RAIL_EN(on) | ((discharge) ? 0x08 : 0x00) | ((ipk) << 4) | ((mode) << 6)) \
+               + MAX77654_PROFILE_CHECK((ipk) >= 0 && (ipk) <= 3 && ((mode) == 0 || (mode) == 1))))
+
+// CNFG_LDOx_A, CNFG_LDOx_B, mode is LDO_MODE_LDO or LDO_MODE_LSW
+#define MAX77654_LDO(mv, on, mode, discharge) \
+    MAX77654_LDO_MV(mv), \
+    ((uint8_t)((MAX77654_RAIL_EN(on) | ((discharge) ? 0x08 : 0x00) | ((mode) << 4)) \
+               + MAX77654_PROFILE_CHECK((mode) == 0 || (mode) == 1)))
+
+#define MAX77654_PROFILE(sbb0, sbb1, sbb2, ldo0, ldo1) \
+    { .sbb = { sbb0, sbb1, sbb2 }, .ldo = { ldo0, ldo1 } }
+
+#endif
@@ -0,0 +1,189 @@
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "hardware/timer.h"
+#include "max77654.h"
+#include "max77654_seq.h"
+
+#define N_SSB 3
+#define NOT_YET UINT64_MAX
+
+
+// Checks the rails and dependencies and rejects cycles (Kahn's algorithm on the rail masks)
+static bool graph_ok(const max77654_seq_step_t *steps, int n)
+{
+    uint32_t listed = 0;
+
+    for (int i = 0; i < n; i++)
+    {
+        if (steps[i].rail >= MAX77654_SEQ_RAILS || (listed & MAX77654_SEQ_RAIL(steps[i].rail)))
+            return false;
+        listed |= MAX77654_SEQ_RAIL(steps[i].rail);
+    }
+
+    uint32_t done = 0;
+    for (int round = 0; round < n; round++)
+    {
+        uint32_t before = done;
+        for (int i = 0; i < n; i++)
+        {
+            if (steps[i].depends_on & ~listed)
+                return false;
+            if ((steps[i].depends_on & done) == steps[i].depends_on)
+                done |= MAX77654_SEQ_RAIL(steps[i].rail);
+        }
+        if (done == listed)
+            return true;
+        if (done == before)
+            return false; // the rest waits on each other
+    }
+    return done == listed;
+}
+
+static int rail_enable(int rail, bool on)
+{
+    return rail < N_SSB ? SSBx_enable(rail, on) : LDOx_enable(rail - N_SSB, on);
+}
+
+// Shared by power up and down. up: a step waits for its dependencies, down: for its dependents.
+static int run(const max77654_seq_step_t *steps, int n, bool up, max77654_seq_result_t *result)
+{
+    uint64_t switched[MAX77654_SEQ_RAILS]; // time the enable/disable write finished
+    uint64_t ready[MAX77654_SEQ_RAILS];    // time the rail counted as up / off
+    bool batch[MAX77654_SEQ_RAILS];        // switched in the current commit
+    max77654_seq_result_t res = {.failed_rail = -1};
+    int ret = 0;
+
+    if (!graph_ok(steps, n))
+        ret = MAX77654_SEQ_ERR_GRAPH;
+
+    for (int i = 0; i < MAX77654_SEQ_RAILS; i++)
+        switched[i] = ready[i] = NOT_YET;
+
+    uint64_t start = time_us_64();
+    int remaining = ret == 0 ? n : 0;
+
+    while (remaining > 0)
+    {
+        uint64_t now = time_us_64();
+        uint64_t next = NOT_YET;
+        int count = 0;
+
+        // rails that were switched and are now settled (power down: off right away)
+        for (int i = 0; i < n; i++)
+        {
+            const max77654_seq_step_t *s = &steps[i];
+            if (switched[s->rail] == NOT_YET || ready[s->rail] != NOT_YET)
+                continue;
+
+            uint64_t settled = switched[s->rail] + (up ? s->settle_us : 0);
+            if (now < settled)
+            {
+                next = MIN(next, settled);
+            }
+            else if (!up || s->power_good == NULL || s->power_good(s->rail, s->user))
+            {
+                ready[s->rail] = s->power_good ? now : settled;
+                remaining--;
+            }
+            else if (now >= settled + s->pg_timeout_us)
+            {
+                res.failed_rail = s->rail;
+                ret = MAX77654_SEQ_ERR_POWER_GOOD;
+                break;
+            }
+            else
+            {
+                next = MIN(next, now + MAX77654_SEQ_POLL_US);
+            }
+        }
+        if (ret != 0)
+            break;
+
+        // switch every rail whose predecessors are done long enough, in one commit
+        max77654_begin();
+        for (int i = 0; i < n; i++)
+        {
+            const max77654_seq_step_t *s = &steps[i];
+            batch[s->rail] = false;
+            if (switched[s->rail] != NOT_YET)
+                continue;
+
+            uint64_t due = 0;
+            bool has_pred = false;
+            bool waiting = false;
+            for (int j = 0; j < n; j++)
+            {
+                // up: j is a dependency of i, down: i is a dependency of j
+                const max77654_seq_step_t *pred = up ? &steps[j] : s;
+                const max77654_seq_step_t *succ = up ? s : &steps[j];
+                if (j == i || !(succ->depends_on & MAX77654_SEQ_RAIL(pred->rail)))
+                    continue;
+
+                has_pred = true;
+                if (ready[steps[j].rail] == NOT_YET)
+                    waiting = true;
+                else
+                    due = MAX(due, ready[steps[j].rail] + succ->delay_us);
+            }
+            // a rail nothing has to wait for is delayed from the start of the sequence
+            if (!has_pred)
+                due = start + (up ? s->delay_us : 0);
+            if (waiting)
+                continue;
+
+            if (now >= due)
+            {
+                rail_enable(s->rail, up);
+                batch[s->rail] = true;
+                count++;
+            }
+            else
+            {
+                next = MIN(next, due);
+            }
+        }
+        if (max77654_commit() < 0)
+        {
+            ret = MAX77654_SEQ_ERR_BUS;
+            break;
+        }
+
+        if (count > 0)
+        {
+            uint64_t done = time_us_64();
+            for (int i = 0; i < n; i++)
+                if (batch[steps[i].rail])
+                    switched[steps[i].rail] = done;
+            res.commits++;
+            continue; // rails without settle time are ready right away
+        }
+
+        if (next != NOT_YET)
+            busy_wait_until(next);
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        int rail = steps[i].rail;
+        if (switched[rail] != NOT_YET)
+            res.on_us[rail] = switched[rail] - start;
+        if (ready[rail] != NOT_YET)
+            res.up_us[rail] = ready[rail] - start;
+    }
+    res.total_us = time_us_64() - start;
+
+    if (result)
+        *result = res;
+    return ret;
+}
+
+
+int max77654_seq_power_up(const max77654_seq_step_t *steps, int n, max77654_seq_result_t *result)
+{
+    return run(steps, n, true, result);
+}
+
+int max77654_seq_power_down(const max77654_seq_step_t *steps, int n, max77654_seq_result_t *result)
+{
+    return run(steps, n, false, result);
+}
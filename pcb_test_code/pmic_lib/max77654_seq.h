@@ -0,0 +1,49 @@
+#ifndef __MAX__77654__SEQ__H__
+
+#define __MAX__77654__SEQ__H__
+
+#include "pico/stdlib.h"
+
+// Power sequencing from a dependency graph. Every step names a rail, the rails it depends on
+// and the minimum delay after the last of them is up. A rail counts as up settle_us after its
+// enable write, and once the optional power_good callback agrees. All rails that become ready
+// at the same time are enabled in one commit, so independent rails share a burst.
+// Power down runs the graph backwards: a rail is switched off delay_us after the last rail that
+// depends on it was switched off. Voltages are not touched, set them (or a profile) beforehand.
+//
+// Rails: 0..2 = SSB0..SSB2, 3..4 = LDO0..LDO1 (same numbering as pmic_protocol)
+
+#define MAX77654_SEQ_RAILS 5
+#define MAX77654_SEQ_RAIL(rail) (1u << (rail))
+#define MAX77654_SEQ_POLL_US 50 // power_good polling interval
+
+#define MAX77654_SEQ_ERR_GRAPH -1      // unknown rail, rail listed twice, dependency not in the list or a cycle
+#define MAX77654_SEQ_ERR_BUS -2
+#define MAX77654_SEQ_ERR_POWER_GOOD -3 // power_good did not agree within pg_timeout_us
+
+typedef bool (*max77654_seq_pg_t)(int rail, void *user);
+
+typedef struct {
+    uint8_t rail;
+    uint8_t depends_on;        // MAX77654_SEQ_RAIL() mask
+    uint32_t delay_us;         // after the last dependency is up (power down: after the last dependent is off)
+    uint32_t settle_us;        // after the enable write until the rail can be used
+    max77654_seq_pg_t power_good; // optional, polled after settle_us
+    void *user;
+    uint32_t pg_timeout_us;
+} max77654_seq_step_t;
+
+typedef struct {
+    uint32_t on_us[MAX77654_SEQ_RAILS]; // enable (power down: disable) written, from the start of the sequence
+    uint32_t up_us[MAX77654_SEQ_RAILS]; // rail counted as up
+    uint32_t total_us;
+    uint32_t commits; // rails switched together share one
+    int failed_rail; // -1 or the rail that failed
+} max77654_seq_result_t;
+
+// both return 0 or a MAX77654_SEQ_ERR_* code, result is optional
+// a failed power up leaves the rails that were already enabled on
+int max77654_seq_power_up(const max77654_seq_step_t *steps, int n, max77654_seq_result_t *result);
+int max77654_seq_power_down(const max77654_seq_step_t *steps, int n, max77654_seq_result_t *result);
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef __MAX__77654__SHADOW__H__
+
+#define __MAX__77654__SHADOW__H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "max77654_types.h"
+
+// Shadow register map access for the other parts of pmic_lib (charger, ...), not for applications.
+// Change fields in the map, then call max77654_shadow_changed() with the register, it is written
+// with the next commit (right away outside of max77654_begin()/max77654_commit()).
+
+reg_map_max77654_t *max77654_shadow_map(void);
+
+// reads the registers of reg..reg+len-1 whose shadow value is not known yet, in one burst
+int max77654_shadow_fetch(uint8_t reg, size_t len);
+
+int max77654_shadow_changed(uint8_t reg);
+
+#endif
@@ -0,0 +1,239 @@
+#include "pico/stdlib.h"
+#include "max77654.h"
+#include "max77654_shadow.h"
+#include "max77654_snapshot.h"
+#include <string.h>
+
+#define REG_ADDR_SHADOW_FIRST 0x20 // CNFG_CHG_A, bit 0 of the shadow dirty/valid masks
+#define SHADOW_BIT(reg) (1u << ((reg) - REG_ADDR_SHADOW_FIRST))
+
+typedef struct {
+    uint8_t first;
+    uint8_t count;
+} block_t;
+
+// Readable registers, one burst each. The gaps are the clear-on-read interrupt registers (0x00, 0x01,
+// 0x04, 0x05) and unused addresses that cost more as a new transaction than as bytes read through.
+static const block_t all_blocks[] = {
+    {0x02, 2},  // STAT_CHG_A, STAT_CHG_B
+    {0x06, 4},  // STAT_GLBL, INTM_CHG, INTM_GLBL0, INTM_GLBL1
+    {0x10, 8},  // CNFG_GLBL, CNFG_GPIO0..2, CID, CNFG_WDT (0x17)
+    {0x20, 16}, // CNFG_CHG_A..CNFG_CHG_I, CNFG_SBB0_A..CNFG_SBB2_B, CNFG_SBB_TOP
+    {0x38, 4},  // CNFG_LDO0_A..CNFG_LDO1_B
+};
+
+// the shadowed registers
+static const block_t config_blocks[] = {
+    {0x20, 15}, // CNFG_CHG_A..CNFG_SBB2_B
+    {0x38, 4},  // CNFG_LDO0_A..CNFG_LDO1_B
+};
+
+// Fields of the shadowed registers, reserved bits are left out
+static const struct {
+    uint8_t reg;
+    uint8_t mask;
+    const char *name;
+} fields[] = {
+    {0x20, 0x03, "THM_COLD"}, {0x20, 0x0C, "THM_COOL"}, {0x20, 0x30, "THM_WARM"}, {0x20, 0xC0, "THM_HOT"},
+    {0x21, 0x01, "CHG_EN"}, {0x21, 0x02, "I_PQ"}, {0x21, 0x1C, "ICHGIN_LIM"}, {0x21, 0xE0, "VCHGIN_MIN"},
+    {0x22, 0x07, "T_TOPOFF"}, {0x22, 0x18, "I_TERM"}, {0x22, 0xE0, "CHG_PQ"},
+    {0x23, 0x1F, "VSYS_REG"}, {0x23, 0xE0, "TJ_REG"},
+    {0x24, 0x03, "T_FAST_CHG"}, {0x24, 0xFC, "CHG_CC"},
+    {0x25, 0x02, "THM_EN"}, {0x25, 0xFC, "CHG_CC_JEITA"},
+    {0x26, 0x02, "USBS"}, {0x26, 0xFC, "CHG_CV"},
+    {0x27, 0xFC, "CHG_CV_JEITA"},
+    {0x28, 0x0F, "MUX_SEL"}, {0x28, 0xF0, "IMON_DISCHG_SCALE"},
+    {0x29, 0x7F, "SBB0_TV"}, {0x2A, 0x07, "SBB0_EN"}, {0x2A, 0x08, "SBB0_ADE"}, {0x2A, 0x30, "SBB0_IP"}, {0x2A, 0x40, "SBB0_OP_MODE"},
+    {0x2B, 0x7F, "SBB1_TV"}, {0x2C, 0x07, "SBB1_EN"}, {0x2C, 0x08, "SBB1_ADE"}, {0x2C, 0x30, "SBB1_IP"}, {0x2C, 0x40, "SBB1_OP_MODE"},
+    {0x2D, 0x7F, "SBB2_TV"}, {0x2E, 0x07, "SBB2_EN"}, {0x2E, 0x08, "SBB2_ADE"}, {0x2E, 0x30, "SBB2_IP"}, {0x2E, 0x40, "SBB2_OP_MODE"},
+    {0x38, 0x7F, "LDO0_TV"}, {0x39, 0x07, "LDO0_EN"}, {0x39, 0x08, "LDO0_ADE"}, {0x39, 0x10, "LDO0_MD"},
+    {0x3A, 0x7F, "LDO1_TV"}, {0x3B, 0x07, "LDO1_EN"}, {0x3B, 0x08, "LDO1_ADE"}, {0x3B, 0x10, "LDO1_MD"},
+};
+
+#define FIELD_COUNT (sizeof(fields) / sizeof(fields[0]))
+
+static max77654_resync_t policy = MAX77654_RESYNC_REPORT;
+static uint32_t verify_period_us;
+static uint64_t next_verify_us;
+static max77654_snapshot_stats_t stats;
+
+
+static int read_blocks(max77654_snapshot_t *snap, const block_t *blocks, int count)
+{
+    int ret = 0;
+
+    snap->valid = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (max77654_read_regs(blocks[i].first, &snap->regs[blocks[i].first], blocks[i].count) < 0)
+        {
+            ret = -1;
+            continue;
+        }
+        snap->valid |= (MAX77654_SNAPSHOT_BIT(blocks[i].count) - 1) << blocks[i].first;
+    }
+    snap->time_us = time_us_64();
+    return ret;
+}
+
+int max77654_snapshot(max77654_snapshot_t *snap)
+{
+    return read_blocks(snap, all_blocks, sizeof(all_blocks) / sizeof(all_blocks[0]));
+}
+
+int max77654_snapshot_config(max77654_snapshot_t *snap)
+{
+    return read_blocks(snap, config_blocks, sizeof(config_blocks) / sizeof(config_blocks[0]));
+}
+
+static uint8_t field_value(uint8_t value, uint8_t mask)
+{
+    return (value & mask) >> __builtin_ctz(mask);
+}
+
+int max77654_diff(const max77654_snapshot_t *snap, max77654_drift_t *drifts, int max_drifts)
+{
+    const max77654_t *dev = max77654_selected();
+    int count = 0;
+    uint8_t shadow = 0;
+    int shadow_reg = -1;
+
+    for (unsigned int i = 0; i < FIELD_COUNT; i++)
+    {
+        uint8_t reg = fields[i].reg;
+
+        if (!(snap->valid & MAX77654_SNAPSHOT_BIT(reg)))
+            continue;
+        // unknown to the shadow, or changed on the MCU and not written yet
+        if (!(dev->shadow_valid & SHADOW_BIT(reg)) || (dev->shadow_dirty & SHADOW_BIT(reg)))
+            continue;
+
+        if (reg != shadow_reg)
+        {
+            max77654_shadow_get(reg, &shadow, 1);
+            shadow_reg = reg;
+        }
+
+        uint8_t mask = fields[i].mask;
+        if (((snap->regs[reg] ^ shadow) & mask) == 0)
+            continue;
+
+        if (drifts && count < max_drifts)
+        {
+            drifts[count].reg = reg;
+            drifts[count].mask = mask;
+            drifts[count].chip = field_value(snap->regs[reg], mask);
+            drifts[count].shadow = field_value(shadow, mask);
+            drifts[count].name = fields[i].name;
+        }
+        count++;
+    }
+    return count;
+}
+
+void max77654_set_resync_policy(max77654_resync_t p)
+{
+    policy = p;
+}
+
+// Restores or adopts every register with a drifted field, returns the number of registers
+static int resync(const max77654_snapshot_t *snap)
+{
+    uint32_t drifted = 0;
+    uint8_t shadow;
+    int count = 0;
+
+    for (unsigned int i = 0; i < FIELD_COUNT; i++)
+    {
+        uint8_t reg = fields[i].reg;
+        if (!(snap->valid & MAX77654_SNAPSHOT_BIT(reg)) || (drifted & SHADOW_BIT(reg)))
+            continue;
+
+        const max77654_t *dev = max77654_selected();
+        if (!(dev->shadow_valid & SHADOW_BIT(reg)) || (dev->shadow_dirty & SHADOW_BIT(reg)))
+            continue;
+
+        max77654_shadow_get(reg, &shadow, 1);
+        if ((snap->regs[reg] ^ shadow) & fields[i].mask)
+        {
+            drifted |= SHADOW_BIT(reg);
+            count++;
+        }
+    }
+    if (drifted == 0)
+        return 0;
+
+    if (policy == MAX77654_RESYNC_ADOPT)
+    {
+        for (uint8_t reg = REG_ADDR_SHADOW_FIRST; reg < MAX77654_SNAPSHOT_REGS; reg++)
+            if (drifted & SHADOW_BIT(reg))
+                max77654_shadow_put(reg, &snap->regs[reg], 1);
+        return count;
+    }
+
+    // one commit, neighbouring registers share a burst
+    max77654_begin();
+    for (uint8_t reg = REG_ADDR_SHADOW_FIRST; reg < MAX77654_SNAPSHOT_REGS; reg++)
+        if (drifted & SHADOW_BIT(reg))
+            max77654_shadow_changed(reg);
+    return max77654_commit() < 0 ? -1 : count;
+}
+
+int max77654_verify(max77654_drift_t *drifts, int max_drifts)
+{
+    max77654_snapshot_t snap;
+
+    if (max77654_snapshot_config(&snap) < 0)
+    {
+        stats.bus_errors++;
+        return -1;
+    }
+
+    stats.checks++;
+    int count = max77654_diff(&snap, drifts, max_drifts);
+    if (count == 0)
+        return 0;
+
+    stats.drifts++;
+    stats.fields += count;
+    stats.last_drift_us = snap.time_us;
+
+    if (policy != MAX77654_RESYNC_REPORT)
+    {
+        int regs = resync(&snap);
+        if (regs < 0)
+        {
+            stats.bus_errors++;
+            return -1;
+        }
+        stats.resyncs += regs;
+    }
+    return count;
+}
+
+void max77654_set_verify_period(uint32_t period_us)
+{
+    verify_period_us = period_us;
+    next_verify_us = time_us_64() + period_us;
+}
+
+int max77654_verify_task(void)
+{
+    if (verify_period_us == 0 || time_us_64() < next_verify_us)
+        return 0;
+
+    next_verify_us += verify_period_us;
+    if (next_verify_us <= time_us_64())
+        next_verify_us = time_us_64() + verify_period_us; // fell behind, don't catch up in a burst
+    return max77654_verify(NULL, 0);
+}
+
+void max77654_snapshot_get_stats(max77654_snapshot_stats_t *s)
+{
+    *s = stats;
+}
+
+void max77654_snapshot_reset_stats(void)
+{
+    memset(&stats, 0, sizeof(stats));
+}
@@ -0,0 +1,71 @@
+#ifndef __MAX__77654__SNAPSHOT__H__
+
+#define __MAX__77654__SNAPSHOT__H__
+
+#include "pico/stdlib.h"
+
+// Register snapshots of the selected MAX77654 and drift detection against the shadow register map.
+// A snapshot reads whole register blocks with one auto-increment burst each, never a transaction per
+// register: max77654_snapshot() covers the readable register space in 5 bursts, the clear-on-read
+// interrupt registers (INT_GLBL0/1, INT_CHG, ERCFLAG) are left to max77654_irq. The configuration
+// snapshot is only the shadowed registers, 0x20..0x2E and 0x38..0x3B in 2 bursts, about 25 bytes on
+// the bus, cheap enough to check every control period.
+//
+// max77654_diff() compares a snapshot with the shadow map field by field, reserved bits never count.
+// Registers the shadow does not know yet and registers with uncommitted changes are skipped.
+// max77654_verify() takes a configuration snapshot, diffs it and resyncs by the policy: RESTORE writes
+// the shadow values back (a brown-out or watchdog reset of the PMIC lost them), ADOPT takes the chip
+// values into the shadow map (something else on the bus owns the setting). Drifted registers are
+// restored in one commit, so they go out in as few bursts as the shadow map allows.
+
+#define MAX77654_SNAPSHOT_REGS 0x3C // 0x00 .. CNFG_LDO1_B
+#define MAX77654_SNAPSHOT_BIT(reg) (1ull << (reg))
+
+typedef struct {
+    uint8_t regs[MAX77654_SNAPSHOT_REGS];
+    uint64_t valid;   // MAX77654_SNAPSHOT_BIT of the registers that were read
+    uint64_t time_us; // end of the last burst
+} max77654_snapshot_t;
+
+// one drifted field
+typedef struct {
+    uint8_t reg;
+    uint8_t mask;       // bits of the field in the register
+    uint8_t chip;       // field value in the snapshot, shifted down
+    uint8_t shadow;     // field value the shadow map expects, shifted down
+    const char *name;   // e.g. "SBB1_TV"
+} max77654_drift_t;
+
+typedef enum {
+    MAX77654_RESYNC_REPORT = 0, // only report the drift
+    MAX77654_RESYNC_RESTORE,    // write the shadow values back to the chip
+    MAX77654_RESYNC_ADOPT,      // load the chip values into the shadow map
+} max77654_resync_t;
+
+typedef struct {
+    uint32_t checks;      // configuration snapshots compared
+    uint32_t drifts;      // checks that found at least one drifted field
+    uint32_t fields;      // drifted fields over all checks
+    uint32_t resyncs;     // registers restored or adopted
+    uint32_t bus_errors;
+    uint64_t last_drift_us;
+} max77654_snapshot_stats_t;
+
+// 0, or -1 if a burst failed (the registers of the bursts that worked are still valid)
+int max77654_snapshot(max77654_snapshot_t *snap);
+int max77654_snapshot_config(max77654_snapshot_t *snap);
+
+// drifted fields of snap, the first max_drifts are stored in drifts (may be NULL)
+int max77654_diff(const max77654_snapshot_t *snap, max77654_drift_t *drifts, int max_drifts);
+
+void max77654_set_resync_policy(max77654_resync_t policy);
+// configuration snapshot, diff and resync; returns the number of drifted fields or -1 on a bus error
+int max77654_verify(max77654_drift_t *drifts, int max_drifts);
+// for the main loop: max77654_verify() once every period_us (0 = never), returns its result or 0
+void max77654_set_verify_period(uint32_t period_us);
+int max77654_verify_task(void);
+
+void max77654_snapshot_get_stats(max77654_snapshot_stats_t *stats);
+void max77654_snapshot_reset_stats(void);
+
+#endif
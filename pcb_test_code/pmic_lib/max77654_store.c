@@ -0,0 +1,174 @@
+#include "pico/stdlib.h"
+#include "max77654.h"
+#include "max77654_store.h"
+#include "max77654_boot.h"
+#include "max77654_store_port.h"
+#include <stddef.h>
+#include <string.h>
+
+#define STORE_MAGIC 0x52504D50 // "PMPR"
+#define SLOTS (MAX77654_STORE_SECTORS * MAX77654_STORE_SECTOR_SIZE / MAX77654_STORE_SLOT_SIZE)
+#define SLOTS_PER_SECTOR (MAX77654_STORE_SECTOR_SIZE / MAX77654_STORE_SLOT_SIZE)
+
+#define SBB_TV_MAX 0x5E // 5.5V
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t len;
+    uint32_t seq;
+    uint8_t profile[16];
+    uint32_t crc;
+} record_t;
+
+_Static_assert(sizeof(record_t) == MAX77654_STORE_SLOT_SIZE, "record_t");
+_Static_assert(sizeof(max77654_profile_t) <= sizeof(((record_t *)0)->profile), "profile does not fit a slot");
+_Static_assert(MAX77654_STORE_PAGE_SIZE % MAX77654_STORE_SLOT_SIZE == 0, "slots must not cross pages");
+
+
+static uint32_t crc32(const uint8_t *data, uint32_t len)
+{
+    uint32_t crc = 0xFFFFFFFF;
+
+    while (len--)
+    {
+        crc ^= *data++;
+        for (int i = 0; i < 8; i++)
+            crc = crc & 1 ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+    }
+    return ~crc;
+}
+
+static const record_t *slot_record(int slot)
+{
+    return (const record_t *)(max77654_store_port_area() + slot * MAX77654_STORE_SLOT_SIZE);
+}
+
+static bool slot_blank(int slot)
+{
+    const uint8_t *p = (const uint8_t *)slot_record(slot);
+
+    for (int i = 0; i < MAX77654_STORE_SLOT_SIZE; i++)
+        if (p[i] != 0xFF)
+            return false;
+    return true;
+}
+
+static bool slot_valid(int slot)
+{
+    const record_t *r = slot_record(slot);
+
+    return r->magic == STORE_MAGIC && r->version == MAX77654_STORE_VERSION && r->len == sizeof(max77654_profile_t)
+        && r->crc == crc32((const uint8_t *)r, offsetof(record_t, crc));
+}
+
+// slot of the active record, -1 if there is none
+static int newest_slot(void)
+{
+    int newest = -1;
+
+    for (int slot = 0; slot < SLOTS; slot++)
+        if (slot_valid(slot) && (newest < 0 || slot_record(slot)->seq > slot_record(newest)->seq))
+            newest = slot;
+    return newest;
+}
+
+bool max77654_profile_check(const max77654_profile_t *profile)
+{
+    for (int ch = 0; ch < 3; ch++)
+    {
+        uint8_t a = profile->sbb[2 * ch], b = profile->sbb[2 * ch + 1];
+        if (a > SBB_TV_MAX || (b & 0x80))
+            return false;
+    }
+    for (int ch = 0; ch < 2; ch++)
+    {
+        uint8_t a = profile->ldo[2 * ch], b = profile->ldo[2 * ch + 1];
+        if ((a & 0x80) || (b & 0xE0))
+            return false;
+    }
+    return true;
+}
+
+int max77654_store_load(max77654_profile_t *profile)
+{
+    int slot = newest_slot();
+    if (slot < 0)
+        return -1;
+
+    memcpy(profile, slot_record(slot)->profile, sizeof(*profile));
+    return max77654_profile_check(profile) ? 0 : -1;
+}
+
+int max77654_store_save(const max77654_profile_t *profile)
+{
+    record_t r;
+
+    if (!max77654_profile_check(profile))
+        return -1;
+
+    int newest = newest_slot();
+    memset(&r, 0xFF, sizeof(r));
+    r.magic = STORE_MAGIC;
+    r.version = MAX77654_STORE_VERSION;
+    r.len = sizeof(*profile);
+    r.seq = newest < 0 ? 1 : slot_record(newest)->seq + 1;
+    memcpy(r.profile, profile, sizeof(*profile));
+    r.crc = crc32((const uint8_t *)&r, offsetof(record_t, crc));
+
+    // next free slot behind the active record, slots left by a cut short save are skipped
+    int slot = newest < 0 ? 0 : (newest + 1) % SLOTS;
+    for (int tries = 0; tries < SLOTS; tries++, slot = (slot + 1) % SLOTS)
+    {
+        if (slot % SLOTS_PER_SECTOR == 0 && !slot_blank(slot))
+        {
+            // wrapped into a used sector, it must not hold the active record
+            if (newest >= 0 && newest / SLOTS_PER_SECTOR == slot / SLOTS_PER_SECTOR)
+                return -1;
+            if (max77654_store_port_erase(slot * MAX77654_STORE_SLOT_SIZE) < 0)
+                return -1;
+        }
+        if (!slot_blank(slot))
+            continue;
+
+        if (max77654_store_port_program(slot * MAX77654_STORE_SLOT_SIZE, (const uint8_t *)&r, sizeof(r)) < 0)
+            return -1;
+        return memcmp(slot_record(slot), &r, sizeof(r)) == 0 ? 0 : -1;
+    }
+    return -1;
+}
+
+int max77654_store_clear(void)
+{
+    for (int sector = 0; sector < MAX77654_STORE_SECTORS; sector++)
+        if (max77654_store_port_erase(sector * MAX77654_STORE_SECTOR_SIZE) < 0)
+            return -1;
+    return 0;
+}
+
+void max77654_store_get_info(max77654_store_info_t *info)
+{
+    int newest = newest_slot();
+    int slot = newest < 0 ? 0 : (newest + 1) % SLOTS;
+
+    info->stored = newest >= 0;
+    info->seq = newest < 0 ? 0 : slot_record(newest)->seq;
+    info->slot = newest < 0 ? 0 : newest;
+    info->free = 0;
+    while (info->free < SLOTS && slot_blank(slot))
+    {
+        info->free++;
+        slot = (slot + 1) % SLOTS;
+    }
+}
+
+int max77654_store_boot(i2c_inst_t *i2c)
+{
+    max77654_profile_t profile;
+    bool stored = max77654_store_load(&profile) == 0;
+    max77654_boot_mark(MAX77654_BOOT_STORE, stored);
+
+    if (max77654_init_with_profile(i2c, stored ? &profile : NULL) < 0)
+        return -1;
+    return stored ? 1 : 0;
+}
@@ -0,0 +1,50 @@
+#ifndef __MAX__77654__STORE__H__
+
+#define __MAX__77654__STORE__H__
+
+#include "hardware/i2c.h"
+#include "max77654_profile.h"
+
+// Rail profiles kept in flash, so the rails come up with the board's settings right at reset instead
+// of after the host has enumerated USB and sent a command. Call max77654_store_boot() first thing in
+// main(), before USB and stdio; it applies the stored profile in the two bursts of max77654_apply_profile().
+//
+// The store is a log of 32 byte slots over MAX77654_STORE_SECTORS flash sectors, 256 slots in all:
+//   [magic u32][format version u16][profile length u16][sequence u32][profile, 0xFF padded to 16][CRC-32]
+// A save programs the next free slot behind the newest record, the record with the highest sequence
+// number is the active one. A sector is only erased when the log wraps into it: one of them is erased
+// every 128 saves, each single sector once per 256, and the active record always sits in the other
+// sector meanwhile: a save cut short by a reset leaves a slot with a bad CRC that is skipped, the
+// previous profile stays active.
+// Records of another format version are skipped as well.
+//
+// Saving blocks for a page program (about 1 ms), or a sector erase (about 50 ms) on every 128th save,
+// with interrupts off; a USB stack on core 1 (cdc_init_core1()) is paused meanwhile.
+
+#define MAX77654_STORE_SECTORS 2
+#define MAX77654_STORE_SLOT_SIZE 32
+#define MAX77654_STORE_VERSION 1
+
+typedef struct {
+    bool stored;       // a valid record was found
+    uint32_t seq;      // sequence number of the active record
+    uint16_t slot;     // its slot
+    uint16_t free;     // erased slots left before the next sector erase
+} max77654_store_info_t;
+
+// the profile only uses values the chip defines, reserved bits clear
+bool max77654_profile_check(const max77654_profile_t *profile);
+
+// the active profile, -1 if nothing is stored
+int max77654_store_load(max77654_profile_t *profile);
+// -1 if the profile fails max77654_profile_check() or flash could not be written
+int max77654_store_save(const max77654_profile_t *profile);
+// erases the store, max77654_store_boot() falls back to the built-in profile
+int max77654_store_clear(void);
+void max77654_store_get_info(max77654_store_info_t *info);
+
+// max77654_init_with_profile() with the stored profile, or the built-in one if nothing is stored.
+// Returns 1 if the stored profile was applied, 0 for the built-in one, -1 if the PMIC is not on the bus.
+int max77654_store_boot(i2c_inst_t *i2c);
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef __MAX__77654__STORE__PORT__H__
+
+#define __MAX__77654__STORE__PORT__H__
+
+#include "pico/stdlib.h"
+
+// Flash behind max77654_store.c: max77654_store_rp2040.c uses the last sectors of the program flash,
+// the host build a NOR flash model in RAM. Offsets are relative to the start of the store area.
+// Like NOR flash, erasing sets every bit of a sector and programming only clears bits,
+// programming 0xFF over a byte leaves it as it is.
+
+#define MAX77654_STORE_SECTOR_SIZE 4096
+#define MAX77654_STORE_PAGE_SIZE 256
+
+// the store area, memory mapped, MAX77654_STORE_SECTORS sectors
+const uint8_t *max77654_store_port_area(void);
+// 0 or -1
+int max77654_store_port_erase(uint32_t offset); // the sector at offset
+int max77654_store_port_program(uint32_t offset, const uint8_t *data, uint32_t len); // within one page
+
+#endif
@@ -0,0 +1,67 @@
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "max77654_store.h"
+#include "max77654_store_port.h"
+#include <string.h>
+
+// RP2040 port of max77654_store: the store takes the last sectors of the program flash, read
+// through XIP. Erase and program run with interrupts off since the code around them executes
+// from flash; if core 1 registered as a lockout victim (the USB loop of cdc_init_core1() does),
+// it is parked in RAM for the duration.
+
+#ifndef MAX77654_STORE_FLASH_OFFSET
+#define MAX77654_STORE_FLASH_OFFSET (PICO_FLASH_SIZE_BYTES - MAX77654_STORE_SECTORS * FLASH_SECTOR_SIZE)
+#endif
+
+_Static_assert(MAX77654_STORE_SECTOR_SIZE == FLASH_SECTOR_SIZE && MAX77654_STORE_PAGE_SIZE == FLASH_PAGE_SIZE, "flash geometry");
+
+
+static void flash_begin(uint32_t *irq_state)
+{
+    if (multicore_lockout_victim_is_initialized(1))
+        multicore_lockout_start_blocking();
+    *irq_state = save_and_disable_interrupts();
+}
+
+static void flash_end(uint32_t irq_state)
+{
+    restore_interrupts(irq_state);
+    if (multicore_lockout_victim_is_initialized(1))
+        multicore_lockout_end_blocking();
+}
+
+const uint8_t *max77654_store_port_area(void)
+{
+    return (const uint8_t *)(XIP_BASE + MAX77654_STORE_FLASH_OFFSET);
+}
+
+int max77654_store_port_erase(uint32_t offset)
+{
+    uint32_t irq_state;
+
+    flash_begin(&irq_state);
+    flash_range_erase(MAX77654_STORE_FLASH_OFFSET + offset, FLASH_SECTOR_SIZE);
+    flash_end(irq_state);
+    return 0;
+}
+
+int max77654_store_port_program(uint32_t offset, const uint8_t *data, uint32_t len)
+{
+    uint8_t page[FLASH_PAGE_SIZE];
+    uint32_t page_offset = offset & ~(FLASH_PAGE_SIZE - 1);
+    uint32_t irq_state;
+
+    if (offset - page_offset + len > FLASH_PAGE_SIZE)
+        return -1;
+
+    // the rest of the page stays as it is, programming 0xFF does not change a byte
+    memset(page, 0xFF, sizeof(page));
+    memcpy(&page[offset - page_offset], data, len);
+
+    flash_begin(&irq_state);
+    flash_range_program(MAX77654_STORE_FLASH_OFFSET + page_offset, page, FLASH_PAGE_SIZE);
+    flash_end(irq_state);
+    return 0;
+}
@@ -0,0 +1,186 @@
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "max77654.h"
+#include "max77654_async.h"
+#include "max77654_telemetry.h"
+
+typedef struct {
+    bool used;
+    max77654_t *dev; // selected when the stream was added
+    uint8_t reg;
+    uint8_t count;
+    uint32_t period_us;
+    uint16_t seq;        // triggers so far
+    uint16_t sample_seq; // trigger of the read in flight, the record carries it
+    repeating_timer_t timer;
+    max77654_async_req_t req;
+    uint8_t data[MAX77654_TELEM_MAX_REGS];
+    max77654_telem_counters_t counters;
+} telem_stream_t;
+
+typedef struct {
+    uint8_t len; // bytes used in bytes[]
+    uint8_t bytes[MAX77654_TELEM_RECORD_HEADER + MAX77654_TELEM_MAX_REGS];
+} telem_record_t;
+
+static telem_stream_t streams[MAX77654_TELEM_MAX_STREAMS];
+static bool running;
+
+// single producer (I2C completion), single consumer (max77654_telem_drain)
+static telem_record_t records[MAX77654_TELEM_RING_RECORDS];
+static volatile uint32_t records_head;
+static volatile uint32_t records_tail;
+
+
+// I2C completion, interrupt context
+static void on_sample(max77654_async_req_t *req, void *user)
+{
+    telem_stream_t *s = user;
+    int id = s - streams;
+
+    if (req->status != 0)
+    {
+        s->counters.bus_errors++;
+        return;
+    }
+
+    if (records_head - records_tail >= MAX77654_TELEM_RING_RECORDS)
+    {
+        s->counters.dropped_full++;
+        return;
+    }
+
+    telem_record_t *r = &records[records_head & (MAX77654_TELEM_RING_RECORDS - 1)];
+    uint32_t t = (uint32_t)req->submit_us;
+
+    r->bytes[0] = id;
+    r->bytes[1] = s->count;
+    r->bytes[2] = s->sample_seq & 0xFF;
+    r->bytes[3] = s->sample_seq >> 8;
+    r->bytes[4] = t & 0xFF;
+    r->bytes[5] = (t >> 8) & 0xFF;
+    r->bytes[6] = (t >> 16) & 0xFF;
+    r->bytes[7] = t >> 24;
+    for (int i = 0; i < s->count; i++)
+        r->bytes[MAX77654_TELEM_RECORD_HEADER + i] = s->data[i];
+    r->len = MAX77654_TELEM_RECORD_HEADER + s->count;
+
+    __dmb(); // record complete before it is published
+    records_head++;
+    s->counters.samples++;
+}
+
+// hardware timer, interrupt context
+static bool on_trigger(repeating_timer_t *rt)
+{
+    telem_stream_t *s = rt->user_data;
+
+    s->seq++;
+    if (s->req.status == MAX77654_ASYNC_PENDING)
+    {
+        s->counters.dropped_busy++;
+        return running;
+    }
+
+    s->sample_seq = s->seq;
+    max77654_async_read_dev(s->dev, &s->req, s->reg, s->data, s->count, on_sample, s);
+    return running;
+}
+
+
+int max77654_telem_add_stream(uint8_t reg, uint8_t count, uint32_t rate_hz)
+{
+    if (count == 0 || count > MAX77654_TELEM_MAX_REGS || rate_hz == 0 || rate_hz > 1000000)
+        return -1;
+
+    for (int i = 0; i < MAX77654_TELEM_MAX_STREAMS; i++)
+    {
+        telem_stream_t *s = &streams[i];
+        if (s->used)
+            continue;
+
+        *s = (telem_stream_t){0};
+        s->dev = max77654_selected();
+        s->reg = reg;
+        s->count = count;
+        s->period_us = 1000000 / rate_hz;
+        s->used = true;
+
+        if (running)
+            add_repeating_timer_us(-(int64_t)s->period_us, on_trigger, s, &s->timer);
+        return i;
+    }
+    return -1;
+}
+
+void max77654_telem_remove_stream(int stream)
+{
+    if (stream < 0 || stream >= MAX77654_TELEM_MAX_STREAMS || !streams[stream].used)
+        return;
+
+    if (running)
+        cancel_repeating_timer(&streams[stream].timer);
+    max77654_async_wait(&streams[stream].req);
+    streams[stream].used = false;
+}
+
+bool max77654_telem_start(void)
+{
+    if (running)
+        return true;
+
+    running = true;
+    for (int i = 0; i < MAX77654_TELEM_MAX_STREAMS; i++)
+    {
+        // negative delay: fixed rate, independent of how long the callback takes
+        if (streams[i].used && !add_repeating_timer_us(-(int64_t)streams[i].period_us, on_trigger, &streams[i], &streams[i].timer))
+        {
+            max77654_telem_stop();
+            return false;
+        }
+    }
+    return true;
+}
+
+void max77654_telem_stop(void)
+{
+    if (!running)
+        return;
+
+    running = false;
+    for (int i = 0; i < MAX77654_TELEM_MAX_STREAMS; i++)
+        if (streams[i].used)
+            cancel_repeating_timer(&streams[i].timer);
+    max77654_async_flush();
+}
+
+uint32_t max77654_telem_drain(max77654_telem_write_t write)
+{
+    uint32_t sent = 0;
+
+    while (records_tail != records_head)
+    {
+        __dmb(); // head was read before the record
+        telem_record_t *r = &records[records_tail & (MAX77654_TELEM_RING_RECORDS - 1)];
+
+        if (write(r->bytes, r->len) < r->len)
+            break;
+
+        records_tail++;
+        sent++;
+    }
+    return sent;
+}
+
+void max77654_telem_get_counters(int stream, max77654_telem_counters_t *counters)
+{
+    if (stream < 0 || stream >= MAX77654_TELEM_MAX_STREAMS)
+    {
+        *counters = (max77654_telem_counters_t){0};
+        return;
+    }
+
+    uint32_t irq = save_and_disable_interrupts();
+    *counters = streams[stream].counters;
+    restore_interrupts(irq);
+}
@@ -0,0 +1,42 @@
+#ifndef __MAX__77654__TELEMETRY__H__
+
+#define __MAX__77654__TELEMETRY__H__
+
+#include "pico/stdlib.h"
+
+// Periodic sampling of MAX77654 register blocks (ERCFLAG, INT_GLBL*, STAT_CHG_*, ...).
+// Every stream reads `count` consecutive registers in one burst on its own hardware timer,
+// through the async queue (max77654_async_init() must have been called), so sampling never
+// blocks the main loop. Samples are packed into records in a lock-free ring from the I2C
+// interrupt; max77654_telem_drain() hands them to a writer (e.g. cdc_write_buf) from the main loop.
+//
+// Record, little endian: [stream][len][seq u16][timestamp_us u32][len register bytes]
+// timestamp is the time the sample was triggered, seq counts triggers so gaps show drops.
+
+#define MAX77654_TELEM_MAX_STREAMS 4
+#define MAX77654_TELEM_MAX_REGS 16
+#define MAX77654_TELEM_RECORD_HEADER 8
+#define MAX77654_TELEM_RING_RECORDS 64 // power of two
+
+typedef struct {
+    uint32_t samples;      // records produced
+    uint32_t dropped_busy; // trigger skipped, the previous read of the stream was still on the bus
+    uint32_t dropped_full; // sample lost, the record ring was full
+    uint32_t bus_errors;
+} max77654_telem_counters_t;
+
+// returns the writer's accepted byte count, a record is only taken out of the ring when it was accepted completely
+typedef uint32_t (*max77654_telem_write_t)(const uint8_t *data, uint32_t len);
+
+// samples the selected device, returns the stream id, or -1 if out of streams / bad arguments
+int max77654_telem_add_stream(uint8_t reg, uint8_t count, uint32_t rate_hz);
+void max77654_telem_remove_stream(int stream);
+bool max77654_telem_start(void);
+void max77654_telem_stop(void);
+
+// hand queued records to write until it stops accepting, returns the number of records sent
+uint32_t max77654_telem_drain(max77654_telem_write_t write);
+// counters of a stream id out of range are all zero
+void max77654_telem_get_counters(int stream, max77654_telem_counters_t *counters);
+
+#endif
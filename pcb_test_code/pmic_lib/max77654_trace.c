@@ -0,0 +1,88 @@
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "max77654_trace.h"
+#include <string.h>
+
+// written from the main loop and from the async I2C completion interrupt
+static max77654_trace_op_t ops[MAX77654_OP_COUNT];
+static max77654_trace_reg_t regs[MAX77654_TRACE_REGS];
+
+
+#if MAX77654_TRACE
+void max77654_trace_record(max77654_op_t op, uint8_t reg, uint32_t us, int result)
+{
+    uint32_t bucket = max77654_trace_bucket(us);
+    uint32_t irq = save_and_disable_interrupts();
+    max77654_trace_op_t *o = &ops[op];
+
+    if (o->count == 0 || us < o->min_us)
+        o->min_us = us;
+    o->max_us = MAX(o->max_us, us);
+    o->total_us += us;
+    o->count++;
+    o->hist[bucket]++;
+    if (result == PICO_ERROR_TIMEOUT)
+        o->timeouts++;
+    else if (result < 0)
+        o->nacks++;
+
+    if (reg < MAX77654_TRACE_REGS)
+    {
+        max77654_trace_reg_t *r = &regs[reg];
+        r->count++;
+        r->max_us = MAX(r->max_us, us);
+        r->hist[bucket]++;
+        if (result < 0)
+            r->errors++;
+    }
+    restore_interrupts(irq);
+}
+#endif
+
+void max77654_trace_get_op(max77654_op_t op, max77654_trace_op_t *stats)
+{
+    uint32_t irq = save_and_disable_interrupts();
+    *stats = ops[op];
+    restore_interrupts(irq);
+}
+
+void max77654_trace_get_reg(uint8_t reg, max77654_trace_reg_t *stats)
+{
+    if (reg >= MAX77654_TRACE_REGS)
+    {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+
+    uint32_t irq = save_and_disable_interrupts();
+    *stats = regs[reg];
+    restore_interrupts(irq);
+}
+
+void max77654_trace_reset(void)
+{
+    uint32_t irq = save_and_disable_interrupts();
+    memset(ops, 0, sizeof(ops));
+    memset(regs, 0, sizeof(regs));
+    restore_interrupts(irq);
+}
+
+uint32_t max77654_trace_percentile(const uint32_t *hist, uint32_t permille)
+{
+    uint64_t total = 0;
+    uint64_t seen = 0;
+    int b;
+
+    for (b = 0; b < MAX77654_TRACE_BUCKETS; b++)
+        total += hist[b];
+    if (total == 0)
+        return 0;
+
+    for (b = 0; b < MAX77654_TRACE_BUCKETS - 1; b++)
+    {
+        seen += hist[b];
+        if (seen * 1000 >= total * permille)
+            break;
+    }
+    return b == 0 ? 0 : b == MAX77654_TRACE_BUCKETS - 1 ? UINT32_MAX : (1u << b) - 1;
+}
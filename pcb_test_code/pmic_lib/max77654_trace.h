@@ -0,0 +1,70 @@
+#ifndef __MAX__77654__TRACE__H__
+
+#define __MAX__77654__TRACE__H__
+
+#include "pico/stdlib.h"
+
+// Latency and error instrumentation of the MAX77654 bus traffic.
+// Every blocking transfer (max77654_write_regs / max77654_read_regs / max77654_on_bus) and every
+// async request is timed and sorted into a log2 histogram per operation and per first register,
+// NACKs and timeouts are counted. Async latency runs from submission to completion, queueing included.
+// Build with MAX77654_TRACE=0 to compile the recording out, the getters then report zeros.
+//
+// Histogram bucket b counts latencies of 2^(b-1) .. 2^b - 1 us (bucket 0: 0 us), the last one everything longer.
+
+#ifndef MAX77654_TRACE
+#define MAX77654_TRACE 1
+#endif
+
+#define MAX77654_TRACE_BUCKETS 16
+#define MAX77654_TRACE_REGS 0x50 // registers 0x00..0x4F
+
+typedef enum {
+    MAX77654_OP_WRITE = 0,
+    MAX77654_OP_READ,
+    MAX77654_OP_ASYNC_WRITE,
+    MAX77654_OP_ASYNC_READ,
+    MAX77654_OP_PROBE, // max77654_on_bus
+    MAX77654_OP_COUNT,
+} max77654_op_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t nacks;
+    uint32_t timeouts;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t total_us;
+    uint32_t hist[MAX77654_TRACE_BUCKETS];
+} max77654_trace_op_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t errors; // NACKs and timeouts
+    uint32_t max_us;
+    uint32_t hist[MAX77654_TRACE_BUCKETS];
+} max77654_trace_reg_t;
+
+#if MAX77654_TRACE
+// result as returned by the SDK: >= 0 success, PICO_ERROR_TIMEOUT, anything else negative is a NACK
+void max77654_trace_record(max77654_op_t op, uint8_t reg, uint32_t us, int result);
+#else
+static inline void max77654_trace_record(max77654_op_t op, uint8_t reg, uint32_t us, int result)
+{
+    (void)op; (void)reg; (void)us; (void)result;
+}
+#endif
+
+void max77654_trace_get_op(max77654_op_t op, max77654_trace_op_t *stats);
+void max77654_trace_get_reg(uint8_t reg, max77654_trace_reg_t *stats);
+void max77654_trace_reset(void);
+
+// upper bound in us of the bucket holding the given fraction (per mille) of the samples, 0 without samples
+uint32_t max77654_trace_percentile(const uint32_t *hist, uint32_t permille);
+
+static inline uint32_t max77654_trace_bucket(uint32_t us)
+{
+    return us == 0 ? 0 : MIN(32 - __builtin_clz(us), MAX77654_TRACE_BUCKETS - 1);
+}
+
+#endif
@@ -4,7 +4,7 @@
 
 
 typedef struct {
-    unsigned int target_voltage : 6;  // Bits 6:0, 0x00 = 0.8V, 0x3F = 5.5V
+    unsigned int target_voltage : 7;  // Bits 6:0, 0x00 = 0.8V, 0x5E = 5.5V
     unsigned int reserved : 1;  // Bits 7 reserved for future use
 }reg_cnfg_ssbx_a_t;
 
@@ -24,7 +24,7 @@ typedef struct {
 
 
 typedef struct {
-    unsigned int target_voltage : 6;  // Bits 6:0, 0x00 = 0.8V, 0x3F = 3.975V
+    unsigned int target_voltage : 7;  // Bits 6:0, 0x00 = 0.8V, 0x7F = 3.975V
     unsigned int reserved : 1;  // Bits 7 reserved for future use
 } reg_cnfg_ldox_a_t;
 
@@ -43,6 +43,67 @@ typedef struct{
 } reg_cnfg_ldox_t;
 
 typedef struct {
+    unsigned int thm_cold : 2;  // Bits 1:0; JEITA T_COLD, 0x00 = -10C, 0x01 = -5C, 0x02 = 0C, 0x03 = 5C
+    unsigned int thm_cool : 2;  // Bits 3:2; JEITA T_COOL, 0x00 = 15C, 0x01 = 10C, 0x02 = 5C, 0x03 = 0C
+    unsigned int thm_warm : 2;  // Bits 5:4; JEITA T_WARM, 0x00 = 35C, 0x01 = 40C, 0x02 = 45C, 0x03 = 50C
+    unsigned int thm_hot : 2;   // Bits 7:6; JEITA T_HOT, 0x00 = 45C, 0x01 = 50C, 0x02 = 55C, 0x03 = 60C
+} reg_cnfg_chg_a_t;
+
+typedef struct {
+    unsigned int chg_en : 1;      // Bit 0; 0x00 = charger off, 0x01 = on
+    unsigned int i_pq : 1;        // Bit 1; pre-charge current, 0x00 = 10%, 0x01 = 20% of CHG_CC
+    unsigned int ichgin_lim : 3;  // Bits 4:2; CHGIN current limit, 0x00 = 95mA .. 0x04 = 475mA
+    unsigned int vchgin_min : 3;  // Bits 7:5; CHGIN voltage regulation, 0x00 = 4.0V .. 0x07 = 4.7V
+} reg_cnfg_chg_b_t;
+
+typedef struct {
+    unsigned int t_topoff : 3;  // Bits 2:0; top-off time, 0x00 = 0min .. 0x07 = 35min, 5min steps
+    unsigned int i_term : 2;    // Bits 4:3; termination current, 0x00 = 5%, 0x01 = 7.5%, 0x02 = 10%, 0x03 = 15% of CHG_CC
+    unsigned int chg_pq : 3;    // Bits 7:5; pre-charge threshold, 0x00 = 2.3V .. 0x07 = 3.0V
+} reg_cnfg_chg_c_t;
+
+typedef struct {
+    unsigned int vsys_reg : 5;  // Bits 4:0; SYS regulation, 0x00 = 3.3V .. 0x1E = 4.8V, 50mV steps
+    unsigned int tj_reg : 3;    // Bits 7:5; die temperature regulation, 0x00 = 60C .. 0x04 = 100C
+} reg_cnfg_chg_d_t;
+
+typedef struct {
+    unsigned int t_fast_chg : 2;  // Bits 1:0; fast-charge timer, 0x00 = off, 0x01 = 3h, 0x02 = 5h, 0x03 = 7h
+    unsigned int chg_cc : 6;      // Bits 7:2; fast-charge current, 0x00 = 7.5mA .. 0x27 = 300mA
+} reg_cnfg_chg_e_t;
+
+typedef struct {
+    unsigned int reserved : 1;      // Bit 0
+    unsigned int thm_en : 1;        // Bit 1; thermistor monitoring (JEITA)
+    unsigned int chg_cc_jeita : 6;  // Bits 7:2; fast-charge current between T_COLD..T_COOL and T_WARM..T_HOT
+} reg_cnfg_chg_f_t;
+
+typedef struct {
+    unsigned int reserved : 1;  // Bit 0
+    unsigned int usbs : 1;      // Bit 1; USB suspend, CHGIN draws no current
+    unsigned int chg_cv : 6;    // Bits 7:2; charge voltage, 0x00 = 3.6V .. 0x28 = 4.6V
+} reg_cnfg_chg_g_t;
+
+typedef struct {
+    unsigned int reserved : 2;      // Bits 1:0
+    unsigned int chg_cv_jeita : 6;  // Bits 7:2; charge voltage outside T_COOL..T_WARM
+} reg_cnfg_chg_h_t;
+
+typedef struct {
+    unsigned int mux_sel : 4;  // Bits 3:0; AMUX channel, 0x00 = disabled, 0x03 = BATT voltage, ...
+    unsigned int imon_dischg_scale : 4;  // Bits 7:4; full scale of the discharge current monitor, 0x00 = 8.2mA .. 0x0A = 300mA
+} reg_cnfg_chg_i_t;
+
+typedef struct {
+    reg_cnfg_chg_a_t chg_a;   // CNFG_CHG_A, JEITA thresholds
+    reg_cnfg_chg_b_t chg_b;   // CNFG_CHG_B, input limits, charger enable
+    reg_cnfg_chg_c_t chg_c;   // CNFG_CHG_C, pre-charge, termination
+    reg_cnfg_chg_d_t chg_d;   // CNFG_CHG_D, SYS and die temperature regulation
+    reg_cnfg_chg_e_t chg_e;   // CNFG_CHG_E, fast-charge current and timer
+    reg_cnfg_chg_f_t chg_f;   // CNFG_CHG_F, JEITA current
+    reg_cnfg_chg_g_t chg_g;   // CNFG_CHG_G, charge voltage
+    reg_cnfg_chg_h_t chg_h;   // CNFG_CHG_H, JEITA charge voltage
+    reg_cnfg_chg_i_t chg_i;   // CNFG_CHG_I, AMUX selection
     reg_cnfg_ssbx_t ssbs[3];  // SSBS0, SSBS1, SSBS2
     reg_cnfg_ldox_t ldos[2];  // LDO0, LDO1
 } reg_map_max77654_t;
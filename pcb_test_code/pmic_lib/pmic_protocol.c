@@ -0,0 +1,429 @@
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "max77654.h"
+#include "max77654_telemetry.h"
+#include "max77654_log.h"
+#include "max77654_trace.h"
+#include "max77654_store.h"
+#include "max77654_boot.h"
+#include "pmic_protocol.h"
+#include <string.h>
+
+#define N_SSB 3
+#define N_LDO 2
+#define MIN_MV 800
+#define SSB_MAX_MV 5500
+#define LDO_MAX_MV 3975
+
+static pmic_proto_write_t proto_write;
+static uint8_t rx_frame[PMIC_PROTO_MAX_PAYLOAD + PMIC_PROTO_MAX_PAYLOAD / 254 + 2]; // COBS encoded, delimiter excluded
+static uint32_t rx_len;
+static bool rx_overflow;
+static uint32_t dropped_frames;
+
+
+uint16_t pmic_proto_crc16(const uint8_t *data, uint32_t len)
+{
+    uint16_t crc = 0xFFFF;
+
+    while (len--)
+    {
+        crc ^= (uint16_t)(*data++) << 8;
+        for (int i = 0; i < 8; i++)
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+uint32_t pmic_proto_encode(uint8_t *payload, uint32_t len, uint8_t *frame)
+{
+    uint16_t crc = pmic_proto_crc16(payload, len);
+    payload[len++] = crc & 0xFF;
+    payload[len++] = crc >> 8;
+
+    // COBS: every zero is replaced by the distance to the next one
+    uint32_t out = 1, code_pos = 0;
+    uint8_t code = 1;
+
+    for (uint32_t i = 0; i < len; i++)
+    {
+        if (payload[i] == 0)
+        {
+            frame[code_pos] = code;
+            code_pos = out++;
+            code = 1;
+            continue;
+        }
+
+        frame[out++] = payload[i];
+        if (++code == 0xFF)
+        {
+            frame[code_pos] = code;
+            code_pos = out++;
+            code = 1;
+        }
+    }
+    frame[code_pos] = code;
+    frame[out++] = 0x00;
+    return out;
+}
+
+// decode in place, returns the decoded length or 0 for a malformed frame
+static uint32_t cobs_decode(uint8_t *buf, uint32_t len)
+{
+    uint32_t in = 0, out = 0;
+
+    while (in < len)
+    {
+        uint8_t code = buf[in++];
+        if (code == 0 || in + code - 1 > len)
+            return 0;
+
+        for (uint8_t i = 1; i < code; i++)
+            buf[out++] = buf[in++];
+        if (code < 0xFF && in < len)
+            buf[out++] = 0;
+    }
+    return out;
+}
+
+
+// the rail functions clamp, a request outside the range of the rail is refused instead
+static bool voltage_in_range(uint8_t rail, uint16_t mV)
+{
+    return mV >= MIN_MV && mV <= (rail < N_SSB ? SSB_MAX_MV : LDO_MAX_MV);
+}
+
+static int set_voltage(uint8_t rail, uint16_t mV)
+{
+    if (rail < N_SSB)
+        return SSBx_set_voltage(rail, mV);
+    return LDOx_set_voltage(rail - N_SSB, mV);
+}
+
+static int enable(uint8_t rail, bool on)
+{
+    if (rail < N_SSB)
+        return SSBx_enable(rail, on);
+    return LDOx_enable(rail - N_SSB, on);
+}
+
+// little endian u32 values into resp, returns the byte count
+static uint32_t put_u32s(uint8_t *resp, const uint32_t *values, uint32_t n)
+{
+    for (uint32_t i = 0; i < 4 * n; i++)
+        resp[i] = values[i / 4] >> (8 * (i % 4));
+    return 4 * n;
+}
+
+// execute one command, response data goes to resp, its length to resp_len
+static pmic_status_t execute(uint8_t cmd, const uint8_t *args, uint32_t len, uint8_t *resp, uint32_t *resp_len, uint32_t resp_room)
+{
+    int ret = 0;
+
+    *resp_len = 0;
+    switch (cmd)
+    {
+        case PMIC_CMD_PING:
+            if (len > resp_room)
+                return PMIC_STATUS_BAD_ARGS;
+            for (uint32_t i = 0; i < len; i++)
+                resp[i] = args[i];
+            *resp_len = len;
+            break;
+
+        case PMIC_CMD_SET_VOLTAGE:
+            if (len != 3 || args[0] >= N_SSB + N_LDO || !voltage_in_range(args[0], args[1] | (args[2] << 8)))
+                return PMIC_STATUS_BAD_ARGS;
+            ret = set_voltage(args[0], args[1] | (args[2] << 8));
+            break;
+
+        case PMIC_CMD_ENABLE:
+            if (len != 2 || args[0] >= N_SSB + N_LDO)
+                return PMIC_STATUS_BAD_ARGS;
+            ret = enable(args[0], args[1] != 0);
+            break;
+
+        case PMIC_CMD_LDO_MODE:
+            if (len != 2 || args[0] >= N_LDO || args[1] > LDO_MODE_LSW)
+                return PMIC_STATUS_BAD_ARGS;
+            ret = LDOx_set_mode(args[0], args[1]);
+            break;
+
+        case PMIC_CMD_READ_REGS:
+            if (len != 2 || args[1] == 0 || args[1] > resp_room)
+                return PMIC_STATUS_BAD_ARGS;
+            ret = max77654_read_regs(args[0], resp, args[1]);
+            *resp_len = ret < 0 ? 0 : args[1];
+            break;
+
+        case PMIC_CMD_WRITE_REGS:
+            if (len < 2 || len - 1 > MAX77654_MAX_BURST_LEN)
+                return PMIC_STATUS_BAD_ARGS;
+            ret = max77654_write_regs(args[0], &args[1], len - 1);
+            break;
+
+        case PMIC_CMD_BATCH:
+        {
+            // all rail changes of the batch end up in one commit, read data is concatenated
+            uint32_t pos;
+            pmic_status_t status = PMIC_STATUS_OK;
+
+            // a malformed batch runs nothing
+            for (pos = 0; pos < len; pos += 2 + args[pos + 1])
+                if (pos + 2 > len || pos + 2 + args[pos + 1] > len || args[pos] == PMIC_CMD_BATCH)
+                    return PMIC_STATUS_BAD_ARGS;
+
+            max77654_begin();
+            for (pos = 0; pos < len && status == PMIC_STATUS_OK; pos += 2 + args[pos + 1])
+            {
+                uint32_t sub_resp_len;
+
+                status = execute(args[pos], &args[pos + 2], args[pos + 1], &resp[*resp_len], &sub_resp_len, resp_room - *resp_len);
+                *resp_len += sub_resp_len;
+            }
+
+            // no half batch: a failed command drops the rail changes staged before it
+            if (status != PMIC_STATUS_OK)
+            {
+                max77654_discard();
+                *resp_len = 0;
+                return status;
+            }
+            ret = max77654_commit();
+            break;
+        }
+
+        case PMIC_CMD_TELEM_ADD:
+        {
+            if (len != 4 || resp_room < 1)
+                return PMIC_STATUS_BAD_ARGS;
+            int stream = max77654_telem_add_stream(args[0], args[1], args[2] | (args[3] << 8));
+            if (stream < 0)
+                return PMIC_STATUS_BAD_ARGS;
+            max77654_telem_start();
+            resp[0] = stream;
+            *resp_len = 1;
+            break;
+        }
+
+        case PMIC_CMD_TELEM_REMOVE:
+            if (len != 1 || args[0] >= MAX77654_TELEM_MAX_STREAMS)
+                return PMIC_STATUS_BAD_ARGS;
+            max77654_telem_remove_stream(args[0]);
+            break;
+
+        case PMIC_CMD_TELEM_COUNTERS:
+        {
+            max77654_telem_counters_t c;
+            uint32_t values[4];
+
+            if (len != 1 || args[0] >= MAX77654_TELEM_MAX_STREAMS || resp_room < sizeof(values))
+                return PMIC_STATUS_BAD_ARGS;
+            max77654_telem_get_counters(args[0], &c);
+            values[0] = c.samples;
+            values[1] = c.dropped_busy;
+            values[2] = c.dropped_full;
+            values[3] = c.bus_errors;
+            *resp_len = put_u32s(resp, values, 4);
+            break;
+        }
+
+        case PMIC_CMD_TRACE:
+        {
+            uint32_t values[7 + MAX77654_TRACE_BUCKETS];
+            uint32_t n;
+
+            if (len != 2 || resp_room < sizeof(values))
+                return PMIC_STATUS_BAD_ARGS;
+            if (args[0] == 0 && args[1] < MAX77654_OP_COUNT)
+            {
+                max77654_trace_op_t t;
+                max77654_trace_get_op(args[1], &t);
+                values[0] = t.count;
+                values[1] = t.nacks;
+                values[2] = t.timeouts;
+                values[3] = t.min_us;
+                values[4] = t.max_us;
+                values[5] = (uint32_t)t.total_us;
+                values[6] = (uint32_t)(t.total_us >> 32);
+                memcpy(&values[7], t.hist, sizeof(t.hist));
+                n = 7 + MAX77654_TRACE_BUCKETS;
+            }
+            else if (args[0] == 1 && args[1] < MAX77654_TRACE_REGS)
+            {
+                max77654_trace_reg_t t;
+                max77654_trace_get_reg(args[1], &t);
+                values[0] = t.count;
+                values[1] = t.errors;
+                values[2] = t.max_us;
+                memcpy(&values[3], t.hist, sizeof(t.hist));
+                n = 3 + MAX77654_TRACE_BUCKETS;
+            }
+            else
+            {
+                return PMIC_STATUS_BAD_ARGS;
+            }
+            *resp_len = put_u32s(resp, values, n);
+            break;
+        }
+
+        case PMIC_CMD_TRACE_RESET:
+            max77654_trace_reset();
+            break;
+
+        case PMIC_CMD_PROFILE_GET:
+        {
+            max77654_store_info_t info;
+            max77654_profile_t profile;
+
+            if (len != 0 || resp_room < 7 + sizeof(profile))
+                return PMIC_STATUS_BAD_ARGS;
+            max77654_store_get_info(&info);
+            resp[0] = info.stored;
+            put_u32s(&resp[1], &info.seq, 1);
+            resp[5] = info.free & 0xFF;
+            resp[6] = info.free >> 8;
+            *resp_len = 7;
+            if (info.stored && max77654_store_load(&profile) == 0)
+            {
+                memcpy(&resp[7], &profile, sizeof(profile));
+                *resp_len += sizeof(profile);
+            }
+            break;
+        }
+
+        case PMIC_CMD_PROFILE_SAVE:
+        {
+            max77654_profile_t profile;
+
+            if (len != 1 + sizeof(profile))
+                return PMIC_STATUS_BAD_ARGS;
+            memcpy(&profile, &args[1], sizeof(profile));
+            if (!max77654_profile_check(&profile))
+                return PMIC_STATUS_BAD_ARGS;
+            if (max77654_store_save(&profile) < 0)
+                return PMIC_STATUS_FLASH_ERROR;
+            if (args[0] & 0x01)
+                ret = max77654_apply_profile(&profile);
+            break;
+        }
+
+        case PMIC_CMD_PROFILE_CLEAR:
+            if (max77654_store_clear() < 0)
+                return PMIC_STATUS_FLASH_ERROR;
+            break;
+
+        case PMIC_CMD_BOOT_REPORT:
+            if (len != 1)
+                return PMIC_STATUS_BAD_ARGS;
+            *resp_len = max77654_boot_report(args[0], resp, resp_room);
+            if (*resp_len == 0)
+                return PMIC_STATUS_BAD_ARGS;
+            break;
+
+        default:
+            return PMIC_STATUS_UNKNOWN_CMD;
+    }
+
+    return ret < 0 ? PMIC_STATUS_BUS_ERROR : PMIC_STATUS_OK;
+}
+
+static void handle_frame(uint8_t *frame, uint32_t len)
+{
+    uint8_t resp[PMIC_PROTO_MAX_PAYLOAD];
+    uint8_t encoded[PMIC_PROTO_MAX_PAYLOAD + PMIC_PROTO_MAX_PAYLOAD / 254 + 2];
+    uint32_t data_len;
+
+    len = cobs_decode(frame, len);
+    if (len < 4 || pmic_proto_crc16(frame, len - 2) != (frame[len - 2] | (frame[len - 1] << 8)))
+    {
+        dropped_frames++;
+        return;
+    }
+
+    resp[0] = frame[0];
+    resp[1] = execute(frame[1], &frame[2], len - 4, &resp[2], &data_len, sizeof(resp) - 4);
+
+    if (proto_write)
+        proto_write(encoded, pmic_proto_encode(resp, 2 + data_len, encoded));
+}
+
+
+// wraps one telemetry record into a frame, accepted only if the whole frame was written
+static uint32_t write_telemetry_frame(const uint8_t *record, uint32_t len)
+{
+    uint8_t payload[2 + MAX77654_TELEM_RECORD_HEADER + MAX77654_TELEM_MAX_REGS + 2];
+    uint8_t encoded[sizeof(payload) + 2];
+
+    payload[0] = 0;
+    payload[1] = PMIC_STATUS_TELEMETRY;
+    for (uint32_t i = 0; i < len; i++)
+        payload[2 + i] = record[i];
+
+    uint32_t n = pmic_proto_encode(payload, 2 + len, encoded);
+    return proto_write(encoded, n) == n ? len : 0;
+}
+
+
+// wraps a batch of log records into a frame, accepted only if the whole frame was written
+static uint32_t write_log_frame(const uint8_t *batch, uint32_t len)
+{
+    uint8_t payload[PMIC_PROTO_MAX_PAYLOAD];
+    uint8_t encoded[sizeof(payload) + sizeof(payload) / 254 + 2];
+
+    payload[0] = 0;
+    payload[1] = PMIC_STATUS_LOG;
+    for (uint32_t i = 0; i < len; i++)
+        payload[2 + i] = batch[i];
+
+    uint32_t n = pmic_proto_encode(payload, 2 + len, encoded);
+    return proto_write(encoded, n) == n ? len : 0;
+}
+
+
+void pmic_proto_init(pmic_proto_write_t write)
+{
+    proto_write = write;
+    rx_len = 0;
+    rx_overflow = false;
+    dropped_frames = 0;
+}
+
+void pmic_proto_feed(const uint8_t *data, uint32_t len)
+{
+    for (uint32_t i = 0; i < len; i++)
+    {
+        if (data[i] == 0x00)
+        {
+            if (rx_overflow)
+                dropped_frames++;
+            else if (rx_len)
+                handle_frame(rx_frame, rx_len);
+            rx_len = 0;
+            rx_overflow = false;
+        }
+        else if (rx_len < sizeof(rx_frame))
+        {
+            rx_frame[rx_len++] = data[i];
+        }
+        else
+        {
+            rx_overflow = true; // drop until the next delimiter
+        }
+    }
+}
+
+void pmic_proto_poll(void)
+{
+    if (proto_write)
+    {
+        max77654_telem_drain(write_telemetry_frame);
+        max77654_log_drain(write_log_frame, PMIC_PROTO_MAX_PAYLOAD - 4);
+    }
+}
+
+uint32_t pmic_proto_dropped_frames(void)
+{
+    return dropped_frames;
+}
@@ -0,0 +1,71 @@
+#ifndef __PMIC__PROTOCOL__H__
+
+#define __PMIC__PROTOCOL__H__
+
+#include "pico/stdlib.h"
+
+// Binary command protocol for controlling the MAX77654 from a host, meant for the application CDC interface.
+//
+// Framing: every frame is COBS encoded and terminated by 0x00, so several frames can share one USB packet.
+// Decoded frame: [request id][command][arguments ...][CRC-16/CCITT-FALSE, little endian]
+// Response:      [request id][status][data ...][CRC]
+// Frames with a bad CRC are dropped without a response (the request id can not be trusted), the host times out.
+//
+// Telemetry records (max77654_telemetry.h) are sent unsolicited as frames with request id 0 and status
+// PMIC_STATUS_TELEMETRY, the record follows as data. Hosts should not use request id 0.
+// Log records (max77654_log.h) follow the same way with status PMIC_STATUS_LOG, several whole records per frame.
+//
+// Rails are numbered 0..2 for SSB0..SSB2 and 3..4 for LDO0..LDO1, voltages are little endian mV.
+
+#define PMIC_PROTO_MAX_PAYLOAD 256 // decoded frame, request id and CRC included
+
+typedef enum {
+    PMIC_CMD_PING = 0x00,        // args: any, echoed back
+    PMIC_CMD_SET_VOLTAGE = 0x01, // args: rail, mV (u16), 800..5500 for SSBs, 800..3975 for LDOs
+    PMIC_CMD_ENABLE = 0x02,      // args: rail, 0/1
+    PMIC_CMD_LDO_MODE = 0x03,    // args: ldo channel, LDO_MODE_LDO / LDO_MODE_LSW
+    PMIC_CMD_READ_REGS = 0x04,   // args: reg, count; response data: count bytes
+    PMIC_CMD_WRITE_REGS = 0x05,  // args: reg, data ... (up to MAX77654_MAX_BURST_LEN bytes)
+    PMIC_CMD_BATCH = 0x06,       // args: n x [command, arg length, args], rail commands are committed together at the
+                                 // end (one max77654 transaction), register commands run when they are reached.
+                                 // A failing command ends the batch with its status and no response data, the rail
+                                 // changes staged before it are dropped (register commands before it have run)
+    PMIC_CMD_TELEM_ADD = 0x07,   // args: reg, count, rate Hz (u16); response data: stream id
+    PMIC_CMD_TELEM_REMOVE = 0x08,// args: stream id
+    PMIC_CMD_TELEM_COUNTERS = 0x09, // args: stream id; response data: samples, dropped busy, dropped full, bus errors (u32 each)
+    PMIC_CMD_TRACE = 0x0A,       // args: 0, operation (max77654_op_t); response data: count, nacks, timeouts, min us, max us,
+                                 //       total us (u64), 16 histogram buckets (u32 each)
+                                 // args: 1, register; response data: count, errors, max us, 16 histogram buckets (u32 each)
+    PMIC_CMD_TRACE_RESET = 0x0B, // clears the latency histograms and error counters
+    PMIC_CMD_PROFILE_GET = 0x0C, // response data: stored 0/1, sequence (u32), free slots (u16), then the 10 profile
+                                 //                bytes (max77654_profile_t) if one is stored
+    PMIC_CMD_PROFILE_SAVE = 0x0D,// args: flags (bit 0: apply now), 10 profile bytes; saved to flash, applied at every boot
+    PMIC_CMD_PROFILE_CLEAR = 0x0E, // erases the stored profiles, the next boot uses the built-in one
+    PMIC_CMD_BOOT_REPORT = 0x0F, // args: age (0 = this boot, 1 = the one before, ...); response data: max77654_boot_report()
+} pmic_cmd_t;
+
+typedef enum {
+    PMIC_STATUS_OK = 0x00,
+    PMIC_STATUS_UNKNOWN_CMD = 0x01,
+    PMIC_STATUS_BAD_ARGS = 0x02,
+    PMIC_STATUS_BUS_ERROR = 0x03,
+    PMIC_STATUS_FLASH_ERROR = 0x04,
+    PMIC_STATUS_TELEMETRY = 0x80,
+    PMIC_STATUS_LOG = 0x81,
+} pmic_status_t;
+
+// returns the number of bytes accepted, frames are only written as a whole
+typedef uint32_t (*pmic_proto_write_t)(const uint8_t *data, uint32_t len);
+
+void pmic_proto_init(pmic_proto_write_t write);
+// hand received bytes to the decoder, complete frames are executed and answered right away
+void pmic_proto_feed(const uint8_t *data, uint32_t len);
+// call from the main loop, sends queued telemetry and log records as long as write accepts them
+void pmic_proto_poll(void);
+uint32_t pmic_proto_dropped_frames(void);
+
+// append the CRC to payload (len bytes, room for 2 more needed), COBS encode into frame and add the delimiter
+uint32_t pmic_proto_encode(uint8_t *payload, uint32_t len, uint8_t *frame);
+uint16_t pmic_proto_crc16(const uint8_t *data, uint32_t len);
+
+#endif
@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+"""Measure what usb_dual_cdc_lib sustains on a real link, against the test_usb_dual_cdc_bench* firmware on cdc1.
+
+Runs device-to-host and host-to-device streams and echo round trips of several sizes and prints
+one CSV line per run, or JSON with --json, so results of both firmware modes can be collected
+and compared over time. Exits with 1 if any byte came back wrong.
+
+    python3 cdc_bench.py /dev/ttyACM1 --mode core1 --bytes 1048576 --header
+"""
+import argparse
+import json
+import os
+import statistics
+import struct
+import sys
+import time
+
+import serial  # pyserial
+
+FIELDS = ["scenario", "mode", "chunk_bytes", "MB_per_s", "device_us", "dropped_bytes", "blocked_us",
+          "rtt_p50_us", "rtt_p99_us", "rtt_max_us", "errors"]
+
+
+def pattern(n):
+    return bytes(i & 0xFF for i in range(n))
+
+
+def read_exact(port, n):
+    data = port.read(n)
+    if len(data) != n:
+        raise IOError("timeout after %d of %d bytes" % (len(data), n))
+    return data
+
+
+def device_stats(port):
+    port.write(b"S")
+    return dict(zip(["written", "dropped", "blocked_us", "flushes"], struct.unpack("<4I", read_exact(port, 16))))
+
+
+def run_tx(port, total, chunk):
+    """device to host, read chunk bytes per call"""
+    expect = pattern(256)
+    errors = 0
+    got = 0
+    port.write(b"T" + struct.pack("<I", total))
+    t0 = time.perf_counter()
+    while got < total:
+        data = port.read(min(chunk, total - got))
+        if not data:
+            raise IOError("stream stopped after %d of %d bytes" % (got, total))
+        off = got & 0xFF
+        errors += sum(1 for i, b in enumerate(data) if b != expect[(off + i) & 0xFF])
+        got += len(data)
+    elapsed = time.perf_counter() - t0
+    stats = device_stats(port)
+    return {"MB_per_s": total / elapsed / 1e6, "dropped_bytes": stats["dropped"],
+            "blocked_us": stats["blocked_us"], "errors": errors}
+
+
+def run_rx(port, total, chunk):
+    """host to device, written chunk bytes per call"""
+    data = pattern(256) * ((chunk + 255) // 256 + 1)
+    port.write(b"R" + struct.pack("<I", total))
+    t0 = time.perf_counter()
+    sent = 0
+    while sent < total:
+        n = min(chunk, total - sent)
+        port.write(data[sent & 0xFF:(sent & 0xFF) + n])
+        sent += n
+    device_us, errors = struct.unpack("<II", read_exact(port, 8))
+    elapsed = time.perf_counter() - t0
+    return {"MB_per_s": total / elapsed / 1e6, "device_us": device_us, "errors": errors}
+
+
+def run_echo(port, size, count):
+    rtts = []
+    errors = 0
+    for _ in range(count):
+        payload = os.urandom(size)
+        t0 = time.perf_counter()
+        port.write(b"E" + struct.pack("<H", size) + payload)
+        echo = read_exact(port, size)
+        rtts.append((time.perf_counter() - t0) * 1e6)
+        errors += echo != payload
+    rtts.sort()
+    return {"MB_per_s": 2 * size * count / (sum(rtts) / 1e6) / 1e6, "rtt_p50_us": statistics.median(rtts),
+            "rtt_p99_us": rtts[max(int(len(rtts) * 0.99) - 1, 0)], "rtt_max_us": rtts[-1], "errors": errors}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("port", help="serial device of cdc1")
+    parser.add_argument("--mode", default="core0", help="label for the output")
+    parser.add_argument("--bytes", type=int, default=1 << 20, help="bytes per stream run")
+    parser.add_argument("--chunks", default="64,512,4096", help="host read/write sizes of the stream runs")
+    parser.add_argument("--echo-sizes", default="1,32,64,256,1024", help="payload sizes of the echo runs")
+    parser.add_argument("--count", type=int, default=500, help="round trips per echo size")
+    parser.add_argument("--json", action="store_true", help="print one JSON list instead of CSV")
+    parser.add_argument("--header", action="store_true", help="print the CSV header first")
+    args = parser.parse_args()
+
+    results = []
+    with serial.Serial(args.port, timeout=2) as port:
+        port.reset_input_buffer()
+        device_stats(port)  # clears the counters and checks the firmware answers
+        for chunk in map(int, args.chunks.split(",")):
+            results.append(dict(scenario="tx", chunk_bytes=chunk, **run_tx(port, args.bytes, chunk)))
+            results.append(dict(scenario="rx", chunk_bytes=chunk, **run_rx(port, args.bytes, chunk)))
+        for size in map(int, args.echo_sizes.split(",")):
+            results.append(dict(scenario="echo", chunk_bytes=size, **run_echo(port, size, args.count)))
+
+    for r in results:
+        r["mode"] = args.mode
+    if args.json:
+        print(json.dumps(results, indent=1))
+    else:
+        if args.header:
+            print(",".join(FIELDS))
+        for r in results:
+            print(",".join(("%.3f" % r[f] if isinstance(r.get(f), float) else str(r.get(f, 0))) for f in FIELDS))
+    return 1 if any(r["errors"] for r in results) else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
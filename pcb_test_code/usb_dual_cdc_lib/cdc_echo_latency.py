@@ -0,0 +1,53 @@
+#!/usr/bin/env python3
+"""Measure round-trip latency and throughput of the cdc1 echo firmware (test_usb_dual_cdc_echo*).
+
+Sends COUNT payloads of SIZE bytes, waits for each echo and prints one CSV line
+(mode,size,count,min_us,median_us,p99_us,max_us,kB_per_s), so runs of both firmware
+modes can be compared or collected over time.
+
+    python3 cdc_echo_latency.py /dev/ttyACM1 --mode core1 --size 32 --count 1000
+"""
+import argparse
+import os
+import statistics
+import sys
+import time
+
+import serial  # pyserial
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("port", help="serial device of cdc1")
+    parser.add_argument("--mode", default="core0", help="label for the CSV output")
+    parser.add_argument("--size", type=int, default=32, help="payload bytes per echo")
+    parser.add_argument("--count", type=int, default=1000, help="number of echoes")
+    parser.add_argument("--header", action="store_true", help="print the CSV header first")
+    args = parser.parse_args()
+
+    rtts = []
+    with serial.Serial(args.port, timeout=1) as port:
+        port.reset_input_buffer()
+        start = time.perf_counter()
+        for _ in range(args.count):
+            payload = os.urandom(args.size)
+            t0 = time.perf_counter()
+            port.write(payload)
+            echo = port.read(args.size)
+            rtts.append((time.perf_counter() - t0) * 1e6)
+            if echo != payload:
+                print("echo mismatch or timeout", file=sys.stderr)
+                return 1
+        elapsed = time.perf_counter() - start
+
+    rtts.sort()
+    if args.header:
+        print("mode,size,count,min_us,median_us,p99_us,max_us,kB_per_s")
+    print("%s,%d,%d,%.0f,%.0f,%.0f,%.0f,%.1f" % (
+        args.mode, args.size, args.count, rtts[0], statistics.median(rtts),
+        rtts[int(len(rtts) * 0.99) - 1], rtts[-1], 2 * args.size * args.count / elapsed / 1e3))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,141 @@
+/**
+ * @file cdc_ring.h
+ * @brief This file contains a lock-free single-producer/single-consumer ring buffer used for the CDC data paths.
+ *
+ * The buffer size must be a power of two. Head and tail are free running counters, head is only written by the producer
+ * and tail only by the consumer, so one side can run on the other core or in an IRQ without a lock.
+ * Besides copying in and out, both sides can access the contiguous region in place (region/produce, region/consume),
+ * which lets TinyUSB read into and write out of the ring directly.
+ *
+ * This file is part of the usb_dual_cdc_lib.
+ */
+
+#ifndef CDC_RING_H
+#define CDC_RING_H
+
+#include <stdint.h>
+#include <string.h>
+#include "hardware/sync.h"
+
+typedef struct {
+    uint8_t *buf;
+    uint32_t mask;          // size - 1
+    volatile uint32_t head; // total bytes produced
+    volatile uint32_t tail; // total bytes consumed
+} cdc_ring_t;
+
+#if !defined(MIN)
+#define MIN(a, b) ((a > b) ? b : a)
+#endif /* MIN */
+
+/**
+ * @brief Initializes a ring on top of a buffer whose size is a power of two.
+ */
+static inline void cdc_ring_init(cdc_ring_t *r, uint8_t *buf, uint32_t size)
+{
+    r->buf = buf;
+    r->mask = size - 1;
+    r->head = 0;
+    r->tail = 0;
+}
+
+/**
+ * @brief Returns the number of bytes stored in the ring.
+ */
+static inline uint32_t cdc_ring_count(const cdc_ring_t *r)
+{
+    return r->head - r->tail;
+}
+
+/**
+ * @brief Returns the number of bytes that can still be written to the ring.
+ */
+static inline uint32_t cdc_ring_space(const cdc_ring_t *r)
+{
+    return r->mask + 1 - (r->head - r->tail);
+}
+
+/**
+ * @brief Producer side: returns the contiguous free region and stores its length in len.
+ */
+static inline uint8_t *cdc_ring_write_region(cdc_ring_t *r, uint32_t *len)
+{
+    uint32_t offset = r->head & r->mask;
+    *len = MIN(cdc_ring_space(r), r->mask + 1 - offset);
+    return &r->buf[offset];
+}
+
+/**
+ * @brief Producer side: publishes n bytes written into the region returned by cdc_ring_write_region().
+ */
+static inline void cdc_ring_produce(cdc_ring_t *r, uint32_t n)
+{
+    __dmb(); // data must be visible before the new head
+    r->head += n;
+}
+
+/**
+ * @brief Consumer side: returns the contiguous stored region and stores its length in len.
+ */
+static inline uint8_t *cdc_ring_read_region(cdc_ring_t *r, uint32_t *len)
+{
+    uint32_t offset = r->tail & r->mask;
+    *len = MIN(cdc_ring_count(r), r->mask + 1 - offset);
+    __dmb(); // head was read before the data
+    return &r->buf[offset];
+}
+
+/**
+ * @brief Consumer side: releases n bytes read from the region returned by cdc_ring_read_region().
+ */
+static inline void cdc_ring_consume(cdc_ring_t *r, uint32_t n)
+{
+    __dmb(); // finish reading before the space is handed back
+    r->tail += n;
+}
+
+/**
+ * @brief Copies up to len bytes into the ring, in at most two chunks across the wrap.
+ * @return The number of bytes actually written.
+ */
+static inline uint32_t cdc_ring_write(cdc_ring_t *r, const uint8_t *data, uint32_t len)
+{
+    uint32_t done = 0;
+
+    while (done < len)
+    {
+        uint32_t chunk;
+        uint8_t *dst = cdc_ring_write_region(r, &chunk);
+        if (chunk == 0)
+            break;
+        chunk = MIN(chunk, len - done);
+        memcpy(dst, &data[done], chunk);
+        cdc_ring_produce(r, chunk);
+        done += chunk;
+    }
+    return done;
+}
+
+/**
+ * @brief Copies up to len bytes out of the ring, in at most two chunks across the wrap.
+ * @return The number of bytes actually read.
+ */
+static inline uint32_t cdc_ring_read(cdc_ring_t *r, uint8_t *data, uint32_t len)
+{
+    uint32_t done = 0;
+
+    while (done < len)
+    {
+        uint32_t chunk;
+        const uint8_t *src = cdc_ring_read_region(r, &chunk);
+        if (chunk == 0)
+            break;
+        chunk = MIN(chunk, len - done);
+        memcpy(&data[done], src, chunk);
+        cdc_ring_consume(r, chunk);
+        done += chunk;
+    }
+    return done;
+}
+
+#endif
@@ -0,0 +1,136 @@
+#include <pico/stdlib.h>
+#include <string.h>
+#include "usb_dual_cdc.h"
+
+// Benchmark firmware for cdc_bench.py, commands on cdc1 (little endian):
+//   'T' len:u32           stream len bytes of the pattern (i & 0xFF) to the host
+//   'R' len:u32 data      sink len bytes of the pattern, reply elapsed_us:u32 errors:u32
+//   'E' len:u16 data      echo the len bytes back once all have arrived
+//   'S'                   reply the cdc1 counters written, dropped, blocked_us, flushes (u32 each) and clear them
+// Built twice like the echo firmware: test_usb_dual_cdc_bench polls cdc_task() in the main loop,
+// test_usb_dual_cdc_bench_core1 runs USB on core 1 (CDC_ON_CORE1=1).
+
+#ifndef CDC_ON_CORE1
+#define CDC_ON_CORE1 0
+#endif
+
+#define CDC_BENCH_ITF 1
+#define ECHO_MAX 1024
+
+static uint8_t buf[ECHO_MAX];
+
+static uint32_t get_u32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    for (int i = 0; i < 4; i++)
+        p[i] = v >> (8 * i);
+}
+
+// reads exactly len bytes, keeping USB serviced
+static void read_exact(uint8_t *data, uint32_t len)
+{
+    uint32_t done = 0;
+
+    while (done < len)
+    {
+        cdc_task();
+        done += cdc_read_buf(CDC_BENCH_ITF, &data[done], len - done);
+    }
+}
+
+static void stream_to_host(uint32_t len)
+{
+    uint8_t pattern[512]; // twice round, a write of up to 256 bytes can start anywhere in the first half
+
+    for (uint32_t i = 0; i < sizeof(pattern); i++)
+        pattern[i] = i;
+
+    for (uint32_t sent = 0; sent < len; )
+    {
+        cdc_task();
+        sent += cdc_write_buf(CDC_BENCH_ITF, &pattern[sent & 0xFF], MIN(256, len - sent));
+    }
+    cdc_flush(CDC_BENCH_ITF, 100000);
+}
+
+static void sink_from_host(uint32_t len)
+{
+    uint32_t got = 0, errors = 0;
+    uint64_t start = 0;
+
+    while (got < len)
+    {
+        cdc_task();
+
+        uint8_t *data;
+        uint32_t n;
+        cdc_peek(CDC_BENCH_ITF, &data, &n);
+        n = MIN(n, len - got);
+        if (n == 0)
+            continue;
+        if (got == 0)
+            start = time_us_64();
+        for (uint32_t i = 0; i < n; i++)
+            errors += data[i] != (uint8_t)(got + i);
+        cdc_consume(CDC_BENCH_ITF, n);
+        got += n;
+    }
+
+    uint8_t reply[8];
+    put_u32(&reply[0], (uint32_t)(time_us_64() - start));
+    put_u32(&reply[4], errors);
+    cdc_write_buf(CDC_BENCH_ITF, reply, sizeof(reply));
+}
+
+int main() 
+{
+    uint8_t cmd[4];
+
+#if CDC_ON_CORE1
+    cdc_init_core1();
+#else
+    cdc_init();
+#endif
+    // nothing may be lost while measuring, stall instead
+    cdc_set_overflow_policy(CDC_BENCH_ITF, CDC_OVERFLOW_BLOCK, 1000000);
+
+    while (1) 
+    {
+        read_exact(cmd, 1);
+        switch (cmd[0])
+        {
+        case 'T':
+            read_exact(cmd, 4);
+            stream_to_host(get_u32(cmd));
+            break;
+        case 'R':
+            read_exact(cmd, 4);
+            sink_from_host(get_u32(cmd));
+            break;
+        case 'E':
+        {
+            read_exact(cmd, 2);
+            uint32_t len = MIN((uint32_t)(cmd[0] | (cmd[1] << 8)), ECHO_MAX);
+            read_exact(buf, len);
+            cdc_write_buf(CDC_BENCH_ITF, buf, len);
+            break;
+        }
+        case 'S':
+        {
+            cdc_stats_t stats;
+            uint8_t reply[16];
+            cdc_get_stats(CDC_BENCH_ITF, &stats);
+            put_u32(&reply[0], stats.written);
+            put_u32(&reply[4], stats.dropped);
+            put_u32(&reply[8], stats.blocked_us);
+            put_u32(&reply[12], stats.flushes);
+            cdc_write_buf(CDC_BENCH_ITF, reply, sizeof(reply));
+            cdc_reset_stats(CDC_BENCH_ITF);
+            break;
+        }
+        default:
+            break; // unknown bytes are skipped, the host resynchronizes with 'S'
+        }
+    }
+}
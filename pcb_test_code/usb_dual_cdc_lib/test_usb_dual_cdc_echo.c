@@ -0,0 +1,37 @@
+#include <pico/stdlib.h>
+#include "usb_dual_cdc.h"
+
+// Echo firmware for measuring end-to-end latency with cdc_echo_latency.py.
+// cdc1 echoes everything back while the main loop is kept busy for BUSY_US per pass,
+// standing in for blocking PMIC I2C transfers or long printf calls.
+// Built twice: test_usb_dual_cdc_echo polls cdc_task() in the main loop,
+// test_usb_dual_cdc_echo_core1 runs USB on core 1 (CDC_ON_CORE1=1).
+
+#ifndef CDC_ON_CORE1
+#define CDC_ON_CORE1 0
+#endif
+
+#define CDC_ECHO_ITF 1
+#define BUSY_US 2000 // time the application blocks per main loop pass
+
+int main() 
+{
+    uint8_t buf[64]; // temporary buffer for cdc read/write
+
+#if CDC_ON_CORE1
+    cdc_init_core1();
+#else
+    cdc_init();
+#endif
+
+    while (1) 
+    {
+        cdc_task(); // no-op when USB runs on core 1
+
+        uint32_t len = cdc_read_buf(CDC_ECHO_ITF, buf, sizeof(buf));
+        if (len)
+            cdc_write_buf(CDC_ECHO_ITF, buf, len);
+
+        busy_wait_us(BUSY_US);
+    }
+}
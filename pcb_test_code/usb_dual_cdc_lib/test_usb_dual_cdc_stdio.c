@@ -11,6 +11,7 @@
 void leds_ctrl(uint8_t led, uint8_t on);
 void leds_init(void);
 void debug_interface(void);
+void burst_log(void);
 
 #define CDC_APP_ITF 1 // take 1 since 0 is used for stdio
 
@@ -31,7 +32,8 @@ int main()
 
     while (1) 
     {
-        cdc_task(); // ! Always call cdc_task() in main loop
+        // Sleep until the host sends something (or 1 ms passed), cdc_task() is called inside
+        cdc_wait(1000);
 
         // Example Application, echo back data from cdc1 to cdc1
         // When received data from cdc1, echo back
@@ -108,12 +110,34 @@ void debug_interface(void)
                 leds_ctrl(2,0);
                 printf("Turn off all leds\r\n");
                 break;
+            case 'B':
+                burst_log();
+                break;
             default:
                 printf("This is the interface for debug\r\n");
                 printf("1. You can type 'L' to turn on all leds\r\n");
                 printf("2. You can type 'l' to turn off all leds\r\n");
-                printf("3. =====================================\r\n");
+                printf("3. You can type 'B' for a 64 KiB printf burst, nothing may be lost\r\n");
+                printf("4. =====================================\r\n");
                 break;
         }
     }
-}
\ No newline at end of file
+}
+
+void burst_log(void)
+{
+    cdc_stats_t stats;
+
+    cdc_reset_stats(CDC_STDIO_ITF);
+    uint64_t start = time_us_64();
+
+    // 1024 lines of 64 bytes, far more than the transmit buffer holds
+    for (int i = 0; i < 1024; i++)
+        printf("burst line %04d ..............................................\r\n", i);
+    cdc_flush(CDC_STDIO_ITF, USB_STDIO_CDC_FLUSH_TIMEOUT_US); // stdio_flush() does not wait for the host
+
+    uint32_t elapsed_us = (uint32_t)(time_us_64() - start);
+    cdc_get_stats(CDC_STDIO_ITF, &stats);
+    printf("burst: %lu bytes written, %lu dropped, %lu us blocked, %lu us total\r\n",
+           (unsigned long)stats.written, (unsigned long)stats.dropped, (unsigned long)stats.blocked_us, (unsigned long)elapsed_us);
+}
@@ -12,7 +12,9 @@
 
 #define CFG_TUSB_RHPORT0_MODE OPT_MODE_DEVICE
 
-#define CFG_TUD_CDC 2
+#include "usb_cdc_config.h"
+
+#define CFG_TUD_CDC USB_CDC_COUNT // see usb_cdc_config.h for the interfaces and their buffers
 #define CFG_TUD_CDC_RX_BUFSIZE 1024
 #define CFG_TUD_CDC_TX_BUFSIZE 1024
 
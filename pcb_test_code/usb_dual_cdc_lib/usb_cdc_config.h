@@ -0,0 +1,40 @@
+/**
+ * @file usb_cdc_config.h
+ * @brief This file contains the list of CDC interfaces the device exposes, with the buffer sizes of each one.
+ *
+ * USB_CDC_INTERFACES(X) calls X(itf, name, rx_size, tx_size) once per interface. From it are generated at compile time:
+ * CFG_TUD_CDC, the USB configuration descriptor with its endpoints and interface strings (usb_descriptors.c)
+ * and the receive and transmit rings of every interface (usb_dual_cdc.c).
+ * - itf: interface number as a plain literal, listed in order starting from 0
+ * - name: the interface string the host shows, e.g. in /dev/serial/by-id, up to 19 characters
+ * - rx_size, tx_size: bytes of the receive and transmit ring, a power of two and at least one packet (64)
+ *
+ * An application brings its own list by defining USB_CDC_CONFIG_HEADER to a header defining USB_CDC_INTERFACES,
+ * for the whole target since TinyUSB has to see the same CFG_TUD_CDC, e.g.
+ *     target_compile_definitions(app PRIVATE USB_CDC_CONFIG_HEADER="app_cdc_config.h")
+ * Endpoints are allocated two numbers per interface (cmd IN 2n+1, data OUT 2n+1, data IN 2n+2), which allows up to 7.
+ *
+ * This file is part of the usb_dual_cdc_lib.
+ */
+
+#ifndef USB_CDC_CONFIG_H
+#define USB_CDC_CONFIG_H
+
+#ifdef USB_CDC_CONFIG_HEADER
+#include USB_CDC_CONFIG_HEADER
+#else
+// two equal interfaces, cdc0 is usually stdio and cdc1 the application
+#define USB_CDC_INTERFACES(X) \
+    X(0, "Board CDC", 1024, 1024) \
+    X(1, "Board CDC", 1024, 1024)
+#endif
+
+#define USB_CDC_COUNT_ONE(itf, name, rx_size, tx_size) + 1
+#define USB_CDC_COUNT (0 USB_CDC_INTERFACES(USB_CDC_COUNT_ONE))
+
+#define USB_CDC_RAM_ONE(itf, name, rx_size, tx_size) + (rx_size) + (tx_size)
+#define USB_CDC_RAM_BYTES (0 USB_CDC_INTERFACES(USB_CDC_RAM_ONE)) // ring storage of all interfaces
+
+#define USB_CDC_MAX_COUNT 7 // endpoint numbers go up to 15
+
+#endif /* USB_CDC_CONFIG_H */
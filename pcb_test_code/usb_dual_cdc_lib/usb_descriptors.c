@@ -20,18 +20,13 @@
 #define USBD_DESC_LEN (TUD_CONFIG_DESC_LEN + TUD_CDC_DESC_LEN * CFG_TUD_CDC)
 #define USBD_MAX_POWER_MA 500
 
-#define USBD_ITF_CDC_0 0
-#define USBD_ITF_CDC_1 2
-#define USBD_ITF_MAX 4
+#define USBD_ITF_MAX (2 * CFG_TUD_CDC) /* control and data interface per CDC */
 
-#define USBD_CDC_0_EP_CMD 0x81
-#define USBD_CDC_1_EP_CMD 0x83
-
-#define USBD_CDC_0_EP_OUT 0x01
-#define USBD_CDC_1_EP_OUT 0x03
-
-#define USBD_CDC_0_EP_IN 0x82
-#define USBD_CDC_1_EP_IN 0x84
+/* interface numbers and endpoints of CDC n, as listed in USB_CDC_INTERFACES */
+#define USBD_ITF_CDC(n) (2 * (n))
+#define USBD_CDC_EP_CMD(n) (0x81 + 2 * (n))
+#define USBD_CDC_EP_OUT(n) (0x01 + 2 * (n))
+#define USBD_CDC_EP_IN(n) (0x82 + 2 * (n))
 
 #define USBD_CDC_CMD_MAX_SIZE 8
 #define USBD_CDC_IN_OUT_MAX_SIZE 64
@@ -41,7 +36,14 @@
 #define USBD_STR_PRODUCT 0x02
 #define USBD_STR_SERIAL 0x03
 #define USBD_STR_SERIAL_LEN 17
-#define USBD_STR_CDC 0x04
+#define USBD_STR_CDC 0x04 /* first of CFG_TUD_CDC interface strings */
+
+/* descriptor and string of every entry of USB_CDC_INTERFACES */
+#define USBD_CDC_DESC(itf, name, rx_size, tx_size) \
+	TUD_CDC_DESCRIPTOR(USBD_ITF_CDC(itf), USBD_STR_CDC + (itf), USBD_CDC_EP_CMD(itf), \
+		USBD_CDC_CMD_MAX_SIZE, USBD_CDC_EP_OUT(itf), USBD_CDC_EP_IN(itf), \
+		USBD_CDC_IN_OUT_MAX_SIZE),
+#define USBD_CDC_STR(itf, name, rx_size, tx_size) [USBD_STR_CDC + (itf)] = name,
 
 static const tusb_desc_device_t usbd_desc_device = {
 	.bLength = sizeof(tusb_desc_device_t),
@@ -64,13 +66,7 @@ static const uint8_t usbd_desc_cfg[USBD_DESC_LEN] = {
 	TUD_CONFIG_DESCRIPTOR(1, USBD_ITF_MAX, USBD_STR_0, USBD_DESC_LEN,
 		TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP, USBD_MAX_POWER_MA),
 
-	TUD_CDC_DESCRIPTOR(USBD_ITF_CDC_0, USBD_STR_CDC, USBD_CDC_0_EP_CMD,
-		USBD_CDC_CMD_MAX_SIZE, USBD_CDC_0_EP_OUT, USBD_CDC_0_EP_IN,
-		USBD_CDC_IN_OUT_MAX_SIZE),
-
-	TUD_CDC_DESCRIPTOR(USBD_ITF_CDC_1, USBD_STR_CDC, USBD_CDC_1_EP_CMD,
-		USBD_CDC_CMD_MAX_SIZE, USBD_CDC_1_EP_OUT, USBD_CDC_1_EP_IN,
-		USBD_CDC_IN_OUT_MAX_SIZE),
+	USB_CDC_INTERFACES(USBD_CDC_DESC)
 };
 
 static char usbd_id[USBD_STR_SERIAL_LEN] = "000000000000";
@@ -79,7 +75,7 @@ static const char *const usbd_desc_str[] = {
 	[USBD_STR_MANUF] = "Raspberry Pi",
 	[USBD_STR_PRODUCT] = "Pico",
 	[USBD_STR_SERIAL] = usbd_id,
-	[USBD_STR_CDC] = "Board CDC",
+	USB_CDC_INTERFACES(USBD_CDC_STR)
 };
 
 const uint8_t *tud_descriptor_device_cb(void)
@@ -10,29 +10,75 @@
  */
 
 #include <pico/stdlib.h>
+#include <pico/multicore.h>
+#include <pico/sync.h>
 #include <string.h>
 #include <tusb.h>
 #include "usb_dual_cdc.h"
+#include "cdc_ring.h"
 
-#define BUFFER_SIZE 1024 // it will be occupied 4 times for two cdc interfaces
+// ring sizes from USB_CDC_INTERFACES, see usb_cdc_config.h
+#define CDC_SIZE_OK(size) ((size) >= 64 && ((size) & ((size) - 1)) == 0)
+#define CDC_CHECK_SIZES(itf, name, rx_size, tx_size) \
+    _Static_assert(CDC_SIZE_OK(rx_size) && CDC_SIZE_OK(tx_size), "cdc" #itf " buffer sizes must be powers of two of at least 64");
+USB_CDC_INTERFACES(CDC_CHECK_SIZES)
+
+// enum values count the position in the list, a duplicate interface does not compile
+#define CDC_POSITION(itf, name, rx_size, tx_size) cdc_position_##itf,
+#define CDC_CHECK_POSITION(itf, name, rx_size, tx_size) \
+    _Static_assert(cdc_position_##itf == (itf), "cdc" #itf " is out of order, interfaces are listed from 0 up");
+enum { USB_CDC_INTERFACES(CDC_POSITION) };
+USB_CDC_INTERFACES(CDC_CHECK_POSITION)
+
+_Static_assert(CFG_TUD_CDC >= 1 && CFG_TUD_CDC <= USB_CDC_MAX_COUNT, "1 to USB_CDC_MAX_COUNT CDC interfaces");
+
+static const struct {
+    uint32_t rx_size;
+    uint32_t tx_size;
+} cdc_sizes[CFG_TUD_CDC] = {
+#define CDC_SIZES(itf, name, rx_size, tx_size) [itf] = {rx_size, tx_size},
+    USB_CDC_INTERFACES(CDC_SIZES)
+#undef CDC_SIZES
+};
+
+static uint8_t cdc_buffers[USB_CDC_RAM_BYTES]; // rings of all interfaces back to back, carved up by itf_init()
 
 typedef struct {
-	uint8_t recv_buffer[BUFFER_SIZE];
-	uint32_t recv_pos;
+    cdc_ring_t recv_ring; // produced by cdc_task, consumed by cdc_read_buf
+    cdc_ring_t write_ring; // produced by cdc_write_buf, consumed by cdc_task
 
-    uint8_t write_buffer[BUFFER_SIZE];
-    uint32_t write_pos;
+    cdc_overflow_policy_t policy;
+    uint32_t timeout_us;
+    critical_section_t write_lock;  // with CDC_OVERFLOW_DROP_OLDEST the producer also moves the tail of write_ring
+    volatile uint32_t tx_pending;   // bytes TinyUSB has not sent yet, recorded by the USB service
+    cdc_stats_t stats;              // only changed by the producer
 } cdc_data_t;
 
-cdc_data_t CDC_DATA[2];
+cdc_data_t CDC_DATA[CFG_TUD_CDC];
 
-// Private functions
-#if !defined(MIN)
-#define MIN(a, b) ((a > b) ? b : a)
-#endif /* MIN */
+#define CORE1_READY 0xCDC0CDC1 // pushed through the SIO FIFO once USB is up on core 1
 
+static volatile bool service_on_core1; // set by cdc_init_core1(), cdc_task() is a no-op then
+static volatile bool itf_connected[CFG_TUD_CDC]; // connection state as seen by the USB service
+static volatile int8_t servicing_core = -1; // core running cdc_service() right now, it must not wait for itself
+
+static struct {
+    cdc_event_callback_t rx_fn;
+    void *rx_param;
+    cdc_event_callback_t tx_fn;
+    void *tx_param;
+} itf_callbacks[CFG_TUD_CDC];
+
+// Private functions
+static void itf_init(uint8_t itf);
+static uint32_t write_drop_oldest(cdc_data_t *cd, const uint8_t *data, uint32_t len);
+static uint32_t write_blocking(uint8_t itf, const uint8_t *data, uint32_t len);
+static bool can_wait(void);
 static void usb_write_bytes(uint8_t itf);
 static void usb_read_bytes(uint8_t itf);
+static void cdc_service(void);
+static void core1_service_loop(void);
+static bool cdc_connected(uint8_t itf);
 
 
 /**
@@ -42,7 +88,7 @@ static void usb_read_bytes(uint8_t itf);
  * It first initializes the USB device ID to ensure it is unique.
  * Then, it initializes the TinyUSB stack.
  * Finally, it iterates over all CDC interfaces defined in the configuration,
- * and resets the read and write positions in their respective buffers to 0.
+ * and sets up empty receive and transmit ring buffers for them.
  */
 void cdc_init()
 {
@@ -50,33 +96,48 @@ void cdc_init()
 
     tusb_init();
 
+    for(uint8_t itf=0; itf<CFG_TUD_CDC; itf++)
+        itf_init(itf);
+}
+
+/**
+ * @brief Initializes the CDC interfaces and runs the USB stack on core 1.
+ *
+ * This function is an alternative to cdc_init(). It sets up the ring buffers and the USB device ID on core 0,
+ * then launches a service loop on core 1 which initializes TinyUSB there and keeps calling tud_task() and moving data
+ * between TinyUSB and the ring buffers. Core 0 only touches the ring buffers, which are single-producer/single-consumer
+ * and need no lock, so a busy or blocked core 0 no longer delays USB.
+ * It returns once core 1 reports through the SIO FIFO that USB is up. cdc_task() does nothing in this mode.
+ * Core 1 must not be used for anything else.
+ */
+void cdc_init_core1()
+{
+    usbd_id_init(); // reads the flash unique ID, must happen before core 1 runs
+
     for(uint8_t itf=0; itf<CFG_TUD_CDC; itf++)
     {
-        CDC_DATA[itf].recv_pos = 0;
-        CDC_DATA[itf].write_pos = 0;
+        itf_init(itf);
+        itf_connected[itf] = false;
     }
+
+    service_on_core1 = true;
+    multicore_launch_core1(core1_service_loop);
+
+    while (multicore_fifo_pop_blocking() != CORE1_READY)
+        ;
 }
 
 /**
  * @brief Handles the CDC (Communication Device Class) tasks.
  *
  * This function handles the tasks related to the CDC interfaces for USB communication.
- * It must be called periodically to keep the USB connection alive.
- * It first calls the TinyUSB task function, which handles the low-level USB tasks.
- * Then, it iterates over all CDC interfaces defined in the configuration.
- * For each connected interface, it reads any available bytes from the interface and writes any bytes in the buffer to the interface.
+ * It must be called periodically to keep the USB connection alive, unless the USB stack runs on core 1 (cdc_init_core1()),
+ * in which case it does nothing.
  */
 void cdc_task()
 {   
-    // Must be periodically called to keep USB alive
-    tud_task();
-
-    for (uint8_t itf = 0; itf < CFG_TUD_CDC; itf++) {
-        if (tud_cdc_n_connected(itf)) {
-            usb_read_bytes(itf);
-            usb_write_bytes(itf);
-        }
-    }
+    if (!service_on_core1)
+        cdc_service();
 }
 
 
@@ -84,7 +145,7 @@ void cdc_task()
  * @brief Returns the number of bytes available to read from a CDC interface's buffer.
  *
  * This function checks the number of bytes that have been read from a specified CDC interface and are available in the buffer.
- * It returns the current position in the buffer, which is the number of bytes available to read.
+ * It returns the fill level of the interface's receive ring.
  *
  * @param itf The CDC interface to check.
  * @return The number of bytes available to read from the buffer.
@@ -92,7 +153,7 @@ void cdc_task()
 uint32_t cdc_available_bytes(uint8_t itf)
 {
     cdc_data_t *cd = &CDC_DATA[itf];
-    return cd->recv_pos;
+    return cdc_ring_count(&cd->recv_ring);
 }
 
 
@@ -100,9 +161,8 @@ uint32_t cdc_available_bytes(uint8_t itf)
  * @brief Reads a specified number of bytes from a CDC interface's buffer.
  *
  * This function reads a specified number of bytes from a specified CDC interface's buffer into a provided data array.
- * If the interface is connected, it checks if the number of bytes available in the buffer is less than the requested number.
- * If so, it reads all available bytes and resets the buffer's position.
- * If not, it reads the requested number of bytes and moves the remaining bytes to the beginning of the buffer, updating the buffer's position accordingly.
+ * If the interface is connected, it copies at most the requested number of bytes out of the receive ring,
+ * in up to two chunks when the data wraps around the end of the buffer. The remaining bytes stay where they are.
  * If the interface is not connected, it does not read any bytes.
  *
  * @param itf The CDC interface to read from.
@@ -112,25 +172,12 @@ uint32_t cdc_available_bytes(uint8_t itf)
  */
 uint32_t cdc_read_buf(uint8_t itf, uint8_t *data, uint32_t len)
 {   
-    uint32_t read_n_bytes = len;
+    uint32_t read_n_bytes;
 
-    if (tud_cdc_n_connected(itf)) 
+    if (cdc_connected(itf)) 
     {
         cdc_data_t *cd = &CDC_DATA[itf];
-
-        if (cd->recv_pos < len)
-        {
-            read_n_bytes = cd->recv_pos;
-            memcpy(data, cd->recv_buffer, read_n_bytes);
-            cd->recv_pos = 0;
-        }
-        else 
-        {
-            read_n_bytes = len;
-            memcpy(data, cd->recv_buffer, read_n_bytes);
-            memmove(cd->recv_buffer, &cd->recv_buffer[len], cd->recv_pos - len);
-            cd->recv_pos -= len;
-        }
+        read_n_bytes = cdc_ring_read(&cd->recv_ring, data, len);
     }
     else
     {
@@ -144,41 +191,499 @@ uint32_t cdc_read_buf(uint8_t itf, uint8_t *data, uint32_t len)
  * @brief Writes a specified number of bytes to a CDC interface's buffer.
  *
  * This function writes a specified number of bytes from a provided data array to a specified CDC interface's buffer.
- * If the interface is connected, it checks if the buffer has enough space for the new data.
- * If not, it does not write any data.
- * If there is enough space, it copies the data to the buffer at the current position and updates the position accordingly.
+ * If the interface is connected, it copies the data into the transmit ring. When there is not enough space,
+ * the interface's overflow policy decides: the write is dropped as a whole, only the part that fits is queued,
+ * the oldest queued bytes are discarded, or the function waits for the host to take data, running cdc_task() meanwhile.
+ * Waiting is skipped inside the USB service itself and in interrupt handlers, the part that fits is queued then.
+ * Queued and lost bytes are added to the interface's counters.
  *
  * @param itf The CDC interface to write to.
  * @param data The array of bytes to write.
  * @param len The number of bytes to write.
+ * @return The number of bytes queued.
  */
-void cdc_write_buf(uint8_t itf, uint8_t *data, uint32_t len)
+uint32_t cdc_write_buf(uint8_t itf, uint8_t *data, uint32_t len)
 {
-    if (tud_cdc_n_connected(itf)) 
+    cdc_data_t *cd = &CDC_DATA[itf];
+    uint32_t done = 0;
+
+    if (cdc_connected(itf)) 
+    {
+        switch (cd->policy)
+        {
+        case CDC_OVERFLOW_DROP:
+            if (cdc_ring_space(&cd->write_ring) >= len)
+                done = cdc_ring_write(&cd->write_ring, data, len);
+            break;
+        case CDC_OVERFLOW_PARTIAL:
+            done = cdc_ring_write(&cd->write_ring, data, len);
+            break;
+        case CDC_OVERFLOW_DROP_OLDEST:
+            done = write_drop_oldest(cd, data, len);
+            break;
+        case CDC_OVERFLOW_BLOCK:
+            done = write_blocking(itf, data, len);
+            break;
+        }
+    }
+
+    cd->stats.written += done;
+    cd->stats.dropped += len - done;
+    return done;
+}
+
+
+/**
+ * @brief Selects the overflow policy of a CDC interface.
+ *
+ * @param itf The CDC interface.
+ * @param policy What cdc_write_buf() does when the transmit ring is full.
+ * @param timeout_us Longest wait of one cdc_write_buf() call with CDC_OVERFLOW_BLOCK.
+ */
+void cdc_set_overflow_policy(uint8_t itf, cdc_overflow_policy_t policy, uint32_t timeout_us)
+{
+    CDC_DATA[itf].timeout_us = timeout_us;
+    CDC_DATA[itf].policy = policy;
+}
+
+
+/**
+ * @brief Drains the transmit path of a CDC interface.
+ *
+ * This function keeps USB serviced, like cdc_wait(), until the transmit ring is empty and TinyUSB has passed
+ * everything on to the USB controller, or until the timeout. It returns right away if the host is not connected,
+ * and inside the USB service or an interrupt handler, where waiting would never end.
+ *
+ * @param itf The CDC interface to flush.
+ * @param timeout_us Longest time to wait.
+ * @return True if nothing is left to send.
+ */
+bool cdc_flush(uint8_t itf, uint32_t timeout_us)
+{
+    cdc_data_t *cd = &CDC_DATA[itf];
+    absolute_time_t until = make_timeout_time_us(timeout_us);
+    uint64_t start = time_us_64();
+    bool drained = false;
+
+    cd->stats.flushes++;
+    while (cdc_connected(itf) && can_wait())
+    {
+        cdc_task();
+
+        drained = cdc_ring_count(&cd->write_ring) == 0 && cd->tx_pending == 0;
+        if (drained || best_effort_wfe_or_timeout(until))
+            break;
+    }
+
+    cd->stats.blocked_us += time_us_64() - start;
+    return drained;
+}
+
+
+/**
+ * @brief Hands the transmit ring of a CDC interface to TinyUSB and starts sending, without waiting.
+ *
+ * Meant for flushes that run often, like the one of stdio after every printf. What does not fit into the
+ * TinyUSB FIFO stays in the ring, cdc_flush() is the call that waits until everything is out.
+ * It leaves TinyUSB alone where it could meet the USB service: with the service on core 1, inside an
+ * interrupt handler or inside the service itself. The next service pass sends the data then.
+ *
+ * @param itf The CDC interface to flush.
+ */
+void cdc_write_flush(uint8_t itf)
+{
+    if (!service_on_core1 && can_wait() && cdc_connected(itf))
+        usb_write_bytes(itf);
+}
+
+
+/**
+ * @brief Copies the transmit counters of a CDC interface.
+ *
+ * @param itf The CDC interface.
+ * @param stats Receives the counters.
+ */
+void cdc_get_stats(uint8_t itf, cdc_stats_t *stats)
+{
+    *stats = CDC_DATA[itf].stats;
+}
+
+
+/**
+ * @brief Clears the transmit counters of a CDC interface.
+ *
+ * @param itf The CDC interface.
+ */
+void cdc_reset_stats(uint8_t itf)
+{
+    memset(&CDC_DATA[itf].stats, 0, sizeof(cdc_stats_t));
+}
+
+
+/**
+ * @brief Gives direct access to the received bytes of a CDC interface.
+ *
+ * This function returns the contiguous part of the interface's receive ring, so a parser can work on the data in place.
+ * When the received data wraps around the end of the ring, only the part up to the end is returned;
+ * once it has been consumed the next call returns the rest from the start of the ring.
+ * If the interface is not connected, no bytes are returned.
+ *
+ * @param itf The CDC interface to read from.
+ * @param data Set to the first received byte.
+ * @param len Set to the number of contiguous bytes at data.
+ */
+void cdc_peek(uint8_t itf, uint8_t **data, uint32_t *len)
+{
+    if (cdc_connected(itf))
     {
         cdc_data_t *cd = &CDC_DATA[itf];
+        *data = cdc_ring_read_region(&cd->recv_ring, len);
+    }
+    else
+    {
+        *data = NULL;
+        *len = 0;
+    }
+}
+
+
+/**
+ * @brief Releases bytes handed out by cdc_peek().
+ *
+ * This function frees the first n received bytes of a CDC interface, making room for new data from the host.
+ * The pointer returned by cdc_peek() must not be used for these bytes afterwards.
+ *
+ * @param itf The CDC interface to release bytes of.
+ * @param n The number of bytes to release.
+ */
+void cdc_consume(uint8_t itf, uint32_t n)
+{
+    cdc_data_t *cd = &CDC_DATA[itf];
+
+    n = MIN(n, cdc_ring_count(&cd->recv_ring));
+    cdc_ring_consume(&cd->recv_ring, n);
+}
+
+
+/**
+ * @brief Reserves contiguous room in a CDC interface's transmit buffer.
+ *
+ * This function returns a pointer into the interface's transmit ring where the caller can serialize n bytes directly.
+ * The room has to be contiguous, so close to the end of the ring a reservation can fail even though
+ * enough bytes are free in total; callers can then fall back to cdc_write_buf().
+ * Nothing is sent until cdc_commit() is called.
+ *
+ * @param itf The CDC interface to write to.
+ * @param n The number of bytes needed.
+ * @return Pointer to the reserved room, or NULL if the interface is not connected or there is not enough contiguous room.
+ */
+uint8_t *cdc_reserve(uint8_t itf, uint32_t n)
+{
+    if (!cdc_connected(itf))
+        return NULL;
+
+    cdc_data_t *cd = &CDC_DATA[itf];
+    uint32_t room;
+    uint8_t *dst = cdc_ring_write_region(&cd->write_ring, &room);
+
+    return room >= n ? dst : NULL;
+}
+
+
+/**
+ * @brief Queues bytes written into the room returned by cdc_reserve().
+ *
+ * This function publishes the first n bytes of the reserved room to the transmit ring,
+ * they are sent to the host by the next cdc_task().
+ *
+ * @param itf The CDC interface to write to.
+ * @param n The number of bytes written.
+ */
+void cdc_commit(uint8_t itf, uint32_t n)
+{
+    cdc_data_t *cd = &CDC_DATA[itf];
+
+    cdc_ring_produce(&cd->write_ring, n);
+    cd->stats.written += n;
+}
+
+
+/**
+ * @brief Registers a callback for received data on a CDC interface.
+ *
+ * The callback runs from tud_cdc_rx_cb(), right after the new bytes have been moved into the interface's receive ring,
+ * so it is called inside the USB task: from cdc_task() on core 0, or on core 1 when cdc_init_core1() was used.
+ *
+ * @param itf The CDC interface to watch.
+ * @param fn The callback, NULL to remove it.
+ * @param param Passed to the callback.
+ */
+void cdc_set_rx_callback(uint8_t itf, cdc_event_callback_t fn, void *param)
+{
+    itf_callbacks[itf].rx_param = param;
+    itf_callbacks[itf].rx_fn = fn;
+}
+
+
+/**
+ * @brief Registers a callback for completed transmissions on a CDC interface.
+ *
+ * The callback runs from tud_cdc_tx_complete_cb() after the next part of the transmit ring has been handed to TinyUSB,
+ * in the same context as the receive callback.
+ *
+ * @param itf The CDC interface to watch.
+ * @param fn The callback, NULL to remove it.
+ * @param param Passed to the callback.
+ */
+void cdc_set_tx_callback(uint8_t itf, cdc_event_callback_t fn, void *param)
+{
+    itf_callbacks[itf].tx_param = param;
+    itf_callbacks[itf].tx_fn = fn;
+}
+
 
-        if (cd->write_pos + len > BUFFER_SIZE)
-            return;
+/**
+ * @brief Waits for received data on any CDC interface.
+ *
+ * This function lets the application sleep instead of spinning on cdc_available_bytes().
+ * Between checks the core waits with __wfe(); it is woken by the USB interrupt, by the __sev() that the receive path sends
+ * when USB runs on core 1, or by the timeout. When USB is polled on this core, cdc_task() is run after every wake-up.
+ *
+ * @param timeout_us Longest time to wait.
+ * @return True if any interface has data available, false on timeout.
+ */
+bool cdc_wait(uint32_t timeout_us)
+{
+    absolute_time_t until = make_timeout_time_us(timeout_us);
+
+    while (1)
+    {
+        cdc_task();
 
-        memcpy(&cd->write_buffer[cd->write_pos], data, len);
-        cd->write_pos += len;
+        for (uint8_t itf = 0; itf < CFG_TUD_CDC; itf++)
+            if (cdc_ring_count(&CDC_DATA[itf].recv_ring))
+                return true;
+
+        if (best_effort_wfe_or_timeout(until))
+            return false;
     }
 }
 
 
+// ================================================================================
+// TinyUSB callbacks
+// ================================================================================
+
+/**
+ * @brief Invoked by TinyUSB when new data arrived on a CDC interface.
+ *
+ * The data is moved into the receive ring right away instead of waiting for the next pass over all interfaces,
+ * then the registered callback runs and an event wakes a core sleeping in __wfe().
+ *
+ * @param itf The CDC interface that received data.
+ */
+void tud_cdc_rx_cb(uint8_t itf)
+{
+    usb_read_bytes(itf);
+
+    if (itf_callbacks[itf].rx_fn)
+        itf_callbacks[itf].rx_fn(itf, itf_callbacks[itf].rx_param);
+
+    __sev();
+}
+
+
+/**
+ * @brief Invoked by TinyUSB when the host has taken the data written to a CDC interface.
+ *
+ * The next part of the transmit ring is handed to TinyUSB right away to keep the endpoint busy,
+ * then the registered callback runs and an event wakes a core sleeping in __wfe().
+ *
+ * @param itf The CDC interface that completed a transmission.
+ */
+void tud_cdc_tx_complete_cb(uint8_t itf)
+{
+    usb_write_bytes(itf);
+
+    if (itf_callbacks[itf].tx_fn)
+        itf_callbacks[itf].tx_fn(itf, itf_callbacks[itf].tx_param);
+
+    __sev();
+}
+
+
 // ================================================================================
 // Private functions
 // ================================================================================
 
+/**
+ * @brief Sets up empty ring buffers and the default overflow policy of a CDC interface.
+ * The rings take their part of cdc_buffers, sized as listed in USB_CDC_INTERFACES.
+ *
+ * @param itf The CDC interface.
+ */
+static void itf_init(uint8_t itf)
+{
+    cdc_data_t *cd = &CDC_DATA[itf];
+    uint32_t offset = 0;
+
+    for (uint8_t i = 0; i < itf; i++)
+        offset += cdc_sizes[i].rx_size + cdc_sizes[i].tx_size;
+
+    cdc_ring_init(&cd->recv_ring, &cdc_buffers[offset], cdc_sizes[itf].rx_size);
+    cdc_ring_init(&cd->write_ring, &cdc_buffers[offset + cdc_sizes[itf].rx_size], cdc_sizes[itf].tx_size);
+    if (!critical_section_is_initialized(&cd->write_lock))
+        critical_section_init(&cd->write_lock);
+    cd->policy = CDC_OVERFLOW_DROP;
+    cd->tx_pending = 0;
+    memset(&cd->stats, 0, sizeof(cdc_stats_t));
+}
+
+
+/**
+ * @brief Queues data after discarding as many of the oldest queued bytes as needed.
+ *
+ * The tail of the transmit ring belongs to the consumer, so it is only moved under the lock that
+ * usb_write_bytes() holds while it hands data to TinyUSB. Of a write longer than the ring only the newest bytes are kept.
+ *
+ * @param cd The interface data.
+ * @param data The bytes to write.
+ * @param len The number of bytes to write.
+ * @return The number of bytes of data queued.
+ */
+static uint32_t write_drop_oldest(cdc_data_t *cd, const uint8_t *data, uint32_t len)
+{
+    uint32_t size = cd->write_ring.mask + 1;
+    uint32_t skip = len > size ? len - size : 0;
+    uint32_t need = len - skip;
+
+    critical_section_enter_blocking(&cd->write_lock);
+    uint32_t space = cdc_ring_space(&cd->write_ring);
+    if (space < need)
+    {
+        cdc_ring_consume(&cd->write_ring, need - space);
+        cd->stats.dropped += need - space;
+    }
+    critical_section_exit(&cd->write_lock);
+
+    return cdc_ring_write(&cd->write_ring, &data[skip], need);
+}
+
+
+/**
+ * @brief Queues data, waiting for room up to the interface's timeout.
+ *
+ * While waiting, cdc_task() keeps the USB stack running on this core; with USB on core 1 the core sleeps in __wfe()
+ * until the transmit-complete event. Waiting ends early if the host closes the interface.
+ *
+ * @param itf The CDC interface to write to.
+ * @param data The bytes to write.
+ * @param len The number of bytes to write.
+ * @return The number of bytes queued.
+ */
+static uint32_t write_blocking(uint8_t itf, const uint8_t *data, uint32_t len)
+{
+    cdc_data_t *cd = &CDC_DATA[itf];
+    uint32_t done = cdc_ring_write(&cd->write_ring, data, len);
+
+    if (done == len || !can_wait())
+        return done;
+
+    absolute_time_t until = make_timeout_time_us(cd->timeout_us);
+    uint64_t start = time_us_64();
+
+    while (cdc_connected(itf))
+    {
+        cdc_task();
+
+        done += cdc_ring_write(&cd->write_ring, &data[done], len - done);
+        if (done == len || best_effort_wfe_or_timeout(until))
+            break;
+    }
+
+    cd->stats.blocked_us += time_us_64() - start;
+    return done;
+}
+
+
+/**
+ * @brief Returns whether the caller may wait for the USB service.
+ *
+ * Not inside an interrupt handler, and not on the core that is running cdc_service() right now
+ * (the receive and transmit callbacks), since that wait would never end.
+ */
+static bool can_wait(void)
+{
+    return __get_current_exception() == 0 && servicing_core != (int8_t)get_core_num();
+}
+
+/**
+ * @brief Runs one pass of the USB service.
+ *
+ * It first calls the TinyUSB task function, which handles the low-level USB tasks.
+ * Then, it iterates over all CDC interfaces defined in the configuration.
+ * For each connected interface, it reads any available bytes from the interface and writes any bytes in the buffer to the interface.
+ */
+static void cdc_service(void)
+{
+    servicing_core = get_core_num();
+
+    // Must be periodically called to keep USB alive
+    tud_task();
+
+    for (uint8_t itf = 0; itf < CFG_TUD_CDC; itf++) {
+        itf_connected[itf] = tud_cdc_n_connected(itf);
+        if (itf_connected[itf]) {
+            usb_read_bytes(itf);
+            usb_write_bytes(itf);
+        }
+    }
+
+    servicing_core = -1;
+}
+
+
+/**
+ * @brief Service loop for core 1, see cdc_init_core1().
+ *
+ * TinyUSB is initialized here so its interrupt is handled on core 1 as well.
+ * The core accepts multicore lockout requests, so core 0 can erase and program flash meanwhile.
+ */
+static void core1_service_loop(void)
+{
+    multicore_lockout_victim_init(); // core 0 can park this core while it writes flash
+    tusb_init();
+
+    multicore_fifo_push_blocking(CORE1_READY);
+
+    while (1)
+        cdc_service();
+}
+
+
+/**
+ * @brief Returns whether a CDC interface is connected.
+ *
+ * When the USB stack runs on core 1 the state recorded by its service loop is used, so core 0 never calls into TinyUSB.
+ *
+ * @param itf The CDC interface to check.
+ * @return True if the host has the interface open.
+ */
+static bool cdc_connected(uint8_t itf)
+{
+    if (service_on_core1)
+        return itf_connected[itf];
+    return tud_cdc_n_connected(itf);
+}
+
+
 /**
  * @brief Reads bytes from a USB interface and stores them in a buffer.
  *
- * This function reads available bytes from a specified USB interface and stores them in a buffer.
+ * This function reads available bytes from a specified USB interface straight into the interface's receive ring.
  * The function first checks how many bytes are available on the interface. If there are bytes available,
- * it calculates the minimum between the available bytes and the remaining space in the buffer.
- * Then, it reads the calculated number of bytes from the interface and stores them in the buffer,
- * updating the buffer's current position accordingly.
+ * it reads them into the contiguous free region of the ring, and once more into the start of the buffer
+ * when the free space wraps around.
  *
  * @param itf The USB interface from which to read bytes.
  */
@@ -186,17 +691,20 @@ static void usb_read_bytes(uint8_t itf)
 {
     cdc_data_t *cd = &CDC_DATA[itf];
 
-    uint32_t len = tud_cdc_n_available(itf);
-
-    if (len)
+    for (int chunk = 0; chunk < 2; chunk++)
     {
-        len = MIN(len, BUFFER_SIZE - cd->recv_pos);
-        if (len) 
-        {
-            uint32_t count;
-            count = tud_cdc_n_read(itf, &cd->recv_buffer[cd->recv_pos], len);
-            cd->recv_pos += count;
-        }
+        uint32_t len = tud_cdc_n_available(itf);
+        if (len == 0)
+            break;
+
+        uint32_t space;
+        uint8_t *dst = cdc_ring_write_region(&cd->recv_ring, &space);
+        len = MIN(len, space);
+        if (len == 0)
+            break;
+
+        uint32_t count = tud_cdc_n_read(itf, dst, len);
+        cdc_ring_produce(&cd->recv_ring, count);
     }
 }
 
@@ -204,26 +712,38 @@ static void usb_read_bytes(uint8_t itf)
 /**
  * @brief Writes bytes to a USB interface from a buffer.
  *
- * This function writes bytes to a specified USB interface from a buffer.
- * If there are bytes in the buffer, it writes as many bytes as possible to the interface.
- * If not all bytes could be written, it moves the remaining bytes to the beginning of the buffer.
- * After writing, it updates the buffer's current position accordingly.
- * Finally, it flushes the write buffer to ensure all data is sent.
+ * This function writes bytes to a specified USB interface straight from the interface's transmit ring.
+ * It hands the contiguous stored region to TinyUSB, and once more the part at the start of the buffer
+ * when the data wraps around. Bytes TinyUSB does not take stay in the ring for the next call.
+ * With CDC_OVERFLOW_DROP_OLDEST this happens under the interface's lock, since the producer may discard bytes too.
+ * Finally, it flushes the write buffer to ensure all data is sent and records how much TinyUSB still holds for cdc_flush().
  *
  * @param itf The USB interface to which to write bytes.
  */
 static void usb_write_bytes(uint8_t itf)
 {
     cdc_data_t *cd = &CDC_DATA[itf];
-    
-    if (cd->write_pos>0)
+    bool locked = cd->policy == CDC_OVERFLOW_DROP_OLDEST;
+
+    if (locked)
+        critical_section_enter_blocking(&cd->write_lock);
+
+    for (int chunk = 0; chunk < 2; chunk++)
     {
-        uint32_t count;
-        count = tud_cdc_n_write(itf, cd->write_buffer, cd->write_pos);
-        if (count < cd->write_pos)
-            memmove(cd->write_buffer, &cd->write_buffer[count], cd->write_pos - count);
-        cd->write_pos -= count;
+        uint32_t len;
+        uint8_t *src = cdc_ring_read_region(&cd->write_ring, &len);
+        if (len == 0)
+            break;
+
+        uint32_t count = tud_cdc_n_write(itf, src, len);
+        cdc_ring_consume(&cd->write_ring, count);
+        if (count < len)
+            break;
     }
 
+    if (locked)
+        critical_section_exit(&cd->write_lock);
+
     tud_cdc_n_write_flush(itf);
+    cd->tx_pending = CFG_TUD_CDC_TX_BUFSIZE - tud_cdc_n_write_available(itf);
 }
@@ -4,6 +4,7 @@
  *
  * The functions declared in this file allow for initializing the CDC interfaces, handling the tasks related to the CDC interfaces,
  * writing to the CDC interfaces' buffers, checking the number of bytes available in the CDC interfaces' buffers, and reading from the CDC interfaces' buffers.
+ * Received and transmitted data can also be accessed in place, without copying through a caller buffer.
  *
  * This file is part of the usb_dual_cdc_lib.
  */
@@ -18,18 +19,88 @@
  */
 void cdc_init();
 
+/**
+ * @brief Initializes the CDC interfaces and runs the USB stack and data pumping on core 1.
+ *
+ * Use instead of cdc_init(). The application on core 0 then only talks to the lock-free buffers,
+ * and cdc_task() does nothing.
+ */
+void cdc_init_core1();
+
 /**
  * @brief Handles the tasks related to the CDC interfaces for USB communication.
+ * Must be called periodically unless cdc_init_core1() was used.
  */
 void cdc_task();
 
+/**
+ * @brief What cdc_write_buf() does when the data does not fit into the transmit buffer.
+ */
+typedef enum {
+    CDC_OVERFLOW_DROP = 0,    // drop the whole write (default)
+    CDC_OVERFLOW_PARTIAL,     // queue what fits, drop the rest
+    CDC_OVERFLOW_DROP_OLDEST, // discard the oldest queued bytes to make room
+    CDC_OVERFLOW_BLOCK,       // wait for room up to a timeout while keeping USB serviced, then drop the rest
+} cdc_overflow_policy_t;
+
+/**
+ * @brief Transmit counters of a CDC interface.
+ */
+typedef struct {
+    uint32_t written;    // bytes queued for the host
+    uint32_t dropped;    // bytes lost to overflow, a closed interface or CDC_OVERFLOW_DROP_OLDEST
+    uint32_t blocked_us; // time spent waiting in CDC_OVERFLOW_BLOCK and cdc_flush()
+    uint32_t flushes;
+} cdc_stats_t;
+
 /**
  * @brief Writes a specified number of bytes from a provided data array to a specified CDC interface's buffer.
+ * What happens when the data does not fit depends on the interface's overflow policy, see cdc_set_overflow_policy().
  * @param itf The CDC interface to write to.
  * @param data The array of bytes to write.
  * @param len The number of bytes to write.
+ * @return The number of bytes of data that were queued.
  */
-void cdc_write_buf(uint8_t itf, uint8_t *data, uint32_t len);
+uint32_t cdc_write_buf(uint8_t itf, uint8_t *data, uint32_t len);
+
+/**
+ * @brief Selects what cdc_write_buf() does with a specified CDC interface when its transmit buffer is full.
+ * Set it before data flows on the interface.
+ * @param itf The CDC interface.
+ * @param policy The overflow policy.
+ * @param timeout_us Longest wait of one cdc_write_buf() call, only used by CDC_OVERFLOW_BLOCK.
+ */
+void cdc_set_overflow_policy(uint8_t itf, cdc_overflow_policy_t policy, uint32_t timeout_us);
+
+/**
+ * @brief Waits until everything written to a specified CDC interface has been handed to the USB controller.
+ * @param itf The CDC interface to flush.
+ * @param timeout_us Longest time to wait.
+ * @return True if the interface was drained, false on timeout or when the host is not connected.
+ */
+bool cdc_flush(uint8_t itf, uint32_t timeout_us);
+
+/**
+ * @brief Moves what fits of the transmit ring of a specified CDC interface to TinyUSB and starts sending, returns right away.
+ *
+ * Does not drain the interface, cdc_flush() does. Only acts when the USB service runs on this core (cdc_task())
+ * and outside of interrupt handlers and the service itself, otherwise the next service pass sends the data.
+ * @param itf The CDC interface to flush.
+ */
+void cdc_write_flush(uint8_t itf);
+
+/**
+ * @brief Copies the transmit counters of a specified CDC interface.
+ * @param itf The CDC interface.
+ * @param stats Receives the counters.
+ */
+void cdc_get_stats(uint8_t itf, cdc_stats_t *stats);
+
+/**
+ * @brief Clears the transmit counters of a specified CDC interface.
+ * @param itf The CDC interface.
+ */
+void cdc_reset_stats(uint8_t itf);
 
 /**
  * @brief Checks the number of bytes that have been read from a specified CDC interface and are available in the buffer.
@@ -47,4 +118,66 @@ uint32_t cdc_available_bytes(uint8_t itf);
  */
 uint32_t cdc_read_buf(uint8_t itf, uint8_t *data, uint32_t len);
 
+/**
+ * @brief Gives direct access to the received bytes of a specified CDC interface without copying them.
+ * @param itf The CDC interface to read from.
+ * @param data Set to the first received byte.
+ * @param len Set to the number of contiguous bytes at data, 0 if there are none.
+ */
+void cdc_peek(uint8_t itf, uint8_t **data, uint32_t *len);
+
+/**
+ * @brief Releases bytes handed out by cdc_peek().
+ * @param itf The CDC interface to release bytes of.
+ * @param n The number of bytes that have been processed, at most the len returned by cdc_peek().
+ */
+void cdc_consume(uint8_t itf, uint32_t n);
+
+/**
+ * @brief Reserves contiguous room in a specified CDC interface's transmit buffer to serialize into.
+ * @param itf The CDC interface to write to.
+ * @param n The number of bytes needed.
+ * @return Pointer to the reserved room, or NULL if n contiguous bytes are not free.
+ */
+uint8_t *cdc_reserve(uint8_t itf, uint32_t n);
+
+/**
+ * @brief Queues bytes written into the room returned by cdc_reserve() for transmission.
+ * @param itf The CDC interface to write to.
+ * @param n The number of bytes written, at most the n passed to cdc_reserve().
+ */
+void cdc_commit(uint8_t itf, uint32_t n);
+
+/**
+ * @brief Callback type for data events of a CDC interface.
+ * @param itf The CDC interface the event belongs to.
+ * @param param The pointer given when the callback was registered.
+ */
+typedef void (*cdc_event_callback_t)(uint8_t itf, void *param);
+
+/**
+ * @brief Registers a callback that runs whenever new bytes from the host were stored in a CDC interface's buffer.
+ * The callback runs inside the USB task (core 1 when cdc_init_core1() was used) and must be short. NULL removes it.
+ * @param itf The CDC interface to watch.
+ * @param fn The callback.
+ * @param param Passed to the callback.
+ */
+void cdc_set_rx_callback(uint8_t itf, cdc_event_callback_t fn, void *param);
+
+/**
+ * @brief Registers a callback that runs whenever the host has taken a packet from a CDC interface.
+ * Same context rules as cdc_set_rx_callback().
+ * @param itf The CDC interface to watch.
+ * @param fn The callback.
+ * @param param Passed to the callback.
+ */
+void cdc_set_tx_callback(uint8_t itf, cdc_event_callback_t fn, void *param);
+
+/**
+ * @brief Sleeps with __wfe() until any CDC interface has received bytes, keeping USB serviced meanwhile.
+ * @param timeout_us Longest time to wait.
+ * @return True if data is available, false on timeout.
+ */
+bool cdc_wait(uint32_t timeout_us);
+
 #endif
\ No newline at end of file
@@ -19,10 +19,10 @@ void cdc_out_func(const char *buf, int len)
     cdc_write_buf(CDC_STDIO_ITF, (uint8_t *)buf, len);
 }
 
-// Function to flush the output buffer of the CDC interface
+// Function to flush the output buffer of the CDC interface. The stdio layer calls it after every printf,
+// so it does not wait; cdc_flush(CDC_STDIO_ITF, ...) waits until the host has the data
 void cdc_out_flush(void) {
-    // Currently, this function does nothing
-    return;
+    cdc_write_flush(CDC_STDIO_ITF);
 }
 
 // Function to read characters from the CDC interface
@@ -31,10 +31,21 @@ int cdc_in_chars(char *buf, int len) {
     return cdc_read_buf(CDC_STDIO_ITF, buf, len);
 }
 
+// Callback of the stdio layer, called whenever characters arrived on the stdio interface
+static void (*chars_available_fn)(void*);
+static void *chars_available_param;
+
+static void cdc_stdio_rx(uint8_t itf, void *param) {
+    if (chars_available_fn)
+        chars_available_fn(chars_available_param);
+}
+
 // Function to set a callback function for when characters are available
 void cdc_set_chars_available_callback(void (*fn)(void*), void *param) {
-    // Currently, this function does nothing
-    return;
+    chars_available_param = param;
+    chars_available_fn = fn;
+    // Hook it to the receive callback of the CDC interface
+    cdc_set_rx_callback(CDC_STDIO_ITF, fn ? cdc_stdio_rx : NULL, NULL);
 }
 
 // Define the stdio driver for the CDC interface
@@ -50,6 +61,8 @@ stdio_driver_t usb_stdio_cdc = {
 
 // Function to initialize the CDC interface for stdio
 void usb_stdio_cdc_init(void) {
+    // Log output waits for the host instead of being dropped in bursts
+    cdc_set_overflow_policy(CDC_STDIO_ITF, CDC_OVERFLOW_BLOCK, USB_STDIO_CDC_TIMEOUT_US);
     // Enable the stdio driver for the CDC interface
     stdio_set_driver_enabled(&usb_stdio_cdc, true);
     // Filter the stdio driver for the CDC interface
@@ -2,8 +2,9 @@
  * @file usb_stdio_cdc.h
  * @brief This file contains the declaration of the function for initializing a CDC interface for standard input/output (stdio).
  *
- * The CDC_STDIO_ITF macro defines which CDC interface to use for stdio. It can be 0 or 1.
+ * The CDC_STDIO_ITF macro defines which CDC interface to use for stdio. It can be any interface of USB_CDC_INTERFACES.
  * The usb_stdio_cdc_init function is declared, which is used to initialize this interface.
+ * It selects CDC_OVERFLOW_BLOCK for the interface, use cdc_set_overflow_policy() afterwards for another policy.
  *
  * This file is part of the usb_dual_cdc_lib.
  */
@@ -11,7 +12,18 @@
 #ifndef __USB_STDIO_CDC_H__
 #define __USB_STDIO_CDC_H__ 1
 
-#define CDC_STDIO_ITF 0 // which CDC interface to use for stdio, can be 0 or 1
+#define CDC_STDIO_ITF 0 // which CDC interface to use for stdio, one of USB_CDC_INTERFACES
+
+// stdio output waits for the host instead of dropping, one write gives up after this long
+#ifndef USB_STDIO_CDC_TIMEOUT_US
+#define USB_STDIO_CDC_TIMEOUT_US 50000
+#endif
+
+// stdio_flush() does not wait for the host and does not drain: it only moves what fits of the ring into TinyUSB
+// (cdc_write_flush()). cdc_flush(CDC_STDIO_ITF, USB_STDIO_CDC_FLUSH_TIMEOUT_US) is the draining call
+#ifndef USB_STDIO_CDC_FLUSH_TIMEOUT_US
+#define USB_STDIO_CDC_FLUSH_TIMEOUT_US 100000
+#endif
 
 void usb_stdio_cdc_init(void);
 